@@ -25,6 +25,12 @@ struct gr_api_response {
 
 #define GR_API_MAX_MSG_LEN (128 * 1024)
 
+// List responses are split in chunks that fit in GR_API_MAX_MSG_LEN. List requests have
+// a "cursor" field that must be zero to get the first chunk. List responses have a "next"
+// field. When it is not zero, the same request must be sent again with "cursor" set to this
+// value to get the next chunk.
+#define GR_API_LIST_MAX(item_type) ((GR_API_MAX_MSG_LEN - 64) / sizeof(item_type))
+
 #define REQUEST_TYPE(module, id) (((uint32_t)(0xffff & module) << 16) | (0xffff & id))
 #define PAYLOAD(header) ((void *)(header + 1))
 
@@ -79,4 +79,67 @@ static inline int ip4_net_format(const struct ip4_net *net, char *buf, size_t le
 	return snprintf(buf + n, len - n, "/%u", net->prefixlen);
 }
 
+// Loose syntax checks, addresses are validated by inet_pton().
+#define __IPV6_RE "[[:xdigit:]]*:[[:xdigit:]:.]+"
+#define IPV6_RE "^" __IPV6_RE "$"
+#define IPV6_NET_RE "^" __IPV6_RE "/(12[0-8]|1[01][0-9]|[1-9][0-9]|[0-9])$"
+
+struct ip6_net {
+	struct in6_addr ip;
+	uint8_t prefixlen;
+};
+
+static inline bool
+ip6_addr_same_subnet(const struct in6_addr *a, const struct in6_addr *b, uint8_t prefixlen) {
+	uint8_t bytes = prefixlen / 8, bits = prefixlen % 8;
+
+	if (memcmp(a, b, bytes) != 0)
+		return false;
+	if (bits == 0)
+		return true;
+
+	return ((a->s6_addr[bytes] ^ b->s6_addr[bytes]) & (0xff << (8 - bits))) == 0;
+}
+
+static inline int ip6_net_parse(const char *s, struct ip6_net *net, bool zero_mask) {
+	char *addr = NULL;
+	int ret = -1;
+
+	if (sscanf(s, "%m[0-9a-fA-F:.]/%hhu%*c", &addr, &net->prefixlen) != 2) {
+		errno = EINVAL;
+		goto out;
+	}
+	if (net->prefixlen > 128) {
+		errno = EINVAL;
+		goto out;
+	}
+	if (inet_pton(AF_INET6, addr, &net->ip) != 1) {
+		errno = EINVAL;
+		goto out;
+	}
+	if (zero_mask) {
+		// mask non network bits to zero
+		for (unsigned i = 0; i < sizeof(net->ip); i++) {
+			if (net->prefixlen <= i * 8)
+				net->ip.s6_addr[i] = 0;
+			else if (net->prefixlen < (i + 1) * 8)
+				net->ip.s6_addr[i] &= 0xff << ((i + 1) * 8 - net->prefixlen);
+		}
+	}
+	ret = 0;
+out:
+	free(addr);
+	return ret;
+}
+
+static inline int ip6_net_format(const struct ip6_net *net, char *buf, size_t len) {
+	const char *tmp;
+	int n;
+
+	if ((tmp = inet_ntop(AF_INET6, &net->ip, buf, len)) == NULL)
+		return -1;
+	n = strlen(tmp);
+	return snprintf(buf + n, len - n, "/%u", net->prefixlen);
+}
+
 #endif
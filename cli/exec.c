@@ -48,11 +48,41 @@ static cmd_cb_t *find_cmd_callback(struct ec_pnode *parsed) {
 	return NULL;
 }
 
+static bool batch_enabled;
+static cmd_cb_t *batch_cb;
+static cmd_flush_cb_t *batch_flush;
+
+void exec_batch_enable(bool enabled) {
+	batch_enabled = enabled;
+}
+
+bool cli_batch_enabled(void) {
+	return batch_enabled;
+}
+
+void cli_batch_defer(cmd_cb_t *cb, cmd_flush_cb_t *flush) {
+	batch_cb = cb;
+	batch_flush = flush;
+}
+
+exec_status_t exec_flush(const struct gr_api_client *client) {
+	cmd_flush_cb_t *flush = batch_flush;
+
+	batch_cb = NULL;
+	batch_flush = NULL;
+
+	if (flush != NULL && flush(client) != CMD_SUCCESS)
+		return EXEC_BATCH_FAILED;
+
+	return EXEC_SUCCESS;
+}
+
 static exec_status_t exec_strvec(
 	const struct gr_api_client *client,
 	const struct ec_node *cmdlist,
 	const struct ec_strvec *vec
 ) {
+	exec_status_t flush_status = EXEC_SUCCESS;
 	struct ec_pnode *parsed = NULL;
 	exec_status_t status;
 	cmd_cb_t *cb;
@@ -69,9 +99,12 @@ static exec_status_t exec_strvec(
 		status = EXEC_CB_UNDEFINED;
 		goto out;
 	}
+	// queued requests must be sent before executing any other command
+	if (batch_cb != NULL && batch_cb != cb)
+		flush_status = exec_flush(client);
 	switch (cb(client, parsed)) {
 	case CMD_SUCCESS:
-		status = EXEC_SUCCESS;
+		status = flush_status;
 		break;
 	case CMD_EXIT:
 		status = EXEC_CMD_EXIT;
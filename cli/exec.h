@@ -8,6 +8,8 @@
 
 #include <ecoli.h>
 
+#include <stdbool.h>
+
 struct ec_node *init_commands(void);
 
 typedef enum {
@@ -18,6 +20,7 @@ typedef enum {
 	EXEC_CMD_INVALID_ARGS, // command not recognized
 	EXEC_CMD_FAILED, // command callback returned an error
 	EXEC_CB_UNDEFINED, // no callback registered, internal error
+	EXEC_BATCH_FAILED, // some of the previously queued commands failed
 	EXEC_OTHER_ERROR, // other internal error
 } exec_status_t;
 
@@ -32,4 +35,8 @@ exec_status_t exec_args(
 	const char *const *argv
 );
 
+void exec_batch_enable(bool enabled);
+
+exec_status_t exec_flush(const struct gr_api_client *);
+
 #endif
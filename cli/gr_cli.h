@@ -10,6 +10,7 @@
 #include <ecoli.h>
 #include <rte_ether.h>
 
+#include <stdbool.h>
 #include <sys/queue.h>
 
 typedef int(gr_cli_ctx_init_t)(struct ec_node *root);
@@ -32,6 +33,15 @@ typedef enum {
 
 typedef cmd_status_t(cmd_cb_t)(const struct gr_api_client *, const struct ec_pnode *);
 
+typedef cmd_status_t(cmd_flush_cb_t)(const struct gr_api_client *);
+
+// When grcli reads commands from stdin, commands may queue their API requests and send them in
+// bulk. cli_batch_enabled() tells if this is allowed. Once a request is queued, the command must
+// call cli_batch_defer(). The flush callback is invoked before executing a command that has
+// a different callback and at the end of input.
+bool cli_batch_enabled(void);
+void cli_batch_defer(cmd_cb_t *cb, cmd_flush_cb_t *flush);
+
 struct ec_node *with_help(const char *help, struct ec_node *node);
 
 struct ec_node *with_callback(cmd_cb_t *cb, struct ec_node *node);
@@ -56,6 +66,14 @@ static inline int arg_u16(const struct ec_pnode *p, const char *id, uint16_t *va
 	return ret;
 }
 
+static inline int arg_u32(const struct ec_pnode *p, const char *id, uint32_t *val) {
+	uint64_t v;
+	int ret = arg_u64(p, id, &v);
+	if (ret == 0)
+		*val = v;
+	return ret;
+}
+
 #define CTX_END                                                                                    \
 	&(const struct ctx_arg) {                                                                  \
 		.name = NULL                                                                       \
@@ -5,8 +5,13 @@
 #define _GR_TABLE
 
 struct libscols_line;
+struct libscols_table;
 
 int scols_line_sprintf(struct libscols_line *, int column, const char *fmt, ...)
 	__attribute__((format(printf, 3, 4)));
 
+// Print and remove all lines of a table that is filled in multiple chunks.
+// Column headers are only printed with the first chunk.
+int scols_print_chunk(struct libscols_table *);
+
 #endif
@@ -66,6 +66,9 @@ int print_cmd_status(exec_status_t status) {
 	case EXEC_CB_UNDEFINED:
 		errorf("no callback defined for command");
 		break;
+	case EXEC_BATCH_FAILED:
+		errorf("some queued commands failed");
+		break;
 	case EXEC_OTHER_ERROR:
 		errorf("fatal: %s", strerror(errno));
 		break;
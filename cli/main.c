@@ -149,14 +149,21 @@ int main(int argc, char **argv) {
 		if (interact(client, cmdlist) < 0)
 			goto end;
 	} else {
+		bool failed = false;
 		char buf[BUFSIZ];
-		while (fgets(buf, sizeof(buf), stdin)) {
+		exec_batch_enable(true);
+		while (!failed && fgets(buf, sizeof(buf), stdin)) {
 			if (opts.trace_commands)
 				trace_cmd(buf);
 			status = exec_line(client, cmdlist, buf);
 			if (print_cmd_status(status) < 0 && opts.err_exit)
-				goto end;
+				failed = true;
 		}
+		// send queued requests, even after an error
+		if (print_cmd_status(exec_flush(client)) < 0 && opts.err_exit)
+			failed = true;
+		if (failed)
+			goto end;
 	}
 
 	ret = EXIT_SUCCESS;
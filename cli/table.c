@@ -21,3 +21,10 @@ int scols_line_sprintf(struct libscols_line *line, int column, const char *fmt,
 
 	return scols_line_set_data(line, column, buf);
 }
+
+int scols_print_chunk(struct libscols_table *table) {
+	int ret = scols_print_table(table);
+	scols_table_remove_lines(table);
+	scols_table_enable_noheadings(table, 1);
+	return ret;
+}
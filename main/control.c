@@ -118,3 +118,12 @@ void gr_modules_dp_fini(void) {
 		}
 	}
 }
+
+void gr_modules_dp_tick(void) {
+	struct gr_module *mod;
+
+	STAILQ_FOREACH (mod, &modules, entries) {
+		if (mod->tick_dp != NULL)
+			mod->tick_dp();
+	}
+}
@@ -5,12 +5,18 @@
 #define _GR
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#define GR_DEFAULT_MAX_ROUTES (1 << 16)
+#define GR_DEFAULT_MAX_NEXTHOPS (1 << 16)
 
 struct gr_args {
 	const char *api_sock_path;
 	unsigned log_level;
 	bool test_mode;
 	bool poll_mode;
+	uint32_t max_routes;
+	uint32_t max_nexthops;
 };
 
 const struct gr_args *gr_args(void);
@@ -38,6 +38,8 @@ struct gr_module {
 	void (*fini)(struct event_base *);
 	void (*init_dp)(void);
 	void (*fini_dp)(void);
+	// Periodic housekeeping, called from every datapath worker loop.
+	void (*tick_dp)(void);
 	STAILQ_ENTRY(gr_module) entries;
 };
 
@@ -47,4 +49,6 @@ void gr_modules_dp_init(void);
 
 void gr_modules_dp_fini(void);
 
+void gr_modules_dp_tick(void);
+
 #endif
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_TIMER_WHEEL
+#define _GR_TIMER_WHEEL
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/queue.h>
+
+// Hierarchical timer wheel for the control plane. Time is expressed in ticks, the caller decides
+// of the tick duration and advances the wheel. Adding, removing and expiring a timer are O(1).
+// Timers are moved to lower levels at most once per level.
+//
+// This is not thread safe. All functions must be called from the same thread.
+
+#define GR_TIMER_WHEEL_LEVELS 4
+#define GR_TIMER_WHEEL_SLOT_BITS 6
+#define GR_TIMER_WHEEL_SLOTS (1 << GR_TIMER_WHEEL_SLOT_BITS)
+// Longer delays are clamped to this value.
+#define GR_TIMER_WHEEL_MAX_TICKS                                                                   \
+	((UINT64_C(1) << (GR_TIMER_WHEEL_LEVELS * GR_TIMER_WHEEL_SLOT_BITS)) - 1)
+
+struct gr_timer;
+
+typedef void (*gr_timer_cb_t)(struct gr_timer *);
+
+struct gr_timer {
+	LIST_ENTRY(gr_timer) next;
+	uint64_t expire;
+	gr_timer_cb_t cb;
+};
+
+struct gr_timer_wheel {
+	uint64_t now;
+	LIST_HEAD(, gr_timer) slots[GR_TIMER_WHEEL_LEVELS][GR_TIMER_WHEEL_SLOTS];
+};
+
+void gr_timer_wheel_init(struct gr_timer_wheel *, uint64_t now);
+
+// Expire all timers up to the given tick. Callbacks may add or remove timers.
+void gr_timer_wheel_run(struct gr_timer_wheel *, uint64_t now);
+
+// (Re)arm a timer to expire in the given number of ticks (at least one).
+void gr_timer_add(struct gr_timer_wheel *, struct gr_timer *, uint64_t ticks, gr_timer_cb_t);
+
+void gr_timer_del(struct gr_timer *);
+
+static inline bool gr_timer_pending(const struct gr_timer *t) {
+	return t->next.le_prev != NULL;
+}
+
+#endif
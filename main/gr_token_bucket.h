@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_TOKEN_BUCKET
+#define _GR_TOKEN_BUCKET
+
+#include <rte_jhash.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Simple token bucket rate limiter. Time is expressed in an arbitrary clock (usually TSC
+// cycles) with hz ticks per second. This is not thread safe.
+struct gr_token_bucket {
+	uint64_t tokens;
+	uint64_t last; // last refill time
+	uint32_t rate; // tokens per second, must not be zero
+	uint32_t burst; // bucket size
+};
+
+static inline void
+gr_token_bucket_init(struct gr_token_bucket *tb, uint32_t rate, uint32_t burst, uint64_t now) {
+	tb->rate = rate;
+	tb->burst = burst;
+	tb->tokens = burst;
+	tb->last = now;
+}
+
+// Consume one token. Returns false if the bucket is empty.
+static inline bool gr_token_bucket_take(struct gr_token_bucket *tb, uint64_t now, uint64_t hz) {
+	uint64_t elapsed = now - tb->last;
+	uint64_t refill;
+
+	refill = (elapsed / hz) * tb->rate + (elapsed % hz) * tb->rate / hz;
+	if (refill > 0) {
+		if (tb->tokens + refill >= tb->burst) {
+			tb->tokens = tb->burst;
+			tb->last = now;
+		} else {
+			tb->tokens += refill;
+			// keep the remainder for the next refill
+			tb->last += refill * hz / tb->rate;
+		}
+	}
+	if (tb->tokens == 0)
+		return false;
+
+	tb->tokens--;
+
+	return true;
+}
+
+// Same as gr_token_bucket_take() but first picks up rate and burst changes made by the
+// control plane. A bucket with a zero rate was never used and starts full.
+static inline bool gr_token_bucket_take_conf(
+	struct gr_token_bucket *tb,
+	uint32_t rate,
+	uint32_t burst,
+	uint64_t now,
+	uint64_t hz
+) {
+	if (tb->rate == 0) {
+		gr_token_bucket_init(tb, rate, burst, now);
+	} else {
+		tb->rate = rate;
+		tb->burst = burst;
+		if (tb->tokens > burst)
+			tb->tokens = burst;
+	}
+	return gr_token_bucket_take(tb, now, hz);
+}
+
+// Per source token buckets in a direct mapped table. Colliding keys evict each other and
+// start with a full bucket, callers should also bound the total with a global bucket.
+struct gr_token_bucket_src {
+	uint32_t key; // usually the masked source address
+	struct gr_token_bucket tb;
+};
+
+// Consume one token from the bucket of key. size must be a power of 2.
+static inline bool gr_token_bucket_src_take(
+	struct gr_token_bucket_src *table,
+	unsigned size,
+	uint32_t key,
+	uint32_t rate,
+	uint32_t burst,
+	uint64_t now,
+	uint64_t hz
+) {
+	struct gr_token_bucket_src *s = &table[rte_jhash_1word(key, 0) & (size - 1)];
+
+	if (s->key != key || s->tb.rate == 0) {
+		s->key = key;
+		gr_token_bucket_init(&s->tb, rate, burst, now);
+	}
+
+	return gr_token_bucket_take_conf(&s->tb, rate, burst, now, hz);
+}
+
+#endif
@@ -15,6 +15,7 @@
 #include <rte_log.h>
 #include <rte_mempool.h>
 
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <locale.h>
@@ -26,18 +27,23 @@
 #include <sys/epoll.h>
 #include <sys/signalfd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
 // Please keep options/flags in alphabetical order.
 
 static void usage(const char *prog) {
-	printf("Usage: %s [-h] [-p] [-s PATH] [-t] [-v] [-x]\n", prog);
+	printf("Usage: %s [-h] [-m NUM] [-n NUM] [-p] [-s PATH] [-t] [-v] [-x]\n", prog);
 	puts("");
 	printf("  Graph router version %s.\n", GROUT_VERSION);
 	puts("");
 	puts("options:");
 	puts("  -h, --help                 Display this help message and exit.");
+	puts("  -m NUM, --max-routes NUM   Maximum number of IP routes per FIB.");
+	printf("                             Default: %d.\n", GR_DEFAULT_MAX_ROUTES);
+	puts("  -n NUM, --max-nexthops NUM Maximum number of IP next hops.");
+	printf("                             Default: %d.\n", GR_DEFAULT_MAX_NEXTHOPS);
 	puts("  -p, --poll-mode            Disable automatic micro-sleep.");
 	puts("  -s PATH, --socket PATH     Path the control plane API socket.");
 	puts("                             Default: GROUT_SOCK_PATH from env or");
@@ -54,12 +60,28 @@ const struct gr_args *gr_args(void) {
 	return &args;
 }
 
+static int parse_uint32(const char *str, uint32_t *value) {
+	unsigned long v;
+	char *end;
+
+	errno = 0;
+	v = strtoul(str, &end, 0);
+	if (errno != 0 || *end != '\0' || end == str || v == 0 || v > UINT32_MAX)
+		return -1;
+
+	*value = v;
+
+	return 0;
+}
+
 static int parse_args(int argc, char **argv) {
 	int c;
 
-#define FLAGS ":hps:tvx"
+#define FLAGS ":hm:n:ps:tvx"
 	static struct option long_options[] = {
 		{"help", no_argument, NULL, 'h'},
+		{"max-routes", required_argument, NULL, 'm'},
+		{"max-nexthops", required_argument, NULL, 'n'},
 		{"poll-mode", no_argument, NULL, 'p'},
 		{"socket", required_argument, NULL, 's'},
 		{"test-mode", no_argument, NULL, 't'},
@@ -72,12 +94,26 @@ static int parse_args(int argc, char **argv) {
 
 	args.api_sock_path = getenv("GROUT_SOCK_PATH");
 	args.log_level = RTE_LOG_NOTICE;
+	args.max_routes = GR_DEFAULT_MAX_ROUTES;
+	args.max_nexthops = GR_DEFAULT_MAX_NEXTHOPS;
 
 	while ((c = getopt_long(argc, argv, FLAGS, long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			usage(argv[0]);
 			return -1;
+		case 'm':
+			if (parse_uint32(optarg, &args.max_routes) < 0) {
+				fprintf(stderr, "error: invalid max routes: %s", optarg);
+				return -1;
+			}
+			break;
+		case 'n':
+			if (parse_uint32(optarg, &args.max_nexthops) < 0) {
+				fprintf(stderr, "error: invalid max next hops: %s", optarg);
+				return -1;
+			}
+			break;
 		case 'p':
 			args.poll_mode = true;
 			break;
@@ -122,35 +158,135 @@ static void finalize_close_fd(struct event *ev, void *priv) {
 	close(event_get_fd(ev));
 }
 
-static ssize_t send_response(evutil_socket_t sock, struct gr_api_response *resp) {
-	if (resp == NULL) {
-		errno = ENOMEM;
-		return -1;
+// The response payload returned by API handlers is sent as is, without copying it.
+struct api_reply {
+	struct gr_api_response hdr;
+	void *payload;
+	size_t sent;
+};
+
+static void api_reply_free(struct api_reply *r) {
+	if (r == NULL)
+		return;
+	free(r->payload);
+	free(r);
+}
+
+// Returns 0 when the whole reply was sent. Returns -1 with errno set to EAGAIN when the
+// socket buffer is full, the remaining bytes must be sent when the socket is writable.
+static int send_reply(evutil_socket_t sock, struct api_reply *r) {
+	size_t total = sizeof(r->hdr) + r->hdr.payload_len;
+	struct iovec iov[2];
+	struct msghdr msg = {.msg_iov = iov};
+	size_t off;
+	ssize_t n;
+
+	if (r->sent == 0)
+		LOG(DEBUG,
+		    "for_id=%u len=%u status=%u %s",
+		    r->hdr.for_id,
+		    r->hdr.payload_len,
+		    r->hdr.status,
+		    strerror(r->hdr.status));
+
+	while (r->sent < total) {
+		if (r->sent < sizeof(r->hdr)) {
+			iov[0].iov_base = (char *)&r->hdr + r->sent;
+			iov[0].iov_len = sizeof(r->hdr) - r->sent;
+			iov[1].iov_base = r->payload;
+			iov[1].iov_len = r->hdr.payload_len;
+			msg.msg_iovlen = r->hdr.payload_len > 0 ? 2 : 1;
+		} else {
+			off = r->sent - sizeof(r->hdr);
+			iov[0].iov_base = (char *)r->payload + off;
+			iov[0].iov_len = r->hdr.payload_len - off;
+			msg.msg_iovlen = 1;
+		}
+		if ((n = sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL)) < 0)
+			return -1;
+		r->sent += n;
 	}
 
-	LOG(DEBUG,
-	    "for_id=%u len=%u status=%u %s",
-	    resp->for_id,
-	    resp->payload_len,
-	    resp->status,
-	    strerror(resp->status));
-
-	size_t len = sizeof(*resp) + resp->payload_len;
-	return send(sock, resp, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	return 0;
 }
 
 static struct event_base *ev_base;
 
+// Request being received on an API connection. Large requests may be split across multiple
+// socket reads. They are received incrementally from the read callback so that a slow client
+// does not block the event loop.
+struct api_conn {
+	struct gr_api_request req;
+	void *payload;
+	size_t received; // header and payload bytes
+};
+
+static void api_conn_reset(struct api_conn *conn) {
+	free(conn->payload);
+	conn->payload = NULL;
+	conn->received = 0;
+}
+
+static void finalize_api_conn(struct event *ev, void *priv) {
+	struct api_conn *conn = priv;
+	api_conn_reset(conn);
+	free(conn);
+	close(event_get_fd(ev));
+}
+
+// Returns 1 when the whole request has been received and 0 when the client disconnected.
+// Returns -1 with errno set on error. EAGAIN means that the rest of the request has not
+// arrived yet, the next call resumes where this one stopped.
+static int recv_request(evutil_socket_t sock, struct api_conn *conn) {
+	size_t total;
+	ssize_t n;
+
+	while (conn->received < sizeof(conn->req)) {
+		n = recv(sock,
+			 (char *)&conn->req + conn->received,
+			 sizeof(conn->req) - conn->received,
+			 MSG_DONTWAIT);
+		if (n <= 0)
+			return n;
+		conn->received += n;
+	}
+
+	if (conn->req.payload_len > GR_API_MAX_MSG_LEN) {
+		LOG(ERR, "request payload too large: %u bytes", conn->req.payload_len);
+		errno = EMSGSIZE;
+		return -1;
+	}
+	if (conn->req.payload_len > 0 && conn->payload == NULL) {
+		if ((conn->payload = malloc(conn->req.payload_len)) == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	total = sizeof(conn->req) + conn->req.payload_len;
+	while (conn->received < total) {
+		n = recv(sock,
+			 (char *)conn->payload + conn->received - sizeof(conn->req),
+			 total - conn->received,
+			 MSG_DONTWAIT);
+		if (n <= 0)
+			return n;
+		conn->received += n;
+	}
+
+	return 1;
+}
+
 static void api_write_cb(evutil_socket_t sock, short what, void *priv) {
 	struct event *ev = event_base_get_running_event(ev_base);
-	struct gr_api_response *resp = priv;
+	struct api_reply *reply = priv;
 
 	(void)what;
 
-	if (send_response(sock, resp) < 0) {
+	if (send_reply(sock, reply) < 0) {
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
 			goto retry;
-		LOG(ERR, "send_response: %s", strerror(errno));
+		LOG(ERR, "send_reply: %s", strerror(errno));
 	}
 	goto free;
 
@@ -162,52 +298,36 @@ retry:
 	return;
 
 free:
-	free(resp);
+	api_reply_free(reply);
 	if (ev != NULL)
 		event_free(ev);
 }
 
-static void api_read_cb(evutil_socket_t sock, short what, void *ctx) {
+static void api_read_cb(evutil_socket_t sock, short what, void *priv) {
 	struct event *ev = event_base_get_running_event(ev_base);
-	void *req_payload = NULL, *resp_payload = NULL;
-	struct gr_api_response *resp = NULL;
-	struct gr_api_request req;
+	struct api_conn *conn = priv;
+	struct gr_api_request *req = &conn->req;
+	struct api_reply *reply = NULL;
+	void *resp_payload = NULL;
 	struct event *write_ev;
 	struct api_out out;
-	ssize_t len;
-
-	(void)ctx;
+	int ret;
 
 	if (what & EV_CLOSED)
 		goto close;
 
-	if ((len = recv(sock, &req, sizeof(req), MSG_DONTWAIT)) < 0) {
+	if ((ret = recv_request(sock, conn)) < 0) {
 		if (errno == EAGAIN || errno == EWOULDBLOCK) {
 			return;
 		}
 		LOG(ERR, "recv: %s", strerror(errno));
 		goto close;
-	} else if (len == 0) {
+	} else if (ret == 0) {
 		LOG(DEBUG, "client disconnected");
 		goto close;
 	}
 
-	if (req.payload_len > 0) {
-		req_payload = malloc(req.payload_len);
-		if (req_payload == NULL) {
-			LOG(ERR, "cannot allocate %u bytes for request payload", req.payload_len);
-			goto close;
-		}
-		if ((len = recv(sock, req_payload, req.payload_len, MSG_DONTWAIT)) < 0) {
-			LOG(ERR, "recv: %s", strerror(errno));
-			goto close;
-		} else if (len == 0) {
-			LOG(DEBUG, "client disconnected");
-			goto close;
-		}
-	}
-
-	const struct gr_api_handler *handler = lookup_api_handler(&req);
+	const struct gr_api_handler *handler = lookup_api_handler(req);
 	if (handler == NULL) {
 		out.status = ENOTSUP;
 		out.len = 0;
@@ -216,56 +336,57 @@ static void api_read_cb(evutil_socket_t sock, short what, void *ctx) {
 
 	LOG(DEBUG,
 	    "request: id=%u type=0x%08x '%s' len=%u",
-	    req.id,
-	    req.type,
+	    req->id,
+	    req->type,
 	    handler->name,
-	    req.payload_len);
+	    req->payload_len);
 
-	out = handler->callback(req_payload, &resp_payload);
+	out = handler->callback(conn->payload, &resp_payload);
 
 send:
-	resp = malloc(sizeof(*resp) + out.len);
-	if (resp == NULL) {
-		LOG(ERR, "cannot allocate %zu bytes for response payload", sizeof(*resp) + out.len);
+	if ((reply = calloc(1, sizeof(*reply))) == NULL) {
+		LOG(ERR, "cannot allocate response");
+		free(resp_payload);
 		goto close;
 	}
-	resp->for_id = req.id;
-	resp->status = out.status;
-	resp->payload_len = out.len;
+	reply->hdr.for_id = req->id;
+	reply->hdr.status = out.status;
 	if (resp_payload != NULL && out.len > 0) {
-		memcpy(PAYLOAD(resp), resp_payload, out.len);
+		reply->hdr.payload_len = out.len;
+		reply->payload = resp_payload;
+	} else {
 		free(resp_payload);
-		resp_payload = NULL;
 	}
-	if (send_response(sock, resp) < 0) {
+	resp_payload = NULL;
+	if (send_reply(sock, reply) < 0) {
 		if (errno == EAGAIN || errno == EWOULDBLOCK)
 			goto retry_send;
 		LOG(ERR, "send: %s", strerror(errno));
 		goto close;
 	}
-	free(req_payload);
-	free(resp);
+	api_conn_reset(conn);
+	api_reply_free(reply);
 	return;
 
 retry_send:
-	write_ev = event_new(ev_base, sock, EV_WRITE | EV_FINALIZE, api_write_cb, resp);
+	write_ev = event_new(ev_base, sock, EV_WRITE | EV_FINALIZE, api_write_cb, reply);
 	if (write_ev == NULL || event_add(write_ev, NULL) < 0) {
 		LOG(ERR, "failed to add event to loop");
 		if (write_ev != NULL)
 			event_free(write_ev);
 		goto close;
 	}
-	free(req_payload);
+	api_conn_reset(conn);
 	return;
 
 close:
-	free(req_payload);
-	free(resp);
+	api_reply_free(reply);
 	if (ev != NULL)
-		event_free_finalize(0, ev, finalize_close_fd);
+		event_free_finalize(0, ev, finalize_api_conn);
 }
 
 static void listen_cb(evutil_socket_t sock, short what, void *ctx) {
+	struct api_conn *conn;
 	struct event *ev;
 	int fd;
 
@@ -286,13 +407,20 @@ static void listen_cb(evutil_socket_t sock, short what, void *ctx) {
 
 	LOG(DEBUG, "new connection");
 
+	if ((conn = calloc(1, sizeof(*conn))) == NULL) {
+		LOG(ERR, "cannot allocate connection");
+		close(fd);
+		return;
+	}
+
 	ev = event_new(
-		ev_base, fd, EV_READ | EV_CLOSED | EV_PERSIST | EV_FINALIZE, api_read_cb, NULL
+		ev_base, fd, EV_READ | EV_CLOSED | EV_PERSIST | EV_FINALIZE, api_read_cb, conn
 	);
 	if (ev == NULL || event_add(ev, NULL) < 0) {
 		LOG(ERR, "failed to add event to loop");
 		if (ev != NULL)
 			event_free(ev);
+		free(conn);
 		close(fd);
 	}
 }
@@ -348,7 +476,9 @@ static int listen_api_socket(void) {
 
 static int ev_close(const struct event_base *, const struct event *ev, void *) {
 	event_callback_fn cb = event_get_callback(ev);
-	if (cb == api_read_cb || cb == api_write_cb)
+	if (cb == api_read_cb)
+		event_free_finalize(0, (struct event *)ev, finalize_api_conn);
+	else if (cb == api_write_cb)
 		event_free_finalize(0, (struct event *)ev, finalize_close_fd);
 	return 0;
 }
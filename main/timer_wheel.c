@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_timer_wheel.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/queue.h>
+
+#define SLOT_MASK (GR_TIMER_WHEEL_SLOTS - 1)
+
+static inline unsigned slot_index(uint64_t tick, unsigned level) {
+	return (tick >> (level * GR_TIMER_WHEEL_SLOT_BITS)) & SLOT_MASK;
+}
+
+static void timer_insert(struct gr_timer_wheel *w, struct gr_timer *t) {
+	uint64_t delta = t->expire - w->now;
+	unsigned level;
+
+	// Find the lowest level whose range covers the delay. Expired timers go in the current
+	// slot of the first level.
+	if (t->expire < w->now)
+		delta = 0;
+	for (level = 0; level < GR_TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < (UINT64_C(1) << ((level + 1) * GR_TIMER_WHEEL_SLOT_BITS)))
+			break;
+	}
+
+	LIST_INSERT_HEAD(&w->slots[level][slot_index(t->expire, level)], t, next);
+}
+
+void gr_timer_wheel_init(struct gr_timer_wheel *w, uint64_t now) {
+	w->now = now;
+	for (unsigned l = 0; l < GR_TIMER_WHEEL_LEVELS; l++) {
+		for (unsigned s = 0; s < GR_TIMER_WHEEL_SLOTS; s++)
+			LIST_INIT(&w->slots[l][s]);
+	}
+}
+
+void gr_timer_add(struct gr_timer_wheel *w, struct gr_timer *t, uint64_t ticks, gr_timer_cb_t cb) {
+	gr_timer_del(t);
+	if (ticks == 0)
+		ticks = 1;
+	if (ticks > GR_TIMER_WHEEL_MAX_TICKS)
+		ticks = GR_TIMER_WHEEL_MAX_TICKS;
+	t->expire = w->now + ticks;
+	t->cb = cb;
+	timer_insert(w, t);
+}
+
+void gr_timer_del(struct gr_timer *t) {
+	if (gr_timer_pending(t)) {
+		LIST_REMOVE(t, next);
+		t->next.le_prev = NULL;
+	}
+}
+
+// Move the timers of a higher level slot to lower levels.
+static void cascade(struct gr_timer_wheel *w, unsigned level) {
+	struct gr_timer *t;
+	unsigned index;
+
+	index = slot_index(w->now, level);
+	while ((t = LIST_FIRST(&w->slots[level][index])) != NULL) {
+		LIST_REMOVE(t, next);
+		timer_insert(w, t);
+	}
+	// Continue with the next level when this one wrapped around.
+	if (index == 0 && level + 1 < GR_TIMER_WHEEL_LEVELS)
+		cascade(w, level + 1);
+}
+
+void gr_timer_wheel_run(struct gr_timer_wheel *w, uint64_t now) {
+	struct gr_timer *t;
+	unsigned index;
+
+	while (w->now < now) {
+		w->now++;
+		index = slot_index(w->now, 0);
+		if (index == 0)
+			cascade(w, 1);
+
+		// Callbacks cannot rearm timers in the current slot, the minimum delay is one tick.
+		while ((t = LIST_FIRST(&w->slots[0][index])) != NULL) {
+			gr_timer_del(t);
+			t->cb(t);
+		}
+	}
+}
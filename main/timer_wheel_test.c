@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_cmocka.h>
+#include <gr_timer_wheel.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#define LEVEL_TICKS(level) (UINT64_C(1) << ((level) * GR_TIMER_WHEEL_SLOT_BITS))
+
+struct test_timer {
+	struct gr_timer timer; // must be first
+	unsigned fired;
+	uint64_t fired_at;
+	struct test_timer *other;
+	uint64_t ticks;
+};
+
+static struct gr_timer_wheel wheel;
+static struct test_timer timers[4];
+
+static void fired_cb(struct gr_timer *t) {
+	struct test_timer *tt = (struct test_timer *)t;
+	assert_false(gr_timer_pending(t));
+	tt->fired++;
+	tt->fired_at = wheel.now;
+}
+
+static void del_other_cb(struct gr_timer *t) {
+	struct test_timer *tt = (struct test_timer *)t;
+	fired_cb(t);
+	gr_timer_del(&tt->other->timer);
+}
+
+static void add_other_cb(struct gr_timer *t) {
+	struct test_timer *tt = (struct test_timer *)t;
+	fired_cb(t);
+	gr_timer_add(&wheel, &tt->other->timer, tt->ticks, fired_cb);
+}
+
+static void rearm_cb(struct gr_timer *t) {
+	struct test_timer *tt = (struct test_timer *)t;
+	fired_cb(t);
+	if (tt->fired < 3)
+		gr_timer_add(&wheel, t, tt->ticks, rearm_cb);
+}
+
+static int setup(void **) {
+	memset(timers, 0, sizeof(timers));
+	return 0;
+}
+
+// Arm a single timer at now + ticks and check that it fires at this exact tick.
+static void check_expire(uint64_t now, uint64_t ticks) {
+	struct test_timer *tt = &timers[0];
+
+	memset(tt, 0, sizeof(*tt));
+	gr_timer_wheel_init(&wheel, now);
+	gr_timer_add(&wheel, &tt->timer, ticks, fired_cb);
+	assert_true(gr_timer_pending(&tt->timer));
+
+	gr_timer_wheel_run(&wheel, now + ticks - 1);
+	if (tt->fired != 0)
+		fail_msg("now %lu ticks %lu fired early at %lu", now, ticks, tt->fired_at);
+	gr_timer_wheel_run(&wheel, now + ticks);
+	if (tt->fired != 1)
+		fail_msg("now %lu ticks %lu not fired", now, ticks);
+	assert_int_equal(tt->fired_at, now + ticks);
+	assert_false(gr_timer_pending(&tt->timer));
+
+	gr_timer_wheel_run(&wheel, now + ticks + LEVEL_TICKS(1) + 1);
+	assert_int_equal(tt->fired, 1);
+}
+
+static void expire_level_boundaries(void **) {
+	for (unsigned level = 1; level < GR_TIMER_WHEEL_LEVELS; level++) {
+		check_expire(0, LEVEL_TICKS(level) - 1);
+		check_expire(0, LEVEL_TICKS(level));
+		check_expire(0, LEVEL_TICKS(level) + 1);
+	}
+	check_expire(0, 1);
+	check_expire(0, GR_TIMER_WHEEL_MAX_TICKS);
+}
+
+static void expire_cascade_boundaries(void **) {
+	// start right before and right after each level wraps around
+	for (unsigned level = 1; level < GR_TIMER_WHEEL_LEVELS; level++) {
+		uint64_t wrap = LEVEL_TICKS(level);
+		for (uint64_t now = wrap - 2; now <= wrap + 1; now++) {
+			check_expire(now, 1);
+			check_expire(now, 2);
+			check_expire(now, LEVEL_TICKS(1) - 1);
+			check_expire(now, LEVEL_TICKS(1));
+			check_expire(now, LEVEL_TICKS(1) + 1);
+			check_expire(now, LEVEL_TICKS(2) + LEVEL_TICKS(1) - 1);
+			check_expire(now, LEVEL_TICKS(3) + 1);
+		}
+	}
+}
+
+static void expire_clamped(void **) {
+	struct test_timer *tt = &timers[0];
+
+	gr_timer_wheel_init(&wheel, 1000);
+	gr_timer_add(&wheel, &tt->timer, 0, fired_cb);
+	gr_timer_wheel_run(&wheel, 1001);
+	assert_int_equal(tt->fired, 1);
+	assert_int_equal(tt->fired_at, 1001);
+
+	gr_timer_add(&wheel, &tt->timer, UINT64_MAX, fired_cb);
+	assert_int_equal(tt->timer.expire, 1001 + GR_TIMER_WHEEL_MAX_TICKS);
+}
+
+static void add_rearm(void **) {
+	struct test_timer *tt = &timers[0];
+
+	gr_timer_wheel_init(&wheel, 0);
+	gr_timer_add(&wheel, &tt->timer, LEVEL_TICKS(2), fired_cb);
+	gr_timer_add(&wheel, &tt->timer, 10, fired_cb);
+	gr_timer_wheel_run(&wheel, LEVEL_TICKS(2) + 1);
+	assert_int_equal(tt->fired, 1);
+	assert_int_equal(tt->fired_at, 10);
+}
+
+static void del_pending(void **) {
+	struct test_timer *tt = &timers[0];
+
+	gr_timer_wheel_init(&wheel, 0);
+	gr_timer_del(&tt->timer); // never armed
+	gr_timer_add(&wheel, &tt->timer, LEVEL_TICKS(1) + 5, fired_cb);
+	gr_timer_del(&tt->timer);
+	assert_false(gr_timer_pending(&tt->timer));
+	gr_timer_del(&tt->timer);
+	gr_timer_wheel_run(&wheel, LEVEL_TICKS(2));
+	assert_int_equal(tt->fired, 0);
+}
+
+static void del_during_expiry(void **) {
+	struct test_timer *a = &timers[0], *b = &timers[1], *c = &timers[2], *d = &timers[3];
+
+	gr_timer_wheel_init(&wheel, 0);
+	// a and b expire in the same slot and delete each other
+	a->other = b;
+	b->other = a;
+	gr_timer_add(&wheel, &a->timer, 100, del_other_cb);
+	gr_timer_add(&wheel, &b->timer, 100, del_other_cb);
+	// d deletes c which is still in a higher level
+	d->other = c;
+	gr_timer_add(&wheel, &c->timer, LEVEL_TICKS(2) + 3, fired_cb);
+	gr_timer_add(&wheel, &d->timer, 50, del_other_cb);
+	gr_timer_wheel_run(&wheel, LEVEL_TICKS(3));
+
+	assert_int_equal(a->fired + b->fired, 1);
+	assert_int_equal(c->fired, 0);
+	assert_int_equal(d->fired, 1);
+	assert_int_equal(d->fired_at, 50);
+}
+
+static void add_during_expiry(void **) {
+	struct test_timer *a = &timers[0], *b = &timers[1], *c = &timers[2];
+
+	gr_timer_wheel_init(&wheel, LEVEL_TICKS(1) - 3);
+	// a arms b in a higher level while the wheel runs
+	a->other = b;
+	a->ticks = LEVEL_TICKS(1) + 7;
+	gr_timer_add(&wheel, &a->timer, 2, add_other_cb);
+	// c rearms itself with the minimum delay
+	c->ticks = 1;
+	gr_timer_add(&wheel, &c->timer, 2, rearm_cb);
+	gr_timer_wheel_run(&wheel, LEVEL_TICKS(2));
+
+	assert_int_equal(a->fired, 1);
+	assert_int_equal(a->fired_at, LEVEL_TICKS(1) - 1);
+	assert_int_equal(b->fired, 1);
+	assert_int_equal(b->fired_at, LEVEL_TICKS(1) - 1 + LEVEL_TICKS(1) + 7);
+	assert_int_equal(c->fired, 3);
+	assert_int_equal(c->fired_at, LEVEL_TICKS(1) + 1);
+}
+
+static void run_backwards(void **) {
+	struct test_timer *tt = &timers[0];
+
+	gr_timer_wheel_init(&wheel, 500);
+	gr_timer_add(&wheel, &tt->timer, 1, fired_cb);
+	gr_timer_wheel_run(&wheel, 400);
+	assert_int_equal(wheel.now, 500);
+	assert_int_equal(tt->fired, 0);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test_setup(expire_level_boundaries, setup),
+		cmocka_unit_test_setup(expire_cascade_boundaries, setup),
+		cmocka_unit_test_setup(expire_clamped, setup),
+		cmocka_unit_test_setup(add_rearm, setup),
+		cmocka_unit_test_setup(del_pending, setup),
+		cmocka_unit_test_setup(del_during_expiry, setup),
+		cmocka_unit_test_setup(add_during_expiry, setup),
+		cmocka_unit_test_setup(run_backwards, setup),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
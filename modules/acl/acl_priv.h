@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _ACL_PRIV_H
+#define _ACL_PRIV_H
+
+#include <gr_acl.h>
+#include <gr_net_types.h>
+
+#include <rte_acl.h>
+#include <rte_byteorder.h>
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Compiled rule set. This is never modified once published, updates replace it. Only the hit
+// counters are updated by the datapath workers.
+struct acl_ruleset {
+	struct rte_acl_ctx *ctx; // NULL if there are no rules.
+	struct gr_acl_rule *rules; // As configured, for the API.
+	uint16_t n_rules;
+	// Indexed by the rte_acl_classify() result. Zero means that no rule matched.
+	struct {
+		gr_acl_action_t action;
+		_Atomic(uint64_t) hits;
+	} results[/* n_rules + 1 */];
+};
+
+// Classifier input built from the packet headers, in network order. rte_acl requires the
+// first field to be one byte long and all others to be grouped in 4 bytes words.
+struct acl_key {
+	uint8_t proto;
+	uint8_t _pad0[3];
+	uint8_t dscp;
+	uint8_t _pad1;
+	rte_be16_t vrf_id;
+	ip4_addr_t src;
+	ip4_addr_t dst;
+	rte_be16_t src_port;
+	rte_be16_t dst_port;
+};
+
+// Get the rule set attached to an interface, NULL if there is none.
+struct acl_ruleset *acl_iface_get(uint16_t iface_id, gr_acl_dir_t dir);
+
+#endif
@@ -0,0 +1,480 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_acl.h>
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_cli_iface.h>
+#include <gr_net_types.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ACL_ADD_CTX(root) CLI_CONTEXT(root, CTX_ADD, CTX_ARG("acl", "Create access control lists."))
+#define ACL_SET_CTX(root) CLI_CONTEXT(root, CTX_SET, CTX_ARG("acl", "Modify access control lists."))
+#define ACL_DEL_CTX(root) CLI_CONTEXT(root, CTX_DEL, CTX_ARG("acl", "Delete access control lists."))
+#define ACL_SHOW_CTX(root) CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("acl", "Show access control lists."))
+
+#define PORT_RANGE_RE "^[0-9]{1,5}(-[0-9]{1,5})?$"
+#define PROTO_RE "^(tcp|udp|icmp|[0-9]{1,3})$"
+
+static int parse_action(const char *s, gr_acl_action_t *action) {
+	if (strcmp(s, "permit") == 0)
+		*action = GR_ACL_PERMIT;
+	else if (strcmp(s, "deny") == 0)
+		*action = GR_ACL_DENY;
+	else
+		return errno_set(EINVAL);
+	return 0;
+}
+
+static int parse_dir(const char *s, gr_acl_dir_t *dir) {
+	if (strcmp(s, "in") == 0)
+		*dir = GR_ACL_INGRESS;
+	else if (strcmp(s, "out") == 0)
+		*dir = GR_ACL_EGRESS;
+	else
+		return errno_set(EINVAL);
+	return 0;
+}
+
+static int parse_proto(const char *s, uint8_t *proto) {
+	unsigned long p;
+	char *end;
+
+	if (strcmp(s, "tcp") == 0) {
+		*proto = IPPROTO_TCP;
+		return 0;
+	}
+	if (strcmp(s, "udp") == 0) {
+		*proto = IPPROTO_UDP;
+		return 0;
+	}
+	if (strcmp(s, "icmp") == 0) {
+		*proto = IPPROTO_ICMP;
+		return 0;
+	}
+	p = strtoul(s, &end, 10);
+	if (*end != '\0' || p > UINT8_MAX)
+		return errno_set(EINVAL);
+	*proto = p;
+
+	return 0;
+}
+
+static int parse_ports(const char *s, uint16_t *min, uint16_t *max) {
+	unsigned long lo, hi;
+	char *end;
+
+	lo = strtoul(s, &end, 10);
+	hi = lo;
+	if (*end == '-')
+		hi = strtoul(end + 1, &end, 10);
+	if (*end != '\0' || lo > UINT16_MAX || hi > UINT16_MAX || lo > hi || hi == 0)
+		return errno_set(ERANGE);
+	*min = lo;
+	*max = hi;
+
+	return 0;
+}
+
+static const char *proto_str(uint8_t proto, char *buf, size_t len) {
+	switch (proto) {
+	case 0:
+		return "any";
+	case IPPROTO_TCP:
+		return "tcp";
+	case IPPROTO_UDP:
+		return "udp";
+	case IPPROTO_ICMP:
+		return "icmp";
+	}
+	snprintf(buf, len, "%u", proto);
+	return buf;
+}
+
+static const char *ports_str(uint16_t min, uint16_t max, char *buf, size_t len) {
+	if (max == 0 || (min == 0 && max == UINT16_MAX))
+		return "any";
+	if (min == max)
+		snprintf(buf, len, "%u", min);
+	else
+		snprintf(buf, len, "%u-%u", min, max);
+	return buf;
+}
+
+// Get the current rules of an ACL, with room for one more. Missing ACLs are returned empty.
+static struct gr_acl_set_req *acl_fetch(const struct gr_api_client *c, uint16_t acl_id) {
+	struct gr_acl_get_req get = {.acl_id = acl_id};
+	const struct gr_acl_get_resp *resp;
+	struct gr_acl_set_req *req;
+	void *resp_ptr = NULL;
+	uint16_t n_rules = 0;
+
+	if (gr_api_client_send_recv(c, GR_ACL_GET, sizeof(get), &get, &resp_ptr) < 0) {
+		if (errno != ENOENT)
+			return NULL;
+	} else {
+		resp = resp_ptr;
+		n_rules = resp->acl.n_rules;
+	}
+
+	req = calloc(1, sizeof(*req) + (n_rules + 1) * sizeof(req->rules[0]));
+	if (req == NULL) {
+		free(resp_ptr);
+		return errno_set_null(ENOMEM);
+	}
+	req->acl_id = acl_id;
+	req->default_action = GR_ACL_PERMIT;
+	if (resp_ptr != NULL) {
+		resp = resp_ptr;
+		req->default_action = resp->acl.default_action;
+		req->n_rules = n_rules;
+		for (uint16_t i = 0; i < n_rules; i++)
+			req->rules[i] = resp->rules[i].rule;
+	}
+	free(resp_ptr);
+
+	return req;
+}
+
+static cmd_status_t acl_send(const struct gr_api_client *c, const struct gr_acl_set_req *req) {
+	size_t len = sizeof(*req) + req->n_rules * sizeof(req->rules[0]);
+
+	if (gr_api_client_send_recv(c, GR_ACL_SET, len, req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t acl_rule_add(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_acl_rule rule = {.vrf_id = GR_ACL_VRF_ANY, .dscp = GR_ACL_DSCP_ANY};
+	struct gr_acl_set_req *req = NULL;
+	cmd_status_t ret = CMD_ERROR;
+	uint16_t id, dscp;
+	const char *s;
+
+	if (arg_u16(p, "ACL", &id) < 0)
+		return CMD_ERROR;
+	if ((s = arg_str(p, "SRC")) != NULL && ip4_net_parse(s, &rule.src, true) < 0)
+		return CMD_ERROR;
+	if ((s = arg_str(p, "DST")) != NULL && ip4_net_parse(s, &rule.dst, true) < 0)
+		return CMD_ERROR;
+	if ((s = arg_str(p, "PROTO")) != NULL && parse_proto(s, &rule.proto) < 0)
+		return CMD_ERROR;
+	s = arg_str(p, "SPORT");
+	if (s != NULL && parse_ports(s, &rule.src_port_min, &rule.src_port_max) < 0)
+		return CMD_ERROR;
+	s = arg_str(p, "DPORT");
+	if (s != NULL && parse_ports(s, &rule.dst_port_min, &rule.dst_port_max) < 0)
+		return CMD_ERROR;
+	if (arg_u16(p, "VRF", &rule.vrf_id) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u16(p, "DSCP", &dscp) == 0)
+		rule.dscp = dscp;
+	else if (errno != ENOENT)
+		return CMD_ERROR;
+	if (parse_action(arg_str(p, "ACTION"), &rule.action) < 0)
+		return CMD_ERROR;
+
+	if ((req = acl_fetch(c, id)) == NULL)
+		return CMD_ERROR;
+	req->rules[req->n_rules++] = rule;
+	ret = acl_send(c, req);
+	free(req);
+
+	return ret;
+}
+
+static cmd_status_t acl_default_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_acl_set_req *req;
+	gr_acl_action_t action;
+	cmd_status_t ret;
+	uint16_t id;
+
+	if (arg_u16(p, "ACL", &id) < 0)
+		return CMD_ERROR;
+	if (parse_action(arg_str(p, "ACTION"), &action) < 0)
+		return CMD_ERROR;
+
+	if ((req = acl_fetch(c, id)) == NULL)
+		return CMD_ERROR;
+	req->default_action = action;
+	ret = acl_send(c, req);
+	free(req);
+
+	return ret;
+}
+
+static cmd_status_t acl_del(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_acl_del_req del = {.missing_ok = true};
+	struct gr_acl_set_req *req;
+	cmd_status_t ret;
+	uint16_t index;
+
+	if (arg_u16(p, "ACL", &del.acl_id) < 0)
+		return CMD_ERROR;
+
+	if (arg_u16(p, "INDEX", &index) < 0) {
+		if (errno != ENOENT)
+			return CMD_ERROR;
+		if (gr_api_client_send_recv(c, GR_ACL_DEL, sizeof(del), &del, NULL) < 0)
+			return CMD_ERROR;
+		return CMD_SUCCESS;
+	}
+
+	if ((req = acl_fetch(c, del.acl_id)) == NULL)
+		return CMD_ERROR;
+	if (index >= req->n_rules) {
+		free(req);
+		errno = ENOENT;
+		return CMD_ERROR;
+	}
+	memmove(&req->rules[index],
+		&req->rules[index + 1],
+		(req->n_rules - index - 1) * sizeof(req->rules[0]));
+	req->n_rules--;
+	ret = acl_send(c, req);
+	free(req);
+
+	return ret;
+}
+
+static cmd_status_t acl_attach(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_acl_attach_req req = {0};
+	struct gr_iface iface;
+
+	if (arg_u16(p, "ACL", &req.acl_id) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	if (parse_dir(arg_str(p, "DIR"), &req.dir) < 0)
+		return CMD_ERROR;
+	req.iface_id = iface.id;
+
+	if (gr_api_client_send_recv(c, GR_ACL_ATTACH, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t acl_list(const struct gr_api_client *c) {
+	const struct gr_acl_iface_list_resp *ifaces;
+	const struct gr_acl_list_resp *resp;
+	struct libscols_table *table;
+	void *resp_ptr = NULL;
+	struct gr_iface iface;
+
+	if (gr_api_client_send_recv(c, GR_ACL_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "ACL", 0, 0);
+	scols_table_new_column(table, "DEFAULT", 0, 0);
+	scols_table_new_column(table, "RULES", 0, 0);
+	scols_table_new_column(table, "REFS", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < resp->n_acls; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_acl *acl = &resp->acls[i];
+		scols_line_sprintf(line, 0, "%u", acl->acl_id);
+		scols_line_sprintf(line, 1, "%s", gr_acl_action_name(acl->default_action));
+		scols_line_sprintf(line, 2, "%u", acl->n_rules);
+		scols_line_sprintf(line, 3, "%u", acl->ref_count);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+	resp_ptr = NULL;
+
+	if (gr_api_client_send_recv(c, GR_ACL_IFACE_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	ifaces = resp_ptr;
+	if (ifaces->n_ifaces > 0) {
+		printf("\n");
+		table = scols_new_table();
+		scols_table_new_column(table, "IFACE", 0, 0);
+		scols_table_new_column(table, "DIR", 0, 0);
+		scols_table_new_column(table, "ACL", 0, 0);
+		scols_table_set_column_separator(table, "  ");
+		for (uint16_t i = 0; i < ifaces->n_ifaces; i++) {
+			struct libscols_line *line = scols_table_new_line(table, NULL);
+			const struct gr_acl_iface *a = &ifaces->ifaces[i];
+			if (iface_from_id(c, a->iface_id, &iface) == 0)
+				scols_line_sprintf(line, 0, "%s", iface.name);
+			else
+				scols_line_sprintf(line, 0, "%u", a->iface_id);
+			scols_line_sprintf(line, 1, "%s", gr_acl_dir_name(a->dir));
+			scols_line_sprintf(line, 2, "%u", a->acl_id);
+		}
+		scols_print_table(table);
+		scols_unref_table(table);
+	}
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t acl_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_acl_get_resp *resp;
+	struct gr_acl_get_req req = {0};
+	char src[64], dst[64], buf[16];
+	struct libscols_table *table;
+	void *resp_ptr = NULL;
+
+	if (arg_u16(p, "ACL", &req.acl_id) < 0) {
+		if (errno == ENOENT)
+			return acl_list(c);
+		return CMD_ERROR;
+	}
+
+	if (gr_api_client_send_recv(c, GR_ACL_GET, sizeof(req), &req, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "INDEX", 0, 0);
+	scols_table_new_column(table, "SRC", 0, 0);
+	scols_table_new_column(table, "DST", 0, 0);
+	scols_table_new_column(table, "PROTO", 0, 0);
+	scols_table_new_column(table, "SPORT", 0, 0);
+	scols_table_new_column(table, "DPORT", 0, 0);
+	scols_table_new_column(table, "DSCP", 0, 0);
+	scols_table_new_column(table, "VRF", 0, 0);
+	scols_table_new_column(table, "ACTION", 0, 0);
+	scols_table_new_column(table, "HITS", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+
+	for (uint16_t i = 0; i < resp->acl.n_rules; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_acl_rule *r = &resp->rules[i].rule;
+
+		ip4_net_format(&r->src, src, sizeof(src));
+		ip4_net_format(&r->dst, dst, sizeof(dst));
+		scols_line_sprintf(line, 0, "%u", i);
+		scols_line_sprintf(line, 1, "%s", src);
+		scols_line_sprintf(line, 2, "%s", dst);
+		scols_line_sprintf(line, 3, "%s", proto_str(r->proto, buf, sizeof(buf)));
+		scols_line_sprintf(
+			line, 4, "%s", ports_str(r->src_port_min, r->src_port_max, buf, sizeof(buf))
+		);
+		scols_line_sprintf(
+			line, 5, "%s", ports_str(r->dst_port_min, r->dst_port_max, buf, sizeof(buf))
+		);
+		if (r->dscp == GR_ACL_DSCP_ANY)
+			scols_line_set_data(line, 6, "any");
+		else
+			scols_line_sprintf(line, 6, "%u", r->dscp);
+		if (r->vrf_id == GR_ACL_VRF_ANY)
+			scols_line_set_data(line, 7, "any");
+		else
+			scols_line_sprintf(line, 7, "%u", r->vrf_id);
+		scols_line_sprintf(line, 8, "%s", gr_acl_action_name(r->action));
+		scols_line_sprintf(line, 9, "%lu", resp->rules[i].hits);
+	}
+	struct libscols_line *line = scols_table_new_line(table, NULL);
+	scols_line_set_data(line, 0, "default");
+	scols_line_sprintf(line, 8, "%s", gr_acl_action_name(resp->acl.default_action));
+	scols_line_sprintf(line, 9, "%lu", resp->default_hits);
+
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		ACL_ADD_CTX(root),
+		"ACL rule [(src SRC),(dst DST),(proto PROTO),(sport SPORT),(dport DPORT),"
+		"(dscp DSCP),(vrf VRF)] action ACTION",
+		acl_rule_add,
+		"Append a rule to an access control list, create it if needed.",
+		with_help("Access control list ID.", ec_node_uint("ACL", 1, GR_ACL_MAX - 1, 10)),
+		with_help("Source IPv4 prefix.", ec_node_re("SRC", IPV4_NET_RE)),
+		with_help("Destination IPv4 prefix.", ec_node_re("DST", IPV4_NET_RE)),
+		with_help("IP protocol name or number.", ec_node_re("PROTO", PROTO_RE)),
+		with_help("TCP/UDP source port or range.", ec_node_re("SPORT", PORT_RANGE_RE)),
+		with_help(
+			"TCP/UDP destination port or range.", ec_node_re("DPORT", PORT_RANGE_RE)
+		),
+		with_help("DiffServ code point.", ec_node_uint("DSCP", 0, 63, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10)),
+		with_help("Action for matching packets.", ec_node_re("ACTION", "^(permit|deny)$"))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		ACL_ADD_CTX(root),
+		"ACL iface IFACE dir DIR",
+		acl_attach,
+		"Attach an access control list to an interface.",
+		with_help("Access control list ID.", ec_node_uint("ACL", 1, GR_ACL_MAX - 1, 10)),
+		with_help("Interface name.", ec_node_dyn("IFACE", complete_iface_names, NULL)),
+		with_help("Traffic direction.", ec_node_re("DIR", "^(in|out)$"))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		ACL_SET_CTX(root),
+		"ACL default ACTION",
+		acl_default_set,
+		"Change the action for packets which match no rule.",
+		with_help("Access control list ID.", ec_node_uint("ACL", 1, GR_ACL_MAX - 1, 10)),
+		with_help("Default action.", ec_node_re("ACTION", "^(permit|deny)$"))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		ACL_DEL_CTX(root),
+		"ACL [rule INDEX]",
+		acl_del,
+		"Delete an access control list or one of its rules.",
+		with_help("Access control list ID.", ec_node_uint("ACL", 1, GR_ACL_MAX - 1, 10)),
+		with_help("Rule index.", ec_node_uint("INDEX", 0, GR_ACL_MAX_RULES - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		ACL_DEL_CTX(root),
+		"iface IFACE dir DIR",
+		acl_attach,
+		"Detach the access control list of an interface.",
+		with_help("Interface name.", ec_node_dyn("IFACE", complete_iface_names, NULL)),
+		with_help("Traffic direction.", ec_node_re("DIR", "^(in|out)$"))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		ACL_SHOW_CTX(root),
+		"[ACL]",
+		acl_show,
+		"Show access control lists and their counters.",
+		with_help("Access control list ID.", ec_node_uint("ACL", 1, GR_ACL_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "acl",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -0,0 +1,451 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "acl_priv.h"
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_worker.h>
+
+#include <rte_acl.h>
+#include <rte_errno.h>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	PROTO_FIELD = 0,
+	DSCP_FIELD,
+	VRF_FIELD,
+	SRC_FIELD,
+	DST_FIELD,
+	SRC_PORT_FIELD,
+	DST_PORT_FIELD,
+	NUM_FIELDS,
+};
+
+static const struct rte_acl_field_def field_defs[NUM_FIELDS] = {
+	[PROTO_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_BITMASK,
+		.size = sizeof(uint8_t),
+		.field_index = PROTO_FIELD,
+		.input_index = 0,
+		.offset = offsetof(struct acl_key, proto),
+	},
+	[DSCP_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_BITMASK,
+		.size = sizeof(uint8_t),
+		.field_index = DSCP_FIELD,
+		.input_index = 1,
+		.offset = offsetof(struct acl_key, dscp),
+	},
+	[VRF_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_BITMASK,
+		.size = sizeof(uint16_t),
+		.field_index = VRF_FIELD,
+		.input_index = 1,
+		.offset = offsetof(struct acl_key, vrf_id),
+	},
+	[SRC_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_MASK,
+		.size = sizeof(ip4_addr_t),
+		.field_index = SRC_FIELD,
+		.input_index = 2,
+		.offset = offsetof(struct acl_key, src),
+	},
+	[DST_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_MASK,
+		.size = sizeof(ip4_addr_t),
+		.field_index = DST_FIELD,
+		.input_index = 3,
+		.offset = offsetof(struct acl_key, dst),
+	},
+	[SRC_PORT_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_RANGE,
+		.size = sizeof(uint16_t),
+		.field_index = SRC_PORT_FIELD,
+		.input_index = 4,
+		.offset = offsetof(struct acl_key, src_port),
+	},
+	[DST_PORT_FIELD] = {
+		.type = RTE_ACL_FIELD_TYPE_RANGE,
+		.size = sizeof(uint16_t),
+		.field_index = DST_PORT_FIELD,
+		.input_index = 4,
+		.offset = offsetof(struct acl_key, dst_port),
+	},
+};
+
+RTE_ACL_RULE_DEF(acl_rule, NUM_FIELDS);
+
+// Rule sets are referenced by id so that they can be replaced without touching interfaces.
+static _Atomic(struct acl_ruleset *) acls[GR_ACL_MAX];
+static uint32_t acl_refs[GR_ACL_MAX];
+static uint16_t iface_acls[GR_ACL_DIR_COUNT][MAX_IFACES];
+
+struct acl_ruleset *acl_iface_get(uint16_t iface_id, gr_acl_dir_t dir) {
+	return atomic_load_explicit(&acls[iface_acls[dir][iface_id]], memory_order_acquire);
+}
+
+static inline bool port_any(uint16_t min, uint16_t max) {
+	return max == 0 || (min == 0 && max == UINT16_MAX);
+}
+
+static int rule_validate(const struct gr_acl_rule *r) {
+	bool ports = r->proto == IPPROTO_TCP || r->proto == IPPROTO_UDP;
+
+	if (r->action != GR_ACL_PERMIT && r->action != GR_ACL_DENY)
+		return errno_set(EINVAL);
+	if (r->src.prefixlen > 32 || r->dst.prefixlen > 32)
+		return errno_set(EINVAL);
+	if (r->dscp != GR_ACL_DSCP_ANY && r->dscp > 63)
+		return errno_set(EINVAL);
+	if (r->src_port_max != 0 && r->src_port_min > r->src_port_max)
+		return errno_set(ERANGE);
+	if (r->dst_port_max != 0 && r->dst_port_min > r->dst_port_max)
+		return errno_set(ERANGE);
+	if (!ports && !port_any(r->src_port_min, r->src_port_max))
+		return errno_set(EPROTONOSUPPORT);
+	if (!ports && !port_any(r->dst_port_min, r->dst_port_max))
+		return errno_set(EPROTONOSUPPORT);
+
+	return 0;
+}
+
+// Values are in host order, rte_acl converts them when building the context.
+static void rule_to_acl(struct acl_rule *a, const struct gr_acl_rule *r, uint16_t index) {
+	memset(a, 0, sizeof(*a));
+	// First matching rule wins.
+	a->data.priority = GR_ACL_MAX_RULES - index;
+	a->data.category_mask = 1;
+	a->data.userdata = index + 1;
+
+	a->field[PROTO_FIELD].value.u8 = r->proto;
+	a->field[PROTO_FIELD].mask_range.u8 = r->proto != 0 ? UINT8_MAX : 0;
+	if (r->dscp != GR_ACL_DSCP_ANY) {
+		a->field[DSCP_FIELD].value.u8 = r->dscp;
+		a->field[DSCP_FIELD].mask_range.u8 = 0x3f;
+	}
+	if (r->vrf_id != GR_ACL_VRF_ANY) {
+		a->field[VRF_FIELD].value.u16 = r->vrf_id;
+		a->field[VRF_FIELD].mask_range.u16 = UINT16_MAX;
+	}
+	a->field[SRC_FIELD].value.u32 = rte_be_to_cpu_32(r->src.ip);
+	a->field[SRC_FIELD].mask_range.u32 = r->src.prefixlen;
+	a->field[DST_FIELD].value.u32 = rte_be_to_cpu_32(r->dst.ip);
+	a->field[DST_FIELD].mask_range.u32 = r->dst.prefixlen;
+	if (port_any(r->src_port_min, r->src_port_max)) {
+		a->field[SRC_PORT_FIELD].mask_range.u16 = UINT16_MAX;
+	} else {
+		a->field[SRC_PORT_FIELD].value.u16 = r->src_port_min;
+		a->field[SRC_PORT_FIELD].mask_range.u16 = r->src_port_max;
+	}
+	if (port_any(r->dst_port_min, r->dst_port_max)) {
+		a->field[DST_PORT_FIELD].mask_range.u16 = UINT16_MAX;
+	} else {
+		a->field[DST_PORT_FIELD].value.u16 = r->dst_port_min;
+		a->field[DST_PORT_FIELD].mask_range.u16 = r->dst_port_max;
+	}
+}
+
+static void ruleset_free(struct acl_ruleset *rs) {
+	if (rs == NULL)
+		return;
+	rte_acl_free(rs->ctx);
+	free(rs->rules);
+	free(rs);
+}
+
+static struct acl_ruleset *ruleset_alloc(const struct gr_acl_set_req *req) {
+	struct rte_acl_param params = {
+		.socket_id = SOCKET_ID_ANY,
+		.rule_size = RTE_ACL_RULE_SZ(NUM_FIELDS),
+		.max_rule_num = req->n_rules,
+	};
+	struct rte_acl_config cfg = {
+		.num_categories = 1,
+		.num_fields = NUM_FIELDS,
+	};
+	// rte_acl context names must be unique, old contexts still exist while replacing them
+	static uint32_t generation;
+	char name[RTE_ACL_NAMESIZE];
+	struct acl_ruleset *rs;
+	struct acl_rule rule;
+	int ret;
+
+	rs = calloc(1, sizeof(*rs) + (req->n_rules + 1) * sizeof(rs->results[0]));
+	if (rs == NULL)
+		return errno_set_null(ENOMEM);
+	rs->rules = calloc(req->n_rules + 1, sizeof(*rs->rules));
+	if (rs->rules == NULL) {
+		errno = ENOMEM;
+		goto err;
+	}
+	rs->n_rules = req->n_rules;
+	rs->results[0].action = req->default_action;
+	for (uint16_t i = 0; i < req->n_rules; i++) {
+		if (rule_validate(&req->rules[i]) < 0)
+			goto err;
+		rs->rules[i] = req->rules[i];
+		rs->results[i + 1].action = req->rules[i].action;
+	}
+	if (req->n_rules == 0)
+		return rs;
+
+	snprintf(name, sizeof(name), "acl%u_%u", req->acl_id, generation++);
+	params.name = name;
+	if ((rs->ctx = rte_acl_create(&params)) == NULL) {
+		errno = rte_errno;
+		goto err;
+	}
+	for (uint16_t i = 0; i < req->n_rules; i++) {
+		rule_to_acl(&rule, &req->rules[i], i);
+		if ((ret = rte_acl_add_rules(rs->ctx, (struct rte_acl_rule *)&rule, 1)) < 0) {
+			errno = -ret;
+			goto err;
+		}
+	}
+	memcpy(cfg.defs, field_defs, sizeof(field_defs));
+	if ((ret = rte_acl_build(rs->ctx, &cfg)) < 0) {
+		errno = -ret;
+		goto err;
+	}
+
+	return rs;
+err:
+	ruleset_free(rs);
+	return NULL;
+}
+
+static struct api_out acl_set(const void *request, void **response) {
+	const struct gr_acl_set_req *req = request;
+	struct acl_ruleset *rs, *old;
+
+	(void)response;
+
+	if (req->acl_id == 0 || req->acl_id >= GR_ACL_MAX)
+		return api_out(EINVAL, 0);
+	if (req->default_action != GR_ACL_PERMIT && req->default_action != GR_ACL_DENY)
+		return api_out(EINVAL, 0);
+	if (req->n_rules > GR_ACL_MAX_RULES)
+		return api_out(E2BIG, 0);
+
+	if ((rs = ruleset_alloc(req)) == NULL)
+		return api_out(errno, 0);
+
+	// Workers see either the previous or the new rules, never a mix of both.
+	old = atomic_exchange_explicit(&acls[req->acl_id], rs, memory_order_acq_rel);
+	if (old != NULL) {
+		gr_datapath_sync();
+		ruleset_free(old);
+	}
+
+	return api_out(0, 0);
+}
+
+static struct api_out acl_del(const void *request, void **response) {
+	const struct gr_acl_del_req *req = request;
+	struct acl_ruleset *old;
+
+	(void)response;
+
+	if (req->acl_id == 0 || req->acl_id >= GR_ACL_MAX)
+		return api_out(EINVAL, 0);
+	if (atomic_load(&acls[req->acl_id]) == NULL)
+		return api_out(req->missing_ok ? 0 : ENOENT, 0);
+	if (acl_refs[req->acl_id] > 0)
+		return api_out(EBUSY, 0);
+
+	old = atomic_exchange_explicit(&acls[req->acl_id], NULL, memory_order_acq_rel);
+	gr_datapath_sync();
+	ruleset_free(old);
+
+	return api_out(0, 0);
+}
+
+static struct api_out acl_get(const void *request, void **response) {
+	const struct gr_acl_get_req *req = request;
+	struct gr_acl_get_resp *resp;
+	const struct acl_ruleset *rs;
+	size_t len;
+
+	if (req->acl_id >= GR_ACL_MAX)
+		return api_out(EINVAL, 0);
+	if ((rs = atomic_load(&acls[req->acl_id])) == NULL)
+		return api_out(ENOENT, 0);
+
+	len = sizeof(*resp) + rs->n_rules * sizeof(resp->rules[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->acl.acl_id = req->acl_id;
+	resp->acl.default_action = rs->results[0].action;
+	resp->acl.n_rules = rs->n_rules;
+	resp->acl.ref_count = acl_refs[req->acl_id];
+	resp->default_hits = atomic_load_explicit(&rs->results[0].hits, memory_order_relaxed);
+	for (uint16_t i = 0; i < rs->n_rules; i++) {
+		resp->rules[i].rule = rs->rules[i];
+		resp->rules[i].hits = atomic_load_explicit(
+			&rs->results[i + 1].hits, memory_order_relaxed
+		);
+	}
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static struct api_out acl_list(const void *request, void **response) {
+	struct gr_acl_list_resp *resp;
+	const struct acl_ruleset *rs;
+	struct gr_acl *acl;
+
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp) + GR_ACL_MAX * sizeof(resp->acls[0]))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (uint16_t id = 1; id < GR_ACL_MAX; id++) {
+		if ((rs = atomic_load(&acls[id])) == NULL)
+			continue;
+		acl = &resp->acls[resp->n_acls++];
+		acl->acl_id = id;
+		acl->default_action = rs->results[0].action;
+		acl->n_rules = rs->n_rules;
+		acl->ref_count = acl_refs[id];
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_acls * sizeof(resp->acls[0]));
+}
+
+static void iface_acl_set(uint16_t iface_id, gr_acl_dir_t dir, uint16_t acl_id) {
+	uint16_t old = iface_acls[dir][iface_id];
+
+	if (old != 0)
+		acl_refs[old]--;
+	if (acl_id != 0)
+		acl_refs[acl_id]++;
+	iface_acls[dir][iface_id] = acl_id;
+
+	if (dir == GR_ACL_INGRESS)
+		ip_input_hook_enable(iface_id, IP_INPUT_HOOK_ACL, acl_id != 0);
+	else
+		ip_output_hook_enable(iface_id, IP_OUTPUT_HOOK_ACL, acl_id != 0);
+}
+
+static struct api_out acl_attach(const void *request, void **response) {
+	const struct gr_acl_attach_req *req = request;
+
+	(void)response;
+
+	if (iface_from_id(req->iface_id) == NULL)
+		return api_out(errno, 0);
+	if (req->dir >= GR_ACL_DIR_COUNT || req->acl_id >= GR_ACL_MAX)
+		return api_out(EINVAL, 0);
+	if (req->acl_id != 0 && atomic_load(&acls[req->acl_id]) == NULL)
+		return api_out(ENOENT, 0);
+
+	iface_acl_set(req->iface_id, req->dir, req->acl_id);
+
+	return api_out(0, 0);
+}
+
+static struct api_out acl_iface_list(const void *request, void **response) {
+	struct gr_acl_iface_list_resp *resp;
+	struct gr_acl_iface *i;
+	size_t len;
+
+	(void)request;
+
+	len = sizeof(*resp) + GR_ACL_DIR_COUNT * MAX_IFACES * sizeof(resp->ifaces[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (uint16_t iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		for (gr_acl_dir_t dir = 0; dir < GR_ACL_DIR_COUNT; dir++) {
+			if (iface_acls[dir][iface_id] == 0)
+				continue;
+			i = &resp->ifaces[resp->n_ifaces++];
+			i->iface_id = iface_id;
+			i->dir = dir;
+			i->acl_id = iface_acls[dir][iface_id];
+		}
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_ifaces * sizeof(resp->ifaces[0]));
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	if (event != IFACE_EVENT_PRE_REMOVE)
+		return;
+	for (gr_acl_dir_t dir = 0; dir < GR_ACL_DIR_COUNT; dir++)
+		iface_acl_set(iface->id, dir, 0);
+}
+
+static void acl_fini(struct event_base *) {
+	for (uint16_t id = 0; id < GR_ACL_MAX; id++)
+		ruleset_free(atomic_exchange(&acls[id], NULL));
+}
+
+static struct gr_api_handler acl_set_handler = {
+	.name = "acl set",
+	.request_type = GR_ACL_SET,
+	.callback = acl_set,
+};
+static struct gr_api_handler acl_del_handler = {
+	.name = "acl del",
+	.request_type = GR_ACL_DEL,
+	.callback = acl_del,
+};
+static struct gr_api_handler acl_get_handler = {
+	.name = "acl get",
+	.request_type = GR_ACL_GET,
+	.callback = acl_get,
+};
+static struct gr_api_handler acl_list_handler = {
+	.name = "acl list",
+	.request_type = GR_ACL_LIST,
+	.callback = acl_list,
+};
+static struct gr_api_handler acl_attach_handler = {
+	.name = "acl attach",
+	.request_type = GR_ACL_ATTACH,
+	.callback = acl_attach,
+};
+static struct gr_api_handler acl_iface_list_handler = {
+	.name = "acl iface list",
+	.request_type = GR_ACL_IFACE_LIST,
+	.callback = acl_iface_list,
+};
+
+static struct gr_module acl_module = {
+	.name = "acl",
+	.fini = acl_fini,
+	.fini_prio = 1000,
+};
+
+static struct iface_event_handler acl_iface_event_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(acl_constructor) {
+	gr_register_api_handler(&acl_set_handler);
+	gr_register_api_handler(&acl_del_handler);
+	gr_register_api_handler(&acl_get_handler);
+	gr_register_api_handler(&acl_list_handler);
+	gr_register_api_handler(&acl_attach_handler);
+	gr_register_api_handler(&acl_iface_list_handler);
+	gr_register_module(&acl_module);
+	iface_event_register_handler(&acl_iface_event_handler);
+}
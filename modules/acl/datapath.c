@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "acl_priv.h"
+
+#include <gr_eth_output.h>
+#include <gr_graph.h>
+#include <gr_iface.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+
+#include <rte_acl.h>
+#include <rte_byteorder.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+#include <netinet/in.h>
+#include <stdatomic.h>
+#include <string.h>
+
+enum edges {
+	DENIED = 0,
+	EDGE_COUNT,
+};
+
+// Packets using the same rule set are classified with a single rte_acl_classify() call.
+struct classify_batch {
+	struct acl_ruleset *rs;
+	unsigned n;
+	struct rte_mbuf *mbufs[RTE_GRAPH_BURST_SIZE];
+	struct acl_key keys[RTE_GRAPH_BURST_SIZE];
+	const uint8_t *data[RTE_GRAPH_BURST_SIZE];
+	uint32_t results[RTE_GRAPH_BURST_SIZE];
+};
+
+static inline void
+acl_key_init(struct acl_key *key, const struct rte_mbuf *mbuf, uint16_t vrf_id) {
+	const struct rte_ipv4_hdr *ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
+	const rte_be16_t *ports;
+	size_t ihl;
+
+	key->proto = ip->next_proto_id;
+	key->dscp = ip->type_of_service >> 2;
+	key->vrf_id = rte_cpu_to_be_16(vrf_id);
+	key->src = ip->src_addr;
+	key->dst = ip->dst_addr;
+	key->src_port = 0;
+	key->dst_port = 0;
+
+	// Only the first fragment has ports.
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		ihl = rte_ipv4_hdr_len(ip);
+		if (ip->fragment_offset & RTE_BE16(RTE_IPV4_HDR_OFFSET_MASK))
+			break;
+		if (rte_pktmbuf_data_len(mbuf) < ihl + 2 * sizeof(*ports))
+			break;
+		ports = (const rte_be16_t *)((const uint8_t *)ip + ihl);
+		key->src_port = ports[0];
+		key->dst_port = ports[1];
+		break;
+	}
+}
+
+static inline rte_edge_t accept_edge(struct rte_mbuf *mbuf, gr_acl_dir_t dir) {
+	if (dir == GR_ACL_INGRESS)
+		return ip_input_hook_next(IP_INPUT_HOOK_ACL, mbuf);
+	return ip_output_hook_next(IP_OUTPUT_HOOK_ACL, mbuf);
+}
+
+static inline void batch_flush(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	struct classify_batch *b,
+	gr_acl_dir_t dir
+) {
+	struct acl_ruleset *rs = b->rs;
+	uint32_t last, hits;
+	rte_edge_t next;
+
+	if (rs->ctx != NULL)
+		rte_acl_classify(rs->ctx, b->data, b->results, b->n, 1);
+	else
+		memset(b->results, 0, b->n * sizeof(b->results[0]));
+
+	last = b->results[0];
+	hits = 0;
+	for (unsigned i = 0; i < b->n; i++) {
+		// Consecutive packets usually match the same rule. Update the counters shared
+		// with the other workers once per run.
+		if (b->results[i] != last) {
+			atomic_fetch_add_explicit(
+				&rs->results[last].hits, hits, memory_order_relaxed
+			);
+			last = b->results[i];
+			hits = 0;
+		}
+		hits++;
+
+		if (rs->results[b->results[i]].action == GR_ACL_DENY)
+			next = DENIED;
+		else
+			next = accept_edge(b->mbufs[i], dir);
+		rte_node_enqueue_x1(graph, node, next, b->mbufs[i]);
+	}
+	atomic_fetch_add_explicit(&rs->results[last].hits, hits, memory_order_relaxed);
+
+	b->n = 0;
+}
+
+static inline uint16_t acl_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs,
+	gr_acl_dir_t dir
+) {
+	struct classify_batch batch;
+	const struct iface *iface;
+	struct acl_ruleset *rs;
+	struct rte_mbuf *mbuf;
+
+	batch.n = 0;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		if (dir == GR_ACL_INGRESS)
+			iface = ip_output_mbuf_data(mbuf)->input_iface;
+		else
+			iface = eth_output_mbuf_data(mbuf)->iface;
+
+		// The rule set may have been detached since the packet was diverted.
+		if ((rs = acl_iface_get(iface->id, dir)) == NULL) {
+			rte_node_enqueue_x1(graph, node, accept_edge(mbuf, dir), mbuf);
+			continue;
+		}
+		if (batch.n == RTE_DIM(batch.mbufs) || (batch.n > 0 && batch.rs != rs))
+			batch_flush(graph, node, &batch, dir);
+
+		batch.rs = rs;
+		acl_key_init(&batch.keys[batch.n], mbuf, iface->vrf_id);
+		batch.data[batch.n] = (const uint8_t *)&batch.keys[batch.n];
+		batch.mbufs[batch.n] = mbuf;
+		batch.n++;
+	}
+	if (batch.n > 0)
+		batch_flush(graph, node, &batch, dir);
+
+	return nb_objs;
+}
+
+static uint16_t
+acl_in_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	return acl_process(graph, node, objs, nb_objs, GR_ACL_INGRESS);
+}
+
+static uint16_t
+acl_out_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	return acl_process(graph, node, objs, nb_objs, GR_ACL_EGRESS);
+}
+
+static void acl_in_register(void) {
+	ip_input_add_hook(IP_INPUT_HOOK_ACL, "acl_in");
+}
+
+static void acl_out_register(void) {
+	ip_output_add_hook(IP_OUTPUT_HOOK_ACL, "acl_out");
+}
+
+static struct rte_node_register acl_in_node = {
+	.name = "acl_in",
+	.process = acl_in_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[DENIED] = "acl_in_denied",
+	},
+};
+
+static struct rte_node_register acl_out_node = {
+	.name = "acl_out",
+	.process = acl_out_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[DENIED] = "acl_out_denied",
+	},
+};
+
+static struct gr_node_info acl_in_info = {
+	.node = &acl_in_node,
+	.register_callback = acl_in_register,
+};
+
+static struct gr_node_info acl_out_info = {
+	.node = &acl_out_node,
+	.register_callback = acl_out_register,
+};
+
+GR_NODE_REGISTER(acl_in_info);
+GR_NODE_REGISTER(acl_out_info);
+
+GR_DROP_REGISTER(acl_in_denied);
+GR_DROP_REGISTER(acl_out_denied);
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_API_ACL
+#define _GR_API_ACL
+
+#include <gr_api.h>
+#include <gr_net_types.h>
+
+#include <stdint.h>
+
+// Maximum number of rule sets. Valid identifiers are 1 to GR_ACL_MAX - 1.
+#define GR_ACL_MAX 256
+// Maximum number of rules in a rule set.
+#define GR_ACL_MAX_RULES 1024
+
+#define GR_ACL_PERMIT 0
+#define GR_ACL_DENY 1
+typedef uint8_t gr_acl_action_t;
+
+static inline const char *gr_acl_action_name(const gr_acl_action_t action) {
+	switch (action) {
+	case GR_ACL_PERMIT:
+		return "permit";
+	case GR_ACL_DENY:
+		return "deny";
+	}
+	return "?";
+}
+
+#define GR_ACL_INGRESS 0 // Packets received on the interface, after IPv4 validation.
+#define GR_ACL_EGRESS 1 // Packets sent on the interface, before ethernet encapsulation.
+#define GR_ACL_DIR_COUNT 2
+typedef uint8_t gr_acl_dir_t;
+
+static inline const char *gr_acl_dir_name(const gr_acl_dir_t dir) {
+	switch (dir) {
+	case GR_ACL_INGRESS:
+		return "in";
+	case GR_ACL_EGRESS:
+		return "out";
+	}
+	return "?";
+}
+
+#define GR_ACL_VRF_ANY UINT16_MAX
+#define GR_ACL_DSCP_ANY UINT8_MAX
+
+// IPv4 packet filtering rule. Zero prefixes and protocols match everything.
+struct gr_acl_rule {
+	struct ip4_net src;
+	struct ip4_net dst;
+	// Inclusive port ranges, a zero maximum matches all ports. Restricted ranges require
+	// proto to be TCP or UDP.
+	uint16_t src_port_min;
+	uint16_t src_port_max;
+	uint16_t dst_port_min;
+	uint16_t dst_port_max;
+	uint16_t vrf_id; // GR_ACL_VRF_ANY matches all VRFs.
+	uint8_t proto;
+	uint8_t dscp; // GR_ACL_DSCP_ANY matches all values.
+	gr_acl_action_t action;
+};
+
+struct gr_acl {
+	uint16_t acl_id;
+	gr_acl_action_t default_action; // When no rule matches.
+	uint16_t n_rules;
+	uint32_t ref_count; // Number of interfaces using the rule set.
+};
+
+#define GR_ACL_MODULE 0xac1d
+
+// Create a rule set or atomically replace all its rules. Rules are evaluated in order, the
+// first matching rule wins. Replacing the rules resets the counters.
+#define GR_ACL_SET REQUEST_TYPE(GR_ACL_MODULE, 0x0001)
+
+struct gr_acl_set_req {
+	uint16_t acl_id;
+	gr_acl_action_t default_action;
+	uint16_t n_rules;
+	struct gr_acl_rule rules[/* n_rules */];
+};
+
+// struct gr_acl_set_resp { };
+
+#define GR_ACL_DEL REQUEST_TYPE(GR_ACL_MODULE, 0x0002)
+
+struct gr_acl_del_req {
+	uint16_t acl_id;
+	uint8_t missing_ok;
+};
+
+// struct gr_acl_del_resp { };
+
+#define GR_ACL_GET REQUEST_TYPE(GR_ACL_MODULE, 0x0003)
+
+struct gr_acl_get_req {
+	uint16_t acl_id;
+};
+
+struct gr_acl_get_resp {
+	struct gr_acl acl;
+	uint64_t default_hits; // Packets which did not match any rule.
+	struct {
+		struct gr_acl_rule rule;
+		uint64_t hits;
+	} rules[/* acl.n_rules */];
+};
+
+#define GR_ACL_LIST REQUEST_TYPE(GR_ACL_MODULE, 0x0004)
+
+// struct gr_acl_list_req { };
+
+struct gr_acl_list_resp {
+	uint16_t n_acls;
+	struct gr_acl acls[/* n_acls */];
+};
+
+// Attach a rule set to an interface, replacing the previous one. A zero acl_id detaches it.
+#define GR_ACL_ATTACH REQUEST_TYPE(GR_ACL_MODULE, 0x0005)
+
+struct gr_acl_attach_req {
+	uint16_t iface_id;
+	gr_acl_dir_t dir;
+	uint16_t acl_id;
+};
+
+// struct gr_acl_attach_resp { };
+
+#define GR_ACL_IFACE_LIST REQUEST_TYPE(GR_ACL_MODULE, 0x0006)
+
+// struct gr_acl_iface_list_req { };
+
+struct gr_acl_iface {
+	uint16_t iface_id;
+	gr_acl_dir_t dir;
+	uint16_t acl_id;
+};
+
+struct gr_acl_iface_list_resp {
+	uint16_t n_ifaces;
+	struct gr_acl_iface ifaces[/* n_ifaces */];
+};
+
+#endif
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_cli_iface.h>
+#include <gr_conntrack.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CT_SET_CTX(root)                                                                           \
+	CLI_CONTEXT(root, CTX_SET, CTX_ARG("conntrack", "Modify connection tracking."))
+#define CT_SHOW_CTX(root)                                                                          \
+	CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("conntrack", "Show connection tracking."))
+
+static cmd_status_t ct_iface_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ct_iface_set_req req = {0};
+	const char *mode = arg_str(p, "MODE");
+	struct gr_iface iface;
+
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+
+	req.iface.iface_id = iface.id;
+	if (strcmp(mode, "track") == 0)
+		req.iface.mode = GR_CT_MODE_TRACK;
+	else if (strcmp(mode, "firewall") == 0)
+		req.iface.mode = GR_CT_MODE_FIREWALL;
+	else
+		req.iface.mode = GR_CT_MODE_OFF;
+
+	if (gr_api_client_send_recv(c, GR_CT_IFACE_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t ct_vrf_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ct_vrf_set_req req = {0};
+
+	if (arg_u16(p, "VRF", &req.vrf_id) < 0)
+		return CMD_ERROR;
+	if (arg_u32(p, "MAX", &req.max_conns) < 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_CT_VRF_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t ct_timeouts_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ct_timeouts_set_req req = {0};
+	struct gr_ct_timeouts *t = &req.timeouts;
+
+	if (arg_u32(p, "SYN", &t->tcp_syn) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "EST", &t->tcp_established) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "FIN", &t->tcp_fin) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "CLOSE", &t->tcp_close) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "UDP", &t->udp) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "STREAM", &t->udp_stream) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "ICMP", &t->icmp) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "OTHER", &t->other) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_CT_TIMEOUTS_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t ct_iface_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ct_iface_list_resp *ifaces;
+	struct libscols_table *table;
+	struct gr_iface iface;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_CT_IFACE_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	ifaces = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "IFACE", 0, 0);
+	scols_table_new_column(table, "MODE", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < ifaces->n_ifaces; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_ct_iface *ci = &ifaces->ifaces[i];
+		if (iface_from_id(c, ci->iface_id, &iface) == 0)
+			scols_line_sprintf(line, 0, "%s", iface.name);
+		else
+			scols_line_sprintf(line, 0, "%u", ci->iface_id);
+		scols_line_sprintf(line, 1, "%s", gr_ct_mode_name(ci->mode));
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t ct_vrf_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ct_vrf_list_resp *vrfs;
+	struct libscols_table *table;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_CT_VRF_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	vrfs = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "VRF", 0, 0);
+	scols_table_new_column(table, "MAX", 0, 0);
+	scols_table_new_column(table, "ACTIVE", 0, 0);
+	scols_table_new_column(table, "CREATED", 0, 0);
+	scols_table_new_column(table, "LIMIT_DROPS", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < vrfs->n_vrfs; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_ct_vrf *v = &vrfs->vrfs[i];
+		scols_line_sprintf(line, 0, "%u", v->vrf_id);
+		if (v->max_conns == 0)
+			scols_line_set_data(line, 1, "none");
+		else
+			scols_line_sprintf(line, 1, "%u", v->max_conns);
+		scols_line_sprintf(line, 2, "%u", v->active);
+		scols_line_sprintf(line, 3, "%lu", v->created);
+		scols_line_sprintf(line, 4, "%lu", v->limit_drops);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t ct_timeouts_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ct_timeouts_get_resp *resp;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_CT_TIMEOUTS_GET, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("tcp_syn: %u\n", resp->timeouts.tcp_syn);
+	printf("tcp_established: %u\n", resp->timeouts.tcp_established);
+	printf("tcp_fin: %u\n", resp->timeouts.tcp_fin);
+	printf("tcp_close: %u\n", resp->timeouts.tcp_close);
+	printf("udp: %u\n", resp->timeouts.udp);
+	printf("udp_stream: %u\n", resp->timeouts.udp_stream);
+	printf("icmp: %u\n", resp->timeouts.icmp);
+	printf("other: %u\n", resp->timeouts.other);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+#define TIMEOUT_ARG(id, help) with_help(help, ec_node_uint(id, 1, UINT32_MAX, 10))
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		CT_SET_CTX(root),
+		"iface IFACE mode MODE",
+		ct_iface_set,
+		"Configure connection tracking on an interface.",
+		with_help("Interface name.", ec_node_dyn("IFACE", complete_iface_names, NULL)),
+		with_help(
+			"Tracking mode of received packets.",
+			ec_node_re("MODE", "off|track|firewall")
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CT_SET_CTX(root),
+		"vrf VRF max MAX",
+		ct_vrf_set,
+		"Limit the number of connections tracked in a VRF.",
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10)),
+		with_help(
+			"Maximum connections, 0 for no limit.",
+			ec_node_uint("MAX", 0, UINT32_MAX, 10)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CT_SET_CTX(root),
+		"timeout (syn SYN),(established EST),(fin FIN),(close CLOSE),"
+		"(udp UDP),(udp_stream STREAM),(icmp ICMP),(other OTHER)",
+		ct_timeouts_set,
+		"Change the idle timeouts of tracked connections.",
+		TIMEOUT_ARG("SYN", "TCP handshake in progress (seconds)."),
+		TIMEOUT_ARG("EST", "TCP established (seconds)."),
+		TIMEOUT_ARG("FIN", "TCP closing (seconds)."),
+		TIMEOUT_ARG("CLOSE", "TCP reset or closed (seconds)."),
+		TIMEOUT_ARG("UDP", "UDP without reply (seconds)."),
+		TIMEOUT_ARG("STREAM", "UDP with replies (seconds)."),
+		TIMEOUT_ARG("ICMP", "ICMP echo (seconds)."),
+		TIMEOUT_ARG("OTHER", "Other protocols (seconds).")
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CT_SHOW_CTX(root), "iface", ct_iface_show, "Show connection tracking interfaces."
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CT_SHOW_CTX(root), "vrf", ct_vrf_show, "Show connection tracking VRF counters."
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CT_SHOW_CTX(root), "timeout", ct_timeouts_show, "Show connection tracking timeouts."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "conntrack",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
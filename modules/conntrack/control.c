@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ct_priv.h"
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+
+#include <rte_common.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// Connections are owned by the workers. Only the per VRF counters are shared.
+struct ct_vrf_stats {
+	uint32_t max_conns;
+	_Atomic(uint32_t) active;
+	_Atomic(uint64_t) created;
+	_Atomic(uint64_t) limit_drops;
+};
+
+static struct ct_vrf_stats vrf_stats[IP4_MAX_VRFS];
+static gr_ct_mode_t iface_modes[MAX_IFACES];
+static struct gr_ct_timeouts timeouts = {
+	.tcp_syn = CT_TIMEOUT_TCP_SYN,
+	.tcp_established = CT_TIMEOUT_TCP_ESTABLISHED,
+	.tcp_fin = CT_TIMEOUT_TCP_FIN,
+	.tcp_close = CT_TIMEOUT_TCP_CLOSE,
+	.udp = CT_TIMEOUT_UDP,
+	.udp_stream = CT_TIMEOUT_UDP_STREAM,
+	.icmp = CT_TIMEOUT_ICMP,
+	.other = CT_TIMEOUT_OTHER,
+};
+
+gr_ct_mode_t ct_iface_mode(uint16_t iface_id) {
+	return iface_modes[iface_id];
+}
+
+const struct gr_ct_timeouts *ct_timeouts(void) {
+	return &timeouts;
+}
+
+bool ct_vrf_conn_add(uint16_t vrf_id) {
+	struct ct_vrf_stats *s = &vrf_stats[vrf_id];
+	uint32_t active;
+
+	active = atomic_fetch_add_explicit(&s->active, 1, memory_order_relaxed);
+	if (s->max_conns != 0 && active >= s->max_conns) {
+		atomic_fetch_sub_explicit(&s->active, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&s->limit_drops, 1, memory_order_relaxed);
+		return false;
+	}
+	atomic_fetch_add_explicit(&s->created, 1, memory_order_relaxed);
+
+	return true;
+}
+
+void ct_vrf_conn_del(uint16_t vrf_id) {
+	atomic_fetch_sub_explicit(&vrf_stats[vrf_id].active, 1, memory_order_relaxed);
+}
+
+static void iface_mode_set(uint16_t iface_id, gr_ct_mode_t mode) {
+	iface_modes[iface_id] = mode;
+	ip_input_hook_enable(iface_id, IP_INPUT_HOOK_CONNTRACK, mode != GR_CT_MODE_OFF);
+}
+
+static struct api_out ct_iface_set(const void *request, void **response) {
+	const struct gr_ct_iface_set_req *req = request;
+
+	(void)response;
+
+	if (iface_from_id(req->iface.iface_id) == NULL)
+		return api_out(errno, 0);
+
+	switch (req->iface.mode) {
+	case GR_CT_MODE_OFF:
+	case GR_CT_MODE_TRACK:
+	case GR_CT_MODE_FIREWALL:
+		break;
+	default:
+		return api_out(EINVAL, 0);
+	}
+
+	iface_mode_set(req->iface.iface_id, req->iface.mode);
+
+	return api_out(0, 0);
+}
+
+static struct api_out ct_iface_list(const void *request, void **response) {
+	struct gr_ct_iface_list_resp *resp;
+	struct gr_ct_iface *i;
+	size_t len;
+
+	(void)request;
+
+	len = sizeof(*resp) + MAX_IFACES * sizeof(resp->ifaces[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (uint16_t iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		if (iface_modes[iface_id] == GR_CT_MODE_OFF)
+			continue;
+		i = &resp->ifaces[resp->n_ifaces++];
+		i->iface_id = iface_id;
+		i->mode = iface_modes[iface_id];
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_ifaces * sizeof(resp->ifaces[0]));
+}
+
+static struct api_out ct_vrf_set(const void *request, void **response) {
+	const struct gr_ct_vrf_set_req *req = request;
+
+	(void)response;
+
+	if (req->vrf_id >= IP4_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+
+	// Existing connections are kept when lowering the limit.
+	vrf_stats[req->vrf_id].max_conns = req->max_conns;
+
+	return api_out(0, 0);
+}
+
+static struct api_out ct_vrf_list(const void *request, void **response) {
+	struct gr_ct_vrf_list_resp *resp;
+	struct ct_vrf_stats *s;
+	struct gr_ct_vrf *v;
+	size_t len;
+
+	(void)request;
+
+	len = sizeof(*resp) + IP4_MAX_VRFS * sizeof(resp->vrfs[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (uint16_t vrf_id = 0; vrf_id < IP4_MAX_VRFS; vrf_id++) {
+		s = &vrf_stats[vrf_id];
+		if (s->max_conns == 0 && atomic_load(&s->created) == 0)
+			continue;
+		v = &resp->vrfs[resp->n_vrfs++];
+		v->vrf_id = vrf_id;
+		v->max_conns = s->max_conns;
+		v->active = atomic_load_explicit(&s->active, memory_order_relaxed);
+		v->created = atomic_load_explicit(&s->created, memory_order_relaxed);
+		v->limit_drops = atomic_load_explicit(&s->limit_drops, memory_order_relaxed);
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_vrfs * sizeof(resp->vrfs[0]));
+}
+
+static struct api_out ct_timeouts_set(const void *request, void **response) {
+	const struct gr_ct_timeouts_set_req *req = request;
+
+	(void)response;
+
+	if (req->timeouts.tcp_syn != 0)
+		timeouts.tcp_syn = req->timeouts.tcp_syn;
+	if (req->timeouts.tcp_established != 0)
+		timeouts.tcp_established = req->timeouts.tcp_established;
+	if (req->timeouts.tcp_fin != 0)
+		timeouts.tcp_fin = req->timeouts.tcp_fin;
+	if (req->timeouts.tcp_close != 0)
+		timeouts.tcp_close = req->timeouts.tcp_close;
+	if (req->timeouts.udp != 0)
+		timeouts.udp = req->timeouts.udp;
+	if (req->timeouts.udp_stream != 0)
+		timeouts.udp_stream = req->timeouts.udp_stream;
+	if (req->timeouts.icmp != 0)
+		timeouts.icmp = req->timeouts.icmp;
+	if (req->timeouts.other != 0)
+		timeouts.other = req->timeouts.other;
+
+	return api_out(0, 0);
+}
+
+static struct api_out ct_timeouts_get(const void *request, void **response) {
+	struct gr_ct_timeouts_get_resp *resp;
+
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->timeouts = timeouts;
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	if (event != IFACE_EVENT_PRE_REMOVE)
+		return;
+	iface_mode_set(iface->id, GR_CT_MODE_OFF);
+}
+
+static struct gr_api_handler ct_iface_set_handler = {
+	.name = "conntrack iface set",
+	.request_type = GR_CT_IFACE_SET,
+	.callback = ct_iface_set,
+};
+static struct gr_api_handler ct_iface_list_handler = {
+	.name = "conntrack iface list",
+	.request_type = GR_CT_IFACE_LIST,
+	.callback = ct_iface_list,
+};
+static struct gr_api_handler ct_vrf_set_handler = {
+	.name = "conntrack vrf set",
+	.request_type = GR_CT_VRF_SET,
+	.callback = ct_vrf_set,
+};
+static struct gr_api_handler ct_vrf_list_handler = {
+	.name = "conntrack vrf list",
+	.request_type = GR_CT_VRF_LIST,
+	.callback = ct_vrf_list,
+};
+static struct gr_api_handler ct_timeouts_set_handler = {
+	.name = "conntrack timeouts set",
+	.request_type = GR_CT_TIMEOUTS_SET,
+	.callback = ct_timeouts_set,
+};
+static struct gr_api_handler ct_timeouts_get_handler = {
+	.name = "conntrack timeouts get",
+	.request_type = GR_CT_TIMEOUTS_GET,
+	.callback = ct_timeouts_get,
+};
+
+static struct iface_event_handler iface_event_ct_handler = {
+	.callback = iface_event_handler,
+};
+
+static struct gr_module ct_module = {
+	.name = "conntrack",
+	.tick_dp = ct_worker_tick,
+};
+
+RTE_INIT(conntrack_constructor) {
+	gr_register_api_handler(&ct_iface_set_handler);
+	gr_register_api_handler(&ct_iface_list_handler);
+	gr_register_api_handler(&ct_vrf_set_handler);
+	gr_register_api_handler(&ct_vrf_list_handler);
+	gr_register_api_handler(&ct_timeouts_set_handler);
+	gr_register_api_handler(&ct_timeouts_get_handler);
+	iface_event_register_handler(&iface_event_ct_handler);
+	gr_register_module(&ct_module);
+}
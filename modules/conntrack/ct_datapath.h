@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _CT_DATAPATH_H
+#define _CT_DATAPATH_H
+
+#include "ct_priv.h"
+
+#include <gr_net_types.h>
+
+#include <rte_byteorder.h>
+#include <rte_common.h>
+#include <rte_hash.h>
+#include <rte_icmp.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Connections are checked for expiry once per second. Connections expiring later than
+// CT_WHEEL_SLOTS seconds in the future are checked again when their slot comes around.
+#define CT_WHEEL_SLOTS 1024
+// Maximum amount of work done to expire connections on each worker tick.
+#define CT_EXPIRE_MAX_CONNS 256
+#define CT_EXPIRE_MAX_SLOTS 16
+#define CT_NONE UINT32_MAX
+
+#define CT_DIR_ORIG 0
+#define CT_DIR_REPLY 1
+
+// Packets addressed to the same connection in the same direction have the same key. Each
+// connection is stored twice in the hash table, with its original and reply tuples.
+//
+// Fragments of an accepted datagram are stored once, keyed by the IP identifier in sport.
+struct ct_key {
+	ip4_addr_t src;
+	ip4_addr_t dst;
+	rte_be16_t sport;
+	rte_be16_t dport;
+	uint16_t vrf_id;
+	uint8_t proto;
+	uint8_t frag;
+} __attribute__((packed));
+
+typedef enum {
+	CT_STATE_NONE = 0,
+	CT_STATE_TCP_SYN_SENT,
+	CT_STATE_TCP_SYN_RECV,
+	CT_STATE_TCP_ESTABLISHED,
+	CT_STATE_TCP_FIN_WAIT,
+	CT_STATE_TCP_LAST_ACK,
+	CT_STATE_TCP_TIME_WAIT,
+	CT_STATE_TCP_CLOSE,
+	CT_STATE_NEW, // UDP, ICMP and other protocols, no reply seen yet.
+	CT_STATE_REPLIED,
+	CT_STATE_FRAG, // Remaining fragments of an accepted first fragment.
+} ct_state_t;
+
+struct ct_conn {
+	struct ct_key tuples[2];
+	uint32_t expire;
+	// Expiry wheel slot list, also used to chain free connections.
+	uint32_t prev;
+	uint32_t next;
+	uint8_t state; // ct_state_t
+	uint8_t fin; // Bit mask of directions which sent a FIN.
+};
+
+// Each worker tracks the connections of the packets it receives. This requires a symmetric
+// RSS hash and that both directions of a connection are received by the same worker.
+struct ct_ctx {
+	struct rte_hash *hash;
+	uint64_t tsc_hz;
+	uint32_t now; // Seconds, refreshed on each node invocation and worker tick.
+	uint32_t wheel_time; // Next wheel slot to process.
+	uint32_t free_head;
+	uint32_t wheel[CT_WHEEL_SLOTS];
+	struct ct_conn conns[CT_WORKER_MAX_CONNS];
+};
+
+static inline void ct_ctx_init(struct ct_ctx *ctx, uint32_t now) {
+	ctx->now = now;
+	ctx->wheel_time = now;
+	for (unsigned i = 0; i < CT_WHEEL_SLOTS; i++)
+		ctx->wheel[i] = CT_NONE;
+	for (uint32_t i = 0; i < CT_WORKER_MAX_CONNS; i++)
+		ctx->conns[i].next = i + 1;
+	ctx->conns[CT_WORKER_MAX_CONNS - 1].next = CT_NONE;
+	ctx->free_head = 0;
+}
+
+typedef enum {
+	CT_PKT_TRACK, // Key holds the packet tuple.
+	CT_PKT_RELATED, // Key holds the tuple of the packet quoted in an ICMP error.
+	CT_PKT_FRAGMENT, // Key holds the fragment tuple of a not first fragment.
+	CT_PKT_UNTRACKED, // ICMP messages other than echo and errors.
+	CT_PKT_INVALID, // Truncated headers.
+} ct_pkt_t;
+
+static inline void
+ct_key_frag(struct ct_key *key, const struct rte_ipv4_hdr *ip, uint16_t vrf_id) {
+	memset(key, 0, sizeof(*key));
+	key->src = ip->src_addr;
+	key->dst = ip->dst_addr;
+	key->sport = ip->packet_id;
+	key->vrf_id = vrf_id;
+	key->proto = ip->next_proto_id;
+	key->frag = 1;
+}
+
+static inline ct_pkt_t ct_key_init(
+	struct ct_key *key,
+	const struct rte_ipv4_hdr *ip,
+	uint32_t len,
+	uint16_t vrf_id,
+	uint8_t *flags,
+	bool inner
+) {
+	const struct rte_icmp_hdr *icmp;
+	const struct rte_tcp_hdr *tcp;
+	const rte_be16_t *ports;
+	size_t ihl;
+
+	memset(key, 0, sizeof(*key));
+	*flags = 0;
+
+	ihl = rte_ipv4_hdr_len(ip);
+	if (len < ihl)
+		return CT_PKT_INVALID;
+	if (ip->fragment_offset & RTE_BE16(RTE_IPV4_HDR_OFFSET_MASK)) {
+		// The transport header is only in the first fragment.
+		if (inner)
+			return CT_PKT_INVALID;
+		ct_key_frag(key, ip, vrf_id);
+		return CT_PKT_FRAGMENT;
+	}
+
+	key->src = ip->src_addr;
+	key->dst = ip->dst_addr;
+	key->vrf_id = vrf_id;
+	key->proto = ip->next_proto_id;
+
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+		// ICMP errors only quote the first 8 bytes of the transport header.
+		if (len < ihl + (inner ? 2 * sizeof(*ports) : sizeof(*tcp)))
+			return CT_PKT_INVALID;
+		tcp = (const struct rte_tcp_hdr *)((const uint8_t *)ip + ihl);
+		key->sport = tcp->src_port;
+		key->dport = tcp->dst_port;
+		if (!inner)
+			*flags = tcp->tcp_flags;
+		break;
+	case IPPROTO_UDP:
+		if (len < ihl + 2 * sizeof(*ports))
+			return CT_PKT_INVALID;
+		ports = (const rte_be16_t *)((const uint8_t *)ip + ihl);
+		key->sport = ports[0];
+		key->dport = ports[1];
+		break;
+	case IPPROTO_ICMP:
+		if (len < ihl + sizeof(*icmp))
+			return CT_PKT_INVALID;
+		icmp = (const struct rte_icmp_hdr *)((const uint8_t *)ip + ihl);
+		switch (icmp->icmp_type) {
+		case RTE_IP_ICMP_ECHO_REQUEST:
+		case RTE_IP_ICMP_ECHO_REPLY:
+			// Requests and replies have the same identifier.
+			key->sport = icmp->icmp_ident;
+			key->dport = icmp->icmp_ident;
+			*flags = icmp->icmp_type;
+			break;
+		case 3: // Destination unreachable.
+		case 4: // Source quench.
+		case 5: // Redirect.
+		case 11: // Time exceeded.
+		case 12: // Parameter problem.
+			if (inner)
+				return CT_PKT_INVALID;
+			ip = (const struct rte_ipv4_hdr *)(icmp + 1);
+			len -= ihl + sizeof(*icmp);
+			if (len < sizeof(*ip)
+			    || ct_key_init(key, ip, len, vrf_id, flags, true) != CT_PKT_TRACK)
+				return CT_PKT_INVALID;
+			return CT_PKT_RELATED;
+		default:
+			return CT_PKT_UNTRACKED;
+		}
+		break;
+	}
+
+	return CT_PKT_TRACK;
+}
+
+static inline void ct_key_reverse(struct ct_key *dst, const struct ct_key *src) {
+	*dst = *src;
+	dst->src = src->dst;
+	dst->dst = src->src;
+	dst->sport = src->dport;
+	dst->dport = src->sport;
+}
+
+static inline uint32_t ct_conn_id(const struct ct_ctx *ctx, const struct ct_conn *conn) {
+	return conn - ctx->conns;
+}
+
+static inline void ct_wheel_link(struct ct_ctx *ctx, struct ct_conn *conn) {
+	uint32_t id = ct_conn_id(ctx, conn);
+	uint32_t *head, when;
+
+	// Never link in the slot being processed, the connection would be checked again.
+	when = RTE_MIN(conn->expire, ctx->wheel_time + CT_WHEEL_SLOTS - 1);
+	head = &ctx->wheel[when % CT_WHEEL_SLOTS];
+	conn->prev = CT_NONE;
+	conn->next = *head;
+	if (*head != CT_NONE)
+		ctx->conns[*head].prev = id;
+	*head = id;
+}
+
+// Only used on connections linked in the slot being processed.
+static inline void ct_wheel_unlink(struct ct_ctx *ctx, struct ct_conn *conn) {
+	if (conn->prev != CT_NONE)
+		ctx->conns[conn->prev].next = conn->next;
+	else
+		ctx->wheel[ctx->wheel_time % CT_WHEEL_SLOTS] = conn->next;
+	if (conn->next != CT_NONE)
+		ctx->conns[conn->next].prev = conn->prev;
+}
+
+static inline void ct_conn_free(struct ct_ctx *ctx, struct ct_conn *conn) {
+	rte_hash_del_key(ctx->hash, &conn->tuples[CT_DIR_ORIG]);
+	if (conn->state != CT_STATE_FRAG) {
+		rte_hash_del_key(ctx->hash, &conn->tuples[CT_DIR_REPLY]);
+		ct_vrf_conn_del(conn->tuples[CT_DIR_ORIG].vrf_id);
+	}
+	conn->state = CT_STATE_NONE;
+	conn->next = ctx->free_head;
+	ctx->free_head = ct_conn_id(ctx, conn);
+}
+
+static inline void ct_expire(struct ct_ctx *ctx) {
+	unsigned conns = 0, slots = 0;
+	struct ct_conn *conn;
+	uint32_t *head;
+
+	while (ctx->wheel_time <= ctx->now) {
+		head = &ctx->wheel[ctx->wheel_time % CT_WHEEL_SLOTS];
+		while (*head != CT_NONE) {
+			if (conns++ == CT_EXPIRE_MAX_CONNS)
+				return;
+			conn = &ctx->conns[*head];
+			ct_wheel_unlink(ctx, conn);
+			if (conn->expire <= ctx->now)
+				ct_conn_free(ctx, conn);
+			else
+				ct_wheel_link(ctx, conn);
+		}
+		if (slots++ == CT_EXPIRE_MAX_SLOTS)
+			return;
+		ctx->wheel_time++;
+	}
+}
+
+static inline void
+ct_conn_refresh(struct ct_ctx *ctx, struct ct_conn *conn, const struct gr_ct_timeouts *timeouts) {
+	uint32_t timeout;
+
+	switch (conn->state) {
+	case CT_STATE_TCP_SYN_SENT:
+	case CT_STATE_TCP_SYN_RECV:
+		timeout = timeouts->tcp_syn;
+		break;
+	case CT_STATE_TCP_ESTABLISHED:
+		timeout = timeouts->tcp_established;
+		break;
+	case CT_STATE_TCP_FIN_WAIT:
+	case CT_STATE_TCP_LAST_ACK:
+		timeout = timeouts->tcp_fin;
+		break;
+	case CT_STATE_TCP_TIME_WAIT:
+	case CT_STATE_TCP_CLOSE:
+		timeout = timeouts->tcp_close;
+		break;
+	case CT_STATE_NEW:
+	case CT_STATE_REPLIED:
+		switch (conn->tuples[CT_DIR_ORIG].proto) {
+		case IPPROTO_UDP:
+			if (conn->state == CT_STATE_NEW)
+				timeout = timeouts->udp;
+			else
+				timeout = timeouts->udp_stream;
+			break;
+		case IPPROTO_ICMP:
+			timeout = timeouts->icmp;
+			break;
+		default:
+			timeout = timeouts->other;
+		}
+		break;
+	case CT_STATE_FRAG:
+		timeout = CT_TIMEOUT_FRAG;
+		break;
+	default:
+		timeout = 0;
+	}
+
+	// The connection stays in its current wheel slot and is moved when that slot is
+	// processed. This avoids touching the wheel lists for every packet.
+	conn->expire = ctx->now + timeout;
+}
+
+// Update the TCP state machine. Returns false if the packet is invalid for the state.
+static inline bool ct_tcp_update(struct ct_conn *conn, unsigned dir, uint8_t flags) {
+	const uint8_t syn_ack = RTE_TCP_SYN_FLAG | RTE_TCP_ACK_FLAG;
+
+	if (flags & RTE_TCP_RST_FLAG) {
+		conn->state = CT_STATE_TCP_CLOSE;
+		return true;
+	}
+
+	switch (conn->state) {
+	case CT_STATE_TCP_SYN_SENT:
+		if (dir == CT_DIR_REPLY && (flags & syn_ack) == syn_ack) {
+			conn->state = CT_STATE_TCP_SYN_RECV;
+			return true;
+		}
+		// Retransmitted SYN.
+		return dir == CT_DIR_ORIG && (flags & syn_ack) == RTE_TCP_SYN_FLAG;
+	case CT_STATE_TCP_SYN_RECV:
+		if (dir == CT_DIR_ORIG && (flags & syn_ack) == RTE_TCP_ACK_FLAG)
+			conn->state = CT_STATE_TCP_ESTABLISHED;
+		break;
+	case CT_STATE_TCP_TIME_WAIT:
+	case CT_STATE_TCP_CLOSE:
+		// Port reuse.
+		if (dir == CT_DIR_ORIG && (flags & syn_ack) == RTE_TCP_SYN_FLAG) {
+			conn->state = CT_STATE_TCP_SYN_SENT;
+			conn->fin = 0;
+		}
+		return true;
+	case CT_STATE_TCP_LAST_ACK:
+		if (!(flags & RTE_TCP_FIN_FLAG) && flags & RTE_TCP_ACK_FLAG) {
+			conn->state = CT_STATE_TCP_TIME_WAIT;
+			return true;
+		}
+		break;
+	}
+
+	if (flags & RTE_TCP_FIN_FLAG) {
+		conn->fin |= 1 << dir;
+		if (conn->fin == 0x3)
+			conn->state = CT_STATE_TCP_LAST_ACK;
+		else
+			conn->state = CT_STATE_TCP_FIN_WAIT;
+	}
+
+	return true;
+}
+
+// Packets closing connections and ICMP echo replies do not create connections.
+static inline bool ct_pkt_initiates(const struct ct_key *key, uint8_t flags) {
+	switch (key->proto) {
+	case IPPROTO_TCP:
+		return !(flags & (RTE_TCP_RST_FLAG | RTE_TCP_FIN_FLAG));
+	case IPPROTO_ICMP:
+		return flags == RTE_IP_ICMP_ECHO_REQUEST;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _CT_PRIV_H
+#define _CT_PRIV_H
+
+#include <gr_conntrack.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maximum number of connections tracked by each worker.
+#define CT_WORKER_MAX_CONNS (1 << 16)
+
+// Default timeouts (in seconds), same as Linux.
+#define CT_TIMEOUT_TCP_SYN 120
+#define CT_TIMEOUT_TCP_ESTABLISHED (5 * 24 * 3600)
+#define CT_TIMEOUT_TCP_FIN 120
+#define CT_TIMEOUT_TCP_CLOSE 10
+#define CT_TIMEOUT_UDP 30
+#define CT_TIMEOUT_UDP_STREAM 120
+#define CT_TIMEOUT_ICMP 30
+#define CT_TIMEOUT_OTHER 600
+// Remaining fragments of a datagram are accepted for this long after the first one.
+#define CT_TIMEOUT_FRAG 30
+
+// Get the mode of an interface, read without locking by the datapath workers.
+gr_ct_mode_t ct_iface_mode(uint16_t iface_id);
+// Timeouts, read without locking by the datapath workers.
+const struct gr_ct_timeouts *ct_timeouts(void);
+// Account for a new connection in a VRF. Returns false if the VRF limit is reached.
+bool ct_vrf_conn_add(uint16_t vrf_id);
+// Account for an expired connection in a VRF.
+void ct_vrf_conn_del(uint16_t vrf_id);
+// Expire the connections of the calling worker, called periodically by all workers.
+void ct_worker_tick(void);
+
+#endif
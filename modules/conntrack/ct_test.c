@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ct_datapath.h"
+
+#include <gr_cmocka.h>
+
+#include <rte_byteorder.h>
+#include <rte_icmp.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYN RTE_TCP_SYN_FLAG
+#define ACK RTE_TCP_ACK_FLAG
+#define FIN RTE_TCP_FIN_FLAG
+#define RST RTE_TCP_RST_FLAG
+#define ORIG CT_DIR_ORIG
+#define REPLY CT_DIR_REPLY
+#define NOW 1000
+
+// mocked functions
+static unsigned hash_dels;
+static unsigned vrf_dels;
+
+int __wrap_rte_hash_del_key(const struct rte_hash *, const void *);
+int __wrap_rte_hash_del_key(const struct rte_hash *, const void *) {
+	hash_dels++;
+	return 0;
+}
+
+void ct_vrf_conn_del(uint16_t) {
+	vrf_dels++;
+}
+
+static struct ct_ctx *ctx;
+
+static int setup(void **) {
+	if ((ctx = calloc(1, sizeof(*ctx))) == NULL)
+		return -1;
+	ct_ctx_init(ctx, NOW);
+	hash_dels = 0;
+	vrf_dels = 0;
+	return 0;
+}
+
+static int teardown(void **) {
+	free(ctx);
+	return 0;
+}
+
+static struct ct_conn *conn_new(ct_state_t state, uint32_t expire) {
+	struct ct_conn *conn;
+
+	assert_int_not_equal(ctx->free_head, CT_NONE);
+	conn = &ctx->conns[ctx->free_head];
+	ctx->free_head = conn->next;
+	conn->state = state;
+	conn->fin = 0;
+	conn->expire = expire;
+	ct_wheel_link(ctx, conn);
+
+	return conn;
+}
+
+static unsigned wheel_count(void) {
+	unsigned count = 0;
+
+	for (unsigned i = 0; i < CT_WHEEL_SLOTS; i++) {
+		for (uint32_t id = ctx->wheel[i]; id != CT_NONE; id = ctx->conns[id].next)
+			count++;
+	}
+
+	return count;
+}
+
+struct tcp_step {
+	unsigned dir;
+	uint8_t flags;
+	bool valid;
+	ct_state_t state;
+};
+
+static void tcp_run(ct_state_t initial, const struct tcp_step *steps, unsigned n) {
+	struct ct_conn conn = {.state = initial};
+
+	for (unsigned i = 0; i < n; i++) {
+		if (ct_tcp_update(&conn, steps[i].dir, steps[i].flags) != steps[i].valid)
+			fail_msg("step %u: expected valid=%d", i, steps[i].valid);
+		if (conn.state != steps[i].state)
+			fail_msg("step %u: state %u, expected %u", i, conn.state, steps[i].state);
+	}
+}
+
+static void tcp_lifecycle(void **) {
+	const struct tcp_step steps[] = {
+		{ORIG, SYN, true, CT_STATE_TCP_SYN_SENT},
+		{REPLY, SYN | ACK, true, CT_STATE_TCP_SYN_RECV},
+		{ORIG, ACK, true, CT_STATE_TCP_ESTABLISHED},
+		{REPLY, ACK, true, CT_STATE_TCP_ESTABLISHED},
+		{ORIG, FIN | ACK, true, CT_STATE_TCP_FIN_WAIT},
+		{REPLY, ACK, true, CT_STATE_TCP_FIN_WAIT},
+		{REPLY, FIN | ACK, true, CT_STATE_TCP_LAST_ACK},
+		{ORIG, ACK, true, CT_STATE_TCP_TIME_WAIT},
+		// port reuse
+		{ORIG, SYN, true, CT_STATE_TCP_SYN_SENT},
+	};
+
+	tcp_run(CT_STATE_TCP_SYN_SENT, steps, RTE_DIM(steps));
+}
+
+static void tcp_invalid(void **) {
+	const struct tcp_step syn_sent[] = {
+		{REPLY, ACK, false, CT_STATE_TCP_SYN_SENT},
+		{ORIG, SYN | ACK, false, CT_STATE_TCP_SYN_SENT},
+		{REPLY, SYN, false, CT_STATE_TCP_SYN_SENT},
+		// retransmitted SYN
+		{ORIG, SYN, true, CT_STATE_TCP_SYN_SENT},
+	};
+	const struct tcp_step reset[] = {
+		{REPLY, RST, true, CT_STATE_TCP_CLOSE},
+		{REPLY, SYN, true, CT_STATE_TCP_CLOSE},
+	};
+
+	tcp_run(CT_STATE_TCP_SYN_SENT, syn_sent, RTE_DIM(syn_sent));
+	tcp_run(CT_STATE_TCP_ESTABLISHED, reset, RTE_DIM(reset));
+}
+
+static void tcp_fin_reset(void **) {
+	struct ct_conn conn = {.state = CT_STATE_TCP_TIME_WAIT, .fin = 0x3};
+
+	assert_true(ct_tcp_update(&conn, ORIG, SYN));
+	assert_int_equal(conn.state, CT_STATE_TCP_SYN_SENT);
+	assert_int_equal(conn.fin, 0);
+}
+
+static void wheel_expire(void **) {
+	struct ct_conn *a, *b, *c;
+
+	a = conn_new(CT_STATE_NEW, NOW + 1);
+	b = conn_new(CT_STATE_NEW, NOW + 1);
+	c = conn_new(CT_STATE_NEW, NOW + 5);
+	assert_int_equal(wheel_count(), 3);
+
+	ct_expire(ctx);
+	assert_int_equal(wheel_count(), 3);
+
+	ctx->now = NOW + 1;
+	ct_expire(ctx);
+	assert_int_equal(a->state, CT_STATE_NONE);
+	assert_int_equal(b->state, CT_STATE_NONE);
+	assert_int_equal(c->state, CT_STATE_NEW);
+	assert_int_equal(wheel_count(), 1);
+	assert_int_equal(hash_dels, 4);
+	assert_int_equal(vrf_dels, 2);
+	// freed connections are reused first
+	assert_int_equal(ctx->free_head, ct_conn_id(ctx, a));
+
+	// refreshed connections are moved when their old slot is processed
+	c->expire = NOW + 20;
+	ctx->now = NOW + 10;
+	ct_expire(ctx);
+	assert_int_equal(c->state, CT_STATE_NEW);
+	assert_int_equal(ctx->wheel[(NOW + 20) % CT_WHEEL_SLOTS], ct_conn_id(ctx, c));
+
+	ctx->now = NOW + 20;
+	ct_expire(ctx);
+	assert_int_equal(c->state, CT_STATE_NONE);
+	assert_int_equal(wheel_count(), 0);
+	assert_int_equal(vrf_dels, 3);
+}
+
+static void wheel_far_future(void **) {
+	const uint32_t expire = NOW + 3 * CT_WHEEL_SLOTS + 5;
+	struct ct_conn *conn;
+
+	conn = conn_new(CT_STATE_TCP_ESTABLISHED, expire);
+
+	for (ctx->now = NOW; ctx->now < expire; ctx->now++) {
+		ct_expire(ctx);
+		if (conn->state != CT_STATE_TCP_ESTABLISHED)
+			fail_msg("expired at %u", ctx->now);
+		assert_int_equal(wheel_count(), 1);
+	}
+
+	ct_expire(ctx);
+	assert_int_equal(conn->state, CT_STATE_NONE);
+	assert_int_equal(wheel_count(), 0);
+}
+
+static void wheel_budget(void **) {
+	const unsigned n = CT_EXPIRE_MAX_CONNS + 10;
+
+	for (unsigned i = 0; i < n; i++)
+		conn_new(CT_STATE_NEW, NOW + 1);
+
+	ctx->now = NOW + 1;
+	ct_expire(ctx);
+	assert_int_equal(vrf_dels, CT_EXPIRE_MAX_CONNS);
+	assert_int_equal(wheel_count(), 10);
+
+	ct_expire(ctx);
+	assert_int_equal(vrf_dels, n);
+	assert_int_equal(wheel_count(), 0);
+
+	// An idle worker catches up with a long pause a few slots at a time.
+	conn_new(CT_STATE_NEW, NOW + 100);
+	ctx->now = NOW + 1000;
+	for (unsigned i = 0; i < 1000 / CT_EXPIRE_MAX_SLOTS + 1; i++)
+		ct_expire(ctx);
+	assert_int_equal(wheel_count(), 0);
+	assert_int_equal(ctx->wheel_time, ctx->now + 1);
+}
+
+static void frag_entry(void **) {
+	struct gr_ct_timeouts timeouts = {0};
+	struct ct_conn *conn;
+
+	conn = conn_new(CT_STATE_FRAG, NOW + CT_TIMEOUT_FRAG);
+	ct_conn_refresh(ctx, conn, &timeouts);
+	assert_int_equal(conn->expire, NOW + CT_TIMEOUT_FRAG);
+
+	for (ctx->now = NOW; ctx->now < NOW + CT_TIMEOUT_FRAG; ctx->now++) {
+		ct_expire(ctx);
+		assert_int_equal(conn->state, CT_STATE_FRAG);
+	}
+
+	// only the original tuple is stored and it is not accounted in the VRF
+	ct_expire(ctx);
+	assert_int_equal(conn->state, CT_STATE_NONE);
+	assert_int_equal(hash_dels, 1);
+	assert_int_equal(vrf_dels, 0);
+}
+
+struct pkt {
+	struct rte_ipv4_hdr ip;
+	struct rte_icmp_hdr icmp;
+	struct rte_ipv4_hdr inner_ip;
+	rte_be16_t inner_ports[2];
+} __attribute__((packed));
+
+static void pkt_init(struct pkt *p, uint8_t icmp_type) {
+	memset(p, 0, sizeof(*p));
+	p->ip.version_ihl = RTE_IPV4_VHL_DEF;
+	p->ip.packet_id = RTE_BE16(0x1234);
+	p->ip.next_proto_id = IPPROTO_ICMP;
+	p->ip.src_addr = RTE_BE32(0xc0a80001);
+	p->ip.dst_addr = RTE_BE32(0xc0a80102);
+	p->icmp.icmp_type = icmp_type;
+	p->icmp.icmp_ident = RTE_BE16(42);
+	p->inner_ip.version_ihl = RTE_IPV4_VHL_DEF;
+	p->inner_ip.next_proto_id = IPPROTO_UDP;
+	p->inner_ip.src_addr = p->ip.dst_addr;
+	p->inner_ip.dst_addr = RTE_BE32(0x08080808);
+	p->inner_ports[0] = RTE_BE16(1234);
+	p->inner_ports[1] = RTE_BE16(53);
+}
+
+static void key_classify(void **) {
+	struct ct_key key;
+	uint8_t flags;
+	struct pkt p;
+
+	pkt_init(&p, RTE_IP_ICMP_ECHO_REQUEST);
+	assert_int_equal(ct_key_init(&key, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_TRACK);
+	assert_int_equal(key.sport, RTE_BE16(42));
+	assert_int_equal(key.vrf_id, 1);
+	assert_int_equal(key.frag, 0);
+	assert_int_equal(flags, RTE_IP_ICMP_ECHO_REQUEST);
+
+	// destination unreachable
+	pkt_init(&p, 3);
+	assert_int_equal(ct_key_init(&key, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_RELATED);
+	assert_int_equal(key.proto, IPPROTO_UDP);
+	assert_int_equal(key.src, p.inner_ip.src_addr);
+	assert_int_equal(key.dport, RTE_BE16(53));
+	assert_int_equal(ct_key_init(&key, &p.ip, sizeof(p) - 1, 1, &flags, false), CT_PKT_INVALID);
+
+	// timestamp, address mask and router advertisement are not tracked
+	pkt_init(&p, 13);
+	assert_int_equal(ct_key_init(&key, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_UNTRACKED);
+	pkt_init(&p, 17);
+	assert_int_equal(ct_key_init(&key, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_UNTRACKED);
+	pkt_init(&p, 9);
+	assert_int_equal(ct_key_init(&key, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_UNTRACKED);
+
+	pkt_init(&p, RTE_IP_ICMP_ECHO_REQUEST);
+	assert_int_equal(ct_key_init(&key, &p.ip, 20, 1, &flags, false), CT_PKT_INVALID);
+}
+
+static void key_fragments(void **) {
+	struct ct_key first, other, frag;
+	uint8_t flags;
+	struct pkt p;
+
+	// first fragment, tracked with its transport header
+	pkt_init(&p, RTE_IP_ICMP_ECHO_REQUEST);
+	p.ip.fragment_offset = RTE_BE16(RTE_IPV4_HDR_MF_FLAG);
+	assert_int_equal(ct_key_init(&first, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_TRACK);
+	ct_key_frag(&frag, &p.ip, 1);
+
+	// next fragments only match the fragment key of the first one
+	p.ip.fragment_offset = RTE_BE16(RTE_IPV4_HDR_MF_FLAG | 185);
+	memset(&p.icmp, 0xff, sizeof(p.icmp));
+	assert_int_equal(
+		ct_key_init(&other, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_FRAGMENT
+	);
+	assert_true(memcmp(&other, &frag, sizeof(frag)) == 0);
+	assert_true(memcmp(&other, &first, sizeof(first)) != 0);
+	assert_int_equal(other.frag, 1);
+	assert_int_equal(other.sport, RTE_BE16(0x1234));
+
+	// last fragment of another datagram
+	p.ip.fragment_offset = RTE_BE16(370);
+	p.ip.packet_id = RTE_BE16(0x1235);
+	assert_int_equal(
+		ct_key_init(&other, &p.ip, sizeof(p), 1, &flags, false), CT_PKT_FRAGMENT
+	);
+	assert_true(memcmp(&other, &frag, sizeof(frag)) != 0);
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(tcp_lifecycle),
+		cmocka_unit_test(tcp_invalid),
+		cmocka_unit_test(tcp_fin_reset),
+		cmocka_unit_test_setup_teardown(wheel_expire, setup, teardown),
+		cmocka_unit_test_setup_teardown(wheel_far_future, setup, teardown),
+		cmocka_unit_test_setup_teardown(wheel_budget, setup, teardown),
+		cmocka_unit_test_setup_teardown(frag_entry, setup, teardown),
+		cmocka_unit_test(key_classify),
+		cmocka_unit_test(key_fragments),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,362 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ct_datapath.h"
+#include "ct_priv.h"
+
+#include <gr_graph.h>
+#include <gr_iface.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_worker.h>
+
+#include <rte_byteorder.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_graph_worker.h>
+#include <rte_hash.h>
+#include <rte_hash_crc.h>
+#include <rte_ip.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+
+#include <netinet/in.h>
+#include <stdio.h>
+
+enum edges {
+	UNSOLICITED = 0,
+	INVALID,
+	FULL,
+	EDGE_COUNT,
+};
+
+// Indexed by lcore. Unlike node contexts, this survives graph reloads.
+static struct ct_ctx *ct_workers[RTE_MAX_LCORE];
+
+static inline struct ct_ctx *ct_worker_get(void) {
+	unsigned lcore_id = rte_lcore_id();
+
+	if (lcore_id >= RTE_MAX_LCORE)
+		return NULL;
+
+	return ct_workers[lcore_id];
+}
+
+static struct ct_conn *ct_conn_new(
+	struct ct_ctx *ctx,
+	const struct ct_key *key,
+	uint8_t flags,
+	const struct gr_ct_timeouts *timeouts
+) {
+	struct ct_conn *conn;
+	void *data;
+	uint32_t id;
+
+	if (ctx->free_head == CT_NONE || !ct_vrf_conn_add(key->vrf_id))
+		return NULL;
+
+	id = ctx->free_head;
+	conn = &ctx->conns[id];
+	conn->tuples[CT_DIR_ORIG] = *key;
+	ct_key_reverse(&conn->tuples[CT_DIR_REPLY], key);
+
+	// The hash data holds the connection id and the direction in the lowest bit.
+	data = (void *)(uintptr_t)(id << 1);
+	if (rte_hash_add_key_data(ctx->hash, &conn->tuples[CT_DIR_ORIG], data) < 0) {
+		ct_vrf_conn_del(key->vrf_id);
+		return NULL;
+	}
+	data = (void *)(uintptr_t)((id << 1) | CT_DIR_REPLY);
+	if (rte_hash_add_key_data(ctx->hash, &conn->tuples[CT_DIR_REPLY], data) < 0) {
+		rte_hash_del_key(ctx->hash, &conn->tuples[CT_DIR_ORIG]);
+		ct_vrf_conn_del(key->vrf_id);
+		return NULL;
+	}
+	ctx->free_head = conn->next;
+
+	conn->fin = 0;
+	if (key->proto != IPPROTO_TCP)
+		conn->state = CT_STATE_NEW;
+	else if ((flags & (RTE_TCP_SYN_FLAG | RTE_TCP_ACK_FLAG)) == RTE_TCP_SYN_FLAG)
+		conn->state = CT_STATE_TCP_SYN_SENT;
+	else
+		// Connection established before tracking was enabled.
+		conn->state = CT_STATE_TCP_ESTABLISHED;
+
+	ct_conn_refresh(ctx, conn, timeouts);
+	ct_wheel_link(ctx, conn);
+
+	return conn;
+}
+
+// Remember an accepted first fragment so that the following ones are accepted as well.
+// Returns false if there is no room left.
+static bool ct_frag_new(
+	struct ct_ctx *ctx,
+	const struct rte_ipv4_hdr *ip,
+	uint16_t vrf_id,
+	const struct gr_ct_timeouts *timeouts
+) {
+	struct ct_conn *conn;
+	struct ct_key key;
+	void *data;
+	uint32_t id;
+
+	ct_key_frag(&key, ip, vrf_id);
+	if (rte_hash_lookup_data(ctx->hash, &key, &data) >= 0) {
+		// Retransmitted first fragment.
+		ct_conn_refresh(ctx, &ctx->conns[(uintptr_t)data >> 1], timeouts);
+		return true;
+	}
+	if (ctx->free_head == CT_NONE)
+		return false;
+
+	id = ctx->free_head;
+	conn = &ctx->conns[id];
+	conn->tuples[CT_DIR_ORIG] = key;
+	data = (void *)(uintptr_t)(id << 1);
+	if (rte_hash_add_key_data(ctx->hash, &conn->tuples[CT_DIR_ORIG], data) < 0)
+		return false;
+	ctx->free_head = conn->next;
+
+	// Fragment entries are not accounted in the VRF connection limits.
+	conn->state = CT_STATE_FRAG;
+	conn->fin = 0;
+	ct_conn_refresh(ctx, conn, timeouts);
+	ct_wheel_link(ctx, conn);
+
+	return true;
+}
+
+void ct_worker_tick(void) {
+	struct ct_ctx *ctx = ct_worker_get();
+
+	if (ctx == NULL)
+		return;
+
+	ctx->now = rte_get_tsc_cycles() / ctx->tsc_hz;
+	ct_expire(ctx);
+}
+
+static uint16_t
+ct_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	const struct gr_ct_timeouts *timeouts = ct_timeouts();
+	const void *key_ptrs[RTE_HASH_LOOKUP_BULK_MAX];
+	struct ct_key keys[RTE_HASH_LOOKUP_BULK_MAX];
+	uint8_t flags[RTE_HASH_LOOKUP_BULK_MAX];
+	ct_pkt_t types[RTE_HASH_LOOKUP_BULK_MAX];
+	void *data[RTE_HASH_LOOKUP_BULK_MAX];
+	struct ct_ctx *ctx = ct_worker_get();
+	const struct rte_ipv4_hdr *ip;
+	const struct iface *iface;
+	struct rte_mbuf *mbuf;
+	struct ct_conn *conn;
+	gr_ct_mode_t mode;
+	uint64_t hits;
+	rte_edge_t edge;
+	uintptr_t id;
+	unsigned dir;
+	uint16_t n;
+
+	// Connections are expired from ct_worker_tick(), even when no packets are received.
+	ctx->now = rte_get_tsc_cycles() / ctx->tsc_hz;
+
+	for (uint16_t i = 0; i < nb_objs; i += n) {
+		n = RTE_MIN(nb_objs - i, RTE_HASH_LOOKUP_BULK_MAX);
+
+		for (uint16_t j = 0; j < n; j++) {
+			mbuf = objs[i + j];
+			iface = ip_output_mbuf_data(mbuf)->input_iface;
+			types[j] = ct_key_init(
+				&keys[j],
+				rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *),
+				rte_pktmbuf_data_len(mbuf),
+				iface->vrf_id,
+				&flags[j],
+				false
+			);
+			key_ptrs[j] = &keys[j];
+		}
+
+		hits = 0;
+		rte_hash_lookup_bulk_data(ctx->hash, key_ptrs, n, &hits, data);
+
+		for (uint16_t j = 0; j < n; j++) {
+			mbuf = objs[i + j];
+			iface = ip_output_mbuf_data(mbuf)->input_iface;
+			mode = ct_iface_mode(iface->id);
+			edge = ip_input_hook_next(IP_INPUT_HOOK_CONNTRACK, mbuf);
+
+			switch (types[j]) {
+			case CT_PKT_UNTRACKED:
+				if (mode == GR_CT_MODE_FIREWALL)
+					edge = UNSOLICITED;
+				break;
+			case CT_PKT_INVALID:
+				if (mode == GR_CT_MODE_FIREWALL)
+					edge = INVALID;
+				break;
+			case CT_PKT_RELATED:
+				if (!(hits & (1ULL << j)) && mode == GR_CT_MODE_FIREWALL)
+					edge = UNSOLICITED;
+				break;
+			case CT_PKT_FRAGMENT:
+				// The first fragment may be in the same burst.
+				if (hits & (1ULL << j)
+				    || rte_hash_lookup_data(ctx->hash, &keys[j], &data[j]) >= 0) {
+					conn = &ctx->conns[(uintptr_t)data[j] >> 1];
+					ct_conn_refresh(ctx, conn, timeouts);
+				} else if (mode == GR_CT_MODE_FIREWALL) {
+					// First fragment not seen or not accepted.
+					edge = UNSOLICITED;
+				}
+				break;
+			case CT_PKT_TRACK:
+				dir = CT_DIR_ORIG;
+				// On a miss, the connection may have been created by a previous
+				// packet of the same burst.
+				if (hits & (1ULL << j)
+				    || rte_hash_lookup_data(ctx->hash, &keys[j], &data[j]) >= 0) {
+					id = (uintptr_t)data[j];
+					conn = &ctx->conns[id >> 1];
+					dir = id & 1;
+				} else if (mode == GR_CT_MODE_FIREWALL) {
+					edge = UNSOLICITED;
+					break;
+				} else if (!ct_pkt_initiates(&keys[j], flags[j])) {
+					break;
+				} else {
+					conn = ct_conn_new(ctx, &keys[j], flags[j], timeouts);
+					if (conn == NULL) {
+						edge = FULL;
+						break;
+					}
+				}
+
+				if (keys[j].proto == IPPROTO_TCP) {
+					if (!ct_tcp_update(conn, dir, flags[j])
+					    && mode == GR_CT_MODE_FIREWALL) {
+						edge = INVALID;
+						break;
+					}
+				} else if (dir == CT_DIR_REPLY) {
+					conn->state = CT_STATE_REPLIED;
+				}
+				ct_conn_refresh(ctx, conn, timeouts);
+
+				ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
+				if (mode == GR_CT_MODE_FIREWALL
+				    && ip->fragment_offset & RTE_BE16(RTE_IPV4_HDR_MF_FLAG)
+				    && !ct_frag_new(ctx, ip, iface->vrf_id, timeouts))
+					edge = FULL;
+				break;
+			}
+
+			rte_node_enqueue_x1(graph, node, edge, mbuf);
+		}
+	}
+
+	return nb_objs;
+}
+
+static int ct_worker_alloc(unsigned lcore_id) {
+	int socket_id = rte_lcore_to_socket_id(lcore_id);
+	struct rte_hash_parameters params = {
+		.entries = 2 * CT_WORKER_MAX_CONNS,
+		.key_len = sizeof(struct ct_key),
+		.hash_func = rte_hash_crc,
+		.socket_id = socket_id,
+		.extra_flag = RTE_HASH_EXTRA_FLAGS_EXT_TABLE,
+	};
+	char name[RTE_HASH_NAMESIZE];
+	struct ct_ctx *ctx;
+
+	if (ct_workers[lcore_id] != NULL)
+		return 0;
+
+	ctx = rte_zmalloc_socket(__func__, sizeof(*ctx), RTE_CACHE_LINE_SIZE, socket_id);
+	if (ctx == NULL)
+		return errno_log(rte_errno, "rte_zmalloc_socket");
+
+	snprintf(name, sizeof(name), "ct_%u", lcore_id);
+	params.name = name;
+	if ((ctx->hash = rte_hash_create(&params)) == NULL) {
+		rte_free(ctx);
+		return errno_log(rte_errno, "rte_hash_create");
+	}
+
+	ctx->tsc_hz = rte_get_tsc_hz();
+	ct_ctx_init(ctx, rte_get_tsc_cycles() / ctx->tsc_hz);
+
+	ct_workers[lcore_id] = ctx;
+
+	return 0;
+}
+
+static int ct_init(const struct rte_graph *, struct rte_node *) {
+	struct worker *worker;
+
+	// Graphs are created after the worker threads have started. Allocate the state of new
+	// workers, it is kept when graphs are reloaded.
+	STAILQ_FOREACH (worker, &workers, next) {
+		if (worker->lcore_id >= RTE_MAX_LCORE)
+			continue;
+		if (ct_worker_alloc(worker->lcore_id) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void ct_register(void) {
+	ip_input_add_hook(IP_INPUT_HOOK_CONNTRACK, "conntrack");
+}
+
+static void ct_unregister(void) {
+	struct ct_ctx *ctx;
+
+	for (unsigned i = 0; i < RTE_MAX_LCORE; i++) {
+		if ((ctx = ct_workers[i]) == NULL)
+			continue;
+		// Release the VRF accounting of the remaining connections.
+		for (uint32_t c = 0; c < CT_WORKER_MAX_CONNS; c++) {
+			switch (ctx->conns[c].state) {
+			case CT_STATE_NONE:
+			case CT_STATE_FRAG:
+				break;
+			default:
+				ct_vrf_conn_del(ctx->conns[c].tuples[CT_DIR_ORIG].vrf_id);
+			}
+		}
+		rte_hash_free(ctx->hash);
+		rte_free(ctx);
+		ct_workers[i] = NULL;
+	}
+}
+
+static struct rte_node_register ct_node = {
+	.name = "conntrack",
+
+	.process = ct_process,
+	.init = ct_init,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[UNSOLICITED] = "ct_unsolicited",
+		[INVALID] = "ct_invalid",
+		[FULL] = "ct_full",
+	},
+};
+
+static struct gr_node_info ct_info = {
+	.node = &ct_node,
+	.register_callback = ct_register,
+	.unregister_callback = ct_unregister,
+};
+
+GR_NODE_REGISTER(ct_info);
+
+GR_DROP_REGISTER(ct_unsolicited);
+GR_DROP_REGISTER(ct_invalid);
+GR_DROP_REGISTER(ct_full);
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_API_CONNTRACK
+#define _GR_API_CONNTRACK
+
+#include <gr_api.h>
+
+#include <stdint.h>
+
+// Connections are tracked by the worker which receives their packets. Both directions of a
+// connection must reach the same worker: ports with more than one rx queue need rss_symmetric.
+#define GR_CT_MODE_OFF 0
+// Track connections of packets received on the interface. New connections are accepted.
+#define GR_CT_MODE_TRACK 1
+// Only accept packets of established connections and related ICMP errors. Connections must
+// be initiated from an interface in track mode. Other ICMP messages are dropped and non first
+// fragments are only accepted after the first fragment of their datagram.
+#define GR_CT_MODE_FIREWALL 2
+typedef uint8_t gr_ct_mode_t;
+
+static inline const char *gr_ct_mode_name(const gr_ct_mode_t mode) {
+	switch (mode) {
+	case GR_CT_MODE_OFF:
+		return "off";
+	case GR_CT_MODE_TRACK:
+		return "track";
+	case GR_CT_MODE_FIREWALL:
+		return "firewall";
+	}
+	return "?";
+}
+
+// Idle timeouts in seconds.
+struct gr_ct_timeouts {
+	uint32_t tcp_syn; // Handshake in progress.
+	uint32_t tcp_established;
+	uint32_t tcp_fin; // One or both sides closed.
+	uint32_t tcp_close; // Reset or fully closed.
+	uint32_t udp; // No reply seen yet.
+	uint32_t udp_stream; // Replies seen.
+	uint32_t icmp;
+	uint32_t other;
+};
+
+struct gr_ct_vrf {
+	uint16_t vrf_id;
+	uint32_t max_conns; // Zero means no limit other than the tables size.
+	uint32_t active; // Connections currently tracked by all workers.
+	uint64_t created;
+	uint64_t limit_drops; // New connections refused because of max_conns.
+};
+
+struct gr_ct_iface {
+	uint16_t iface_id;
+	gr_ct_mode_t mode;
+};
+
+#define GR_CT_MODULE 0xc7c7
+
+#define GR_CT_IFACE_SET REQUEST_TYPE(GR_CT_MODULE, 0x0001)
+
+struct gr_ct_iface_set_req {
+	struct gr_ct_iface iface;
+};
+
+// struct gr_ct_iface_set_resp { };
+
+#define GR_CT_IFACE_LIST REQUEST_TYPE(GR_CT_MODULE, 0x0002)
+
+// struct gr_ct_iface_list_req { };
+
+struct gr_ct_iface_list_resp {
+	uint16_t n_ifaces;
+	struct gr_ct_iface ifaces[/* n_ifaces */];
+};
+
+#define GR_CT_VRF_SET REQUEST_TYPE(GR_CT_MODULE, 0x0003)
+
+struct gr_ct_vrf_set_req {
+	uint16_t vrf_id;
+	uint32_t max_conns;
+};
+
+// struct gr_ct_vrf_set_resp { };
+
+// List VRFs with a limit or with tracked connections.
+#define GR_CT_VRF_LIST REQUEST_TYPE(GR_CT_MODULE, 0x0004)
+
+// struct gr_ct_vrf_list_req { };
+
+struct gr_ct_vrf_list_resp {
+	uint16_t n_vrfs;
+	struct gr_ct_vrf vrfs[/* n_vrfs */];
+};
+
+// Zero fields are left unchanged. Existing connections use the new values on their next packet.
+#define GR_CT_TIMEOUTS_SET REQUEST_TYPE(GR_CT_MODULE, 0x0005)
+
+struct gr_ct_timeouts_set_req {
+	struct gr_ct_timeouts timeouts;
+};
+
+// struct gr_ct_timeouts_set_resp { };
+
+#define GR_CT_TIMEOUTS_GET REQUEST_TYPE(GR_CT_MODULE, 0x0006)
+
+// struct gr_ct_timeouts_get_req { };
+
+struct gr_ct_timeouts_get_resp {
+	struct gr_ct_timeouts timeouts;
+};
+
+#endif
@@ -52,6 +52,8 @@ struct gr_iface {
 #define GR_PORT_SET_N_TXQS GR_BIT64(33)
 #define GR_PORT_SET_Q_SIZE GR_BIT64(34)
 #define GR_PORT_SET_MAC GR_BIT64(35)
+#define GR_PORT_SET_CTRLQ GR_BIT64(36)
+#define GR_PORT_SET_RSS_SYMMETRIC GR_BIT64(37)
 
 // Info for GR_IFACE_TYPE_PORT interfaces
 struct gr_iface_info_port {
@@ -64,6 +66,13 @@ struct gr_iface_info_port {
 	uint16_t rxq_size;
 	uint16_t txq_size;
 	struct rte_ether_addr mac;
+	// Steer ARP and control traffic to local addresses to a dedicated rx queue.
+	uint8_t ctrlq;
+	// Read-only: the driver accepted the control queue flow rules.
+	uint8_t ctrlq_active;
+	// Hash both directions of a flow to the same rx queue. Connection tracking requires it
+	// when the port has more than one rx queue.
+	uint8_t rss_symmetric;
 };
 
 static_assert(sizeof(struct gr_iface_info_port) <= MEMBER_SIZE(struct gr_iface, info));
@@ -89,6 +98,64 @@ struct gr_port_rxq_map {
 	uint16_t enabled;
 };
 
+// Number of egress traffic classes. Class 0 has the highest priority, the last one is best
+// effort.
+#define GR_PORT_QOS_TC_COUNT 13
+#define GR_PORT_QOS_TC_BEST_EFFORT (GR_PORT_QOS_TC_COUNT - 1)
+#define GR_PORT_QOS_DSCP_COUNT 64
+#define GR_PORT_QOS_MAX_PIPES 4096
+#define GR_PORT_QOS_MAX_QUEUE_SIZE 4096
+
+// Egress scheduler of a port. Packets are classified according to their DSCP and spread over
+// pipes by flow hash. Within each pipe, the traffic classes are served in strict priority order.
+//
+// By default, CS6 and CS7 are in class 0, EF in class 1, CS5 in class 2, CS4 and AF4x in class
+// 3, CS3 and AF3x in class 4, CS2 and AF2x in class 5, AF1x in class 6 and all other values are
+// best effort.
+struct gr_port_qos {
+	uint64_t rate; // Bytes per second. Zero sends packets directly to the port.
+	uint16_t n_pipes; // Power of two.
+	uint16_t queue_size; // Packets per queue, power of two.
+	// Maximum rate of each traffic class in percent of the port rate.
+	uint8_t tc_rate[GR_PORT_QOS_TC_COUNT];
+	uint8_t dscp_tc[GR_PORT_QOS_DSCP_COUNT]; // Traffic class of each DSCP value.
+};
+
+// Ingress policer modes.
+#define GR_POLICER_SRTCM 0 // Single rate three color marker (RFC 2697).
+#define GR_POLICER_TRTCM 1 // Two rate three color marker (RFC 2698).
+
+// Actions applied to the packets which exceed the committed rate.
+#define GR_POLICER_ACT_PASS 0
+#define GR_POLICER_ACT_DROP 1
+#define GR_POLICER_ACT_REMARK 2 // Rewrite the IPv4/IPv6 DSCP.
+
+// Color blind policer of the packets received on a port or VLAN interface. Rates include the
+// Ethernet header.
+struct gr_iface_policer {
+	uint16_t iface_id;
+	uint8_t mode; // GR_POLICER_SRTCM or GR_POLICER_TRTCM.
+	uint8_t yellow_action; // GR_POLICER_ACT_*.
+	uint8_t yellow_dscp; // DSCP value of remarked yellow packets.
+	uint8_t red_action; // GR_POLICER_ACT_*.
+	uint8_t red_dscp; // DSCP value of remarked red packets.
+	uint64_t cir; // Committed information rate in bytes per second.
+	uint64_t cbs; // Committed burst size in bytes.
+	uint64_t pir; // Peak information rate in bytes per second. Ignored in srTCM mode.
+	uint64_t ebs; // Excess (srTCM) or peak (trTCM) burst size in bytes.
+};
+
+#define GR_POLICER_GREEN 0
+#define GR_POLICER_YELLOW 1
+#define GR_POLICER_RED 2
+#define GR_POLICER_COLORS 3
+
+struct gr_iface_policer_status {
+	struct gr_iface_policer policer;
+	uint64_t packets[GR_POLICER_COLORS];
+	uint64_t bytes[GR_POLICER_COLORS];
+};
+
 struct gr_infra_stat {
 	char name[64];
 	uint64_t objs;
@@ -132,9 +199,11 @@ struct gr_infra_iface_get_resp {
 
 struct gr_infra_iface_list_req {
 	uint16_t type; // use GR_IFACE_TYPE_UNDEF for all
+	uint32_t cursor;
 };
 
 struct gr_infra_iface_list_resp {
+	uint32_t next;
 	uint16_t n_ifaces;
 	struct gr_iface ifaces[/* n_ifaces */];
 };
@@ -179,9 +248,11 @@ typedef uint16_t gr_infra_stats_flags_t;
 struct gr_infra_stats_get_req {
 	gr_infra_stats_flags_t flags;
 	char pattern[64]; // optional glob pattern
+	uint32_t cursor;
 };
 
 struct gr_infra_stats_get_resp {
+	uint32_t next;
 	uint16_t n_stats;
 	struct gr_infra_stat stats[/* n_stats */];
 };
@@ -191,6 +262,52 @@ struct gr_infra_stats_get_resp {
 // struct gr_infra_stats_reset_req { };
 // struct gr_infra_stats_reset_resp { };
 
+// port qos /////////////////////////////////////////////////////////////////////
+#define GR_INFRA_PORT_QOS_SET REQUEST_TYPE(GR_INFRA_MODULE, 0x0040)
+
+struct gr_infra_port_qos_set_req {
+	uint16_t iface_id;
+	struct gr_port_qos qos;
+};
+
+// struct gr_infra_port_qos_set_resp { };
+
+#define GR_INFRA_PORT_QOS_GET REQUEST_TYPE(GR_INFRA_MODULE, 0x0041)
+
+struct gr_infra_port_qos_get_req {
+	uint16_t iface_id;
+};
+
+struct gr_infra_port_qos_get_resp {
+	struct gr_port_qos qos;
+};
+
+// policers ////////////////////////////////////////////////////////////////////
+#define GR_INFRA_POLICER_SET REQUEST_TYPE(GR_INFRA_MODULE, 0x0050)
+
+struct gr_infra_policer_set_req {
+	struct gr_iface_policer policer;
+};
+
+// struct gr_infra_policer_set_resp { };
+
+#define GR_INFRA_POLICER_DEL REQUEST_TYPE(GR_INFRA_MODULE, 0x0051)
+
+struct gr_infra_policer_del_req {
+	uint16_t iface_id;
+};
+
+// struct gr_infra_policer_del_resp { };
+
+#define GR_INFRA_POLICER_LIST REQUEST_TYPE(GR_INFRA_MODULE, 0x0052)
+
+// struct gr_infra_policer_list_req { };
+
+struct gr_infra_policer_list_resp {
+	uint16_t n_policers;
+	struct gr_iface_policer_status policers[/* n_policers */];
+};
+
 // graph ///////////////////////////////////////////////////////////////////////
 #define GR_INFRA_GRAPH_DUMP REQUEST_TYPE(GR_INFRA_MODULE, 0x0030)
 
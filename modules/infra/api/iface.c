@@ -88,17 +88,28 @@ static struct api_out iface_list(const void *request, void **response) {
 	size_t len;
 
 	n_ifaces = ifaces_count(req->type);
+	if (n_ifaces > GR_API_LIST_MAX(struct gr_iface))
+		n_ifaces = GR_API_LIST_MAX(struct gr_iface);
 
 	len = sizeof(*resp) + n_ifaces * sizeof(struct gr_iface);
 	if ((resp = calloc(1, len)) == NULL)
 		return api_out(ENOMEM, 0);
 
-	while ((iface = iface_next(req->type, iface)) != NULL)
+	// The cursor is the ID of the first interface to return. Interfaces are returned in
+	// ascending ID order.
+	while ((iface = iface_next(req->type, iface)) != NULL) {
+		if (iface->id < req->cursor)
+			continue;
+		if (resp->n_ifaces == n_ifaces) {
+			resp->next = iface->id;
+			break;
+		}
 		iface_to_api(&resp->ifaces[resp->n_ifaces++], iface);
+	}
 
 	*response = resp;
 
-	return api_out(0, len);
+	return api_out(0, sizeof(*resp) + resp->n_ifaces * sizeof(struct gr_iface));
 }
 
 static struct api_out iface_set(const void *request, void **response) {
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_infra.h"
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_policer.h>
+
+#include <rte_lcore.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+static struct api_out policer_set(const void *request, void **response) {
+	const struct gr_infra_policer_set_req *req = request;
+
+	(void)response;
+
+	if (iface_policer_set(&req->policer) < 0)
+		return api_out(errno, 0);
+
+	return api_out(0, 0);
+}
+
+static struct api_out policer_del(const void *request, void **response) {
+	const struct gr_infra_policer_del_req *req = request;
+
+	(void)response;
+
+	if (iface_policer_del(req->iface_id) < 0)
+		return api_out(errno, 0);
+
+	return api_out(0, 0);
+}
+
+static struct api_out policer_list(const void *request, void **response) {
+	struct gr_infra_policer_list_resp *resp;
+	struct gr_iface_policer_status *s;
+	const struct iface_policer *p;
+	uint16_t n = 0;
+	size_t len;
+
+	(void)request;
+
+	for (uint16_t iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		if (iface_policer_get(iface_id) != NULL)
+			n++;
+	}
+
+	len = sizeof(*resp) + n * sizeof(resp->policers[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (uint16_t iface_id = 0; iface_id < MAX_IFACES && resp->n_policers < n; iface_id++) {
+		if ((p = iface_policer_get(iface_id)) == NULL)
+			continue;
+		s = &resp->policers[resp->n_policers++];
+		s->policer = p->conf;
+		for (unsigned i = 0; i < RTE_MAX_LCORE; i++) {
+			for (unsigned c = 0; c < GR_POLICER_COLORS; c++) {
+				s->packets[c] += p->workers[i].packets[c];
+				s->bytes[c] += p->workers[i].bytes[c];
+			}
+		}
+	}
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static struct gr_api_handler policer_set_handler = {
+	.name = "policer set",
+	.request_type = GR_INFRA_POLICER_SET,
+	.callback = policer_set,
+};
+static struct gr_api_handler policer_del_handler = {
+	.name = "policer del",
+	.request_type = GR_INFRA_POLICER_DEL,
+	.callback = policer_del,
+};
+static struct gr_api_handler policer_list_handler = {
+	.name = "policer list",
+	.request_type = GR_INFRA_POLICER_LIST,
+	.callback = policer_list,
+};
+
+RTE_INIT(policer_init) {
+	gr_register_api_handler(&policer_set_handler);
+	gr_register_api_handler(&policer_del_handler);
+	gr_register_api_handler(&policer_list_handler);
+}
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_infra.h"
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_port.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+static struct api_out port_qos_set_cb(const void *request, void **response) {
+	const struct gr_infra_port_qos_set_req *req = request;
+	struct iface *iface = iface_from_id(req->iface_id);
+
+	(void)response;
+
+	if (iface == NULL)
+		return api_out(errno, 0);
+
+	if (port_qos_set(iface, &req->qos) < 0)
+		return api_out(errno, 0);
+
+	return api_out(0, 0);
+}
+
+static struct api_out port_qos_get_cb(const void *request, void **response) {
+	const struct gr_infra_port_qos_get_req *req = request;
+	struct iface *iface = iface_from_id(req->iface_id);
+	struct gr_infra_port_qos_get_resp *resp;
+	const struct iface_info_port *port;
+
+	if (iface == NULL)
+		return api_out(errno, 0);
+	if (iface->type_id != GR_IFACE_TYPE_PORT)
+		return api_out(EMEDIUMTYPE, 0);
+
+	if ((resp = malloc(sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	port = (const struct iface_info_port *)iface->info;
+	resp->qos = port->qos;
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+static struct gr_api_handler port_qos_set_handler = {
+	.name = "port qos set",
+	.request_type = GR_INFRA_PORT_QOS_SET,
+	.callback = port_qos_set_cb,
+};
+static struct gr_api_handler port_qos_get_handler = {
+	.name = "port qos get",
+	.request_type = GR_INFRA_PORT_QOS_GET,
+	.callback = port_qos_get_cb,
+};
+
+RTE_INIT(port_qos_init_handlers) {
+	gr_register_api_handler(&port_qos_set_handler);
+	gr_register_api_handler(&port_qos_get_handler);
+}
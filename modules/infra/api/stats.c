@@ -14,6 +14,7 @@
 #include <rte_graph.h>
 
 #include <fnmatch.h>
+#include <string.h>
 
 struct stat_value {
 	uint64_t objs;
@@ -26,14 +27,23 @@ struct stat_entry {
 	struct stat_value value;
 };
 
-static struct api_out stats_get(const void *request, void **response) {
-	const struct gr_infra_stats_get_req *req = request;
-	struct gr_infra_stats_get_resp *resp = NULL;
+// Matching stats of the last request. Chunks of a listing are served from this snapshot
+// instead of collecting all stats again for every chunk.
+static struct {
+	gr_infra_stats_flags_t flags;
+	char pattern[RTE_SIZEOF_FIELD(struct gr_infra_stats_get_req, pattern)];
+	struct gr_infra_stat *stats; // stb_ds array
+} snapshot;
+
+static int stats_snapshot_build(const struct gr_infra_stats_get_req *req) {
 	struct stat_entry *smap = NULL;
-	size_t len, n_stats;
 	char name[64];
 	int ret;
 
+	arrfree(snapshot.stats);
+	snapshot.flags = req->flags;
+	memccpy(snapshot.pattern, req->pattern, 0, sizeof(snapshot.pattern));
+
 	sh_new_arena(smap);
 
 	if (req->flags & GR_INFRA_STAT_F_SW) {
@@ -108,15 +118,20 @@ free_xstat:
 		}
 	}
 
-	// iterate once to determine the number of stats matching pattern
-	n_stats = 0;
+	// keep only the stats matching pattern
 	for (unsigned i = 0; i < shlenu(smap); i++) {
 		struct stat_entry *e = &smap[i];
+		struct gr_infra_stat s = {
+			.objs = e->value.objs,
+			.calls = e->value.calls,
+			.cycles = e->value.cycles,
+		};
 		if (e->value.objs == 0 && !(req->flags & GR_INFRA_STAT_F_ZERO))
 			continue;
 		switch (fnmatch(req->pattern, e->key, 0)) {
 		case 0:
-			n_stats++;
+			memccpy(s.name, e->key, 0, sizeof(s.name));
+			arrput(snapshot.stats, s);
 		case FNM_NOMATCH:
 			continue;
 		default:
@@ -125,41 +140,49 @@ free_xstat:
 		}
 	}
 
+	shfree(smap);
+	return 0;
+err:
+	shfree(smap);
+	arrfree(snapshot.stats);
+	return ret;
+}
+
+static struct api_out stats_get(const void *request, void **response) {
+	const struct gr_infra_stats_get_req *req = request;
+	struct gr_infra_stats_get_resp *resp = NULL;
+	size_t len, n_stats;
+	int ret;
+
+	// The cursor is the number of matching stats already returned. The first chunk takes
+	// a new snapshot, the next ones reuse it unless another listing replaced it meanwhile.
+	if (req->cursor == 0 || snapshot.stats == NULL || snapshot.flags != req->flags
+	    || strncmp(snapshot.pattern, req->pattern, sizeof(snapshot.pattern)) != 0) {
+		if ((ret = stats_snapshot_build(req)) < 0)
+			return api_out(-ret, 0);
+	}
+
+	n_stats = arrlenu(snapshot.stats);
+	n_stats = n_stats > req->cursor ? n_stats - req->cursor : 0;
+	if (n_stats > GR_API_LIST_MAX(struct gr_infra_stat))
+		n_stats = GR_API_LIST_MAX(struct gr_infra_stat);
+
 	// allocate correct response size
 	len = sizeof(*resp) + n_stats * sizeof(struct gr_infra_stat);
-	if ((resp = calloc(1, len)) == NULL) {
-		ret = -ENOMEM;
-		goto err;
-	}
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
 
 	// fill in response
-	for (unsigned i = 0; i < shlenu(smap); i++) {
-		struct stat_entry *e = &smap[i];
-		struct gr_infra_stat *s;
-		if (e->value.objs == 0 && !(req->flags & GR_INFRA_STAT_F_ZERO))
-			continue;
-		switch (fnmatch(req->pattern, e->key, 0)) {
-		case 0:
-			s = &resp->stats[resp->n_stats++];
-			memccpy(s->name, e->key, 0, sizeof(s->name));
-			s->objs = e->value.objs;
-			s->calls = e->value.calls;
-			s->cycles = e->value.cycles;
-		case FNM_NOMATCH:
-			continue;
-		default:
-			ret = -errno;
-			goto err;
-		}
-	}
+	if (n_stats > 0)
+		memcpy(resp->stats, &snapshot.stats[req->cursor], n_stats * sizeof(*resp->stats));
+	resp->n_stats = n_stats;
+	if (req->cursor + n_stats < arrlenu(snapshot.stats))
+		resp->next = req->cursor + n_stats;
+	else
+		arrfree(snapshot.stats); // last chunk
 
-	shfree(smap);
 	*response = resp;
 	return api_out(0, len);
-err:
-	shfree(smap);
-	free(resp);
-	return api_out(-ret, 0);
 }
 
 static struct api_out stats_reset(const void *request, void **response) {
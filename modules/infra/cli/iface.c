@@ -69,6 +69,51 @@ const struct cli_iface_type *type_from_id(uint16_t type_id) {
 	return NULL;
 }
 
+typedef int (*iface_walk_cb_t)(const struct gr_iface *, void *priv);
+
+// Invoke cb for all interfaces of a given type, in ascending ID order. The walk stops when
+// the callback returns a non-zero value. This value is returned.
+static int
+iface_walk(const struct gr_api_client *c, uint16_t type, iface_walk_cb_t cb, void *priv) {
+	struct gr_infra_iface_list_req req = {.type = type};
+	const struct gr_infra_iface_list_resp *resp;
+	void *resp_ptr = NULL;
+	int ret = 0;
+
+	do {
+		ret = gr_api_client_send_recv(c, GR_INFRA_IFACE_LIST, sizeof(req), &req, &resp_ptr);
+		if (ret < 0)
+			return ret;
+
+		resp = resp_ptr;
+		for (uint16_t i = 0; i < resp->n_ifaces && ret == 0; i++)
+			ret = cb(&resp->ifaces[i], priv);
+
+		req.cursor = resp->next;
+		free(resp_ptr);
+		resp_ptr = NULL;
+	} while (ret == 0 && req.cursor != 0);
+
+	return ret;
+}
+
+struct complete_ctx {
+	const struct ec_node *node;
+	struct ec_comp *comp;
+	const char *arg;
+};
+
+static int complete_iface_cb(const struct gr_iface *iface, void *priv) {
+	struct complete_ctx *ctx = priv;
+
+	if (!ec_str_startswith(iface->name, ctx->arg))
+		return 0;
+	if (!ec_comp_add_item(ctx->comp, ctx->node, EC_COMP_FULL, ctx->arg, iface->name))
+		return -1;
+
+	return 0;
+}
+
 int complete_iface_names(
 	const struct gr_api_client *c,
 	const struct ec_node *node,
@@ -76,58 +121,48 @@ int complete_iface_names(
 	const char *arg,
 	void *cb_arg
 ) {
-	struct gr_infra_iface_list_req req = {.type = (uintptr_t)cb_arg};
-	const struct gr_infra_iface_list_resp *resp;
-	void *resp_ptr = NULL;
-	int ret = -1;
+	struct complete_ctx ctx = {.node = node, .comp = comp, .arg = arg};
 
-	if (gr_api_client_send_recv(c, GR_INFRA_IFACE_LIST, sizeof(req), &req, &resp_ptr) < 0)
-		goto fail;
+	if (iface_walk(c, (uintptr_t)cb_arg, complete_iface_cb, &ctx) < 0)
+		return -1;
 
-	resp = resp_ptr;
+	return 0;
+}
 
-	for (uint16_t i = 0; i < resp->n_ifaces; i++) {
-		const struct gr_iface *iface = &resp->ifaces[i];
-		if (!ec_str_startswith(iface->name, arg))
-			continue;
-		if (!ec_comp_add_item(comp, node, EC_COMP_FULL, arg, iface->name))
-			goto fail;
-	}
+struct from_name_ctx {
+	const char *name;
+	struct gr_iface *iface;
+};
 
-	ret = 0;
-fail:
-	free(resp_ptr);
-	return ret;
+static int from_name_cb(const struct gr_iface *iface, void *priv) {
+	struct from_name_ctx *ctx = priv;
+
+	if (strcmp(iface->name, ctx->name) != 0)
+		return 0;
+
+	memcpy(ctx->iface, iface, sizeof(*ctx->iface));
+
+	return 1;
 }
 
 int iface_from_name(const struct gr_api_client *c, const char *name, struct gr_iface *iface) {
-	struct gr_infra_iface_list_req req = {.type = GR_IFACE_TYPE_UNDEF};
-	const struct gr_infra_iface_list_resp *resp;
-	void *resp_ptr = NULL;
-	int ret = -1;
+	struct from_name_ctx ctx = {.name = name, .iface = iface};
+	int ret;
 
 	if (name == NULL) {
 		errno = EINVAL;
-		goto out;
+		return -1;
 	}
 
-	if (gr_api_client_send_recv(c, GR_INFRA_IFACE_LIST, sizeof(req), &req, &resp_ptr) < 0)
-		goto out;
-
-	resp = resp_ptr;
-	for (uint16_t i = 0; i < resp->n_ifaces; i++) {
-		const struct gr_iface *iter = &resp->ifaces[i];
-		if (strcmp(iter->name, name) == 0) {
-			memcpy(iface, iter, sizeof(*iface));
-			ret = 0;
-			goto out;
-		}
+	ret = iface_walk(c, GR_IFACE_TYPE_UNDEF, from_name_cb, &ctx);
+	if (ret < 0)
+		return -1;
+	if (ret == 0) {
+		errno = ENODEV;
+		return -1;
 	}
 
-	errno = ENODEV;
-out:
-	free(resp_ptr);
-	return ret;
+	return 0;
 }
 
 int iface_from_id(const struct gr_api_client *c, uint16_t iface_id, struct gr_iface *iface) {
@@ -221,91 +256,85 @@ static cmd_status_t iface_del(const struct gr_api_client *c, const struct ec_pno
 	return CMD_SUCCESS;
 }
 
-static int iface_order(const void *ia, const void *ib) {
-	const struct gr_iface *a = ia;
-	const struct gr_iface *b = ib;
-	return a->id - b->id;
+struct iface_list_ctx {
+	const struct gr_api_client *client;
+	struct libscols_table *table;
+};
+
+static int iface_list_cb(const struct gr_iface *iface, void *priv) {
+	const struct cli_iface_type *type = type_from_id(iface->type);
+	struct iface_list_ctx *ctx = priv;
+	struct libscols_line *line = scols_table_new_line(ctx->table, NULL);
+	char buf[BUFSIZ];
+	size_t n = 0;
+
+	// name
+	scols_line_set_data(line, 0, iface->name);
+
+	// id
+	scols_line_sprintf(line, 1, "%u", iface->id);
+
+	// flags
+	if (iface->flags & GR_IFACE_F_UP)
+		n += snprintf(buf + n, sizeof(buf) - n, "up");
+	else
+		n += snprintf(buf + n, sizeof(buf) - n, "down");
+	if (iface->state & GR_IFACE_S_RUNNING)
+		n += snprintf(buf + n, sizeof(buf) - n, " running");
+	if (iface->flags & GR_IFACE_F_PROMISC)
+		n += snprintf(buf + n, sizeof(buf) - n, " promisc");
+	if (iface->flags & GR_IFACE_F_ALLMULTI)
+		n += snprintf(buf + n, sizeof(buf) - n, " allmulti");
+	scols_line_set_data(line, 2, buf);
+
+	// vrf
+	scols_line_sprintf(line, 3, "%u", iface->vrf_id);
+
+	if (type == NULL) {
+		// type
+		scols_line_sprintf(line, 4, "%u", iface->type);
+		// info
+		scols_line_set_data(line, 5, "");
+	} else {
+		// type
+		scols_line_set_data(line, 4, type->name);
+		// info
+		type->list_info(ctx->client, iface, buf, sizeof(buf));
+		scols_line_set_data(line, 5, buf);
+	}
+
+	return 0;
 }
 
 static cmd_status_t iface_list(const struct gr_api_client *c, const struct ec_pnode *p) {
-	struct libscols_table *table = scols_new_table();
-	struct gr_infra_iface_list_resp *resp;
-	struct gr_infra_iface_list_req req;
+	struct iface_list_ctx ctx = {.client = c, .table = scols_new_table()};
 	const struct cli_iface_type *type;
-	void *resp_ptr = NULL;
+	uint16_t type_id;
+	int ret;
 
-	if (table == NULL)
+	if (ctx.table == NULL)
 		return CMD_ERROR;
 
 	type = type_from_name(arg_str(p, "TYPE"));
 	if (type == NULL)
-		req.type = GR_IFACE_TYPE_UNDEF;
+		type_id = GR_IFACE_TYPE_UNDEF;
 	else
-		req.type = type->type_id;
-
-	if (gr_api_client_send_recv(c, GR_INFRA_IFACE_LIST, sizeof(req), &req, &resp_ptr) < 0)
-		return CMD_ERROR;
-
-	resp = resp_ptr;
-	qsort(resp->ifaces, resp->n_ifaces, sizeof(*resp->ifaces), iface_order);
-
-	scols_table_new_column(table, "NAME", 0, 0);
-	scols_table_new_column(table, "ID", 0, 0);
-	scols_table_new_column(table, "FLAGS", 0, 0);
-	scols_table_new_column(table, "VRF", 0, 0);
-	scols_table_new_column(table, "TYPE", 0, 0);
-	scols_table_new_column(table, "INFO", 0, 0);
-	scols_table_set_column_separator(table, "  ");
-
-	for (size_t i = 0; i < resp->n_ifaces; i++) {
-		const struct gr_iface *iface = &resp->ifaces[i];
-		const struct cli_iface_type *type = type_from_id(iface->type);
-		struct libscols_line *line = scols_table_new_line(table, NULL);
-		char buf[BUFSIZ];
-		size_t n = 0;
-
-		// name
-		scols_line_set_data(line, 0, iface->name);
-
-		// id
-		scols_line_sprintf(line, 1, "%u", iface->id);
-
-		// flags
-		if (iface->flags & GR_IFACE_F_UP)
-			n += snprintf(buf + n, sizeof(buf) - n, "up");
-		else
-			n += snprintf(buf + n, sizeof(buf) - n, "down");
-		if (iface->state & GR_IFACE_S_RUNNING)
-			n += snprintf(buf + n, sizeof(buf) - n, " running");
-		if (iface->flags & GR_IFACE_F_PROMISC)
-			n += snprintf(buf + n, sizeof(buf) - n, " promisc");
-		if (iface->flags & GR_IFACE_F_ALLMULTI)
-			n += snprintf(buf + n, sizeof(buf) - n, " allmulti");
-		scols_line_set_data(line, 2, buf);
-
-		// vrf
-		scols_line_sprintf(line, 3, "%u", iface->vrf_id);
-
-		if (type == NULL) {
-			// type
-			scols_line_sprintf(line, 4, "%u", iface->type);
-			// info
-			scols_line_set_data(line, 5, "");
-		} else {
-			// type
-			scols_line_set_data(line, 4, type->name);
-			// info
-			type->list_info(c, iface, buf, sizeof(buf));
-			scols_line_set_data(line, 5, buf);
-		}
-	}
-
-	scols_print_table(table);
-	scols_unref_table(table);
-
-	free(resp_ptr);
-
-	return CMD_SUCCESS;
+		type_id = type->type_id;
+
+	scols_table_new_column(ctx.table, "NAME", 0, 0);
+	scols_table_new_column(ctx.table, "ID", 0, 0);
+	scols_table_new_column(ctx.table, "FLAGS", 0, 0);
+	scols_table_new_column(ctx.table, "VRF", 0, 0);
+	scols_table_new_column(ctx.table, "TYPE", 0, 0);
+	scols_table_new_column(ctx.table, "INFO", 0, 0);
+	scols_table_set_column_separator(ctx.table, "  ");
+
+	ret = iface_walk(c, type_id, iface_list_cb, &ctx);
+	if (ret == 0)
+		scols_print_table(ctx.table);
+	scols_unref_table(ctx.table);
+
+	return ret < 0 ? CMD_ERROR : CMD_SUCCESS;
 }
 
 static cmd_status_t iface_show(const struct gr_api_client *c, const struct ec_pnode *p) {
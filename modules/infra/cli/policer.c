@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_cli_iface.h"
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_infra.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ACTION_RE "^(pass|drop|[0-9]{1,2})$"
+
+static int parse_action(const char *s, uint8_t *action, uint8_t *dscp) {
+	unsigned long v;
+	char *end;
+
+	if (s == NULL)
+		return 0;
+	if (strcmp(s, "pass") == 0) {
+		*action = GR_POLICER_ACT_PASS;
+		return 0;
+	}
+	if (strcmp(s, "drop") == 0) {
+		*action = GR_POLICER_ACT_DROP;
+		return 0;
+	}
+	v = strtoul(s, &end, 10);
+	if (*end != '\0' || v > 63)
+		return errno_set(ERANGE);
+	*action = GR_POLICER_ACT_REMARK;
+	*dscp = v;
+
+	return 0;
+}
+
+static const char *action_str(uint8_t action, uint8_t dscp, char *buf, size_t len) {
+	switch (action) {
+	case GR_POLICER_ACT_PASS:
+		return "pass";
+	case GR_POLICER_ACT_DROP:
+		return "drop";
+	}
+	snprintf(buf, len, "dscp %u", dscp);
+	return buf;
+}
+
+static cmd_status_t policer_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_policer_set_req req = {0};
+	struct gr_iface iface;
+	uint64_t v;
+
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.policer.iface_id = iface.id;
+
+	// Rates are given in kbit/s.
+	if (arg_u64(p, "CIR", &v) < 0)
+		return CMD_ERROR;
+	req.policer.cir = v * 1000 / 8;
+	if (arg_u64(p, "CBS", &req.policer.cbs) < 0)
+		return CMD_ERROR;
+	if (arg_u64(p, "PIR", &v) == 0) {
+		req.policer.mode = GR_POLICER_TRTCM;
+		req.policer.pir = v * 1000 / 8;
+	} else if (errno != ENOENT) {
+		return CMD_ERROR;
+	}
+	if (arg_u64(p, "EBS", &req.policer.ebs) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	req.policer.yellow_action = GR_POLICER_ACT_PASS;
+	req.policer.red_action = GR_POLICER_ACT_DROP;
+	if (parse_action(arg_str(p, "YELLOW"), &req.policer.yellow_action, &req.policer.yellow_dscp)
+	    < 0)
+		return CMD_ERROR;
+	if (parse_action(arg_str(p, "RED"), &req.policer.red_action, &req.policer.red_dscp) < 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_POLICER_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t policer_del(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_policer_del_req req = {0};
+	struct gr_iface iface;
+
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.iface_id = iface.id;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_POLICER_DEL, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t policer_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_infra_policer_list_resp *resp;
+	struct libscols_table *table;
+	struct gr_iface iface;
+	void *resp_ptr = NULL;
+	char buf[16];
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_POLICER_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "IFACE", 0, 0);
+	scols_table_new_column(table, "MODE", 0, 0);
+	scols_table_new_column(table, "CIR", 0, 0);
+	scols_table_new_column(table, "CBS", 0, 0);
+	scols_table_new_column(table, "PIR", 0, 0);
+	scols_table_new_column(table, "EBS", 0, 0);
+	scols_table_new_column(table, "YELLOW", 0, 0);
+	scols_table_new_column(table, "RED", 0, 0);
+	scols_table_new_column(table, "GREEN_PKTS", 0, 0);
+	scols_table_new_column(table, "YELLOW_PKTS", 0, 0);
+	scols_table_new_column(table, "RED_PKTS", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < resp->n_policers; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_iface_policer_status *s = &resp->policers[i];
+		const struct gr_iface_policer *conf = &s->policer;
+		if (iface_from_id(c, conf->iface_id, &iface) == 0)
+			scols_line_sprintf(line, 0, "%s", iface.name);
+		else
+			scols_line_sprintf(line, 0, "%u", conf->iface_id);
+		if (conf->mode == GR_POLICER_TRTCM) {
+			scols_line_set_data(line, 1, "trtcm");
+			scols_line_sprintf(line, 4, "%lukbit/s", conf->pir * 8 / 1000);
+		} else {
+			scols_line_set_data(line, 1, "srtcm");
+			scols_line_set_data(line, 4, "-");
+		}
+		scols_line_sprintf(line, 2, "%lukbit/s", conf->cir * 8 / 1000);
+		scols_line_sprintf(line, 3, "%lu", conf->cbs);
+		scols_line_sprintf(line, 5, "%lu", conf->ebs);
+		scols_line_sprintf(
+			line,
+			6,
+			"%s",
+			action_str(conf->yellow_action, conf->yellow_dscp, buf, sizeof(buf))
+		);
+		scols_line_sprintf(
+			line,
+			7,
+			"%s",
+			action_str(conf->red_action, conf->red_dscp, buf, sizeof(buf))
+		);
+		scols_line_sprintf(line, 8, "%lu", s->packets[GR_POLICER_GREEN]);
+		scols_line_sprintf(line, 9, "%lu", s->packets[GR_POLICER_YELLOW]);
+		scols_line_sprintf(line, 10, "%lu", s->packets[GR_POLICER_RED]);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("policer", "Configure ingress policers.")),
+		"iface IFACE cir CIR cbs CBS [(pir PIR),(ebs EBS),(yellow YELLOW),(red RED)]",
+		policer_set,
+		"Police the packets received on an interface. Two rate mode is used if a peak "
+		"rate is given.",
+		with_help(
+			"Port or VLAN interface.", ec_node_dyn("IFACE", complete_iface_names, NULL)
+		),
+		with_help("Committed rate in kbit/s.", ec_node_uint("CIR", 1, UINT32_MAX, 10)),
+		with_help("Committed burst size in bytes.", ec_node_uint("CBS", 1, UINT32_MAX, 10)),
+		with_help("Peak rate in kbit/s.", ec_node_uint("PIR", 1, UINT32_MAX, 10)),
+		with_help(
+			"Excess (single rate) or peak (two rate) burst size in bytes.",
+			ec_node_uint("EBS", 0, UINT32_MAX, 10)
+		),
+		with_help(
+			"Action for yellow packets: pass (default), drop or a DSCP value to set.",
+			ec_node_re("YELLOW", ACTION_RE)
+		),
+		with_help(
+			"Action for red packets: drop (default), pass or a DSCP value to set.",
+			ec_node_re("RED", ACTION_RE)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_DEL, CTX_ARG("policer", "Delete ingress policers.")),
+		"iface IFACE",
+		policer_del,
+		"Stop policing the packets received on an interface.",
+		with_help(
+			"Port or VLAN interface.", ec_node_dyn("IFACE", complete_iface_names, NULL)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("policer", "Show ingress policers.")),
+		"all",
+		policer_show,
+		"Show ingress policers and their per color counters."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "infra policer",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -14,6 +14,8 @@
 #include <rte_ether.h>
 
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/queue.h>
 
 static void port_show(const struct gr_api_client *, const struct gr_iface *iface) {
@@ -26,6 +28,11 @@ static void port_show(const struct gr_api_client *, const struct gr_iface *iface
 	printf("n_txq: %u\n", port->n_txq);
 	printf("rxq_size: %u\n", port->rxq_size);
 	printf("txq_size: %u\n", port->txq_size);
+	if (port->ctrlq)
+		printf("ctrlq: on (%s)\n", port->ctrlq_active ? "active" : "unsupported");
+	else
+		printf("ctrlq: off\n");
+	printf("rss_symmetric: %s\n", port->rss_symmetric ? "on" : "off");
 }
 
 static void
@@ -51,7 +58,7 @@ static uint64_t parse_port_args(
 ) {
 	uint64_t set_attrs = parse_iface_args(c, p, iface, update);
 	struct gr_iface_info_port *port;
-	const char *devargs;
+	const char *devargs, *ctrlq, *rss_sym;
 
 	port = (struct gr_iface_info_port *)iface->info;
 	devargs = arg_str(p, "DEVARGS");
@@ -73,6 +80,18 @@ static uint64_t parse_port_args(
 		set_attrs |= GR_PORT_SET_Q_SIZE;
 	}
 
+	ctrlq = arg_str(p, "CTRLQ");
+	if (ctrlq != NULL) {
+		port->ctrlq = strcmp(ctrlq, "on") == 0;
+		set_attrs |= GR_PORT_SET_CTRLQ;
+	}
+
+	rss_sym = arg_str(p, "RSS_SYM");
+	if (rss_sym != NULL) {
+		port->rss_symmetric = strcmp(rss_sym, "on") == 0;
+		set_attrs |= GR_PORT_SET_RSS_SYMMETRIC;
+	}
+
 	if (set_attrs == 0)
 		errno = EINVAL;
 	return set_attrs;
@@ -186,12 +205,149 @@ static cmd_status_t rxq_list(const struct gr_api_client *c, const struct ec_pnod
 	return CMD_SUCCESS;
 }
 
-#define PORT_ATTRS_CMD IFACE_ATTRS_CMD ",(mac MAC),(rxqs N_RXQ),(qsize Q_SIZE)"
+static int qos_get(
+	const struct gr_api_client *c,
+	const struct ec_pnode *p,
+	struct gr_infra_port_qos_set_req *req
+) {
+	struct gr_infra_port_qos_get_req get_req;
+	struct gr_infra_port_qos_get_resp *resp;
+	struct gr_iface iface;
+	void *resp_ptr = NULL;
+
+	if (iface_from_name(c, arg_str(p, "NAME"), &iface) < 0)
+		return -1;
+
+	get_req.iface_id = iface.id;
+	if (gr_api_client_send_recv(c, GR_INFRA_PORT_QOS_GET, sizeof(get_req), &get_req, &resp_ptr)
+	    < 0)
+		return -1;
+
+	resp = resp_ptr;
+	req->iface_id = iface.id;
+	req->qos = resp->qos;
+	free(resp_ptr);
+
+	return 0;
+}
+
+static cmd_status_t qos_set_rate(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_port_qos_set_req req;
+	uint64_t rate;
+
+	if (qos_get(c, p, &req) < 0)
+		return CMD_ERROR;
+
+	if (arg_u64(p, "RATE", &rate) < 0)
+		return CMD_ERROR;
+	req.qos.rate = rate * 1000000 / 8;
+	if (arg_u16(p, "PIPES", &req.qos.n_pipes) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u16(p, "QSIZE", &req.qos.queue_size) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_PORT_QOS_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t qos_set_tc(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_port_qos_set_req req;
+	uint16_t tc, percent;
+
+	if (qos_get(c, p, &req) < 0)
+		return CMD_ERROR;
+
+	if (arg_u16(p, "TC", &tc) < 0)
+		return CMD_ERROR;
+	if (arg_u16(p, "PERCENT", &percent) < 0)
+		return CMD_ERROR;
+	req.qos.tc_rate[tc] = percent;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_PORT_QOS_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t qos_set_dscp(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_port_qos_set_req req;
+	uint16_t dscp, tc;
+
+	if (qos_get(c, p, &req) < 0)
+		return CMD_ERROR;
+
+	if (arg_u16(p, "DSCP", &dscp) < 0)
+		return CMD_ERROR;
+	if (arg_u16(p, "TC", &tc) < 0)
+		return CMD_ERROR;
+	req.qos.dscp_tc[dscp] = tc;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_PORT_QOS_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t qos_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_port_qos_set_req req;
+	struct libscols_table *table;
+	const struct gr_port_qos *qos;
+
+	if (qos_get(c, p, &req) < 0)
+		return CMD_ERROR;
+
+	qos = &req.qos;
+	if (qos->rate == 0)
+		printf("rate: unlimited\n");
+	else
+		printf("rate: %lu Mbit/s\n", qos->rate * 8 / 1000000);
+	printf("pipes: %u\n", qos->n_pipes);
+	printf("qsize: %u\n", qos->queue_size);
+
+	table = scols_new_table();
+	scols_table_new_column(table, "TC", 0, 0);
+	scols_table_new_column(table, "MAX", 0, 0);
+	scols_table_new_column(table, "DSCP", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (unsigned tc = 0; tc < GR_PORT_QOS_TC_COUNT; tc++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		char buf[BUFSIZ];
+		size_t n = 0;
+
+		buf[0] = '\0';
+		for (unsigned dscp = 0; dscp < GR_PORT_QOS_DSCP_COUNT; dscp++) {
+			if (qos->dscp_tc[dscp] != tc)
+				continue;
+			n += snprintf(buf + n, sizeof(buf) - n, "%s%u", n ? " " : "", dscp);
+		}
+		scols_line_sprintf(line, 0, "%u", tc);
+		scols_line_sprintf(line, 1, "%u%%", qos->tc_rate[tc]);
+		scols_line_set_data(line, 2, buf);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+
+	return CMD_SUCCESS;
+}
+
+#define PORT_ATTRS_CMD                                                                             \
+	IFACE_ATTRS_CMD                                                                            \
+	",(mac MAC),(rxqs N_RXQ),(qsize Q_SIZE),(ctrlq CTRLQ),(rss_symmetric RSS_SYM)"
 
 #define PORT_ATTRS_ARGS                                                                            \
 	IFACE_ATTRS_ARGS, with_help("Set the ethernet address.", ec_node_re("MAC", ETH_ADDR_RE)),  \
 		with_help("Number of Rx queues.", ec_node_uint("N_RXQ", 0, UINT16_MAX - 1, 10)),   \
-		with_help("Rx/Tx queues size.", ec_node_uint("Q_SIZE", 0, UINT16_MAX - 1, 10))
+		with_help("Rx/Tx queues size.", ec_node_uint("Q_SIZE", 0, UINT16_MAX - 1, 10)),    \
+		with_help(                                                                         \
+			"Dedicated Rx queue for ARP and locally destined control traffic.",        \
+			ec_node_re("CTRLQ", "on|off")                                              \
+		),                                                                                 \
+		with_help(                                                                         \
+			"Hash both directions of a flow to the same Rx queue.",                    \
+			ec_node_re("RSS_SYM", "on|off")                                            \
+		)
 
 static int ctx_init(struct ec_node *root) {
 	int ret;
@@ -222,7 +378,7 @@ static int ctx_init(struct ec_node *root) {
 	if (ret < 0)
 		return ret;
 	ret = CLI_COMMAND(
-		CLI_CONTEXT(root, CTX_SET, CTX_ARG("port", "Set DPDK port queue mapping.")),
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("port", "Modify DPDK port settings.")),
 		"qmap NAME rxq RXQ cpu CPU",
 		rxq_set,
 		"Set DPDK port queue mapping.",
@@ -241,6 +397,67 @@ static int ctx_init(struct ec_node *root) {
 		rxq_list,
 		"Display DPDK port RXQ assignment."
 	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("port", "Modify DPDK port settings.")),
+		"qos NAME rate RATE [(pipes PIPES),(qsize QSIZE)]",
+		qos_set_rate,
+		"Set the egress rate of a port. Zero disables the scheduler.",
+		with_help(
+			"Interface name.",
+			ec_node_dyn("NAME", complete_iface_names, INT2PTR(GR_IFACE_TYPE_PORT))
+		),
+		with_help("Rate in Mbit/s.", ec_node_uint("RATE", 0, UINT32_MAX, 10)),
+		with_help(
+			"Number of pipes, packets are spread over them by flow hash.",
+			ec_node_uint("PIPES", 1, GR_PORT_QOS_MAX_PIPES, 10)
+		),
+		with_help(
+			"Number of packets per queue.",
+			ec_node_uint("QSIZE", 1, GR_PORT_QOS_MAX_QUEUE_SIZE, 10)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("port", "Modify DPDK port settings.")),
+		"qos NAME tc TC max PERCENT",
+		qos_set_tc,
+		"Limit the rate of an egress traffic class.",
+		with_help(
+			"Interface name.",
+			ec_node_dyn("NAME", complete_iface_names, INT2PTR(GR_IFACE_TYPE_PORT))
+		),
+		with_help("Traffic class.", ec_node_uint("TC", 0, GR_PORT_QOS_TC_COUNT - 1, 10)),
+		with_help("Percent of the port rate.", ec_node_uint("PERCENT", 1, 100, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("port", "Modify DPDK port settings.")),
+		"qos NAME dscp DSCP tc TC",
+		qos_set_dscp,
+		"Map a DSCP value to an egress traffic class.",
+		with_help(
+			"Interface name.",
+			ec_node_dyn("NAME", complete_iface_names, INT2PTR(GR_IFACE_TYPE_PORT))
+		),
+		with_help("DSCP value.", ec_node_uint("DSCP", 0, GR_PORT_QOS_DSCP_COUNT - 1, 10)),
+		with_help("Traffic class.", ec_node_uint("TC", 0, GR_PORT_QOS_TC_COUNT - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("port", "Display DPDK port information.")),
+		"qos NAME",
+		qos_show,
+		"Display the egress scheduler configuration of a port.",
+		with_help(
+			"Interface name.",
+			ec_node_dyn("NAME", complete_iface_names, INT2PTR(GR_IFACE_TYPE_PORT))
+		)
+	);
 	if (ret < 0)
 		return ret;
 
@@ -32,9 +32,11 @@ static int stats_order_cycles(const void *sa, const void *sb) {
 static cmd_status_t stats_get(const struct gr_api_client *c, const struct ec_pnode *p) {
 	struct gr_infra_stats_get_req req = {.flags = 0};
 	bool brief = arg_str(p, "brief") != NULL;
-	struct gr_infra_stats_get_resp *resp;
+	const struct gr_infra_stats_get_resp *resp;
+	struct gr_infra_stat *stats = NULL, *tmp;
 	void *resp_ptr = NULL;
 	const char *pattern;
+	size_t n_stats = 0;
 
 	if (arg_str(p, "software") != NULL)
 		req.flags |= GR_INFRA_STAT_F_SW;
@@ -47,15 +49,31 @@ static cmd_status_t stats_get(const struct gr_api_client *c, const struct ec_pno
 		pattern = "*";
 	snprintf(req.pattern, sizeof(req.pattern), "%s", pattern);
 
-	if (gr_api_client_send_recv(c, GR_INFRA_STATS_GET, sizeof(req), &req, &resp_ptr) < 0)
-		goto fail;
-
-	resp = resp_ptr;
+	// all chunks must be received before sorting
+	do {
+		if (gr_api_client_send_recv(
+			    c, GR_INFRA_STATS_GET, sizeof(req), &req, &resp_ptr
+		    )
+		    < 0)
+			goto fail;
+
+		resp = resp_ptr;
+		tmp = realloc(stats, (n_stats + resp->n_stats) * sizeof(*stats));
+		if (tmp == NULL && n_stats + resp->n_stats > 0)
+			goto fail;
+		stats = tmp;
+		memcpy(&stats[n_stats], resp->stats, resp->n_stats * sizeof(*stats));
+		n_stats += resp->n_stats;
+
+		req.cursor = resp->next;
+		free(resp_ptr);
+		resp_ptr = NULL;
+	} while (req.cursor != 0);
 
 	if (req.flags & GR_INFRA_STAT_F_HW || brief) {
-		qsort(resp->stats, resp->n_stats, sizeof(*resp->stats), stats_order_name);
-		for (size_t i = 0; i < resp->n_stats; i++) {
-			const struct gr_infra_stat *s = &resp->stats[i];
+		qsort(stats, n_stats, sizeof(*stats), stats_order_name);
+		for (size_t i = 0; i < n_stats; i++) {
+			const struct gr_infra_stat *s = &stats[i];
 			if (req.flags & GR_INFRA_STAT_F_HW || brief)
 				printf("%s %lu\n", s->name, s->objs);
 		}
@@ -70,12 +88,12 @@ static cmd_status_t stats_get(const struct gr_api_client *c, const struct ec_pno
 		scols_table_new_column(table, "CYCLES/PKT", 0, SCOLS_FL_RIGHT);
 		scols_table_set_column_separator(table, "  ");
 
-		qsort(resp->stats, resp->n_stats, sizeof(*resp->stats), stats_order_cycles);
+		qsort(stats, n_stats, sizeof(*stats), stats_order_cycles);
 
-		for (size_t i = 0; i < resp->n_stats; i++) {
+		for (size_t i = 0; i < n_stats; i++) {
 			struct libscols_line *line = scols_table_new_line(table, NULL);
 			double pkt_call = 0, cycles_pkt = 0, cycles_call = 0;
-			const struct gr_infra_stat *s = &resp->stats[i];
+			const struct gr_infra_stat *s = &stats[i];
 
 			if (s->calls != 0) {
 				pkt_call = ((double)s->objs) / ((double)s->calls);
@@ -96,9 +114,10 @@ static cmd_status_t stats_get(const struct gr_api_client *c, const struct ec_pno
 		scols_unref_table(table);
 	}
 
-	free(resp_ptr);
+	free(stats);
 	return CMD_SUCCESS;
 fail:
+	free(stats);
 	free(resp_ptr);
 	return CMD_ERROR;
 }
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_control_output.h"
+
+#include <gr_control.h>
+#include <gr_log.h>
+
+#include <event2/event.h>
+#include <rte_errno.h>
+#include <rte_ring.h>
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define CONTROL_OUTPUT_RING_SIZE 4096
+
+struct control_output_msg {
+	control_output_cb_t cb;
+	void *obj;
+};
+
+static struct rte_ring *control_output_ring;
+static struct event *control_output_ev;
+static int control_output_fd = -1;
+// Set by the first producer after the control plane emptied the ring. The next producers
+// do not need to wake it up again.
+static atomic_bool control_output_signaled;
+
+int post_to_control(control_output_cb_t cb, void *obj) {
+	struct control_output_msg msg = {.cb = cb, .obj = obj};
+	uint64_t one = 1;
+
+	if (rte_ring_enqueue_elem(control_output_ring, &msg, sizeof(msg)) < 0)
+		return errno_set(ENOBUFS);
+
+	if (!atomic_exchange(&control_output_signaled, true)) {
+		if (write(control_output_fd, &one, sizeof(one)) < 0)
+			LOG(ERR, "write(eventfd): %s", strerror(errno));
+	}
+
+	return 0;
+}
+
+static void control_output_drain(void) {
+	struct control_output_msg msg[32];
+	unsigned n;
+
+	do {
+		n = rte_ring_dequeue_burst_elem(
+			control_output_ring, msg, sizeof(msg[0]), RTE_DIM(msg), NULL
+		);
+		for (unsigned i = 0; i < n; i++)
+			msg[i].cb(msg[i].obj);
+	} while (n > 0);
+}
+
+static void control_output_cb(evutil_socket_t fd, short, void *) {
+	uint64_t val;
+
+	if (read(fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		LOG(ERR, "read(eventfd): %s", strerror(errno));
+
+	// Clear the flag before draining. Messages posted after this point will trigger another
+	// wake up, messages posted before are processed now.
+	atomic_store(&control_output_signaled, false);
+	control_output_drain();
+}
+
+static void control_output_init(struct event_base *ev_base) {
+	control_output_ring = rte_ring_create_elem(
+		"control_output",
+		sizeof(struct control_output_msg),
+		CONTROL_OUTPUT_RING_SIZE,
+		SOCKET_ID_ANY,
+		RING_F_MP_RTS_ENQ | RING_F_SC_DEQ
+	);
+	if (control_output_ring == NULL)
+		ABORT("rte_ring_create(control_output): %s", rte_strerror(rte_errno));
+
+	control_output_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (control_output_fd < 0)
+		ABORT("eventfd: %s", strerror(errno));
+
+	control_output_ev = event_new(
+		ev_base,
+		control_output_fd,
+		EV_READ | EV_PERSIST | EV_FINALIZE,
+		control_output_cb,
+		NULL
+	);
+	if (control_output_ev == NULL || event_add(control_output_ev, NULL) < 0)
+		ABORT("event_new() failed");
+}
+
+static void control_output_fini(struct event_base *) {
+	// workers are stopped, process the remaining messages so that objects are freed
+	control_output_drain();
+	event_free(control_output_ev);
+	control_output_ev = NULL;
+	close(control_output_fd);
+	control_output_fd = -1;
+	rte_ring_free(control_output_ring);
+	control_output_ring = NULL;
+}
+
+static struct gr_module control_output_module = {
+	.name = "control_output",
+	.init = control_output_init,
+	.fini = control_output_fini,
+	.fini_prio = -998,
+};
+
+RTE_INIT(control_output_module_init) {
+	gr_register_module(&control_output_module);
+}
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_vlan.h"
+
+#include <gr_iface.h>
+#include <gr_infra.h>
+#include <gr_log.h>
+#include <gr_port.h>
+#include <gr_stb_ds.h>
+
+#include <rte_ethdev.h>
+#include <rte_ether.h>
+#include <rte_flow.h>
+#include <rte_ip.h>
+
+#include <string.h>
+
+// Zero proto is used for ARP rules.
+#define CTRLQ_PROTO_ARP 0
+
+static struct rte_flow *ctrlq_flow_create(const struct iface_info_port *p, struct ctrlq_rule *r) {
+	struct rte_flow_attr attr = {.ingress = 1};
+	struct rte_flow_item_eth eth_spec = {0}, eth_mask = {0};
+	struct rte_flow_item_vlan vlan_spec = {0}, vlan_mask = {0};
+	struct rte_flow_item_ipv4 ip_spec = {0}, ip_mask = {0};
+	struct rte_flow_action_queue queue = {.index = p->n_rxq};
+	struct rte_flow_action actions[] = {
+		{.type = RTE_FLOW_ACTION_TYPE_QUEUE, .conf = &queue},
+		{.type = RTE_FLOW_ACTION_TYPE_END},
+	};
+	struct rte_flow_item pattern[4];
+	struct rte_flow_error error;
+	struct rte_flow *flow;
+	rte_be16_t ether_type;
+	unsigned n = 0;
+
+	memset(pattern, 0, sizeof(pattern));
+	memset(&error, 0, sizeof(error));
+
+	if (r->proto == CTRLQ_PROTO_ARP)
+		ether_type = RTE_BE16(RTE_ETHER_TYPE_ARP);
+	else
+		ether_type = RTE_BE16(RTE_ETHER_TYPE_IPV4);
+
+	pattern[n].type = RTE_FLOW_ITEM_TYPE_ETH;
+	pattern[n].spec = &eth_spec;
+	pattern[n].mask = &eth_mask;
+	n++;
+	if (r->vlan_id != 0) {
+		eth_spec.hdr.ether_type = RTE_BE16(RTE_ETHER_TYPE_VLAN);
+		eth_mask.hdr.ether_type = RTE_BE16(0xffff);
+		vlan_spec.hdr.vlan_tci = rte_cpu_to_be_16(r->vlan_id);
+		vlan_mask.hdr.vlan_tci = RTE_BE16(0x0fff);
+		vlan_spec.hdr.eth_proto = ether_type;
+		vlan_mask.hdr.eth_proto = RTE_BE16(0xffff);
+		pattern[n].type = RTE_FLOW_ITEM_TYPE_VLAN;
+		pattern[n].spec = &vlan_spec;
+		pattern[n].mask = &vlan_mask;
+		n++;
+	} else {
+		eth_spec.hdr.ether_type = ether_type;
+		eth_mask.hdr.ether_type = RTE_BE16(0xffff);
+	}
+	if (r->proto != CTRLQ_PROTO_ARP) {
+		ip_spec.hdr.dst_addr = r->dst;
+		ip_mask.hdr.dst_addr = RTE_BE32(0xffffffff);
+		ip_spec.hdr.next_proto_id = r->proto;
+		ip_mask.hdr.next_proto_id = 0xff;
+		pattern[n].type = RTE_FLOW_ITEM_TYPE_IPV4;
+		pattern[n].spec = &ip_spec;
+		pattern[n].mask = &ip_mask;
+		n++;
+	}
+	pattern[n].type = RTE_FLOW_ITEM_TYPE_END;
+
+	if (rte_flow_validate(p->port_id, &attr, pattern, actions, &error) < 0)
+		goto err;
+	if ((flow = rte_flow_create(p->port_id, &attr, pattern, actions, &error)) == NULL)
+		goto err;
+
+	return flow;
+err:
+	LOG(NOTICE,
+	    "port %u: vlan %u proto %u: %s",
+	    p->port_id,
+	    r->vlan_id,
+	    r->proto,
+	    error.message ? error.message : rte_strerror(rte_errno));
+	return NULL;
+}
+
+// Spread RSS traffic on the regular queues only.
+static int ctrlq_reta_update(const struct iface_info_port *p) {
+	struct rte_eth_rss_reta_entry64 reta[RTE_ETH_RSS_RETA_SIZE_512 / RTE_ETH_RETA_GROUP_SIZE];
+	struct rte_eth_dev_info info;
+	int ret;
+
+	if ((ret = rte_eth_dev_info_get(p->port_id, &info)) < 0)
+		return errno_set(-ret);
+	if (info.reta_size == 0)
+		return 0;
+	if (info.reta_size > RTE_ETH_RSS_RETA_SIZE_512)
+		return errno_set(EOVERFLOW);
+
+	memset(reta, 0, sizeof(reta));
+	for (uint16_t i = 0; i < info.reta_size; i++) {
+		struct rte_eth_rss_reta_entry64 *e = &reta[i / RTE_ETH_RETA_GROUP_SIZE];
+		e->mask |= UINT64_C(1) << (i % RTE_ETH_RETA_GROUP_SIZE);
+		e->reta[i % RTE_ETH_RETA_GROUP_SIZE] = i % p->n_rxq;
+	}
+	if ((ret = rte_eth_dev_rss_reta_update(p->port_id, reta, info.reta_size)) < 0)
+		return errno_set(-ret);
+
+	return 0;
+}
+
+// Flow rules do not survive a port stop unless the driver advertises
+// RTE_ETH_DEV_CAPA_FLOW_RULE_KEEP. Otherwise, the handle is already stale.
+static void ctrlq_flow_destroy(const struct iface_info_port *p, struct rte_flow **flow, bool kept) {
+	struct rte_flow_error error;
+
+	memset(&error, 0, sizeof(error));
+	if (*flow != NULL && kept && rte_flow_destroy(p->port_id, *flow, &error) < 0)
+		LOG(WARNING,
+		    "port %u: rte_flow_destroy: %s",
+		    p->port_id,
+		    error.message ? error.message : rte_strerror(rte_errno));
+	*flow = NULL;
+}
+
+int port_ctrlq_sync(struct iface_info_port *p) {
+	struct ctrlq_rule arp = {.proto = CTRLQ_PROTO_ARP};
+	struct rte_eth_dev_info info;
+	struct ctrlq_rule *r;
+	bool kept;
+	int ret;
+
+	if ((ret = rte_eth_dev_info_get(p->port_id, &info)) < 0)
+		return errno_log(-ret, "rte_eth_dev_info_get");
+	kept = info.dev_capa & RTE_ETH_DEV_CAPA_FLOW_RULE_KEEP;
+
+	// only destroy the flows that were created here, leave other rules alone
+	ctrlq_flow_destroy(p, &p->ctrlq_arp_flow, kept);
+	arrforeach (r, p->ctrlq_rules)
+		ctrlq_flow_destroy(p, &r->flow, kept);
+	p->ctrlq_active = false;
+
+	if (!p->ctrlq)
+		return 0;
+
+	if ((p->ctrlq_arp_flow = ctrlq_flow_create(p, &arp)) == NULL) {
+		LOG(NOTICE,
+		    "port %u: control queue flow rules not supported, falling back to RSS",
+		    p->port_id);
+		return 0;
+	}
+	if (ctrlq_reta_update(p) < 0)
+		LOG(NOTICE,
+		    "port %u: cannot exclude control queue from RSS: %s",
+		    p->port_id,
+		    strerror(errno));
+
+	p->ctrlq_active = true;
+
+	arrforeach (r, p->ctrlq_rules)
+		r->flow = ctrlq_flow_create(p, r);
+
+	return 0;
+}
+
+static struct iface_info_port *ctrlq_port(const struct iface *iface, uint16_t *vlan_id) {
+	const struct iface_info_vlan *vlan;
+	struct iface *parent;
+
+	switch (iface->type_id) {
+	case GR_IFACE_TYPE_PORT:
+		*vlan_id = 0;
+		return (struct iface_info_port *)iface->info;
+	case GR_IFACE_TYPE_VLAN:
+		vlan = (const struct iface_info_vlan *)iface->info;
+		if ((parent = iface_from_id(vlan->parent_id)) == NULL)
+			return NULL;
+		if (parent->type_id != GR_IFACE_TYPE_PORT)
+			return NULL;
+		*vlan_id = vlan->vlan_id;
+		return (struct iface_info_port *)parent->info;
+	}
+
+	return NULL;
+}
+
+int iface_ctrlq_add_ip4(const struct iface *iface, ip4_addr_t dst, uint8_t proto) {
+	struct ctrlq_rule rule = {.dst = dst, .proto = proto};
+	struct iface_info_port *p;
+
+	if ((p = ctrlq_port(iface, &rule.vlan_id)) == NULL)
+		return 0;
+
+	if (p->ctrlq_active)
+		rule.flow = ctrlq_flow_create(p, &rule);
+
+	arrpush(p->ctrlq_rules, rule);
+
+	return 0;
+}
+
+int iface_ctrlq_del_ip4(const struct iface *iface, ip4_addr_t dst, uint8_t proto) {
+	struct iface_info_port *p;
+	uint16_t vlan_id;
+
+	if ((p = ctrlq_port(iface, &vlan_id)) == NULL)
+		return 0;
+
+	for (int i = 0; i < arrlen(p->ctrlq_rules); i++) {
+		struct ctrlq_rule *r = &p->ctrlq_rules[i];
+		if (r->vlan_id != vlan_id || r->dst != dst || r->proto != proto)
+			continue;
+		ctrlq_flow_destroy(p, &r->flow, true);
+		arrdelswap(p->ctrlq_rules, i);
+		return 0;
+	}
+
+	return errno_set(ENOENT);
+}
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_CONTROL_OUTPUT
+#define _GR_CONTROL_OUTPUT
+
+// Invoked from the control plane event loop with the object posted by the datapath.
+// The callback owns the object and must free it.
+typedef void (*control_output_cb_t)(void *obj);
+
+// Send an object from a datapath worker to the control plane. This never blocks.
+// Returns a negative value with errno set to ENOBUFS when the control plane lags behind.
+// The object is not consumed in that case.
+int post_to_control(control_output_cb_t cb, void *obj);
+
+#endif
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_INFRA_POLICER
+#define _GR_INFRA_POLICER
+
+#include <gr_infra.h>
+
+#include <rte_common.h>
+#include <rte_lcore.h>
+#include <rte_meter.h>
+
+#include <stdint.h>
+
+static_assert(GR_POLICER_GREEN == (int)RTE_COLOR_GREEN);
+static_assert(GR_POLICER_YELLOW == (int)RTE_COLOR_YELLOW);
+static_assert(GR_POLICER_RED == (int)RTE_COLOR_RED);
+
+// Meter state of a single worker. rte_meter is not thread safe, each worker gets its share of
+// the configured rates.
+struct __rte_cache_aligned policer_worker {
+	union {
+		struct rte_meter_srtcm srtcm;
+		struct rte_meter_trtcm trtcm;
+	};
+	uint64_t packets[GR_POLICER_COLORS];
+	uint64_t bytes[GR_POLICER_COLORS];
+};
+
+struct iface_policer {
+	struct gr_iface_policer conf;
+	union {
+		struct rte_meter_srtcm_profile srtcm;
+		struct rte_meter_trtcm_profile trtcm;
+	} profile;
+	struct policer_worker workers[RTE_MAX_LCORE];
+};
+
+// Get the policer of an interface, NULL if there is none.
+struct iface_policer *iface_policer_get(uint16_t iface_id);
+
+// Create or replace the policer of an interface. Counters are reset.
+int iface_policer_set(const struct gr_iface_policer *);
+
+int iface_policer_del(uint16_t iface_id);
+
+#endif
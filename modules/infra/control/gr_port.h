@@ -6,9 +6,11 @@
 
 #include <gr_bitops.h>
 #include <gr_iface.h>
+#include <gr_net_types.h>
 
 #include <rte_ethdev.h>
 #include <rte_ether.h>
+#include <rte_flow.h>
 #include <rte_mempool.h>
 
 #include <stdint.h>
@@ -28,11 +30,22 @@ struct mac_filter {
 	struct rte_ether_addr mac[RTE_ETH_NUM_RECEIVE_MAC_ADDR];
 };
 
+// Flow rule steering control traffic to the port control queue.
+struct ctrlq_rule {
+	uint16_t vlan_id; // 0 for untagged traffic
+	ip4_addr_t dst;
+	uint8_t proto;
+	struct rte_flow *flow;
+};
+
 struct __rte_aligned(alignof(void *)) iface_info_port {
 	uint16_t port_id;
 	uint8_t n_rxq;
 	uint8_t n_txq;
 	bool configured;
+	bool ctrlq; // extra rxq (with id n_rxq) dedicated to control traffic
+	bool ctrlq_active; // driver accepted the control queue flow rules
+	bool rss_symmetric; // both directions of a flow are received on the same queue
 	uint16_t rxq_size;
 	uint16_t txq_size;
 	struct rte_ether_addr mac;
@@ -41,8 +54,21 @@ struct __rte_aligned(alignof(void *)) iface_info_port {
 	uint32_t pool_size;
 	struct mac_filter ucast_filter;
 	struct mac_filter mcast_filter;
+	struct ctrlq_rule *ctrlq_rules; // stb array
+	struct rte_flow *ctrlq_arp_flow;
+	struct gr_port_qos qos;
 };
 
+// Total number of configured rx queues, including the control queue.
+static inline uint16_t port_rxq_count(const struct iface_info_port *p) {
+	return p->n_rxq + (p->ctrlq ? 1 : 0);
+}
+
+// When the flow rules are not supported, the extra queue is a regular RSS queue.
+static inline bool port_rxq_is_ctrlq(const struct iface_info_port *p, uint16_t rxq_id) {
+	return p->ctrlq_active && rxq_id == p->n_rxq;
+}
+
 uint32_t port_get_rxq_buffer_us(uint16_t port_id, uint16_t rxq_id);
 int iface_port_reconfig(
 	struct iface *iface,
@@ -53,4 +79,17 @@ int iface_port_reconfig(
 	const void *api_info
 );
 const struct iface *port_get_iface(uint16_t port_id);
+
+// (Re)install the control queue flow rules. Must be called after the port is started.
+int port_ctrlq_sync(struct iface_info_port *);
+// Steer packets of the given ip protocol destined to a local address to the control queue of the
+// port (or the parent port of a VLAN sub interface). Noop for other interface types.
+int iface_ctrlq_add_ip4(const struct iface *, ip4_addr_t dst, uint8_t proto);
+int iface_ctrlq_del_ip4(const struct iface *, ip4_addr_t dst, uint8_t proto);
+
+// Fill the default egress scheduler configuration, disabled.
+void port_qos_init(struct gr_port_qos *);
+// Change the egress scheduler configuration of a port. The schedulers of all workers are
+// recreated, queued packets are lost.
+int port_qos_set(struct iface *, const struct gr_port_qos *);
 #endif
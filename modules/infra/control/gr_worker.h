@@ -7,6 +7,7 @@
 #include <rte_common.h>
 #include <rte_graph.h>
 #include <rte_os.h>
+#include <rte_rcu_qsbr.h>
 
 #include <pthread.h>
 #include <sched.h>
@@ -67,4 +68,15 @@ extern struct workers workers;
 
 int worker_rxq_assign(uint16_t port_id, uint16_t rxq_id, uint16_t cpu_id);
 
+// Quiescent state variable reported by all datapath workers after each graph walk.
+// Use it to defer freeing objects that may still be referenced by the datapath.
+struct rte_rcu_qsbr *gr_datapath_rcu(void);
+
+// Wait until all datapath workers have gone through a quiescent state.
+static inline void gr_datapath_sync(void) {
+	struct rte_rcu_qsbr *rcu = gr_datapath_rcu();
+	if (rcu != NULL)
+		rte_rcu_qsbr_synchronize(rcu, RTE_QSBR_THRID_INVALID);
+}
+
 #endif
@@ -131,6 +131,13 @@ void worker_graph_free(struct worker *worker) {
 	}
 }
 
+static bool rxq_is_ctrlq(const struct queue_map *qmap) {
+	const struct iface *iface = port_get_iface(qmap->port_id);
+	if (iface == NULL)
+		return false;
+	return port_rxq_is_ctrlq((const struct iface_info_port *)iface->info, qmap->queue_id);
+}
+
 static int worker_graph_new(struct worker *worker, uint8_t index) {
 	uint32_t max_sleep_us, rx_buffer_us;
 	struct rx_node_queues *rx = NULL;
@@ -139,6 +146,7 @@ static int worker_graph_new(struct worker *worker, uint8_t index) {
 	struct queue_map *qmap;
 	uint16_t graph_uid;
 	unsigned n_rxqs;
+	bool ctrlq;
 	size_t len;
 	int ret;
 
@@ -168,24 +176,34 @@ static int worker_graph_new(struct worker *worker, uint8_t index) {
 		max_sleep_us = 0;
 	else
 		max_sleep_us = 1000; // unreasonably long maximum (1ms)
-	arrforeach (qmap, worker->rxqs) {
-		if (!qmap->enabled)
-			continue;
-		LOG(DEBUG,
-		    "[CPU %d] <- port %u rxq %u",
-		    worker->cpu_id,
-		    qmap->port_id,
-		    qmap->queue_id);
-		rx->queues[n_rxqs].port_id = qmap->port_id;
-		rx->queues[n_rxqs].rxq_id = qmap->queue_id;
-		if (!gr_args()->poll_mode) {
-			// divide buffer size by two to take into account
-			// the time to wakeup from sleep
-			rx_buffer_us = port_get_rxq_buffer_us(qmap->port_id, qmap->queue_id) / 2;
-			if (rx_buffer_us < max_sleep_us)
-				max_sleep_us = rx_buffer_us;
+	// control queues are polled first
+	for (int pass = 0; pass < 2; pass++) {
+		arrforeach (qmap, worker->rxqs) {
+			if (!qmap->enabled)
+				continue;
+			ctrlq = rxq_is_ctrlq(qmap);
+			if (ctrlq != (pass == 0))
+				continue;
+			LOG(DEBUG,
+			    "[CPU %d] <- port %u rxq %u%s",
+			    worker->cpu_id,
+			    qmap->port_id,
+			    qmap->queue_id,
+			    ctrlq ? " (control)" : "");
+			rx->queues[n_rxqs].port_id = qmap->port_id;
+			rx->queues[n_rxqs].rxq_id = qmap->queue_id;
+			if (!gr_args()->poll_mode) {
+				// divide buffer size by two to take into account
+				// the time to wakeup from sleep
+				rx_buffer_us = port_get_rxq_buffer_us(
+					qmap->port_id, qmap->queue_id
+				);
+				rx_buffer_us /= 2;
+				if (rx_buffer_us < max_sleep_us)
+					max_sleep_us = rx_buffer_us;
+			}
+			n_rxqs++;
 		}
-		n_rxqs++;
 	}
 	rx->n_queues = n_rxqs;
 	if (gr_node_data_set(name, "port_rx", rx) < 0) {
@@ -202,7 +220,8 @@ static int worker_graph_new(struct worker *worker, uint8_t index) {
 		goto err;
 	}
 	// initialize all to invalid queue_ids
-	memset(tx, 0xff, sizeof(*tx));
+	memset(tx, 0, sizeof(*tx));
+	memset(tx->txq_ids, 0xff, sizeof(tx->txq_ids));
 	arrforeach (qmap, worker->txqs) {
 		if (!qmap->enabled)
 			continue;
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_iface.h>
+#include <gr_infra.h>
+#include <gr_log.h>
+#include <gr_policer.h>
+#include <gr_port.h>
+#include <gr_stb_ds.h>
+#include <gr_vlan.h>
+#include <gr_worker.h>
+
+#include <rte_common.h>
+#include <rte_malloc.h>
+#include <rte_meter.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/queue.h>
+
+static _Atomic(struct iface_policer *) policers[MAX_IFACES];
+
+struct iface_policer *iface_policer_get(uint16_t iface_id) {
+	return atomic_load_explicit(&policers[iface_id], memory_order_acquire);
+}
+
+// Number of workers which receive the packets of an interface.
+static unsigned policer_rx_workers(const struct iface *iface) {
+	const struct iface_info_port *port;
+	struct queue_map *qmap;
+	struct worker *worker;
+	unsigned n = 0;
+
+	if (iface->type_id == GR_IFACE_TYPE_VLAN) {
+		iface = iface_from_id(((const struct iface_info_vlan *)iface->info)->parent_id);
+		if (iface == NULL)
+			return 1;
+	}
+	port = (const struct iface_info_port *)iface->info;
+
+	STAILQ_FOREACH (worker, &workers, next) {
+		arrforeach (qmap, worker->rxqs) {
+			if (qmap->enabled && qmap->port_id == port->port_id) {
+				n++;
+				break;
+			}
+		}
+	}
+
+	return RTE_MAX(n, 1U);
+}
+
+static int policer_check(const struct gr_iface_policer *conf) {
+	if (conf->cir == 0 || conf->cbs == 0)
+		return errno_set(EINVAL);
+
+	switch (conf->mode) {
+	case GR_POLICER_SRTCM:
+		break;
+	case GR_POLICER_TRTCM:
+		if (conf->pir < conf->cir || conf->ebs == 0)
+			return errno_set(EINVAL);
+		break;
+	default:
+		return errno_set(EINVAL);
+	}
+
+	if (conf->yellow_action > GR_POLICER_ACT_REMARK || conf->red_action > GR_POLICER_ACT_REMARK)
+		return errno_set(EINVAL);
+	if (conf->yellow_dscp > 63 || conf->red_dscp > 63)
+		return errno_set(ERANGE);
+
+	return 0;
+}
+
+int iface_policer_set(const struct gr_iface_policer *conf) {
+	struct iface_policer *policer, *old;
+	struct iface *iface;
+	unsigned n_workers;
+	int ret;
+
+	if ((iface = iface_from_id(conf->iface_id)) == NULL)
+		return -errno;
+	if (iface->type_id != GR_IFACE_TYPE_PORT && iface->type_id != GR_IFACE_TYPE_VLAN)
+		return errno_set(EMEDIUMTYPE);
+	if (policer_check(conf) < 0)
+		return -errno;
+
+	policer = rte_zmalloc(__func__, sizeof(*policer), RTE_CACHE_LINE_SIZE);
+	if (policer == NULL)
+		return errno_set(ENOMEM);
+	policer->conf = *conf;
+
+	// The split is computed once. Changing the rx queue mapping requires setting the policer
+	// again.
+	n_workers = policer_rx_workers(iface);
+
+	if (conf->mode == GR_POLICER_SRTCM) {
+		struct rte_meter_srtcm_params params = {
+			.cir = conf->cir / n_workers,
+			.cbs = conf->cbs,
+			.ebs = conf->ebs,
+		};
+		ret = rte_meter_srtcm_profile_config(&policer->profile.srtcm, &params);
+		for (unsigned i = 0; ret == 0 && i < RTE_MAX_LCORE; i++) {
+			struct policer_worker *w = &policer->workers[i];
+			ret = rte_meter_srtcm_config(&w->srtcm, &policer->profile.srtcm);
+		}
+	} else {
+		struct rte_meter_trtcm_params params = {
+			.cir = conf->cir / n_workers,
+			.pir = conf->pir / n_workers,
+			.cbs = conf->cbs,
+			.pbs = conf->ebs,
+		};
+		ret = rte_meter_trtcm_profile_config(&policer->profile.trtcm, &params);
+		for (unsigned i = 0; ret == 0 && i < RTE_MAX_LCORE; i++) {
+			struct policer_worker *w = &policer->workers[i];
+			ret = rte_meter_trtcm_config(&w->trtcm, &policer->profile.trtcm);
+		}
+	}
+	if (ret < 0) {
+		rte_free(policer);
+		return errno_set(-ret);
+	}
+
+	old = atomic_exchange_explicit(&policers[conf->iface_id], policer, memory_order_acq_rel);
+	if (old != NULL) {
+		gr_datapath_sync();
+		rte_free(old);
+	}
+
+	return 0;
+}
+
+int iface_policer_del(uint16_t iface_id) {
+	struct iface_policer *old;
+
+	if (iface_id >= MAX_IFACES)
+		return errno_set(ENODEV);
+
+	old = atomic_exchange_explicit(&policers[iface_id], NULL, memory_order_acq_rel);
+	if (old == NULL)
+		return errno_set(ENOENT);
+
+	gr_datapath_sync();
+	rte_free(old);
+
+	return 0;
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	if (event == IFACE_EVENT_PRE_REMOVE && iface_policer_get(iface->id) != NULL)
+		iface_policer_del(iface->id);
+}
+
+static struct iface_event_handler iface_event_policer_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(policer_constructor) {
+	iface_event_register_handler(&iface_event_policer_handler);
+}
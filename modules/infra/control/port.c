@@ -83,14 +83,29 @@ static struct rte_eth_conf default_port_config = {
 		},
 	},
 	.rxmode = {
-		.offloads = RTE_ETH_RX_OFFLOAD_CHECKSUM | RTE_ETH_RX_OFFLOAD_VLAN,
+		.offloads = RTE_ETH_RX_OFFLOAD_CHECKSUM
+			| RTE_ETH_RX_OFFLOAD_VLAN
+			| RTE_ETH_RX_OFFLOAD_RSS_HASH,
 	},
 };
 
+// Toeplitz key made of a repeated 16-bit pattern. Swapping the source and destination addresses
+// and ports gives the same hash, both directions of a flow are received by the same queue
+// index. Only used when the driver does not support symmetric Toeplitz natively.
+static uint8_t symmetric_rss_key[64] = {
+	0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+	0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+	0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+	0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+	0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+	0x6d, 0x5a, 0x6d, 0x5a,
+};
+
 static void port_queue_assign(struct iface_info_port *p) {
 	int socket_id = rte_eth_dev_socket_id(p->port_id);
 	struct worker *worker, *default_worker = NULL;
 	// XXX: can we assume there will never be more than 64 rxqs per port?
+	uint16_t n_rxq = port_rxq_count(p);
 	uint64_t rxq_ids = 0;
 	uint16_t txq = 0;
 
@@ -114,7 +129,7 @@ static void port_queue_assign(struct iface_info_port *p) {
 		for (int i = 0; i < arrlen(worker->rxqs); i++) {
 			struct queue_map *qmap = &worker->rxqs[i];
 			if (qmap->port_id == p->port_id) {
-				if (qmap->queue_id < p->n_rxq) {
+				if (qmap->queue_id < n_rxq) {
 					// rxq already assigned to a worker
 					rxq_ids |= 1 << qmap->queue_id;
 				} else {
@@ -129,7 +144,7 @@ static void port_queue_assign(struct iface_info_port *p) {
 		}
 	}
 	assert(default_worker != NULL);
-	for (uint16_t rxq = 0; rxq < p->n_rxq; rxq++) {
+	for (uint16_t rxq = 0; rxq < n_rxq; rxq++) {
 		if (rxq_ids & (1 << rxq))
 			continue;
 		struct queue_map rx_qmap = {
@@ -144,7 +159,8 @@ static void port_queue_assign(struct iface_info_port *p) {
 static int port_configure(struct iface_info_port *p) {
 	int socket_id = rte_eth_dev_socket_id(p->port_id);
 	struct rte_eth_conf conf = default_port_config;
-	uint16_t rxq_size, txq_size;
+	struct rte_eth_rss_conf *rss = &conf.rx_adv_conf.rss_conf;
+	uint16_t rxq_size, txq_size, n_rxq;
 	struct rte_eth_dev_info info;
 	uint32_t mbuf_count;
 	int ret;
@@ -157,6 +173,7 @@ static int port_configure(struct iface_info_port *p) {
 	p->n_txq = worker_count();
 	if (p->n_rxq == 0)
 		p->n_rxq = 1;
+	n_rxq = port_rxq_count(p);
 
 	if ((ret = rte_eth_dev_info_get(p->port_id, &info)) < 0)
 		return errno_log(-ret, "rte_eth_dev_info_get");
@@ -164,7 +181,7 @@ static int port_configure(struct iface_info_port *p) {
 	rxq_size = get_rxq_size(p, &info);
 	txq_size = get_txq_size(p, &info);
 
-	mbuf_count = rxq_size * p->n_rxq;
+	mbuf_count = rxq_size * n_rxq;
 	mbuf_count += txq_size * p->n_txq;
 	mbuf_count += RTE_GRAPH_BURST_SIZE;
 	mbuf_count = rte_align32pow2(mbuf_count) - 1;
@@ -179,17 +196,30 @@ static int port_configure(struct iface_info_port *p) {
 
 	// Limit configured rss hash functions to only those supported by hardware
 	conf.rx_adv_conf.rss_conf.rss_hf &= info.flow_type_rss_offloads;
+	// Stateful features expect both directions of a flow to be handled by the same worker.
+	if (p->rss_symmetric) {
+		if (info.rss_algo_capa
+		    & RTE_ETH_HASH_ALGO_TO_CAPA(RTE_ETH_HASH_FUNCTION_SYMMETRIC_TOEPLITZ)) {
+			rss->algorithm = RTE_ETH_HASH_FUNCTION_SYMMETRIC_TOEPLITZ;
+		} else if (info.hash_key_size > 0
+			   && info.hash_key_size <= sizeof(symmetric_rss_key)) {
+			rss->rss_key = symmetric_rss_key;
+			rss->rss_key_len = info.hash_key_size;
+		} else {
+			LOG(WARNING, "port %u: symmetric rss not supported", p->port_id);
+		}
+	}
 	if (conf.rx_adv_conf.rss_conf.rss_hf == 0)
 		conf.rxmode.mq_mode = RTE_ETH_MQ_RX_NONE;
 	else
 		conf.rxmode.mq_mode = RTE_ETH_MQ_RX_RSS;
 	conf.rxmode.offloads &= info.rx_offload_capa;
 
-	if ((ret = rte_eth_dev_configure(p->port_id, p->n_rxq, p->n_txq, &conf)) < 0)
+	if ((ret = rte_eth_dev_configure(p->port_id, n_rxq, p->n_txq, &conf)) < 0)
 		return errno_log(-ret, "rte_eth_dev_configure");
 
 	// initialize rx/tx queues
-	for (size_t q = 0; q < p->n_rxq; q++) {
+	for (size_t q = 0; q < n_rxq; q++) {
 		ret = rte_eth_rx_queue_setup(p->port_id, q, rxq_size, socket_id, NULL, p->pool);
 		if (ret < 0)
 			return errno_log(-ret, "rte_eth_rx_queue_setup");
@@ -223,7 +253,9 @@ int iface_port_reconfig(
 	if ((ret = port_unplug(p->port_id)) < 0)
 		return ret;
 
-	if (set_attrs & (GR_PORT_SET_N_RXQS | GR_PORT_SET_N_TXQS | GR_PORT_SET_Q_SIZE)) {
+	if (set_attrs
+	    & (GR_PORT_SET_N_RXQS | GR_PORT_SET_N_TXQS | GR_PORT_SET_Q_SIZE | GR_PORT_SET_CTRLQ
+	       | GR_PORT_SET_RSS_SYMMETRIC)) {
 		if (set_attrs & GR_PORT_SET_N_RXQS)
 			p->n_rxq = api->n_rxq;
 		if (set_attrs & GR_PORT_SET_N_TXQS)
@@ -232,6 +264,10 @@ int iface_port_reconfig(
 			p->rxq_size = api->rxq_size;
 			p->txq_size = api->rxq_size;
 		}
+		if (set_attrs & GR_PORT_SET_CTRLQ)
+			p->ctrlq = api->ctrlq;
+		if (set_attrs & GR_PORT_SET_RSS_SYMMETRIC)
+			p->rss_symmetric = api->rss_symmetric;
 		p->configured = false;
 	}
 
@@ -309,8 +345,12 @@ int iface_port_reconfig(
 			return errno_log(-ret, "rte_eth_macaddr_get");
 	}
 
-	if (stopped && (ret = rte_eth_dev_start(p->port_id)) < 0)
-		return errno_log(-ret, "rte_eth_dev_start");
+	if (stopped) {
+		if ((ret = rte_eth_dev_start(p->port_id)) < 0)
+			return errno_log(-ret, "rte_eth_dev_start");
+		if ((ret = port_ctrlq_sync(p)) < 0)
+			return ret;
+	}
 
 	iface_event_notify(IFACE_EVENT_PORT_POST_RECONFIG, iface);
 
@@ -332,6 +372,9 @@ static int iface_port_fini(struct iface *iface) {
 
 	free(port->devargs);
 	port->devargs = NULL;
+	arrfree(port->ctrlq_rules);
+	port->ctrlq_rules = NULL;
+	port->ctrlq_arp_flow = NULL; // released by rte_eth_dev_close
 	if ((ret = rte_eth_dev_info_get(port->port_id, &info)) < 0)
 		LOG(ERR, "rte_eth_dev_info_get: %s", rte_strerror(-ret));
 	if ((ret = rte_eth_dev_stop(port->port_id)) < 0)
@@ -406,6 +449,10 @@ static int iface_port_init(struct iface *iface, const void *api_info) {
 	if (port->devargs == NULL)
 		goto fail;
 
+	// must be set before the graph is reloaded so that the control queue is polled first
+	port_ifaces[port_id] = iface;
+	port_qos_init(&port->qos);
+
 	ret = iface_port_reconfig(
 		iface, IFACE_SET_ALL, iface->flags, iface->mtu, iface->vrf_id, api_info
 	);
@@ -413,7 +460,6 @@ static int iface_port_init(struct iface *iface, const void *api_info) {
 		iface_port_fini(iface);
 		goto fail;
 	}
-	port_ifaces[port_id] = iface;
 
 	return 0;
 fail:
@@ -615,6 +661,9 @@ static void port_to_api(void *info, const struct iface *iface) {
 	api->n_txq = port->n_txq;
 	api->rxq_size = port->rxq_size;
 	api->txq_size = port->txq_size;
+	api->ctrlq = port->ctrlq;
+	api->ctrlq_active = port->ctrlq_active;
+	api->rss_symmetric = port->rss_symmetric;
 
 	if (rte_eth_dev_info_get(port->port_id, &dev_info) == 0) {
 		memccpy(api->driver_name, dev_info.driver_name, 0, sizeof(api->driver_name));
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "graph_priv.h"
+
+#include <gr_iface.h>
+#include <gr_infra.h>
+#include <gr_log.h>
+#include <gr_macro.h>
+#include <gr_port.h>
+#include <gr_stb_ds.h>
+#include <gr_tx.h>
+#include <gr_worker.h>
+
+#include <rte_common.h>
+#include <rte_errno.h>
+#include <rte_ether.h>
+#include <rte_malloc.h>
+#include <rte_sched.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/queue.h>
+
+static_assert(GR_PORT_QOS_TC_COUNT == RTE_SCHED_TRAFFIC_CLASSES_PER_PIPE);
+static_assert(GR_PORT_QOS_TC_BEST_EFFORT == RTE_SCHED_TRAFFIC_CLASS_BE);
+
+// Token bucket refill periods in milliseconds.
+#define QOS_SUBPORT_TC_PERIOD 10
+#define QOS_PIPE_TC_PERIOD 40
+
+void port_qos_init(struct gr_port_qos *qos) {
+	static const uint8_t dscp_tc[][2] = {
+		{56, 0}, // CS7
+		{48, 0}, // CS6
+		{46, 1}, // EF
+		{40, 2}, // CS5
+		{32, 3}, // CS4
+		{34, 3}, // AF41
+		{36, 3}, // AF42
+		{38, 3}, // AF43
+		{24, 4}, // CS3
+		{26, 4}, // AF31
+		{28, 4}, // AF32
+		{30, 4}, // AF33
+		{16, 5}, // CS2
+		{18, 5}, // AF21
+		{20, 5}, // AF22
+		{22, 5}, // AF23
+		{10, 6}, // AF11
+		{12, 6}, // AF12
+		{14, 6}, // AF13
+	};
+
+	memset(qos, 0, sizeof(*qos));
+	qos->n_pipes = 1;
+	qos->queue_size = 64;
+	memset(qos->tc_rate, 100, sizeof(qos->tc_rate));
+	memset(qos->dscp_tc, GR_PORT_QOS_TC_BEST_EFFORT, sizeof(qos->dscp_tc));
+	for (unsigned i = 0; i < ARRAY_DIM(dscp_tc); i++)
+		qos->dscp_tc[dscp_tc[i][0]] = dscp_tc[i][1];
+}
+
+int port_qos_set(struct iface *iface, const struct gr_port_qos *qos) {
+	struct iface_info_port *port = (struct iface_info_port *)iface->info;
+	struct gr_port_qos old;
+
+	if (iface->type_id != GR_IFACE_TYPE_PORT)
+		return errno_set(EMEDIUMTYPE);
+	if (qos->n_pipes == 0 || qos->n_pipes > GR_PORT_QOS_MAX_PIPES
+	    || !rte_is_power_of_2(qos->n_pipes))
+		return errno_set(EINVAL);
+	if (qos->queue_size == 0 || qos->queue_size > GR_PORT_QOS_MAX_QUEUE_SIZE
+	    || !rte_is_power_of_2(qos->queue_size))
+		return errno_set(EINVAL);
+	for (unsigned tc = 0; tc < GR_PORT_QOS_TC_COUNT; tc++) {
+		if (qos->tc_rate[tc] == 0 || qos->tc_rate[tc] > 100)
+			return errno_set(ERANGE);
+	}
+	for (unsigned dscp = 0; dscp < GR_PORT_QOS_DSCP_COUNT; dscp++) {
+		if (qos->dscp_tc[dscp] >= GR_PORT_QOS_TC_COUNT)
+			return errno_set(ERANGE);
+	}
+
+	old = port->qos;
+	port->qos = *qos;
+
+	// The schedulers are created with the worker graphs.
+	if (worker_graph_reload_all() < 0) {
+		int err = errno;
+		port->qos = old;
+		worker_graph_reload_all();
+		return errno_set(err);
+	}
+
+	return 0;
+}
+
+static unsigned port_tx_workers(uint16_t port_id) {
+	struct queue_map *qmap;
+	struct worker *worker;
+	unsigned n = 0;
+
+	STAILQ_FOREACH (worker, &workers, next) {
+		arrforeach (qmap, worker->txqs) {
+			if (qmap->enabled && qmap->port_id == port_id) {
+				n++;
+				break;
+			}
+		}
+	}
+
+	return n;
+}
+
+struct port_qos *port_qos_create(uint16_t port_id, int socket_id) {
+	struct rte_sched_subport_profile_params subport_profile = {0};
+	struct rte_sched_subport_params subport = {0};
+	struct rte_sched_port_params params = {0};
+	struct rte_sched_pipe_params pipe = {0};
+	const struct iface_info_port *port;
+	const struct iface *iface;
+	struct port_qos *qos;
+	uint64_t rate, tb_size;
+	int ret;
+
+	if ((iface = port_get_iface(port_id)) == NULL)
+		return errno_set_null(ENODEV);
+	port = (const struct iface_info_port *)iface->info;
+
+	rate = port->qos.rate / RTE_MAX(port_tx_workers(port_id), 1U);
+	// Allow bursts of 10ms worth of traffic and at least two full size frames.
+	tb_size = RTE_MAX(rate / 100, 2 * (uint64_t)(iface->mtu + RTE_ETHER_HDR_LEN));
+
+	subport_profile.tb_rate = rate;
+	subport_profile.tb_size = tb_size;
+	subport_profile.tc_period = QOS_SUBPORT_TC_PERIOD;
+	for (unsigned tc = 0; tc < GR_PORT_QOS_TC_COUNT; tc++)
+		subport_profile.tc_rate[tc] = rate;
+
+	// Each pipe may use the whole rate. The subport limits the total.
+	pipe.tb_rate = rate;
+	pipe.tb_size = tb_size;
+	pipe.tc_period = QOS_PIPE_TC_PERIOD;
+	pipe.tc_ov_weight = 1;
+	for (unsigned tc = 0; tc < GR_PORT_QOS_TC_COUNT; tc++)
+		pipe.tc_rate[tc] = RTE_MAX(rate * port->qos.tc_rate[tc] / 100, UINT64_C(1));
+	for (unsigned q = 0; q < RTE_SCHED_BE_QUEUES_PER_PIPE; q++)
+		pipe.wrr_weights[q] = 1;
+
+	subport.n_pipes_per_subport_enabled = port->qos.n_pipes;
+	for (unsigned tc = 0; tc < GR_PORT_QOS_TC_COUNT; tc++)
+		subport.qsize[tc] = port->qos.queue_size;
+	subport.pipe_profiles = &pipe;
+	subport.n_pipe_profiles = 1;
+	subport.n_max_pipe_profiles = 1;
+
+	params.name = iface->name;
+	params.socket = socket_id;
+	params.rate = rate;
+	params.mtu = iface->mtu + RTE_ETHER_HDR_LEN + RTE_VLAN_HLEN;
+	params.frame_overhead = RTE_SCHED_FRAME_OVERHEAD_DEFAULT;
+	params.n_subports_per_port = 1;
+	params.n_subport_profiles = 1;
+	params.subport_profiles = &subport_profile;
+	params.n_max_subport_profiles = 1;
+	params.n_pipes_per_subport = port->qos.n_pipes;
+
+	qos = rte_zmalloc_socket(__func__, sizeof(*qos), RTE_CACHE_LINE_SIZE, socket_id);
+	if (qos == NULL)
+		return errno_set_null(ENOMEM);
+	qos->pipe_mask = port->qos.n_pipes - 1;
+	memcpy(qos->dscp_tc, port->qos.dscp_tc, sizeof(qos->dscp_tc));
+
+	if ((qos->sched = rte_sched_port_config(&params)) == NULL) {
+		ret = rte_errno ? rte_errno : EINVAL;
+		goto fail;
+	}
+	if ((ret = rte_sched_subport_config(qos->sched, 0, &subport, 0)) < 0) {
+		ret = -ret;
+		goto fail;
+	}
+	for (uint32_t p = 0; p < port->qos.n_pipes; p++) {
+		if ((ret = rte_sched_pipe_config(qos->sched, 0, p, 0)) < 0) {
+			ret = -ret;
+			goto fail;
+		}
+	}
+
+	return qos;
+fail:
+	port_qos_destroy(qos);
+	return errno_log_null(ret, "rte_sched_config");
+}
+
+void port_qos_destroy(struct port_qos *qos) {
+	if (qos == NULL)
+		return;
+	// Packets still queued are freed.
+	rte_sched_port_free(qos->sched);
+	rte_free(qos);
+}
@@ -23,6 +23,7 @@
 #include <rte_graph_worker.h>
 #include <rte_lcore.h>
 #include <rte_malloc.h>
+#include <rte_rcu_qsbr.h>
 
 #include <errno.h>
 #include <pthread.h>
@@ -32,6 +33,12 @@
 
 struct workers workers = STAILQ_HEAD_INITIALIZER(workers);
 
+static struct rte_rcu_qsbr *datapath_rcu;
+
+struct rte_rcu_qsbr *gr_datapath_rcu(void) {
+	return datapath_rcu;
+}
+
 int worker_create(unsigned cpu_id) {
 	struct worker *worker = rte_zmalloc(__func__, sizeof(*worker), 0);
 	int ret;
@@ -278,6 +285,14 @@ static int lcore_usage_cb(unsigned int lcore_id, struct rte_lcore_usage *usage)
 }
 
 static void worker_init(struct event_base *) {
+	size_t len = rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE);
+
+	datapath_rcu = rte_zmalloc(__func__, len, RTE_CACHE_LINE_SIZE);
+	if (datapath_rcu == NULL)
+		ABORT("rte_zmalloc(rcu): %s", rte_strerror(rte_errno));
+	if (rte_rcu_qsbr_init(datapath_rcu, RTE_MAX_LCORE) < 0)
+		ABORT("rte_rcu_qsbr_init: %s", rte_strerror(rte_errno));
+
 	rte_lcore_register_usage_cb(lcore_usage_cb);
 }
 
@@ -288,6 +303,9 @@ static void worker_fini(struct event_base *) {
 		worker_destroy(w->cpu_id);
 
 	STAILQ_INIT(&workers);
+
+	rte_free(datapath_rcu);
+	datapath_rcu = NULL;
 }
 
 static struct gr_module worker_module = {
@@ -30,6 +30,7 @@ void iface_type_register(struct iface_type *) { }
 void iface_event_notify(iface_event_t, struct iface *) { }
 mock_func(struct rte_mempool *, gr_pktmbuf_pool_get(int8_t, uint32_t));
 void gr_pktmbuf_pool_release(struct rte_mempool *, uint32_t) { }
+void port_qos_init(struct gr_port_qos *) { }
 
 struct iface *iface_next(uint16_t type_id, const struct iface *prev) {
 	uint16_t ifid;
@@ -44,6 +45,7 @@ struct iface *iface_next(uint16_t type_id, const struct iface *prev) {
 }
 
 mock_func(int, worker_graph_reload_all(void));
+mock_func(int, port_ctrlq_sync(struct iface_info_port *));
 mock_func(void, worker_graph_free(struct worker *));
 mock_func(void *, gr_datapath_loop(void *));
 mock_func(void, __wrap_rte_free(void *));
@@ -170,6 +172,7 @@ static int teardown(void **) {
 static void common_mocks(void) {
 	will_return_maybe(worker_graph_free, 0);
 	will_return_maybe(worker_graph_reload_all, 0);
+	will_return_maybe(port_ctrlq_sync, 0);
 	will_return_maybe(__wrap_numa_bitmask_isbitset, 1);
 	will_return_maybe(__wrap_pthread_create, 0);
 	will_return_maybe(__wrap_pthread_join, 0);
@@ -5,17 +5,25 @@
 
 #include <gr_graph.h>
 #include <gr_log.h>
+#include <gr_policer.h>
 #include <gr_vlan.h>
 
 #include <rte_byteorder.h>
+#include <rte_cycles.h>
 #include <rte_ether.h>
 #include <rte_graph.h>
 #include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_lcore.h>
 #include <rte_mbuf.h>
+#include <rte_meter.h>
+
+#include <stdbool.h>
 
 enum {
 	UNKNOWN_ETHER_TYPE = 0,
 	UNKNOWN_VLAN,
+	POLICER_DROP,
 	NB_EDGES,
 };
 
@@ -29,24 +37,102 @@ void gr_eth_input_add_type(rte_be16_t eth_type, const char *next_node) {
 	l2l3_edges[eth_type] = gr_node_attach_parent("eth_input", next_node);
 }
 
+// Truncated headers are left untouched, the packet will be dropped by ip(6)_input anyway.
+static inline void remark_dscp(struct rte_mbuf *m, rte_be16_t eth_type, uint8_t dscp) {
+	if (eth_type == RTE_BE16(RTE_ETHER_TYPE_IPV4)) {
+		struct rte_ipv4_hdr *ip = rte_pktmbuf_mtod(m, struct rte_ipv4_hdr *);
+		uint16_t old, new;
+		uint32_t sum;
+
+		if (rte_pktmbuf_data_len(m) < sizeof(*ip))
+			return;
+
+		// incremental checksum update (RFC 1624), only the TOS byte changes
+		old = (ip->version_ihl << 8) | ip->type_of_service;
+		ip->type_of_service = (dscp << 2) | (ip->type_of_service & 0x3);
+		new = (ip->version_ihl << 8) | ip->type_of_service;
+		sum = (uint16_t)~rte_be_to_cpu_16(ip->hdr_checksum) + (uint16_t)~old + new;
+		sum = (sum & 0xffff) + (sum >> 16);
+		sum = (sum & 0xffff) + (sum >> 16);
+		ip->hdr_checksum = rte_cpu_to_be_16(~sum);
+	} else if (eth_type == RTE_BE16(RTE_ETHER_TYPE_IPV6)) {
+		struct rte_ipv6_hdr *ip6 = rte_pktmbuf_mtod(m, struct rte_ipv6_hdr *);
+		uint32_t vtc_flow;
+
+		if (rte_pktmbuf_data_len(m) < sizeof(ip6->vtc_flow))
+			return;
+
+		vtc_flow = rte_be_to_cpu_32(ip6->vtc_flow);
+		vtc_flow = (vtc_flow & ~(UINT32_C(0x3f) << 22)) | ((uint32_t)dscp << 22);
+		ip6->vtc_flow = rte_cpu_to_be_32(vtc_flow);
+	}
+}
+
+// Meter a packet and apply the action of its color. Returns false if it must be dropped.
+static inline bool policer_apply(
+	struct iface_policer *p,
+	struct rte_mbuf *m,
+	rte_be16_t eth_type,
+	uint32_t len,
+	uint64_t now
+) {
+	struct policer_worker *w = &p->workers[rte_lcore_id()];
+	enum rte_color color;
+	uint8_t action;
+
+	if (p->conf.mode == GR_POLICER_SRTCM)
+		color = rte_meter_srtcm_color_blind_check(&w->srtcm, &p->profile.srtcm, now, len);
+	else
+		color = rte_meter_trtcm_color_blind_check(&w->trtcm, &p->profile.trtcm, now, len);
+
+	w->packets[color]++;
+	w->bytes[color] += len;
+
+	switch (color) {
+	case RTE_COLOR_YELLOW:
+		action = p->conf.yellow_action;
+		if (action == GR_POLICER_ACT_REMARK)
+			remark_dscp(m, eth_type, p->conf.yellow_dscp);
+		break;
+	case RTE_COLOR_RED:
+		action = p->conf.red_action;
+		if (action == GR_POLICER_ACT_REMARK)
+			remark_dscp(m, eth_type, p->conf.red_dscp);
+		break;
+	default:
+		action = GR_POLICER_ACT_PASS;
+	}
+
+	return action != GR_POLICER_ACT_DROP;
+}
+
 static uint16_t
 eth_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
-	uint16_t vlan_id, last_iface_id, last_vlan_id;
+	uint16_t vlan_id, last_iface_id, last_vlan_id, policer_iface_id;
+	struct eth_input_mbuf_data *eth_in;
+	struct iface_policer *policer;
 	struct rte_ether_hdr *eth;
 	struct rte_vlan_hdr *vlan;
 	struct iface *vlan_iface;
 	rte_be16_t eth_type;
 	struct rte_mbuf *m;
 	rte_edge_t next;
+	uint32_t len;
+	uint64_t now;
 
 	vlan_iface = NULL;
 	last_iface_id = UINT16_MAX;
 	last_vlan_id = UINT16_MAX;
+	policer = NULL;
+	policer_iface_id = UINT16_MAX;
+	// All packets of a burst are metered with the same timestamp.
+	now = rte_rdtsc();
 
 	for (uint16_t i = 0; i < nb_objs; i++) {
 		m = objs[i];
 
 		eth = rte_pktmbuf_mtod(m, struct rte_ether_hdr *);
+		len = rte_pktmbuf_pkt_len(m);
 		rte_pktmbuf_adj(m, sizeof(*eth));
 		eth_type = eth->ether_type;
 		vlan_id = 0;
@@ -63,9 +149,8 @@ eth_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 			vlan_id = rte_be_to_cpu_16(vlan->vlan_tci) & 0xfff;
 			eth_type = vlan->eth_proto;
 		}
+		eth_in = eth_input_mbuf_data(m);
 		if (vlan_id != 0) {
-			struct eth_input_mbuf_data *eth_in = eth_input_mbuf_data(m);
-
 			if (eth_in->iface->id != last_iface_id || vlan_id != last_vlan_id) {
 				vlan_iface = vlan_get_iface(eth_in->iface->id, vlan_id);
 				last_iface_id = eth_in->iface->id;
@@ -77,6 +162,14 @@ eth_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 			}
 			eth_in->iface = vlan_iface;
 		}
+		if (eth_in->iface->id != policer_iface_id) {
+			policer = iface_policer_get(eth_in->iface->id);
+			policer_iface_id = eth_in->iface->id;
+		}
+		if (policer != NULL && !policer_apply(policer, m, eth_type, len, now)) {
+			next = POLICER_DROP;
+			goto next;
+		}
 		next = l2l3_edges[eth_type];
 next:
 		rte_node_enqueue_x1(graph, node, next, m);
@@ -91,6 +184,7 @@ static struct rte_node_register node = {
 	.next_nodes = {
 		[UNKNOWN_ETHER_TYPE] = "eth_input_unknown_type",
 		[UNKNOWN_VLAN] = "eth_input_unknown_vlan",
+		[POLICER_DROP] = "eth_input_policer_drop",
 		// other edges are updated dynamically with gr_eth_input_add_type
 	},
 };
@@ -103,3 +197,4 @@ GR_NODE_REGISTER(info);
 
 GR_DROP_REGISTER(eth_input_unknown_type);
 GR_DROP_REGISTER(eth_input_unknown_vlan);
+GR_DROP_REGISTER(eth_input_policer_drop);
@@ -7,6 +7,7 @@
 #include <gr_graph.h>
 #include <gr_iface.h>
 #include <gr_log.h>
+#include <gr_macro.h>
 #include <gr_port.h>
 #include <gr_vlan.h>
 
@@ -22,6 +23,18 @@ enum {
 	NB_EDGES,
 };
 
+// Ethernet interfaces which are not backed by a DPDK port. Zero if none is registered.
+static rte_edge_t type_edges[128];
+
+void eth_output_add_tunnel(uint16_t iface_type_id, const char *next_node) {
+	LOG(DEBUG, "eth_output: iface_type=%u -> %s", iface_type_id, next_node);
+	if (iface_type_id == GR_IFACE_TYPE_UNDEF || iface_type_id >= ARRAY_DIM(type_edges))
+		ABORT("invalid iface type=%u", iface_type_id);
+	if (type_edges[iface_type_id] != 0)
+		ABORT("next node already registered for iface type=%u", iface_type_id);
+	type_edges[iface_type_id] = gr_node_attach_parent("eth_output", next_node);
+}
+
 static uint16_t
 eth_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
 	const struct rte_ether_addr *src_mac;
@@ -31,6 +44,7 @@ eth_output_process(struct rte_graph *graph, struct rte_node *node, void **objs,
 	struct rte_vlan_hdr *vlan;
 	struct rte_ether_hdr *eth;
 	struct rte_mbuf *mbuf;
+	rte_edge_t next;
 
 	for (uint16_t i = 0; i < nb_objs; i++) {
 		mbuf = objs[i];
@@ -56,7 +70,12 @@ eth_output_process(struct rte_graph *graph, struct rte_node *node, void **objs,
 			src_mac = &port->mac;
 			break;
 		default:
-			rte_node_enqueue_x1(graph, node, INVAL, mbuf);
+			// The tunnel node adds the ethernet header itself.
+			next = INVAL;
+			if (priv->iface->type_id < ARRAY_DIM(type_edges)
+			    && type_edges[priv->iface->type_id] != 0)
+				next = type_edges[priv->iface->type_id];
+			rte_node_enqueue_x1(graph, node, next, mbuf);
 			continue;
 		}
 
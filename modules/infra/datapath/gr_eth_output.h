@@ -20,4 +20,8 @@ GR_MBUF_PRIV_DATA_TYPE(eth_output_mbuf_data, {
 	rte_be16_t ether_type;
 });
 
+// Packets sent on interfaces of this type are passed to next_node instead of a port. The
+// ethernet header is not added yet, eth_output_mbuf_data is left untouched.
+void eth_output_add_tunnel(uint16_t iface_type_id, const char *next_node);
+
 #endif
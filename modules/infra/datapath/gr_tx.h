@@ -4,12 +4,32 @@
 #ifndef _GR_INFRA_TX
 #define _GR_INFRA_TX
 
+#include <gr_infra.h>
+
 #include <rte_build_config.h>
+#include <rte_sched.h>
 
 #include <stdint.h>
 
+// Egress scheduler of a port for a single worker.
+struct port_qos {
+	struct rte_sched_port *sched;
+	uint32_t pipe_mask;
+	uint8_t dscp_tc[GR_PORT_QOS_DSCP_COUNT];
+};
+
 struct tx_node_queues {
 	uint16_t txq_ids[RTE_MAX_ETHPORTS];
+	// Filled by port_tx with the schedulers of the ports which have QoS enabled. The packets
+	// queued in the schedulers are sent by port_tx_qos.
+	uint16_t n_qos_ports;
+	uint16_t qos_ports[RTE_MAX_ETHPORTS];
+	struct port_qos *qos[RTE_MAX_ETHPORTS];
 };
 
+// Create the scheduler of a port for a worker. The port rate is shared evenly between all
+// workers which have a tx queue on it. Must be called from the control plane.
+struct port_qos *port_qos_create(uint16_t port_id, int socket_id);
+void port_qos_destroy(struct port_qos *);
+
 #endif
@@ -15,6 +15,7 @@
 #include <rte_graph_worker.h>
 #include <rte_lcore.h>
 #include <rte_malloc.h>
+#include <rte_rcu_qsbr.h>
 
 #include <pthread.h>
 #include <stdatomic.h>
@@ -119,6 +120,7 @@ void *gr_datapath_loop(void *priv) {
 	uint64_t timestamp, timestamp_tmp, cycles;
 	uint32_t sleep, max_sleep_us;
 	struct worker *w = priv;
+	struct rte_rcu_qsbr *rcu;
 	struct rte_graph *graph;
 	rte_cpuset_t cpuset;
 	unsigned cur, loop;
@@ -157,6 +159,12 @@ void *gr_datapath_loop(void *priv) {
 
 	log(INFO, "lcore_id = %d", w->lcore_id);
 
+	rcu = gr_datapath_rcu();
+	if (rte_rcu_qsbr_thread_register(rcu, w->lcore_id) < 0) {
+		log(ERR, "rte_rcu_qsbr_thread_register: %s", rte_strerror(rte_errno));
+		return NULL;
+	}
+
 	static_assert(atomic_is_lock_free(&w->shutdown));
 	static_assert(atomic_is_lock_free(&w->cur_config));
 	static_assert(atomic_is_lock_free(&w->stats_reset));
@@ -176,6 +184,8 @@ reconfig:
 		goto reconfig;
 	}
 
+	rte_rcu_qsbr_thread_online(rcu, w->lcore_id);
+
 	if (stats_reload(graph, &ctx) < 0)
 		goto shutdown;
 	atomic_store(&w->stats, ctx.w_stats);
@@ -189,20 +199,26 @@ reconfig:
 	timestamp = rte_rdtsc();
 	for (;;) {
 		rte_graph_walk(graph);
+		rte_rcu_qsbr_quiescent(rcu, w->lcore_id);
 
 		if (++loop == 32) {
 			if (atomic_load(&w->shutdown) || atomic_load(&w->next_config) != cur) {
 				gr_modules_dp_fini();
+				rte_rcu_qsbr_thread_offline(rcu, w->lcore_id);
 				goto reconfig;
 			}
 
+			gr_modules_dp_tick();
+
 			ctx.last_count = 0;
 			rte_graph_cluster_stats_get(ctx.stats, false);
 			timestamp_tmp = rte_rdtsc();
 			cycles = timestamp_tmp - timestamp;
 			if (ctx.last_count == 0 && max_sleep_us > 0) {
 				sleep = sleep == max_sleep_us ? sleep : (sleep + 1);
+				rte_rcu_qsbr_thread_offline(rcu, w->lcore_id);
 				usleep(sleep);
+				rte_rcu_qsbr_thread_online(rcu, w->lcore_id);
 			} else {
 				sleep = 0;
 				ctx.w_stats->busy_cycles += cycles;
@@ -218,6 +234,7 @@ reconfig:
 
 shutdown:
 	log(NOTICE, "shutting down tid=%d", w->tid);
+	rte_rcu_qsbr_thread_unregister(rcu, w->lcore_id);
 	atomic_store(&w->stats, NULL);
 	rte_graph_cluster_stats_destroy(ctx.stats);
 	rte_free(ctx.w_stats);
@@ -4,15 +4,23 @@
 #include "gr_tx.h"
 
 #include <gr_graph.h>
+#include <gr_iface.h>
 #include <gr_log.h>
+#include <gr_port.h>
 #include <gr_worker.h>
 
 #include <rte_build_config.h>
+#include <rte_byteorder.h>
 #include <rte_ethdev.h>
+#include <rte_ether.h>
 #include <rte_graph_worker.h>
+#include <rte_ip.h>
 #include <rte_malloc.h>
+#include <rte_sched.h>
 
+#include <errno.h>
 #include <stdint.h>
+#include <string.h>
 
 enum {
 	TX_ERROR = 0,
@@ -21,8 +29,52 @@ enum {
 
 struct tx_ctx {
 	uint16_t txq_ids[RTE_MAX_ETHPORTS];
+	struct port_qos *qos[RTE_MAX_ETHPORTS];
 };
 
+static inline uint8_t pkt_dscp(const struct rte_mbuf *m) {
+	const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(m, const struct rte_ether_hdr *);
+	rte_be16_t ether_type = eth->ether_type;
+	const void *l3 = eth + 1;
+
+	if (ether_type == RTE_BE16(RTE_ETHER_TYPE_VLAN)) {
+		const struct rte_vlan_hdr *vlan = l3;
+		ether_type = vlan->eth_proto;
+		l3 = vlan + 1;
+	}
+
+	switch (ether_type) {
+	case RTE_BE16(RTE_ETHER_TYPE_IPV4):
+		return ((const struct rte_ipv4_hdr *)l3)->type_of_service >> 2;
+	case RTE_BE16(RTE_ETHER_TYPE_IPV6):
+		return (rte_be_to_cpu_32(((const struct rte_ipv6_hdr *)l3)->vtc_flow) >> 22) & 0x3f;
+	}
+
+	return 0;
+}
+
+// Classify packets and store them in the port scheduler. They are sent by port_tx_qos.
+static inline void
+qos_enqueue(const struct port_qos *qos, struct rte_mbuf **mbufs, uint16_t n) {
+	uint32_t hash, pipe, queue;
+	struct rte_mbuf *m;
+	uint8_t tc;
+
+	for (uint16_t i = 0; i < n; i++) {
+		m = mbufs[i];
+		tc = qos->dscp_tc[pkt_dscp(m)];
+		// Keep packets of the same flow in the same pipe and queue to avoid reordering.
+		hash = m->ol_flags & RTE_MBUF_F_RX_RSS_HASH ? m->hash.rss : 0;
+		hash *= 0x9e3779b1;
+		pipe = (hash >> 16) & qos->pipe_mask;
+		queue = tc == RTE_SCHED_TRAFFIC_CLASS_BE ? hash % RTE_SCHED_BE_QUEUES_PER_PIPE : 0;
+		rte_sched_port_pkt_write(qos->sched, m, 0, pipe, tc, queue, RTE_COLOR_GREEN);
+	}
+
+	// Packets which do not fit in their queue are freed by the scheduler.
+	rte_sched_port_enqueue(qos->sched, mbufs, n);
+}
+
 static inline void tx_burst(
 	struct rte_graph *graph,
 	struct rte_node *node,
@@ -36,6 +88,8 @@ static inline void tx_burst(
 	txq_id = ctx->txq_ids[port_id];
 	if (txq_id == 0xffff) {
 		rte_node_enqueue(graph, node, TX_ERROR, (void *)mbufs, n);
+	} else if (ctx->qos[port_id] != NULL) {
+		qos_enqueue(ctx->qos[port_id], mbufs, n);
 	} else {
 		tx_ok = rte_eth_tx_burst(port_id, txq_id, mbufs, n);
 		if (tx_ok < n)
@@ -74,29 +128,57 @@ tx_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t
 	return nb_objs;
 }
 
-static int tx_init(const struct rte_graph *graph, struct rte_node *node) {
-	const struct tx_node_queues *data;
-	struct tx_ctx *ctx;
+static void tx_fini(const struct rte_graph *graph, struct rte_node *node) {
+	struct tx_ctx *ctx = node->ctx_ptr;
 
 	(void)graph;
 
+	if (ctx == NULL)
+		return;
+	for (uint16_t port_id = 0; port_id < RTE_MAX_ETHPORTS; port_id++)
+		port_qos_destroy(ctx->qos[port_id]);
+	rte_free(ctx);
+	node->ctx_ptr = NULL;
+}
+
+static int tx_init(const struct rte_graph *graph, struct rte_node *node) {
+	const struct iface_info_port *port;
+	struct tx_node_queues *data;
+	const struct iface *iface;
+	struct tx_ctx *ctx;
+
 	if ((data = gr_node_data_get(graph->name, node->name)) == NULL)
 		return -1;
 
-	ctx = rte_malloc(__func__, sizeof(*ctx), RTE_CACHE_LINE_SIZE);
+	ctx = rte_zmalloc(__func__, sizeof(*ctx), RTE_CACHE_LINE_SIZE);
 	if (ctx == NULL) {
-		LOG(ERR, "rte_malloc(): %s", rte_strerror(rte_errno));
+		LOG(ERR, "rte_zmalloc(): %s", rte_strerror(rte_errno));
 		return -1;
 	}
 	memcpy(ctx->txq_ids, data->txq_ids, sizeof(ctx->txq_ids));
 	node->ctx_ptr = ctx;
 
-	return 0;
-}
+	data->n_qos_ports = 0;
+	for (uint16_t port_id = 0; port_id < RTE_MAX_ETHPORTS; port_id++) {
+		if (ctx->txq_ids[port_id] == 0xffff)
+			continue;
+		if ((iface = port_get_iface(port_id)) == NULL)
+			continue;
+		port = (const struct iface_info_port *)iface->info;
+		if (port->qos.rate == 0)
+			continue;
+		ctx->qos[port_id] = port_qos_create(port_id, graph->socket);
+		if (ctx->qos[port_id] == NULL) {
+			LOG(ERR, "port %u: %s", port_id, strerror(errno));
+			tx_fini(graph, node);
+			data->n_qos_ports = 0;
+			return -1;
+		}
+		data->qos[port_id] = ctx->qos[port_id];
+		data->qos_ports[data->n_qos_ports++] = port_id;
+	}
 
-static void tx_fini(const struct rte_graph *graph, struct rte_node *node) {
-	(void)graph;
-	rte_free(node->ctx_ptr);
+	return 0;
 }
 
 static struct rte_node_register node = {
@@ -118,4 +200,50 @@ static struct gr_node_info info = {
 
 GR_NODE_REGISTER(info);
 
+static uint16_t
+tx_qos_process(struct rte_graph *graph, struct rte_node *node, void **, uint16_t) {
+	const struct tx_node_queues *data = node->ctx_ptr;
+	struct rte_mbuf **mbufs = (struct rte_mbuf **)node->objs;
+	uint16_t port_id, n, tx_ok, count = 0;
+
+	for (uint16_t i = 0; i < data->n_qos_ports; i++) {
+		port_id = data->qos_ports[i];
+		n = rte_sched_port_dequeue(data->qos[port_id]->sched, mbufs, RTE_GRAPH_BURST_SIZE);
+		if (n == 0)
+			continue;
+		tx_ok = rte_eth_tx_burst(port_id, data->txq_ids[port_id], mbufs, n);
+		if (tx_ok < n)
+			rte_node_enqueue(graph, node, TX_ERROR, (void *)&mbufs[tx_ok], n - tx_ok);
+		count += n;
+	}
+
+	return count;
+}
+
+static int tx_qos_init(const struct rte_graph *graph, struct rte_node *node) {
+	// The schedulers are owned by port_tx.
+	if ((node->ctx_ptr = gr_node_data_get(graph->name, "port_tx")) == NULL)
+		return -1;
+	return 0;
+}
+
+static struct rte_node_register qos_node = {
+	.flags = RTE_NODE_SOURCE_F,
+	.name = "port_tx_qos",
+
+	.process = tx_qos_process,
+	.init = tx_qos_init,
+
+	.nb_edges = NB_EDGES,
+	.next_nodes = {
+		[TX_ERROR] = "port_tx_error",
+	},
+};
+
+static struct gr_node_info qos_info = {
+	.node = &qos_node,
+};
+
+GR_NODE_REGISTER(qos_info);
+
 GR_DROP_REGISTER(port_tx_error);
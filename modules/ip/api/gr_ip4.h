@@ -25,6 +25,7 @@ struct gr_ip4_ifaddr {
 #define GR_IP4_NH_F_LOCAL GR_BIT16(5) // Local address
 #define GR_IP4_NH_F_GATEWAY GR_BIT16(6) // Gateway route
 #define GR_IP4_NH_F_LINK GR_BIT16(7) // Connected link route
+#define GR_IP4_NH_F_GROUP GR_BIT16(8) // Next hop group
 typedef uint16_t gr_ip4_nh_flags_t;
 
 static inline const char *gr_ip4_nh_f_name(const gr_ip4_nh_flags_t flag) {
@@ -45,6 +46,8 @@ static inline const char *gr_ip4_nh_f_name(const gr_ip4_nh_flags_t flag) {
 		return "gateway";
 	case GR_IP4_NH_F_LINK:
 		return "link";
+	case GR_IP4_NH_F_GROUP:
+		return "group";
 	}
 	return "";
 }
@@ -61,9 +64,126 @@ struct gr_ip4_nh {
 	uint16_t held_pkts;
 };
 
+// Maximum number of members in a next hop group.
+#define GR_IP4_NH_GROUP_MAX_MEMBERS 64
+
+// Routes via a next hop group balance flows across all members.
+struct gr_ip4_nh_group {
+	uint32_t group_id; // Must not be zero.
+	uint16_t vrf_id;
+	uint8_t n_members;
+	ip4_addr_t members[GR_IP4_NH_GROUP_MAX_MEMBERS];
+};
+
+// Limits of the packets waiting for next hop resolution.
+struct gr_ip4_nh_hold_conf {
+	uint16_t max_pkts; // Per next hop.
+	uint32_t max_pkts_total; // For all next hops.
+	uint16_t hold_time; // Seconds before held packets are dropped.
+};
+
+struct gr_ip4_nh_hold_stats {
+	uint32_t held_pkts; // Currently held.
+	uint64_t held; // Total number of packets held.
+	uint64_t flushed; // Sent after resolution.
+	uint64_t expired; // Dropped after hold_time or when resolution failed.
+};
+
+// Limits of the ARP requests sent to resolve next hops.
+struct gr_ip4_nh_solicit_conf {
+	uint32_t rate; // Requests per second for all interfaces.
+	uint32_t burst;
+	uint32_t iface_rate; // Requests per second for each interface.
+	uint32_t iface_burst;
+};
+
+struct gr_ip4_nh_solicit_stats {
+	uint64_t sent;
+	uint64_t coalesced; // Duplicate requests ignored.
+	uint64_t rate_limited; // Requests delayed because of a rate limit.
+};
+
+// Limits of the ICMP errors generated by each datapath worker. Packets which would trigger
+// an error beyond these limits are dropped without reply.
+struct gr_ip4_icmp_error_conf {
+	uint32_t rate; // Errors per second for all sources.
+	uint32_t burst;
+	uint32_t src_rate; // Errors per second for each source prefix.
+	uint32_t src_burst;
+	uint8_t src_prefixlen; // Length of the source prefixes.
+};
+
+// Control plane policing classes.
+#define GR_IP4_COPP_ARP 0 // ARP requests and replies.
+#define GR_IP4_COPP_ICMP 1 // ICMP to local addresses.
+#define GR_IP4_COPP_TUNNEL 2 // IPIP and UDP tunnel packets to local addresses.
+#define GR_IP4_COPP_OTHER 3 // Any other protocol to local addresses.
+#define GR_IP4_COPP_CLASS_COUNT 4
+
+// Limits of the packets of a class delivered locally by each datapath worker. Packets
+// beyond these limits are dropped before being processed.
+struct gr_ip4_copp_limit {
+	uint32_t rate; // Packets per second for all sources.
+	uint32_t burst;
+	uint32_t src_rate; // Packets per second for each source prefix.
+	uint32_t src_burst;
+};
+
+struct gr_ip4_copp_conf {
+	struct gr_ip4_copp_limit limits[GR_IP4_COPP_CLASS_COUNT];
+	uint8_t src_prefixlen; // Length of the source prefixes.
+};
+
+// Unicast reverse path forwarding modes.
+#define GR_IP4_URPF_OFF 0
+#define GR_IP4_URPF_STRICT 1 // The route to the source must use the input interface.
+#define GR_IP4_URPF_LOOSE 2 // There must be a route to the source.
+
+struct gr_ip4_urpf {
+	uint16_t iface_id;
+	uint8_t mode; // GR_IP4_URPF_*
+};
+
+struct gr_ip4_flow_cache_conf {
+	uint8_t enabled; // Bypass route and neighbor lookups for known flows.
+};
+
 struct gr_ip4_route {
 	struct ip4_net dest;
 	ip4_addr_t nh;
+	uint32_t group_id; // Zero if the route is not via a next hop group.
+};
+
+#define GR_IP4_FIB_TYPE_DIR24_8 0
+#define GR_IP4_FIB_TYPE_TRIE 1
+#define GR_IP4_FIB_TYPE_COMPACT 2 // Shared with other small VRFs.
+
+static inline const char *gr_ip4_fib_type_name(uint8_t type) {
+	switch (type) {
+	case GR_IP4_FIB_TYPE_DIR24_8:
+		return "dir24_8";
+	case GR_IP4_FIB_TYPE_TRIE:
+		return "trie";
+	case GR_IP4_FIB_TYPE_COMPACT:
+		return "compact";
+	}
+	return "?";
+}
+
+struct gr_ip4_fib_conf {
+	uint8_t type; // Lookup algorithm. Uses values from GR_IP4_FIB_TYPE_*.
+	// Next hop index width in bytes (2, 4 or 8). Both FIB types have a fixed 2^24 entries
+	// table of this width. 2 bytes only store next hop indexes below 32767 and are refused
+	// when grout is started with more next hops.
+	uint8_t nh_size;
+	uint32_t num_tbl8; // Number of tbl8 groups.
+	uint32_t max_routes; // Maximum number of routes.
+};
+
+struct gr_ip4_vrf {
+	uint16_t vrf_id;
+	struct gr_ip4_fib_conf fib;
+	uint32_t n_routes;
 };
 
 #define GR_IP4_MODULE 0xf00d
@@ -93,13 +213,119 @@ struct gr_ip4_nh_del_req {
 
 struct gr_ip4_nh_list_req {
 	uint16_t vrf_id;
+	uint32_t cursor;
 };
 
 struct gr_ip4_nh_list_resp {
+	uint32_t next;
 	uint16_t n_nhs;
 	struct gr_ip4_nh nhs[/* n_nhs */];
 };
 
+// Create a next hop group or atomically replace all its members.
+#define GR_IP4_NH_GROUP_SET REQUEST_TYPE(GR_IP4_MODULE, 0x0004)
+
+struct gr_ip4_nh_group_set_req {
+	struct gr_ip4_nh_group group;
+};
+
+// struct gr_ip4_nh_group_set_resp { };
+
+#define GR_IP4_NH_GROUP_DEL REQUEST_TYPE(GR_IP4_MODULE, 0x0005)
+
+struct gr_ip4_nh_group_del_req {
+	uint16_t vrf_id;
+	uint32_t group_id;
+	uint8_t missing_ok;
+};
+
+// struct gr_ip4_nh_group_del_resp { };
+
+#define GR_IP4_NH_GROUP_LIST REQUEST_TYPE(GR_IP4_MODULE, 0x0006)
+
+struct gr_ip4_nh_group_list_req {
+	uint16_t vrf_id;
+	uint32_t cursor;
+};
+
+struct gr_ip4_nh_group_list_resp {
+	uint32_t next;
+	uint16_t n_groups;
+	struct gr_ip4_nh_group groups[/* n_groups */];
+};
+
+// Zero fields are left unchanged.
+#define GR_IP4_NH_HOLD_SET REQUEST_TYPE(GR_IP4_MODULE, 0x0007)
+
+struct gr_ip4_nh_hold_set_req {
+	struct gr_ip4_nh_hold_conf conf;
+};
+
+// struct gr_ip4_nh_hold_set_resp { };
+
+#define GR_IP4_NH_HOLD_GET REQUEST_TYPE(GR_IP4_MODULE, 0x0008)
+
+// struct gr_ip4_nh_hold_get_req { };
+
+struct gr_ip4_nh_hold_get_resp {
+	struct gr_ip4_nh_hold_conf conf;
+	struct gr_ip4_nh_hold_stats stats;
+};
+
+// Zero fields are left unchanged.
+#define GR_IP4_NH_SOLICIT_SET REQUEST_TYPE(GR_IP4_MODULE, 0x0009)
+
+struct gr_ip4_nh_solicit_set_req {
+	struct gr_ip4_nh_solicit_conf conf;
+};
+
+// struct gr_ip4_nh_solicit_set_resp { };
+
+#define GR_IP4_NH_SOLICIT_GET REQUEST_TYPE(GR_IP4_MODULE, 0x000a)
+
+// struct gr_ip4_nh_solicit_get_req { };
+
+struct gr_ip4_nh_solicit_get_resp {
+	struct gr_ip4_nh_solicit_conf conf;
+	struct gr_ip4_nh_solicit_stats stats;
+};
+
+// Zero fields are left unchanged.
+#define GR_IP4_ICMP_ERROR_SET REQUEST_TYPE(GR_IP4_MODULE, 0x000b)
+
+struct gr_ip4_icmp_error_set_req {
+	struct gr_ip4_icmp_error_conf conf;
+};
+
+// struct gr_ip4_icmp_error_set_resp { };
+
+#define GR_IP4_ICMP_ERROR_GET REQUEST_TYPE(GR_IP4_MODULE, 0x000c)
+
+// struct gr_ip4_icmp_error_get_req { };
+
+struct gr_ip4_icmp_error_get_resp {
+	struct gr_ip4_icmp_error_conf conf;
+};
+
+// Zero fields are left unchanged.
+#define GR_IP4_COPP_SET REQUEST_TYPE(GR_IP4_MODULE, 0x000d)
+
+struct gr_ip4_copp_set_req {
+	uint8_t class; // GR_IP4_COPP_*
+	struct gr_ip4_copp_limit limit;
+	uint8_t src_prefixlen;
+};
+
+// struct gr_ip4_copp_set_resp { };
+
+#define GR_IP4_COPP_GET REQUEST_TYPE(GR_IP4_MODULE, 0x000e)
+
+// struct gr_ip4_copp_get_req { };
+
+struct gr_ip4_copp_get_resp {
+	struct gr_ip4_copp_conf conf;
+};
+
 // routes //////////////////////////////////////////////////////////////////////
 
 #define GR_IP4_ROUTE_ADD REQUEST_TYPE(GR_IP4_MODULE, 0x0010)
@@ -108,6 +334,7 @@ struct gr_ip4_route_add_req {
 	uint16_t vrf_id;
 	struct ip4_net dest;
 	ip4_addr_t nh;
+	uint32_t group_id; // If not zero, nh is ignored and the route uses this group.
 	uint8_t exist_ok;
 };
 
@@ -138,13 +365,44 @@ struct gr_ip4_route_get_resp {
 
 struct gr_ip4_route_list_req {
 	uint16_t vrf_id;
+	// Last route of the previous chunk, zero for the first chunk.
+	struct ip4_net cursor;
 };
 
 struct gr_ip4_route_list_resp {
+	// Zero when the list is complete.
+	struct ip4_net next;
 	uint16_t n_routes;
 	struct gr_ip4_route routes[/* n_routes */];
 };
 
+// Maximum number of routes in a single bulk request.
+#define GR_IP4_ROUTE_BULK_MAX 4096
+
+// Per-route errno values, in request order. Zero means success.
+struct gr_ip4_route_bulk_resp {
+	uint16_t n_status;
+	uint32_t status[/* n_status */];
+};
+
+#define GR_IP4_ROUTE_ADD_BULK REQUEST_TYPE(GR_IP4_MODULE, 0x0014)
+
+struct gr_ip4_route_add_bulk_req {
+	uint16_t n_routes;
+	struct gr_ip4_route_add_req routes[/* n_routes */];
+};
+
+// struct gr_ip4_route_add_bulk_resp = struct gr_ip4_route_bulk_resp
+
+#define GR_IP4_ROUTE_DEL_BULK REQUEST_TYPE(GR_IP4_MODULE, 0x0015)
+
+struct gr_ip4_route_del_bulk_req {
+	uint16_t n_routes;
+	struct gr_ip4_route_del_req routes[/* n_routes */];
+};
+
+// struct gr_ip4_route_del_bulk_resp = struct gr_ip4_route_bulk_resp
+
 // addresses ///////////////////////////////////////////////////////////////////
 
 #define GR_IP4_ADDR_ADD REQUEST_TYPE(GR_IP4_MODULE, 0x0021)
@@ -176,4 +434,70 @@ struct gr_ip4_addr_list_resp {
 	struct gr_ip4_ifaddr addrs[/* n_addrs */];
 };
 
+// vrfs ////////////////////////////////////////////////////////////////////////
+
+// VRF reconfig attributes. Fields not in set_attrs keep their current value.
+#define GR_IP4_VRF_SET_TYPE GR_BIT64(0)
+#define GR_IP4_VRF_SET_NH_SIZE GR_BIT64(1)
+#define GR_IP4_VRF_SET_NUM_TBL8 GR_BIT64(2)
+#define GR_IP4_VRF_SET_MAX_ROUTES GR_BIT64(3)
+
+// Zero fields are replaced by their default values.
+#define GR_IP4_VRF_SET REQUEST_TYPE(GR_IP4_MODULE, 0x0030)
+
+struct gr_ip4_vrf_set_req {
+	uint16_t vrf_id;
+	uint64_t set_attrs;
+	struct gr_ip4_fib_conf fib;
+};
+
+// struct gr_ip4_vrf_set_resp { };
+
+#define GR_IP4_VRF_LIST REQUEST_TYPE(GR_IP4_MODULE, 0x0031)
+
+// struct gr_ip4_vrf_list_req { };
+
+struct gr_ip4_vrf_list_resp {
+	uint16_t n_vrfs;
+	struct gr_ip4_vrf vrfs[/* n_vrfs */];
+};
+
+// flow cache //////////////////////////////////////////////////////////////////
+
+#define GR_IP4_FLOW_CACHE_SET REQUEST_TYPE(GR_IP4_MODULE, 0x0040)
+
+struct gr_ip4_flow_cache_set_req {
+	struct gr_ip4_flow_cache_conf conf;
+};
+
+// struct gr_ip4_flow_cache_set_resp { };
+
+#define GR_IP4_FLOW_CACHE_GET REQUEST_TYPE(GR_IP4_MODULE, 0x0041)
+
+// struct gr_ip4_flow_cache_get_req { };
+
+struct gr_ip4_flow_cache_get_resp {
+	struct gr_ip4_flow_cache_conf conf;
+	uint32_t generation; // Incremented on each route, next hop or interface change.
+};
+
+// urpf ////////////////////////////////////////////////////////////////////////
+
+#define GR_IP4_URPF_SET REQUEST_TYPE(GR_IP4_MODULE, 0x0050)
+
+struct gr_ip4_urpf_set_req {
+	struct gr_ip4_urpf urpf;
+};
+
+// struct gr_ip4_urpf_set_resp { };
+
+#define GR_IP4_URPF_LIST REQUEST_TYPE(GR_IP4_MODULE, 0x0051)
+
+// struct gr_ip4_urpf_list_req { };
+
+struct gr_ip4_urpf_list_resp {
+	uint16_t n_urpfs;
+	struct gr_ip4_urpf urpfs[/* n_urpfs */];
+};
+
 #endif
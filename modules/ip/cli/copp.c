@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ip.h"
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_ip4.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const class_names[GR_IP4_COPP_CLASS_COUNT] = {
+	[GR_IP4_COPP_ARP] = "arp",
+	[GR_IP4_COPP_ICMP] = "icmp",
+	[GR_IP4_COPP_TUNNEL] = "tunnel",
+	[GR_IP4_COPP_OTHER] = "other",
+};
+
+static cmd_status_t copp_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_copp_set_req req = {0};
+	const char *class = arg_str(p, "CLASS");
+	uint16_t prefixlen = 0;
+
+	req.class = GR_IP4_COPP_CLASS_COUNT;
+	for (uint8_t i = 0; i < GR_IP4_COPP_CLASS_COUNT; i++) {
+		if (strcmp(class, class_names[i]) == 0)
+			req.class = i;
+	}
+	if (arg_u32(p, "RATE", &req.limit.rate) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "BURST", &req.limit.burst) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "SRC_RATE", &req.limit.src_rate) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "SRC_BURST", &req.limit.src_burst) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u16(p, "PREFIXLEN", &prefixlen) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	req.src_prefixlen = prefixlen;
+
+	if (gr_api_client_send_recv(c, GR_IP4_COPP_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t copp_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ip4_copp_get_resp *resp;
+	struct libscols_table *table;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_IP4_COPP_GET, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("src_prefixlen: %u\n", resp->conf.src_prefixlen);
+
+	table = scols_new_table();
+	scols_table_new_column(table, "CLASS", 0, 0);
+	scols_table_new_column(table, "RATE", 0, 0);
+	scols_table_new_column(table, "BURST", 0, 0);
+	scols_table_new_column(table, "SRC_RATE", 0, 0);
+	scols_table_new_column(table, "SRC_BURST", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint8_t i = 0; i < GR_IP4_COPP_CLASS_COUNT; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_ip4_copp_limit *l = &resp->conf.limits[i];
+		scols_line_sprintf(line, 0, "%s", class_names[i]);
+		scols_line_sprintf(line, 1, "%u", l->rate);
+		scols_line_sprintf(line, 2, "%u", l->burst);
+		scols_line_sprintf(line, 3, "%u", l->src_rate);
+		scols_line_sprintf(line, 4, "%u", l->src_burst);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		IP_SET_CTX(root),
+		"copp CLASS (rate RATE),(burst BURST),(src_rate SRC_RATE),(src_burst SRC_BURST),"
+		"(src_prefixlen PREFIXLEN)",
+		copp_set,
+		"Change the limits of the packets delivered locally by each worker.",
+		with_help("Traffic class.", ec_node_re("CLASS", "^(arp|icmp|tunnel|other)$")),
+		with_help(
+			"Packets per second for all sources.",
+			ec_node_uint("RATE", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Burst size for all sources.", ec_node_uint("BURST", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Packets per second for each source prefix.",
+			ec_node_uint("SRC_RATE", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Burst size for each source prefix.",
+			ec_node_uint("SRC_BURST", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Length of the source prefixes (all classes).",
+			ec_node_uint("PREFIXLEN", 1, 32, 10)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"copp",
+		copp_show,
+		"Show the limits of the packets delivered locally."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "ipv4 copp",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ip.h"
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_ip4.h>
+
+#include <ecoli.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static cmd_status_t flow_cache_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_flow_cache_set_req req = {0};
+
+	req.conf.enabled = strcmp(arg_str(p, "STATE"), "on") == 0;
+
+	if (gr_api_client_send_recv(c, GR_IP4_FLOW_CACHE_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t flow_cache_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ip4_flow_cache_get_resp *resp;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_IP4_FLOW_CACHE_GET, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("enabled: %s\n", resp->conf.enabled ? "on" : "off");
+	printf("generation: %u\n", resp->generation);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		IP_SET_CTX(root),
+		"flow cache STATE",
+		flow_cache_set,
+		"Enable or disable the per-worker cache of forwarding decisions.",
+		with_help("Cache state.", ec_node_re("STATE", "on|off"))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"flow cache",
+		flow_cache_show,
+		"Show the flow cache configuration."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "ipv4 flow",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ip.h"
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_ip4.h>
+
+#include <ecoli.h>
+
+#include <errno.h>
+#include <stdint.h>
+
+static cmd_status_t icmp4_error_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_icmp_error_set_req req = {0};
+	uint16_t prefixlen = 0;
+
+	if (arg_u32(p, "RATE", &req.conf.rate) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "BURST", &req.conf.burst) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "SRC_RATE", &req.conf.src_rate) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "SRC_BURST", &req.conf.src_burst) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u16(p, "PREFIXLEN", &prefixlen) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	req.conf.src_prefixlen = prefixlen;
+
+	if (gr_api_client_send_recv(c, GR_IP4_ICMP_ERROR_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t icmp4_error_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ip4_icmp_error_get_resp *resp;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_IP4_ICMP_ERROR_GET, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("rate: %u\n", resp->conf.rate);
+	printf("burst: %u\n", resp->conf.burst);
+	printf("src_rate: %u\n", resp->conf.src_rate);
+	printf("src_burst: %u\n", resp->conf.src_burst);
+	printf("src_prefixlen: %u\n", resp->conf.src_prefixlen);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		IP_SET_CTX(root),
+		"icmp error (rate RATE),(burst BURST),(src_rate SRC_RATE),(src_burst SRC_BURST),"
+		"(src_prefixlen PREFIXLEN)",
+		icmp4_error_set,
+		"Change the rate limits of ICMP errors sent by each worker.",
+		with_help(
+			"Errors per second for all sources.",
+			ec_node_uint("RATE", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Burst size for all sources.", ec_node_uint("BURST", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Errors per second for each source prefix.",
+			ec_node_uint("SRC_RATE", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Burst size for each source prefix.",
+			ec_node_uint("SRC_BURST", 1, UINT32_MAX, 10)
+		),
+		with_help("Length of the source prefixes.", ec_node_uint("PREFIXLEN", 1, 32, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"icmp error",
+		icmp4_error_show,
+		"Show the rate limits of ICMP errors."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "ipv4 icmp",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -7,6 +7,7 @@
 #include <gr_cli.h>
 
 #define IP_ADD_CTX(root) CLI_CONTEXT(root, CTX_ADD, CTX_ARG("ip", "Create IPv4 stack elements."))
+#define IP_SET_CTX(root) CLI_CONTEXT(root, CTX_SET, CTX_ARG("ip", "Modify IPv4 stack elements."))
 #define IP_DEL_CTX(root) CLI_CONTEXT(root, CTX_DEL, CTX_ARG("ip", "Delete IPv4 stack elements."))
 #define IP_SHOW_CTX(root) CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("ip", "Show IPv4 stack details."))
 
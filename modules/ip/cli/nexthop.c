@@ -60,8 +60,7 @@ static cmd_status_t nh4_list(const struct gr_api_client *c, const struct ec_pnod
 	struct gr_iface iface;
 	void *resp_ptr = NULL;
 	ssize_t n;
-
-	(void)p;
+	int ret;
 
 	if (table == NULL)
 		return CMD_ERROR;
@@ -69,12 +68,6 @@ static cmd_status_t nh4_list(const struct gr_api_client *c, const struct ec_pnod
 		scols_unref_table(table);
 		return CMD_ERROR;
 	}
-	if (gr_api_client_send_recv(c, GR_IP4_NH_LIST, sizeof(req), &req, &resp_ptr) < 0) {
-		scols_unref_table(table);
-		return CMD_ERROR;
-	}
-
-	resp = resp_ptr;
 
 	scols_table_new_column(table, "VRF", 0, 0);
 	scols_table_new_column(table, "IP", 0, 0);
@@ -85,46 +78,243 @@ static cmd_status_t nh4_list(const struct gr_api_client *c, const struct ec_pnod
 	scols_table_new_column(table, "STATE", 0, 0);
 	scols_table_set_column_separator(table, "  ");
 
-	for (size_t i = 0; i < resp->n_nhs; i++) {
-		struct libscols_line *line = scols_table_new_line(table, NULL);
-		const struct gr_ip4_nh *nh = &resp->nhs[i];
-
-		n = 0;
-		state[0] = '\0';
-		for (uint8_t i = 0; i < 16; i++) {
-			gr_ip4_nh_flags_t f = 1 << i;
-			if (f & nh->flags) {
-				n += snprintf(
-					state + n, sizeof(state) - n, "%s ", gr_ip4_nh_f_name(f)
+	do {
+		ret = gr_api_client_send_recv(c, GR_IP4_NH_LIST, sizeof(req), &req, &resp_ptr);
+		if (ret < 0) {
+			scols_unref_table(table);
+			return CMD_ERROR;
+		}
+
+		resp = resp_ptr;
+		for (size_t i = 0; i < resp->n_nhs; i++) {
+			struct libscols_line *line = scols_table_new_line(table, NULL);
+			const struct gr_ip4_nh *nh = &resp->nhs[i];
+
+			n = 0;
+			state[0] = '\0';
+			for (uint8_t i = 0; i < 16; i++) {
+				gr_ip4_nh_flags_t f = 1 << i;
+				if (f & nh->flags) {
+					n += snprintf(
+						state + n,
+						sizeof(state) - n,
+						"%s ",
+						gr_ip4_nh_f_name(f)
+					);
+				}
+			}
+			if (n > 0)
+				state[n - 1] = '\0';
+
+			inet_ntop(AF_INET, &nh->host, ip, sizeof(ip));
+
+			scols_line_sprintf(line, 0, "%u", nh->vrf_id);
+			scols_line_sprintf(line, 1, "%s", ip);
+			if (nh->flags & GR_IP4_NH_F_REACHABLE) {
+				scols_line_sprintf(
+					line, 2, ETH_ADDR_FMT, ETH_ADDR_SPLIT(&nh->mac)
 				);
+				if (iface_from_id(c, nh->iface_id, &iface) == 0)
+					scols_line_sprintf(line, 3, "%s", iface.name);
+				else
+					scols_line_sprintf(line, 3, "%u", nh->iface_id);
+				scols_line_sprintf(line, 4, "%u", nh->held_pkts);
+				scols_line_sprintf(line, 5, "%u", nh->age);
+			} else {
+				scols_line_set_data(line, 2, "??:??:??:??:??:??");
+				scols_line_set_data(line, 3, "?");
+				scols_line_sprintf(line, 4, "%u", nh->held_pkts);
+				scols_line_set_data(line, 5, "?");
 			}
+			scols_line_sprintf(line, 6, "%s", state);
+		}
+		scols_print_chunk(table);
+
+		req.cursor = resp->next;
+		free(resp_ptr);
+		resp_ptr = NULL;
+	} while (req.cursor != 0);
+
+	scols_unref_table(table);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_group_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_nh_group_set_req req = {0};
+	const struct ec_pnode *n = NULL;
+	const char *str;
+
+	if (arg_u32(p, "GROUP", &req.group.group_id) < 0)
+		return CMD_ERROR;
+	if (arg_u16(p, "VRF", &req.group.vrf_id) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	while ((n = ec_pnode_find_next(p, n, "NH", true)) != NULL) {
+		if (req.group.n_members == GR_IP4_NH_GROUP_MAX_MEMBERS) {
+			errno = E2BIG;
+			return CMD_ERROR;
 		}
-		if (n > 0)
-			state[n - 1] = '\0';
-
-		inet_ntop(AF_INET, &nh->host, ip, sizeof(ip));
-
-		scols_line_sprintf(line, 0, "%u", nh->vrf_id);
-		scols_line_sprintf(line, 1, "%s", ip);
-		if (nh->flags & GR_IP4_NH_F_REACHABLE) {
-			scols_line_sprintf(line, 2, ETH_ADDR_FMT, ETH_ADDR_SPLIT(&nh->mac));
-			if (iface_from_id(c, nh->iface_id, &iface) == 0)
-				scols_line_sprintf(line, 3, "%s", iface.name);
-			else
-				scols_line_sprintf(line, 3, "%u", nh->iface_id);
-			scols_line_sprintf(line, 4, "%u", nh->held_pkts);
-			scols_line_sprintf(line, 5, "%u", nh->age);
-		} else {
-			scols_line_set_data(line, 2, "??:??:??:??:??:??");
-			scols_line_set_data(line, 3, "?");
-			scols_line_sprintf(line, 4, "%u", nh->held_pkts);
-			scols_line_set_data(line, 5, "?");
+		str = ec_strvec_val(ec_pnode_get_strvec(n), 0);
+		if (inet_pton(AF_INET, str, &req.group.members[req.group.n_members++]) != 1) {
+			errno = EINVAL;
+			return CMD_ERROR;
 		}
-		scols_line_sprintf(line, 6, "%s", state);
 	}
 
-	scols_print_table(table);
+	if (gr_api_client_send_recv(c, GR_IP4_NH_GROUP_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_group_del(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_nh_group_del_req req = {.missing_ok = true};
+
+	if (arg_u32(p, "GROUP", &req.group_id) < 0)
+		return CMD_ERROR;
+	if (arg_u16(p, "VRF", &req.vrf_id) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_IP4_NH_GROUP_DEL, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_group_list(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_nh_group_list_req req = {.vrf_id = UINT16_MAX};
+	struct libscols_table *table = scols_new_table();
+	const struct gr_ip4_nh_group_list_resp *resp;
+	char members[BUFSIZ], ip[INET_ADDRSTRLEN];
+	void *resp_ptr = NULL;
+	size_t n;
+	int ret;
+
+	if (table == NULL)
+		return CMD_ERROR;
+	if (arg_u16(p, "VRF", &req.vrf_id) < 0 && errno != ENOENT) {
+		scols_unref_table(table);
+		return CMD_ERROR;
+	}
+
+	scols_table_new_column(table, "VRF", 0, 0);
+	scols_table_new_column(table, "GROUP", 0, 0);
+	scols_table_new_column(table, "MEMBERS", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+
+	do {
+		ret = gr_api_client_send_recv(
+			c, GR_IP4_NH_GROUP_LIST, sizeof(req), &req, &resp_ptr
+		);
+		if (ret < 0) {
+			scols_unref_table(table);
+			return CMD_ERROR;
+		}
+
+		resp = resp_ptr;
+		for (size_t i = 0; i < resp->n_groups; i++) {
+			struct libscols_line *line = scols_table_new_line(table, NULL);
+			const struct gr_ip4_nh_group *g = &resp->groups[i];
+
+			n = 0;
+			members[0] = '\0';
+			for (uint8_t m = 0; m < g->n_members; m++) {
+				inet_ntop(AF_INET, &g->members[m], ip, sizeof(ip));
+				n += snprintf(members + n, sizeof(members) - n, "%s ", ip);
+			}
+			if (n > 0)
+				members[n - 1] = '\0';
+
+			scols_line_sprintf(line, 0, "%u", g->vrf_id);
+			scols_line_sprintf(line, 1, "%u", g->group_id);
+			scols_line_set_data(line, 2, members);
+		}
+		scols_print_chunk(table);
+
+		req.cursor = resp->next;
+		free(resp_ptr);
+		resp_ptr = NULL;
+	} while (req.cursor != 0);
+
 	scols_unref_table(table);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_hold_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_nh_hold_set_req req = {0};
+
+	if (arg_u16(p, "MAX", &req.conf.max_pkts) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "TOTAL", &req.conf.max_pkts_total) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u16(p, "TIME", &req.conf.hold_time) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_IP4_NH_HOLD_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_hold_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ip4_nh_hold_get_resp *resp;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_IP4_NH_HOLD_GET, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("max_pkts: %u\n", resp->conf.max_pkts);
+	printf("max_pkts_total: %u\n", resp->conf.max_pkts_total);
+	printf("hold_time: %u\n", resp->conf.hold_time);
+	printf("held_pkts: %u\n", resp->stats.held_pkts);
+	printf("held: %lu\n", resp->stats.held);
+	printf("flushed: %lu\n", resp->stats.flushed);
+	printf("expired: %lu\n", resp->stats.expired);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_solicit_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_nh_solicit_set_req req = {0};
+
+	if (arg_u32(p, "RATE", &req.conf.rate) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "BURST", &req.conf.burst) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "IFACE_RATE", &req.conf.iface_rate) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+	if (arg_u32(p, "IFACE_BURST", &req.conf.iface_burst) < 0 && errno != ENOENT)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_IP4_NH_SOLICIT_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nh4_solicit_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ip4_nh_solicit_get_resp *resp;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_IP4_NH_SOLICIT_GET, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("rate: %u\n", resp->conf.rate);
+	printf("burst: %u\n", resp->conf.burst);
+	printf("iface_rate: %u\n", resp->conf.iface_rate);
+	printf("iface_burst: %u\n", resp->conf.iface_burst);
+	printf("sent: %lu\n", resp->stats.sent);
+	printf("coalesced: %lu\n", resp->stats.coalesced);
+	printf("rate_limited: %lu\n", resp->stats.rate_limited);
 	free(resp_ptr);
 
 	return CMD_SUCCESS;
@@ -161,6 +351,93 @@ static int ctx_init(struct ec_node *root) {
 		"List all next hops.",
 		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
 	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_ADD_CTX(root),
+		"nexthop group GROUP via NH+ [vrf VRF]",
+		nh4_group_set,
+		"Create a next hop group or atomically replace all its members.",
+		with_help("Next hop group ID.", ec_node_uint("GROUP", 1, UINT32_MAX, 10)),
+		with_help("IPv4 gateway address.", ec_node_re("NH", IPV4_RE)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_DEL_CTX(root),
+		"nexthop group GROUP [vrf VRF]",
+		nh4_group_del,
+		"Delete a next hop group.",
+		with_help("Next hop group ID.", ec_node_uint("GROUP", 1, UINT32_MAX, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"nexthop group [vrf VRF]",
+		nh4_group_list,
+		"List all next hop groups.",
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SET_CTX(root),
+		"nexthop hold (max MAX),(total TOTAL),(time TIME)",
+		nh4_hold_set,
+		"Change the limits of packets waiting for next hop resolution.",
+		with_help("Max held packets per next hop.", ec_node_uint("MAX", 1, UINT16_MAX, 10)),
+		with_help(
+			"Max held packets for all next hops.",
+			ec_node_uint("TOTAL", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Seconds before held packets are dropped.",
+			ec_node_uint("TIME", 1, UINT16_MAX, 10)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"nexthop hold",
+		nh4_hold_show,
+		"Show the limits and counters of packets waiting for next hop resolution."
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SET_CTX(root),
+		"nexthop solicit (rate RATE),(burst BURST),(iface_rate IFACE_RATE),"
+		"(iface_burst IFACE_BURST)",
+		nh4_solicit_set,
+		"Change the rate limits of ARP requests.",
+		with_help(
+			"Requests per second for all interfaces.",
+			ec_node_uint("RATE", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Burst size for all interfaces.", ec_node_uint("BURST", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Requests per second for each interface.",
+			ec_node_uint("IFACE_RATE", 1, UINT32_MAX, 10)
+		),
+		with_help(
+			"Burst size for each interface.",
+			ec_node_uint("IFACE_BURST", 1, UINT32_MAX, 10)
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"nexthop solicit",
+		nh4_solicit_show,
+		"Show the rate limits and counters of ARP requests."
+	);
 	if (ret < 0)
 		return ret;
 
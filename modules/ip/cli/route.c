@@ -15,18 +15,98 @@
 
 #include <errno.h>
 
+// Routes queued when reading commands from stdin.
+static struct gr_ip4_route_add_bulk_req *add_batch;
+static struct gr_ip4_route_del_bulk_req *del_batch;
+
+static cmd_status_t
+bulk_status(const struct gr_ip4_route_bulk_resp *resp, const struct ip4_net *dest, size_t stride) {
+	cmd_status_t ret = CMD_SUCCESS;
+	char buf[BUFSIZ];
+
+	for (uint16_t i = 0; i < resp->n_status; i++) {
+		if (resp->status[i] == 0)
+			continue;
+		ip4_net_format((const void *)((const char *)dest + i * stride), buf, sizeof(buf));
+		errorf("route %s: %s", buf, strerror(resp->status[i]));
+		ret = CMD_ERROR;
+	}
+
+	return ret;
+}
+
+static cmd_status_t route4_add_flush(const struct gr_api_client *c) {
+	void *resp = NULL;
+	cmd_status_t ret;
+	size_t len;
+
+	if (add_batch == NULL || add_batch->n_routes == 0)
+		return CMD_SUCCESS;
+
+	len = sizeof(*add_batch) + add_batch->n_routes * sizeof(add_batch->routes[0]);
+	if (gr_api_client_send_recv(c, GR_IP4_ROUTE_ADD_BULK, len, add_batch, &resp) < 0)
+		ret = CMD_ERROR;
+	else
+		ret = bulk_status(resp, &add_batch->routes[0].dest, sizeof(add_batch->routes[0]));
+
+	add_batch->n_routes = 0;
+	free(resp);
+
+	return ret;
+}
+
+static cmd_status_t route4_del_flush(const struct gr_api_client *c) {
+	void *resp = NULL;
+	cmd_status_t ret;
+	size_t len;
+
+	if (del_batch == NULL || del_batch->n_routes == 0)
+		return CMD_SUCCESS;
+
+	len = sizeof(*del_batch) + del_batch->n_routes * sizeof(del_batch->routes[0]);
+	if (gr_api_client_send_recv(c, GR_IP4_ROUTE_DEL_BULK, len, del_batch, &resp) < 0)
+		ret = CMD_ERROR;
+	else
+		ret = bulk_status(resp, &del_batch->routes[0].dest, sizeof(del_batch->routes[0]));
+
+	del_batch->n_routes = 0;
+	free(resp);
+
+	return ret;
+}
+
 static cmd_status_t route4_add(const struct gr_api_client *c, const struct ec_pnode *p) {
 	struct gr_ip4_route_add_req req = {.exist_ok = true};
 
 	if (ip4_net_parse(arg_str(p, "DEST"), &req.dest, true) < 0)
 		return CMD_ERROR;
-	if (inet_pton(AF_INET, arg_str(p, "NH"), &req.nh) != 1) {
-		errno = EINVAL;
-		return CMD_ERROR;
+	if (arg_u32(p, "GROUP", &req.group_id) < 0) {
+		if (errno != ENOENT)
+			return CMD_ERROR;
+		if (inet_pton(AF_INET, arg_str(p, "NH"), &req.nh) != 1) {
+			errno = EINVAL;
+			return CMD_ERROR;
+		}
 	}
 	if (arg_u16(p, "VRF", &req.vrf_id) < 0 && errno != ENOENT)
 		return CMD_ERROR;
 
+	if (cli_batch_enabled()) {
+		if (add_batch == NULL) {
+			add_batch = malloc(
+				sizeof(*add_batch) + GR_IP4_ROUTE_BULK_MAX * sizeof(req)
+			);
+			if (add_batch == NULL)
+				return CMD_ERROR;
+			add_batch->n_routes = 0;
+		}
+		add_batch->routes[add_batch->n_routes++] = req;
+		if (add_batch->n_routes == GR_IP4_ROUTE_BULK_MAX)
+			return route4_add_flush(c);
+		cli_batch_defer(route4_add, route4_add_flush);
+		return CMD_SUCCESS;
+	}
+
 	if (gr_api_client_send_recv(c, GR_IP4_ROUTE_ADD, sizeof(req), &req, NULL) < 0)
 		return CMD_ERROR;
 
@@ -41,6 +121,22 @@ static cmd_status_t route4_del(const struct gr_api_client *c, const struct ec_pn
 	if (arg_u16(p, "VRF", &req.vrf_id) < 0 && errno != ENOENT)
 		return CMD_ERROR;
 
+	if (cli_batch_enabled()) {
+		if (del_batch == NULL) {
+			del_batch = malloc(
+				sizeof(*del_batch) + GR_IP4_ROUTE_BULK_MAX * sizeof(req)
+			);
+			if (del_batch == NULL)
+				return CMD_ERROR;
+			del_batch->n_routes = 0;
+		}
+		del_batch->routes[del_batch->n_routes++] = req;
+		if (del_batch->n_routes == GR_IP4_ROUTE_BULK_MAX)
+			return route4_del_flush(c);
+		cli_batch_defer(route4_del, route4_del_flush);
+		return CMD_SUCCESS;
+	}
+
 	if (gr_api_client_send_recv(c, GR_IP4_ROUTE_DEL, sizeof(req), &req, NULL) < 0)
 		return CMD_ERROR;
 
@@ -53,37 +149,47 @@ static cmd_status_t route4_list(const struct gr_api_client *c, const struct ec_p
 	struct gr_ip4_route_list_req req = {0};
 	char dest[BUFSIZ], nh[BUFSIZ];
 	void *resp_ptr = NULL;
-
-	(void)p;
+	int ret;
 
 	if (table == NULL)
 		return CMD_ERROR;
 
-	if (arg_u16(p, "VRF", &req.vrf_id) < 0 && errno != ENOENT)
-		return CMD_ERROR;
-
-	if (gr_api_client_send_recv(c, GR_IP4_ROUTE_LIST, sizeof(req), &req, &resp_ptr) < 0) {
+	if (arg_u16(p, "VRF", &req.vrf_id) < 0 && errno != ENOENT) {
 		scols_unref_table(table);
 		return CMD_ERROR;
 	}
 
-	resp = resp_ptr;
 	scols_table_new_column(table, "DESTINATION", 0, 0);
 	scols_table_new_column(table, "NEXT_HOP", 0, 0);
 	scols_table_set_column_separator(table, "  ");
 
-	for (size_t i = 0; i < resp->n_routes; i++) {
-		struct libscols_line *line = scols_table_new_line(table, NULL);
-		const struct gr_ip4_route *route = &resp->routes[i];
-		ip4_net_format(&route->dest, dest, sizeof(dest));
-		inet_ntop(AF_INET, &route->nh, nh, sizeof(nh));
-		scols_line_set_data(line, 0, dest);
-		scols_line_set_data(line, 1, nh);
-	}
+	do {
+		ret = gr_api_client_send_recv(c, GR_IP4_ROUTE_LIST, sizeof(req), &req, &resp_ptr);
+		if (ret < 0) {
+			scols_unref_table(table);
+			return CMD_ERROR;
+		}
+
+		resp = resp_ptr;
+		for (size_t i = 0; i < resp->n_routes; i++) {
+			struct libscols_line *line = scols_table_new_line(table, NULL);
+			const struct gr_ip4_route *route = &resp->routes[i];
+			ip4_net_format(&route->dest, dest, sizeof(dest));
+			if (route->group_id != 0)
+				snprintf(nh, sizeof(nh), "group %u", route->group_id);
+			else
+				inet_ntop(AF_INET, &route->nh, nh, sizeof(nh));
+			scols_line_set_data(line, 0, dest);
+			scols_line_set_data(line, 1, nh);
+		}
+		scols_print_chunk(table);
+
+		req.cursor = resp->next;
+		free(resp_ptr);
+		resp_ptr = NULL;
+	} while (req.cursor.ip != 0 || req.cursor.prefixlen != 0);
 
-	scols_print_table(table);
 	scols_unref_table(table);
-	free(resp_ptr);
 
 	return CMD_SUCCESS;
 }
@@ -112,6 +218,12 @@ static cmd_status_t route4_get(const struct gr_api_client *c, const struct ec_pn
 		return CMD_ERROR;
 
 	resp = resp_ptr;
+	if (resp->nh.flags & GR_IP4_NH_F_GROUP) {
+		// the member is selected per flow by the datapath
+		printf("%s via group %u\n", dest, resp->nh.host);
+		free(resp_ptr);
+		return CMD_SUCCESS;
+	}
 	inet_ntop(AF_INET, &resp->nh.host, buf, sizeof(buf));
 	printf("%s via %s lladdr " ETH_ADDR_FMT, dest, buf, ETH_ADDR_SPLIT(&resp->nh.mac));
 	if (iface_from_id(c, resp->nh.iface_id, &iface) == 0)
@@ -129,11 +241,12 @@ static int ctx_init(struct ec_node *root) {
 
 	ret = CLI_COMMAND(
 		IP_ADD_CTX(root),
-		"route DEST via NH [vrf VRF]",
+		"route DEST via (NH|(group GROUP)) [vrf VRF]",
 		route4_add,
 		"Add a new route.",
 		with_help("IPv4 destination prefix.", ec_node_re("DEST", IPV4_NET_RE)),
 		with_help("IPv4 next hop address.", ec_node_re("NH", IPV4_RE)),
+		with_help("Next hop group ID.", ec_node_uint("GROUP", 1, UINT32_MAX, 10)),
 		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
 	);
 	if (ret < 0)
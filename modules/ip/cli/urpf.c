@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ip.h"
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_cli_iface.h>
+#include <gr_ip4.h>
+#include <gr_macro.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const mode_names[] = {
+	[GR_IP4_URPF_OFF] = "off",
+	[GR_IP4_URPF_STRICT] = "strict",
+	[GR_IP4_URPF_LOOSE] = "loose",
+};
+
+static cmd_status_t urpf_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_urpf_set_req req = {0};
+	const char *mode = arg_str(p, "MODE");
+	struct gr_iface iface;
+
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.urpf.iface_id = iface.id;
+
+	for (uint8_t i = 0; i < ARRAY_DIM(mode_names); i++) {
+		if (strcmp(mode, mode_names[i]) == 0)
+			req.urpf.mode = i;
+	}
+
+	if (gr_api_client_send_recv(c, GR_IP4_URPF_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t urpf_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_ip4_urpf_list_resp *resp;
+	struct libscols_table *table;
+	struct gr_iface iface;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_IP4_URPF_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "IFACE", 0, 0);
+	scols_table_new_column(table, "MODE", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < resp->n_urpfs; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_ip4_urpf *u = &resp->urpfs[i];
+		if (iface_from_id(c, u->iface_id, &iface) == 0)
+			scols_line_sprintf(line, 0, "%s", iface.name);
+		else
+			scols_line_sprintf(line, 0, "%u", u->iface_id);
+		if (u->mode < ARRAY_DIM(mode_names))
+			scols_line_sprintf(line, 1, "%s", mode_names[u->mode]);
+		else
+			scols_line_sprintf(line, 1, "%u", u->mode);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		IP_SET_CTX(root),
+		"urpf iface IFACE MODE",
+		urpf_set,
+		"Check the source address of the packets received on an interface.",
+		with_help("Interface name.", ec_node_dyn("IFACE", complete_iface_names, NULL)),
+		with_help(
+			"The route to the source must use the interface (strict), a route to the "
+			"source must exist (loose) or no check (off).",
+			ec_node_re("MODE", "^(strict|loose|off)$")
+		)
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"urpf",
+		urpf_show,
+		"Show the interfaces with reverse path checks."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "ipv4 urpf",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ip.h"
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_ip4.h>
+#include <gr_table.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <errno.h>
+#include <stdint.h>
+
+static cmd_status_t vrf_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_ip4_vrf_set_req req = {0};
+	const char *type;
+	uint64_t val;
+
+	if (arg_u16(p, "VRF", &req.vrf_id) < 0)
+		return CMD_ERROR;
+
+	if ((type = arg_str(p, "FIB")) != NULL) {
+		if (strcmp(type, "trie") == 0)
+			req.fib.type = GR_IP4_FIB_TYPE_TRIE;
+		else if (strcmp(type, "compact") == 0)
+			req.fib.type = GR_IP4_FIB_TYPE_COMPACT;
+		else
+			req.fib.type = GR_IP4_FIB_TYPE_DIR24_8;
+		req.set_attrs |= GR_IP4_VRF_SET_TYPE;
+	}
+	if (arg_u64(p, "NH_SIZE", &val) == 0) {
+		req.fib.nh_size = val;
+		req.set_attrs |= GR_IP4_VRF_SET_NH_SIZE;
+	}
+	if (arg_u64(p, "N_TBL8", &val) == 0) {
+		req.fib.num_tbl8 = val;
+		req.set_attrs |= GR_IP4_VRF_SET_NUM_TBL8;
+	}
+	if (arg_u64(p, "MAX_ROUTES", &val) == 0) {
+		req.fib.max_routes = val;
+		req.set_attrs |= GR_IP4_VRF_SET_MAX_ROUTES;
+	}
+
+	if (gr_api_client_send_recv(c, GR_IP4_VRF_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t vrf_list(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct libscols_table *table = scols_new_table();
+	const struct gr_ip4_vrf_list_resp *resp;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (table == NULL)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_IP4_VRF_LIST, 0, NULL, &resp_ptr) < 0) {
+		scols_unref_table(table);
+		return CMD_ERROR;
+	}
+
+	resp = resp_ptr;
+	scols_table_new_column(table, "VRF", 0, 0);
+	scols_table_new_column(table, "FIB", 0, 0);
+	scols_table_new_column(table, "NH_SIZE", 0, 0);
+	scols_table_new_column(table, "TBL8", 0, 0);
+	scols_table_new_column(table, "ROUTES", 0, 0);
+	scols_table_new_column(table, "MAX_ROUTES", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+
+	for (size_t i = 0; i < resp->n_vrfs; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_ip4_vrf *vrf = &resp->vrfs[i];
+		scols_line_sprintf(line, 0, "%u", vrf->vrf_id);
+		scols_line_set_data(line, 1, gr_ip4_fib_type_name(vrf->fib.type));
+		scols_line_sprintf(line, 2, "%u", vrf->fib.nh_size);
+		scols_line_sprintf(line, 3, "%u", vrf->fib.num_tbl8);
+		scols_line_sprintf(line, 4, "%u", vrf->n_routes);
+		scols_line_sprintf(line, 5, "%u", vrf->fib.max_routes);
+	}
+
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+#define VRF_ATTRS_CMD "(fib FIB),(nh_size NH_SIZE),(tbl8 N_TBL8),(max_routes MAX_ROUTES)"
+
+#define VRF_ATTRS_ARGS                                                                             \
+	with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10)),            \
+		with_help("FIB lookup algorithm.", ec_node_re("FIB", "dir24_8|trie|compact")),     \
+		with_help(                                                                         \
+			"Next hop index size in bytes (2, 4 or 8). 2 needs -n 32767 or less.",     \
+			ec_node_uint("NH_SIZE", 2, 8, 10)                                          \
+		),                                                                                 \
+		with_help(                                                                         \
+			"Number of tbl8 groups.",                                                  \
+			ec_node_uint("N_TBL8", 1, UINT32_MAX, 10)                                  \
+		),                                                                                 \
+		with_help(                                                                         \
+			"Maximum number of routes.", ec_node_uint("MAX_ROUTES", 1, UINT32_MAX, 10) \
+		)
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_ADD, CTX_ARG("vrf", "Create L3 routing domains.")),
+		"VRF [" VRF_ATTRS_CMD "]",
+		vrf_set,
+		"Create a VRF with a specific FIB configuration.",
+		VRF_ATTRS_ARGS
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("vrf", "Modify L3 routing domains.")),
+		"VRF " VRF_ATTRS_CMD,
+		vrf_set,
+		"Change the FIB configuration of a VRF (existing routes are preserved).",
+		VRF_ATTRS_ARGS
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		IP_SHOW_CTX(root),
+		"vrf",
+		vrf_list,
+		"Show VRFs and their FIB configuration."
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "ipv4 vrf",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -8,6 +8,7 @@
 #include <gr_ip4_control.h>
 #include <gr_log.h>
 #include <gr_net_types.h>
+#include <gr_port.h>
 #include <gr_queue.h>
 
 #include <event2/event.h>
@@ -28,6 +29,18 @@
 
 static struct hoplist *iface_addrs;
 
+// Locally destined protocols steered to the port control queue (if enabled).
+static const uint8_t ctrlq_protos[] = {IPPROTO_ICMP, IPPROTO_IPIP};
+
+static void addr_ctrlq_steer(const struct iface *iface, ip4_addr_t ip, bool add) {
+	for (unsigned i = 0; i < ARRAY_DIM(ctrlq_protos); i++) {
+		if (add)
+			iface_ctrlq_add_ip4(iface, ip, ctrlq_protos[i]);
+		else
+			iface_ctrlq_del_ip4(iface, ip, ctrlq_protos[i]);
+	}
+}
+
 struct nexthop *ip4_addr_get_preferred(uint16_t iface_id, ip4_addr_t dst) {
 	struct hoplist *addrs;
 
@@ -106,6 +119,7 @@ static struct api_out addr_add(const void *request, void **response) {
 	if (ret == 0) {
 		ifaddrs->nh[addr_index] = nh;
 		ifaddrs->count++;
+		addr_ctrlq_steer(iface, nh->ip, true);
 	} else {
 		ip4_nexthop_decref(nh);
 	}
@@ -115,6 +129,7 @@ static struct api_out addr_add(const void *request, void **response) {
 
 static struct api_out addr_del(const void *request, void **response) {
 	const struct gr_ip4_addr_del_req *req = request;
+	const struct iface *iface;
 	struct hoplist *addrs;
 	struct nexthop *nh = NULL;
 	unsigned i;
@@ -140,6 +155,9 @@ static struct api_out addr_del(const void *request, void **response) {
 	if ((nh->flags & (GR_IP4_NH_F_LOCAL | GR_IP4_NH_F_LINK)) || nh->ref_count > 1)
 		return api_out(EBUSY, 0);
 
+	if ((iface = iface_from_id(req->addr.iface_id)) != NULL)
+		addr_ctrlq_steer(iface, nh->ip, false);
+
 	ip4_route_cleanup(nh->vrf_id, nh);
 
 	// shift the remaining addresses
@@ -196,8 +214,10 @@ static void iface_event_handler(iface_event_t event, struct iface *iface) {
 		return;
 
 	ifaddrs = ip4_addr_get_all(iface->id);
-	for (unsigned i = 0; i < ifaddrs->count; i++)
+	for (unsigned i = 0; i < ifaddrs->count; i++) {
+		addr_ctrlq_steer(iface, ifaddrs->nh[i]->ip, false);
 		ip4_route_cleanup(iface->vrf_id, ifaddrs->nh[i]);
+	}
 
 	memset(ifaddrs, 0, sizeof(*ifaddrs));
 }
@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_ip4.h>
+#include <gr_ip4_control.h>
+
+#include <rte_common.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+#define COPP_DEFAULT                                                                               \
+	{                                                                                          \
+		.rate = IP4_COPP_RATE,                                                             \
+		.burst = IP4_COPP_BURST,                                                           \
+		.src_rate = IP4_COPP_SRC_RATE,                                                     \
+		.src_burst = IP4_COPP_SRC_BURST,                                                   \
+	}
+
+static struct gr_ip4_copp_conf copp_conf = {
+	.limits = {
+		[GR_IP4_COPP_ARP] = COPP_DEFAULT,
+		[GR_IP4_COPP_ICMP] = COPP_DEFAULT,
+		[GR_IP4_COPP_TUNNEL] = {
+			.rate = IP4_COPP_TUNNEL_RATE,
+			.burst = IP4_COPP_TUNNEL_BURST,
+			.src_rate = IP4_COPP_TUNNEL_RATE,
+			.src_burst = IP4_COPP_TUNNEL_BURST,
+		},
+		[GR_IP4_COPP_OTHER] = COPP_DEFAULT,
+	},
+	.src_prefixlen = IP4_COPP_SRC_PREFIXLEN,
+};
+
+const struct gr_ip4_copp_conf *ip4_copp_conf(void) {
+	return &copp_conf;
+}
+
+static struct api_out copp_set(const void *request, void **response) {
+	const struct gr_ip4_copp_set_req *req = request;
+	struct gr_ip4_copp_limit *limit;
+
+	(void)response;
+
+	if (req->class >= GR_IP4_COPP_CLASS_COUNT)
+		return api_out(EINVAL, 0);
+	if (req->src_prefixlen > 32)
+		return api_out(EINVAL, 0);
+
+	limit = &copp_conf.limits[req->class];
+	if (req->limit.rate != 0)
+		limit->rate = req->limit.rate;
+	if (req->limit.burst != 0)
+		limit->burst = req->limit.burst;
+	if (req->limit.src_rate != 0)
+		limit->src_rate = req->limit.src_rate;
+	if (req->limit.src_burst != 0)
+		limit->src_burst = req->limit.src_burst;
+	if (req->src_prefixlen != 0)
+		copp_conf.src_prefixlen = req->src_prefixlen;
+
+	return api_out(0, 0);
+}
+
+static struct api_out copp_get(const void *request, void **response) {
+	struct gr_ip4_copp_get_resp *resp;
+
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->conf = copp_conf;
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+static struct gr_api_handler copp_set_handler = {
+	.name = "ipv4 copp set",
+	.request_type = GR_IP4_COPP_SET,
+	.callback = copp_set,
+};
+static struct gr_api_handler copp_get_handler = {
+	.name = "ipv4 copp get",
+	.request_type = GR_IP4_COPP_GET,
+	.callback = copp_get,
+};
+
+RTE_INIT(copp_constructor) {
+	gr_register_api_handler(&copp_set_handler);
+	gr_register_api_handler(&copp_get_handler);
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip4.h>
+#include <gr_ip4_control.h>
+
+#include <rte_common.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static struct gr_ip4_flow_cache_conf flow_conf = {
+	.enabled = false,
+};
+
+// Workers compare it with the generation of their cached flows. There is nothing to flush.
+static _Atomic(uint32_t) flow_generation = 1;
+
+const struct gr_ip4_flow_cache_conf *ip4_flow_cache_conf(void) {
+	return &flow_conf;
+}
+
+uint32_t ip4_flow_cache_generation(void) {
+	return atomic_load_explicit(&flow_generation, memory_order_acquire);
+}
+
+void ip4_flow_cache_invalidate(void) {
+	uint32_t gen = atomic_fetch_add_explicit(&flow_generation, 1, memory_order_acq_rel);
+	if (gen + 1 == 0)
+		atomic_fetch_add_explicit(&flow_generation, 1, memory_order_acq_rel);
+}
+
+static struct api_out flow_cache_set(const void *request, void **response) {
+	const struct gr_ip4_flow_cache_set_req *req = request;
+
+	(void)response;
+
+	flow_conf.enabled = req->conf.enabled != 0;
+	// Do not reuse flows cached before the cache was disabled.
+	ip4_flow_cache_invalidate();
+
+	return api_out(0, 0);
+}
+
+static struct api_out flow_cache_get(const void *request, void **response) {
+	struct gr_ip4_flow_cache_get_resp *resp;
+
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->conf = flow_conf;
+	resp->generation = ip4_flow_cache_generation();
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+static void iface_event_handler(iface_event_t, struct iface *) {
+	// Cached flows reference interfaces.
+	ip4_flow_cache_invalidate();
+}
+
+static struct gr_api_handler flow_cache_set_handler = {
+	.name = "ipv4 flow cache set",
+	.request_type = GR_IP4_FLOW_CACHE_SET,
+	.callback = flow_cache_set,
+};
+static struct gr_api_handler flow_cache_get_handler = {
+	.name = "ipv4 flow cache get",
+	.request_type = GR_IP4_FLOW_CACHE_GET,
+	.callback = flow_cache_get,
+};
+
+static struct iface_event_handler iface_event_flow_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(flow_constructor) {
+	gr_register_api_handler(&flow_cache_set_handler);
+	gr_register_api_handler(&flow_cache_get_handler);
+	iface_event_register_handler(&iface_event_flow_handler);
+}
@@ -7,16 +7,21 @@
 #include <gr_ip4.h>
 #include <gr_net_types.h>
 
+#include <rte_common.h>
 #include <rte_ether.h>
 #include <rte_fib.h>
 #include <rte_hash.h>
 #include <rte_rcu_qsbr.h>
-#include <rte_spinlock.h>
 
+#include <stdatomic.h>
 #include <stdint.h>
 
+struct nh_group;
+
 struct __rte_cache_aligned nexthop {
-	gr_ip4_nh_flags_t flags;
+	// Workers set GR_IP4_NH_F_PENDING concurrently with the control plane state
+	// transitions. Always modify with atomic_fetch_or() and atomic_fetch_and().
+	_Atomic(gr_ip4_nh_flags_t) flags;
 	struct rte_ether_addr lladdr;
 	uint16_t vrf_id;
 	uint16_t iface_id;
@@ -25,11 +30,22 @@ struct __rte_cache_aligned nexthop {
 	uint32_t ref_count;
 	uint8_t prefixlen;
 	uint8_t ucast_probes : 4, bcast_probes : 4;
-	rte_spinlock_t lock;
 	// packets waiting for ARP resolution
-	uint16_t held_pkts_num;
-	struct rte_mbuf *held_pkts_head;
-	struct rte_mbuf *held_pkts_tail;
+	_Atomic(uint16_t) held_pkts_num;
+	// when the oldest held packet was queued
+	_Atomic(uint64_t) held_since;
+	union {
+		// lock-free stack of held packets, see ip4_nexthop_hold()
+		_Atomic(struct rte_mbuf *) held_pkts;
+		// GR_IP4_NH_F_GROUP next hops never hold packets
+		_Atomic(struct nh_group *) group;
+	};
+};
+
+// Members of a next hop group. This is never modified once published, updates replace it.
+struct nh_group {
+	uint16_t n_members;
+	struct nexthop *members[/* n_members */];
 };
 
 #define IP4_HOPLIST_MAX_SIZE 8
@@ -41,6 +57,10 @@ struct hoplist {
 
 // Max number of packets to hold per next hop waiting for resolution (default: 256).
 #define IP4_NH_MAX_HELD_PKTS 256
+// Max number of packets to hold for all next hops (default: 4096).
+#define IP4_NH_MAX_HELD_PKTS_TOTAL 4096
+// Held packets lifetime (default: 3 sec).
+#define IP4_NH_HOLD_TIME 3
 // Reachable next hop lifetime after last ARP reply received (default: 20 min).
 #define IP4_NH_LIFETIME_REACHABLE (20 * 60)
 // Unreachable next hop lifetime after last unreplied ARP request was sent (default: 1 min).
@@ -49,21 +69,89 @@ struct hoplist {
 #define IP4_NH_UCAST_PROBES 3
 // Max number of broadcast ARP probes to send after unicast probes failed.
 #define IP4_NH_BCAST_PROBES 3
+// Max ARP requests per second for all interfaces (default: 1000, burst: 100).
+#define IP4_NH_SOLICIT_RATE 1000
+#define IP4_NH_SOLICIT_BURST 100
+// Max ARP requests per second for each interface (default: 100, burst: 20).
+#define IP4_NH_SOLICIT_IFACE_RATE 100
+#define IP4_NH_SOLICIT_IFACE_BURST 20
+// Max ICMP errors per second for each worker (default: 1000, burst: 50).
+#define IP4_ICMP_ERROR_RATE 1000
+#define IP4_ICMP_ERROR_BURST 50
+// Max ICMP errors per second for each source /24 prefix (default: 10, burst: 10).
+#define IP4_ICMP_ERROR_SRC_RATE 10
+#define IP4_ICMP_ERROR_SRC_BURST 10
+#define IP4_ICMP_ERROR_SRC_PREFIXLEN 24
+// Max ARP and ICMP packets per second handled by each worker (default: 1000, burst: 100).
+#define IP4_COPP_RATE 1000
+#define IP4_COPP_BURST 100
+// Max ARP and ICMP packets per second from each source /32 (default: 100, burst: 20).
+#define IP4_COPP_SRC_RATE 100
+#define IP4_COPP_SRC_BURST 20
+#define IP4_COPP_SRC_PREFIXLEN 32
+// Max tunnel packets per second decapsulated by each worker and from each source.
+#define IP4_COPP_TUNNEL_RATE 10000000
+#define IP4_COPP_TUNNEL_BURST 100000
+// Number of flows cached by each worker, must be a power of two.
+#define IP4_FLOW_CACHE_SIZE 4096
+
+// DIR24_8 FIBs need one tbl8 group for every /24 network which holds longer prefixes. Full
+// Internet tables have a few percent of such routes, reserve one group for every 8 routes.
+static inline uint32_t ip4_fib_num_tbl8(uint32_t max_routes) {
+	return RTE_MAX(UINT32_C(1) << 15, max_routes / 8);
+}
+
+// The lowest bit of FIB table entries is reserved and the largest value is the blackhole. With
+// 2 bytes next hops, only indexes below 32767 can be stored.
+static inline uint64_t ip4_fib_blackhole(uint8_t nh_size) {
+	return (UINT64_C(1) << (nh_size * 8 - 1)) - 1;
+}
 
-// XXX: why not 1337, eh?
-#define IP4_MAX_NEXT_HOPS (1 << 16)
-#define IP4_MAX_ROUTES (1 << 16)
-#define IP4_MAX_VRFS 256
+#define IP4_MAX_VRFS 4096
+// VRFs with fewer routes share a single compact FIB.
+#define IP4_VRF_COMPACT_MAX_ROUTES 128
+// The compact FIB is an IPv6 trie keyed by the VRF ID (16 bits) followed by the IPv4 address.
+// Its first level is a fixed table of 2^24 entries of 4 bytes (64 MiB). Every other byte of
+// key depth needs a tbl8 group of 1 KiB: /24 routes sit at depth 40 and need 2 groups, /32
+// routes sit at depth 48 and need 3. Routes which share their first address bytes also share
+// groups, the worst case is reserved for every route.
+#define IP4_VRF_COMPACT_KEY_DEPTH (16 + 32)
+#define IP4_VRF_COMPACT_TBL8_PER_ROUTE ((IP4_VRF_COMPACT_KEY_DEPTH - 24) / 8)
+#define IP4_VRF_COMPACT_TBL24_SIZE ((1 << 24) * sizeof(uint32_t))
+#define IP4_VRF_COMPACT_TBL8_SIZE (256 * sizeof(uint32_t))
+
+static inline uint32_t ip4_vrf_compact_num_tbl8(uint32_t max_routes) {
+	return RTE_MIN((uint64_t)max_routes * IP4_VRF_COMPACT_TBL8_PER_ROUTE, UINT32_MAX);
+}
+
+// VRFs which outgrow the compact FIB are promoted to a dedicated DIR24_8 FIB with 2 bytes next
+// hops when the number of next hops allows it and only a few tbl8 groups. Its tbl24 still has
+// 2^24 entries (32 or 64 MiB). It is grown to the default configuration when it runs out of
+// tbl8 groups.
+#define IP4_VRF_PROMOTED_NUM_TBL8 1024
 
 struct nexthop *ip4_nexthop_get(uint32_t idx);
 int ip4_nexthop_lookup(uint16_t vrf_id, ip4_addr_t ip, uint32_t *idx, struct nexthop **nh);
 int ip4_nexthop_add(uint16_t vrf_id, ip4_addr_t ip, uint32_t *idx, struct nexthop **nh);
+// Get a neighbor entry, create it with a neighbor table reference if it does not exist.
+int ip4_nexthop_lookup_add(
+	uint16_t vrf_id,
+	ip4_addr_t ip,
+	uint16_t iface_id,
+	uint32_t *idx,
+	struct nexthop **nh
+);
+// Flush unused neighbor entries of a connected subnet.
+void ip4_nexthop_cleanup(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen);
 void ip4_nexthop_incref(struct nexthop *);
 void ip4_nexthop_decref(struct nexthop *);
+int ip4_nexthop_group_lookup(uint16_t vrf_id, uint32_t group_id, uint32_t *idx, struct nexthop **);
 
 int ip4_route_insert(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen, uint32_t nh_idx, struct nexthop *);
 int ip4_route_delete(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen);
 struct nexthop *ip4_route_lookup(uint16_t vrf_id, ip4_addr_t ip);
+// Look up n addresses at once. Next hops of addresses without a route are set to NULL.
+void ip4_route_lookup_bulk(uint16_t vrf_id, const ip4_addr_t *ips, struct nexthop **, unsigned n);
 struct nexthop *ip4_route_lookup_exact(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen);
 void ip4_route_cleanup(uint16_t vrf_id, struct nexthop *nh);
 
@@ -72,4 +160,18 @@ struct nexthop *ip4_addr_get_preferred(uint16_t iface_id, ip4_addr_t dst);
 // get all addresses for a given interface
 struct hoplist *ip4_addr_get_all(uint16_t iface_id);
 
+// ICMP error rate limits, read without locking by the datapath workers.
+const struct gr_ip4_icmp_error_conf *ip4_icmp_error_conf(void);
+
+// Control plane policing limits, read without locking by the datapath workers.
+const struct gr_ip4_copp_conf *ip4_copp_conf(void);
+
+// Flow cache configuration, read without locking by the datapath workers.
+const struct gr_ip4_flow_cache_conf *ip4_flow_cache_conf(void);
+// Current generation of the flow caches. Zero is never a valid generation.
+uint32_t ip4_flow_cache_generation(void);
+// Invalidate the flows cached by all workers. Must be called on any change which may modify
+// forwarding decisions and before freeing objects referenced by cached flows.
+void ip4_flow_cache_invalidate(void);
+
 #endif
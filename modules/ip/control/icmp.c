@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_ip4.h>
+#include <gr_ip4_control.h>
+
+#include <rte_common.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+static struct gr_ip4_icmp_error_conf error_conf = {
+	.rate = IP4_ICMP_ERROR_RATE,
+	.burst = IP4_ICMP_ERROR_BURST,
+	.src_rate = IP4_ICMP_ERROR_SRC_RATE,
+	.src_burst = IP4_ICMP_ERROR_SRC_BURST,
+	.src_prefixlen = IP4_ICMP_ERROR_SRC_PREFIXLEN,
+};
+
+const struct gr_ip4_icmp_error_conf *ip4_icmp_error_conf(void) {
+	return &error_conf;
+}
+
+static struct api_out icmp4_error_set(const void *request, void **response) {
+	const struct gr_ip4_icmp_error_set_req *req = request;
+
+	(void)response;
+
+	if (req->conf.src_prefixlen > 32)
+		return api_out(EINVAL, 0);
+
+	if (req->conf.rate != 0)
+		error_conf.rate = req->conf.rate;
+	if (req->conf.burst != 0)
+		error_conf.burst = req->conf.burst;
+	if (req->conf.src_rate != 0)
+		error_conf.src_rate = req->conf.src_rate;
+	if (req->conf.src_burst != 0)
+		error_conf.src_burst = req->conf.src_burst;
+	if (req->conf.src_prefixlen != 0)
+		error_conf.src_prefixlen = req->conf.src_prefixlen;
+
+	return api_out(0, 0);
+}
+
+static struct api_out icmp4_error_get(const void *request, void **response) {
+	struct gr_ip4_icmp_error_get_resp *resp;
+
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->conf = error_conf;
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+static struct gr_api_handler icmp4_error_set_handler = {
+	.name = "ipv4 icmp error set",
+	.request_type = GR_IP4_ICMP_ERROR_SET,
+	.callback = icmp4_error_set,
+};
+static struct gr_api_handler icmp4_error_get_handler = {
+	.name = "ipv4 icmp error get",
+	.request_type = GR_IP4_ICMP_ERROR_GET,
+	.callback = icmp4_error_get,
+};
+
+RTE_INIT(icmp4_constructor) {
+	gr_register_api_handler(&icmp4_error_set_handler);
+	gr_register_api_handler(&icmp4_error_get_handler);
+}
@@ -1,8 +1,12 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2024 Robin Jarry
 
+#include "nexthop_priv.h"
+
+#include <gr.h>
 #include <gr_api.h>
 #include <gr_control.h>
+#include <gr_control_output.h>
 #include <gr_iface.h>
 #include <gr_ip4.h>
 #include <gr_ip4_control.h>
@@ -10,12 +14,19 @@
 #include <gr_log.h>
 #include <gr_net_types.h>
 #include <gr_queue.h>
+#include <gr_stb_ds.h>
+#include <gr_timer_wheel.h>
+#include <gr_token_bucket.h>
+#include <gr_worker.h>
 
 #include <event2/event.h>
+#include <rte_arp.h>
 #include <rte_errno.h>
 #include <rte_ethdev.h>
 #include <rte_hash.h>
+#include <rte_ip.h>
 #include <rte_malloc.h>
+#include <rte_mbuf.h>
 
 #include <errno.h>
 #include <stdio.h>
@@ -25,19 +36,166 @@
 static struct nexthop *nh_array;
 static struct rte_hash *nh_hash;
 
-struct nexthop_key {
-	ip4_addr_t ip;
-	// XXX: Using uint16_t to hold vrf_id causes the compiler to add 2 bytes
-	// padding at the end of the structure. When the structure is
-	// initialized on the stack, the padding bytes have undetermined
-	// contents.
-	//
-	// This structure is used to compute a hash key. In order to get
-	// deterministic results, use uint32_t to store the vrf_id so that the
-	// compiler does not insert any padding.
-	uint32_t vrf_id;
+// Neighbor state transitions and ARP probes are driven by per next hop timers. The timer
+// wheel is advanced with this frequency.
+#define NH_TIMER_HZ 10
+
+static struct gr_timer_wheel nh_wheel;
+
+// Control plane only state, indexed like nh_array.
+struct nh_ctl {
+	struct gr_timer timer;
+	uint64_t last_solicit;
 };
 
+static struct nh_ctl *nh_ctls;
+
+static inline uint64_t cycles_to_ticks(uint64_t cycles) {
+	return cycles / (rte_get_tsc_hz() / NH_TIMER_HZ);
+}
+
+static void nh_timer_cb(struct gr_timer *);
+
+static void nh_timer_arm(struct nexthop *nh, uint64_t cycles) {
+	struct gr_timer *t = &nh_ctls[nh - nh_array].timer;
+	gr_timer_add(&nh_wheel, t, cycles_to_ticks(cycles), nh_timer_cb);
+}
+
+// Stored in the held packets stack of reachable next hops. Packets are not held anymore until
+// the next hop needs to be resolved again.
+#define HELD_PKTS_CLOSED ((struct rte_mbuf *)UINTPTR_MAX)
+
+static struct gr_ip4_nh_hold_conf hold_conf = {
+	.max_pkts = IP4_NH_MAX_HELD_PKTS,
+	.max_pkts_total = IP4_NH_MAX_HELD_PKTS_TOTAL,
+	.hold_time = IP4_NH_HOLD_TIME,
+};
+
+static struct {
+	_Atomic(uint32_t) held_pkts;
+	_Atomic(uint64_t) held;
+	_Atomic(uint64_t) flushed;
+	_Atomic(uint64_t) expired;
+} hold_stats;
+
+static struct gr_ip4_nh_solicit_conf solicit_conf = {
+	.rate = IP4_NH_SOLICIT_RATE,
+	.burst = IP4_NH_SOLICIT_BURST,
+	.iface_rate = IP4_NH_SOLICIT_IFACE_RATE,
+	.iface_burst = IP4_NH_SOLICIT_IFACE_BURST,
+};
+static struct gr_ip4_nh_solicit_stats solicit_stats;
+static struct gr_token_bucket solicit_bucket;
+static struct gr_token_bucket *iface_buckets;
+
+static void solicit_buckets_init(void) {
+	uint64_t now = rte_get_tsc_cycles();
+
+	gr_token_bucket_init(&solicit_bucket, solicit_conf.rate, solicit_conf.burst, now);
+	for (uint16_t i = 0; i < MAX_IFACES; i++) {
+		gr_token_bucket_init(
+			&iface_buckets[i], solicit_conf.iface_rate, solicit_conf.iface_burst, now
+		);
+	}
+}
+
+ip4_nh_hold_status_t ip4_nexthop_hold(struct nexthop *nh, struct rte_mbuf *mbuf) {
+	struct rte_mbuf *head;
+
+	if (nh->flags & GR_IP4_NH_F_REACHABLE)
+		return IP4_NH_OK_TO_SEND;
+	// Negative cache. Do not try to resolve again until the entry expires.
+	if (nh->flags & GR_IP4_NH_F_FAILED)
+		return IP4_NH_FAILED;
+
+	// Reserve room in the per next hop and global budgets.
+	if (atomic_fetch_add_explicit(&nh->held_pkts_num, 1, memory_order_relaxed)
+	    >= hold_conf.max_pkts)
+		goto full_nh;
+	if (atomic_fetch_add_explicit(&hold_stats.held_pkts, 1, memory_order_relaxed)
+	    >= hold_conf.max_pkts_total)
+		goto full;
+
+	// Push the packet on the stack. Consumers always take the whole stack at once, there
+	// is no ABA problem.
+	head = atomic_load_explicit(&nh->held_pkts, memory_order_relaxed);
+	do {
+		if (head == HELD_PKTS_CLOSED) {
+			// resolved in the meantime
+			atomic_fetch_sub_explicit(&hold_stats.held_pkts, 1, memory_order_relaxed);
+			atomic_fetch_sub_explicit(&nh->held_pkts_num, 1, memory_order_relaxed);
+			return IP4_NH_OK_TO_SEND;
+		}
+		queue_mbuf_data(mbuf)->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&nh->held_pkts, &head, mbuf, memory_order_release, memory_order_relaxed
+	));
+
+	if (head == NULL)
+		atomic_store_explicit(&nh->held_since, rte_get_tsc_cycles(), memory_order_relaxed);
+	atomic_fetch_add_explicit(&hold_stats.held, 1, memory_order_relaxed);
+
+	// Only the worker which sets the flag asks the control plane for resolution.
+	if (!(atomic_fetch_or(&nh->flags, GR_IP4_NH_F_PENDING) & GR_IP4_NH_F_PENDING)) {
+		if (ip4_nexthop_solicit(nh) < 0)
+			atomic_fetch_and(&nh->flags, ~GR_IP4_NH_F_PENDING);
+	}
+
+	return IP4_NH_HELD;
+full:
+	atomic_fetch_sub_explicit(&hold_stats.held_pkts, 1, memory_order_relaxed);
+full_nh:
+	atomic_fetch_sub_explicit(&nh->held_pkts_num, 1, memory_order_relaxed);
+	return IP4_NH_HOLD_QUEUE_FULL;
+}
+
+// Take all held packets and reverse the stack to return them in the order they were queued.
+static struct rte_mbuf *held_pkts_take(struct nexthop *nh, struct rte_mbuf *replace, unsigned *n) {
+	struct rte_mbuf *m, *next, *list = NULL;
+
+	*n = 0;
+	m = atomic_exchange_explicit(&nh->held_pkts, replace, memory_order_acq_rel);
+	if (m == HELD_PKTS_CLOSED)
+		return NULL;
+
+	while (m != NULL) {
+		next = queue_mbuf_data(m)->next;
+		queue_mbuf_data(m)->next = list;
+		list = m;
+		m = next;
+		(*n)++;
+	}
+	atomic_fetch_sub_explicit(&nh->held_pkts_num, *n, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&hold_stats.held_pkts, *n, memory_order_relaxed);
+
+	return list;
+}
+
+struct rte_mbuf *ip4_nexthop_flush(struct nexthop *nh) {
+	struct rte_mbuf *list;
+	unsigned n;
+
+	list = held_pkts_take(nh, HELD_PKTS_CLOSED, &n);
+	atomic_fetch_add_explicit(&hold_stats.flushed, n, memory_order_relaxed);
+
+	return list;
+}
+
+// Free all held packets. The stack is replaced with NULL to hold packets again or with
+// HELD_PKTS_CLOSED to stop holding them.
+static void held_pkts_free(struct nexthop *nh, struct rte_mbuf *replace) {
+	struct rte_mbuf *m, *next;
+	unsigned n;
+
+	m = held_pkts_take(nh, replace, &n);
+	while (m != NULL) {
+		next = queue_mbuf_data(m)->next;
+		rte_pktmbuf_free(m);
+		m = next;
+	}
+	atomic_fetch_add_explicit(&hold_stats.expired, n, memory_order_relaxed);
+}
+
 struct nexthop *ip4_nexthop_get(uint32_t idx) {
 	return &nh_array[idx];
 }
@@ -71,21 +229,39 @@ int ip4_nexthop_add(uint16_t vrf_id, ip4_addr_t ip, uint32_t *idx, struct nextho
 	return 0;
 }
 
+int ip4_nexthop_lookup_add(
+	uint16_t vrf_id,
+	ip4_addr_t ip,
+	uint16_t iface_id,
+	uint32_t *idx,
+	struct nexthop **nh
+) {
+	if (ip4_nexthop_lookup(vrf_id, ip, idx, nh) == 0)
+		return 0;
+	if (ip4_nexthop_add(vrf_id, ip, idx, nh) < 0)
+		return -errno;
+
+	(*nh)->iface_id = iface_id;
+	// reference held by the neighbor table, released when the entry expires
+	ip4_nexthop_incref(*nh);
+	nh_ctls[*idx].last_solicit = 0;
+	nh_timer_arm(*nh, IP4_NH_LIFETIME_REACHABLE * rte_get_tsc_hz());
+
+	return 0;
+}
+
 void ip4_nexthop_decref(struct nexthop *nh) {
 	if (nh->ref_count <= 1) {
 		struct nexthop_key key = {nh->ip, nh->vrf_id};
 
-		rte_spinlock_lock(&nh->lock);
-		// Flush all held packets.
-		struct rte_mbuf *m = nh->held_pkts_head;
-		while (m != NULL) {
-			struct rte_mbuf *next = queue_mbuf_data(m)->next;
-			rte_pktmbuf_free(m);
-			m = next;
-		}
-		rte_spinlock_unlock(&nh->lock);
+		if (nh->flags & GR_IP4_NH_F_GROUP)
+			key.vrf_id |= NH_KEY_GROUP;
+
+		if (!(nh->flags & GR_IP4_NH_F_GROUP))
+			held_pkts_free(nh, NULL);
 
 		rte_hash_del_key(nh_hash, &key);
+		ip4_flow_cache_invalidate();
 		memset(nh, 0, sizeof(*nh));
 	} else {
 		nh->ref_count--;
@@ -96,6 +272,77 @@ void ip4_nexthop_incref(struct nexthop *nh) {
 	nh->ref_count++;
 }
 
+int ip4_nexthop_group_lookup(
+	uint16_t vrf_id,
+	uint32_t group_id,
+	uint32_t *idx,
+	struct nexthop **nh
+) {
+	struct nexthop_key key = {group_id, vrf_id | NH_KEY_GROUP};
+	int32_t nh_idx;
+
+	if ((nh_idx = rte_hash_lookup(nh_hash, &key)) < 0)
+		return errno_set(-nh_idx);
+
+	*idx = nh_idx;
+	*nh = &nh_array[nh_idx];
+
+	return 0;
+}
+
+static int nh_group_add(uint16_t vrf_id, uint32_t group_id, struct nexthop **nh) {
+	struct nexthop_key key = {group_id, vrf_id | NH_KEY_GROUP};
+	int32_t nh_idx = rte_hash_add_key(nh_hash, &key);
+
+	if (nh_idx < 0)
+		return errno_set(-nh_idx);
+
+	*nh = &nh_array[nh_idx];
+	(*nh)->vrf_id = vrf_id;
+	(*nh)->ip = group_id;
+	(*nh)->flags = GR_IP4_NH_F_GROUP;
+	// reference held by the group itself, released by nh4_group_del
+	ip4_nexthop_incref(*nh);
+
+	return 0;
+}
+
+static void nh_group_free(struct nh_group *group) {
+	if (group == NULL)
+		return;
+	for (uint16_t i = 0; i < group->n_members; i++)
+		ip4_nexthop_decref(group->members[i]);
+	free(group);
+}
+
+static struct nh_group *nh_group_alloc(const struct gr_ip4_nh_group *g) {
+	struct nexthop *nh, *link;
+	struct nh_group *group;
+	uint32_t idx;
+
+	group = calloc(1, sizeof(*group) + g->n_members * sizeof(group->members[0]));
+	if (group == NULL)
+		return errno_set_null(ENOMEM);
+
+	for (uint8_t i = 0; i < g->n_members; i++) {
+		// members are gateways, they must be reachable via a connected route
+		if ((link = ip4_route_lookup(g->vrf_id, g->members[i])) == NULL) {
+			errno = EHOSTUNREACH;
+			goto err;
+		}
+		if (ip4_nexthop_lookup_add(g->vrf_id, g->members[i], link->iface_id, &idx, &nh) < 0)
+			goto err;
+		nh->flags |= GR_IP4_NH_F_GATEWAY;
+		ip4_nexthop_incref(nh);
+		group->members[group->n_members++] = nh;
+	}
+
+	return group;
+err:
+	nh_group_free(group);
+	return NULL;
+}
+
 static struct api_out nh4_add(const void *request, void **response) {
 	const struct gr_ip4_nh_add_req *req = request;
 	struct nexthop *nh;
@@ -118,15 +365,16 @@ static struct api_out nh4_add(const void *request, void **response) {
 		return api_out(EEXIST, 0);
 	}
 
-	if ((ret = ip4_nexthop_add(req->nh.vrf_id, req->nh.host, &nh_idx, &nh)) < 0)
+	ret = ip4_nexthop_lookup_add(
+		req->nh.vrf_id, req->nh.host, req->nh.iface_id, &nh_idx, &nh
+	);
+	if (ret < 0)
 		return api_out(-ret, 0);
 
-	nh->iface_id = req->nh.iface_id;
 	memcpy(&nh->lladdr, (void *)&req->nh.mac, sizeof(nh->lladdr));
 	nh->flags = GR_IP4_NH_F_STATIC | GR_IP4_NH_F_REACHABLE;
-	ret = ip4_route_insert(nh->vrf_id, nh->ip, 32, nh_idx, nh);
 
-	return api_out(-ret, 0);
+	return api_out(0, 0);
 }
 
 static struct api_out nh4_del(const void *request, void **response) {
@@ -144,43 +392,107 @@ static struct api_out nh4_del(const void *request, void **response) {
 			return api_out(0, 0);
 		return api_out(errno, 0);
 	}
-	if ((nh->flags & (GR_IP4_NH_F_LOCAL | GR_IP4_NH_F_LINK | GR_IP4_NH_F_GATEWAY))
-	    || nh->ref_count > 1)
+	// only the neighbor table reference must remain
+	if ((nh->flags & (GR_IP4_NH_F_LOCAL | GR_IP4_NH_F_LINK)) || nh->ref_count > 1)
 		return api_out(EBUSY, 0);
 
-	// this also does ip4_nexthop_decref(), freeing the next hop
-	if (ip4_route_delete(req->vrf_id, req->host, 32) < 0)
-		return api_out(errno, 0);
+	ip4_nexthop_decref(nh);
 
 	return api_out(0, 0);
 }
 
+static void nh4_resolve_cb(void *obj) {
+	struct rte_mbuf *mbuf = obj;
+	const struct rte_ipv4_hdr *ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
+	struct nexthop *link = ip_output_mbuf_data(mbuf)->nh;
+	struct nexthop *nh;
+	uint32_t idx;
+
+	// the address may have been removed in the meantime
+	if (!(link->flags & GR_IP4_NH_F_LINK))
+		goto free;
+
+	if (ip4_nexthop_lookup_add(link->vrf_id, ip->dst_addr, link->iface_id, &idx, &nh) < 0)
+		goto free;
+
+	ip_output_mbuf_data(mbuf)->nh = nh;
+	// If the neighbor was resolved since the packet was posted, it is dropped. This only
+	// happens for the first packets sent to a destination.
+	if (ip4_nexthop_hold(nh, mbuf) == IP4_NH_HELD)
+		return;
+free:
+	rte_pktmbuf_free(mbuf);
+}
+
+int ip4_nexthop_resolve(struct rte_mbuf *mbuf) {
+	return post_to_control(nh4_resolve_cb, mbuf);
+}
+
+static void nh4_learn_cb(void *obj) {
+	struct rte_mbuf *mbuf = obj;
+	const struct rte_arp_hdr *arp = rte_pktmbuf_mtod(mbuf, const struct rte_arp_hdr *);
+	const struct arp_learn_mbuf_data *data = arp_learn_mbuf_data(mbuf);
+	struct rte_mbuf *head = NULL;
+	struct nexthop *nh;
+	uint32_t idx;
+
+	// the neighbor may have been removed in the meantime
+	if (ip4_nexthop_lookup(data->vrf_id, arp->arp_data.arp_sip, &idx, &nh) < 0)
+		goto free;
+	if (nh->flags & (GR_IP4_NH_F_STATIC | GR_IP4_NH_F_LOCAL))
+		goto free;
+
+	nh->last_reply = rte_get_tsc_cycles();
+	nh->ucast_probes = 0;
+	nh->bcast_probes = 0;
+	if (nh->iface_id != data->iface_id
+	    || !rte_is_same_ether_addr(&nh->lladdr, &arp->arp_data.arp_sha)) {
+		// Workers read these fields without synchronization. Only write them when they
+		// change and drop the forwarding decisions cached with the old values.
+		nh->iface_id = data->iface_id;
+		rte_ether_addr_copy(&arp->arp_data.arp_sha, &nh->lladdr);
+		ip4_flow_cache_invalidate();
+	}
+	atomic_fetch_or(&nh->flags, GR_IP4_NH_F_REACHABLE);
+	atomic_fetch_and(
+		&nh->flags, ~(GR_IP4_NH_F_STALE | GR_IP4_NH_F_PENDING | GR_IP4_NH_F_FAILED)
+	);
+
+	// Stop holding packets. The ones held in the meantime must be sent by a worker.
+	if (!atomic_compare_exchange_strong(&nh->held_pkts, &head, HELD_PKTS_CLOSED)
+	    && head != HELD_PKTS_CLOSED && arp_input_flush_held(nh) < 0) {
+		LOG(ERR, "arp_input_flush_held: %s", strerror(errno));
+		held_pkts_free(nh, HELD_PKTS_CLOSED);
+	}
+free:
+	rte_pktmbuf_free(mbuf);
+}
+
+int ip4_nexthop_learn(struct rte_mbuf *mbuf) {
+	return post_to_control(nh4_learn_cb, mbuf);
+}
+
 static struct api_out nh4_list(const void *request, void **response) {
 	const struct gr_ip4_nh_list_req *req = request;
 	struct gr_ip4_nh_list_resp *resp = NULL;
 	struct gr_ip4_nh *api_nh;
 	struct nexthop *nh;
-	uint32_t num, iter;
 	const void *key;
+	uint32_t iter;
 	int32_t idx;
 	void *data;
 	size_t len;
 
-	num = 0;
-	iter = 0;
-	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
-		nh = ip4_nexthop_get(idx);
-		if (nh->vrf_id == req->vrf_id || req->vrf_id == UINT16_MAX)
-			num++;
-	}
-
-	len = sizeof(*resp) + num * sizeof(struct gr_ip4_nh);
+	len = sizeof(*resp) + GR_API_LIST_MAX(struct gr_ip4_nh) * sizeof(struct gr_ip4_nh);
 	if ((resp = calloc(len, 1)) == NULL)
 		return api_out(ENOMEM, 0);
 
-	iter = 0;
+	// The cursor is the position of the hash table iterator.
+	iter = req->cursor;
 	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
 		nh = ip4_nexthop_get(idx);
+		if (nh->flags & GR_IP4_NH_F_GROUP)
+			continue;
 		if (nh->vrf_id != req->vrf_id && req->vrf_id != UINT16_MAX)
 			continue;
 		api_nh = &resp->nhs[resp->n_nhs++];
@@ -191,62 +503,314 @@ static struct api_out nh4_list(const void *request, void **response) {
 		api_nh->flags = nh->flags;
 		if (nh->last_reply > 0)
 			api_nh->age = (rte_get_tsc_cycles() - nh->last_reply) / rte_get_tsc_hz();
-		api_nh->held_pkts = nh->held_pkts_num;
+		api_nh->held_pkts = atomic_load(&nh->held_pkts_num);
+		if (resp->n_nhs == GR_API_LIST_MAX(struct gr_ip4_nh)) {
+			resp->next = iter;
+			break;
+		}
 	}
 
 	*response = resp;
 
-	return api_out(0, len);
+	return api_out(0, sizeof(*resp) + resp->n_nhs * sizeof(struct gr_ip4_nh));
 }
 
-static void nexthop_gc(evutil_socket_t, short, void *) {
-	uint64_t now = rte_get_tsc_cycles();
-	uint64_t reply_age, request_age;
-	unsigned probes, max_probes;
-	char buf[INET_ADDRSTRLEN];
+static struct api_out nh4_group_set(const void *request, void **response) {
+	const struct gr_ip4_nh_group_set_req *req = request;
+	struct nh_group *group, *old;
+	struct nexthop *nh;
+	uint32_t idx;
+	int ret;
+
+	(void)response;
+
+	if (req->group.group_id == 0 || req->group.n_members == 0)
+		return api_out(EINVAL, 0);
+	if (req->group.n_members > GR_IP4_NH_GROUP_MAX_MEMBERS)
+		return api_out(E2BIG, 0);
+	if (req->group.vrf_id >= IP4_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+
+	if ((group = nh_group_alloc(&req->group)) == NULL)
+		return api_out(errno, 0);
+
+	if (ip4_nexthop_group_lookup(req->group.vrf_id, req->group.group_id, &idx, &nh) < 0) {
+		if ((ret = nh_group_add(req->group.vrf_id, req->group.group_id, &nh)) < 0) {
+			nh_group_free(group);
+			return api_out(-ret, 0);
+		}
+	}
+
+	// Workers see either the previous or the new members, never a mix of both.
+	old = atomic_exchange_explicit(&nh->group, group, memory_order_acq_rel);
+	ip4_flow_cache_invalidate();
+	if (old != NULL) {
+		gr_datapath_sync();
+		nh_group_free(old);
+	}
+
+	return api_out(0, 0);
+}
+
+static struct api_out nh4_group_del(const void *request, void **response) {
+	const struct gr_ip4_nh_group_del_req *req = request;
+	struct nh_group *old;
+	struct nexthop *nh;
+	uint32_t idx;
+
+	(void)response;
+
+	if (req->vrf_id >= IP4_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+
+	if (ip4_nexthop_group_lookup(req->vrf_id, req->group_id, &idx, &nh) < 0) {
+		if (errno == ENOENT && req->missing_ok)
+			return api_out(0, 0);
+		return api_out(errno, 0);
+	}
+	// still referenced by routes
+	if (nh->ref_count > 1)
+		return api_out(EBUSY, 0);
+
+	old = atomic_exchange_explicit(&nh->group, NULL, memory_order_acq_rel);
+	ip4_flow_cache_invalidate();
+	gr_datapath_sync();
+	nh_group_free(old);
+	ip4_nexthop_decref(nh);
+
+	return api_out(0, 0);
+}
+
+static struct api_out nh4_group_list(const void *request, void **response) {
+	const struct gr_ip4_nh_group_list_req *req = request;
+	struct gr_ip4_nh_group_list_resp *resp = NULL;
+	const struct nh_group *group;
+	struct gr_ip4_nh_group *g;
 	struct nexthop *nh;
 	const void *key;
 	uint32_t iter;
 	int32_t idx;
 	void *data;
+	size_t len;
 
-	max_probes = IP4_NH_UCAST_PROBES + IP4_NH_BCAST_PROBES;
-	iter = 0;
+	len = sizeof(*resp)
+		+ GR_API_LIST_MAX(struct gr_ip4_nh_group) * sizeof(struct gr_ip4_nh_group);
+	if ((resp = calloc(len, 1)) == NULL)
+		return api_out(ENOMEM, 0);
 
+	// The cursor is the position of the hash table iterator.
+	iter = req->cursor;
 	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
 		nh = ip4_nexthop_get(idx);
+		if (!(nh->flags & GR_IP4_NH_F_GROUP))
+			continue;
+		if (nh->vrf_id != req->vrf_id && req->vrf_id != UINT16_MAX)
+			continue;
+		g = &resp->groups[resp->n_groups++];
+		g->group_id = nh->ip;
+		g->vrf_id = nh->vrf_id;
+		group = atomic_load(&nh->group);
+		for (uint16_t i = 0; group != NULL && i < group->n_members; i++)
+			g->members[g->n_members++] = group->members[i]->ip;
+		if (resp->n_groups == GR_API_LIST_MAX(struct gr_ip4_nh_group)) {
+			resp->next = iter;
+			break;
+		}
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_groups * sizeof(struct gr_ip4_nh_group));
+}
+
+static struct api_out nh4_hold_set(const void *request, void **response) {
+	const struct gr_ip4_nh_hold_set_req *req = request;
+
+	(void)response;
+
+	if (req->conf.max_pkts != 0)
+		hold_conf.max_pkts = req->conf.max_pkts;
+	if (req->conf.max_pkts_total != 0)
+		hold_conf.max_pkts_total = req->conf.max_pkts_total;
+	if (req->conf.hold_time != 0)
+		hold_conf.hold_time = req->conf.hold_time;
+
+	return api_out(0, 0);
+}
+
+static struct api_out nh4_hold_get(const void *request, void **response) {
+	struct gr_ip4_nh_hold_get_resp *resp;
 
-		if (nh->flags & GR_IP4_NH_F_STATIC)
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->conf = hold_conf;
+	resp->stats.held_pkts = atomic_load(&hold_stats.held_pkts);
+	resp->stats.held = atomic_load(&hold_stats.held);
+	resp->stats.flushed = atomic_load(&hold_stats.flushed);
+	resp->stats.expired = atomic_load(&hold_stats.expired);
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+static struct api_out nh4_solicit_set(const void *request, void **response) {
+	const struct gr_ip4_nh_solicit_set_req *req = request;
+
+	(void)response;
+
+	if (req->conf.rate != 0)
+		solicit_conf.rate = req->conf.rate;
+	if (req->conf.burst != 0)
+		solicit_conf.burst = req->conf.burst;
+	if (req->conf.iface_rate != 0)
+		solicit_conf.iface_rate = req->conf.iface_rate;
+	if (req->conf.iface_burst != 0)
+		solicit_conf.iface_burst = req->conf.iface_burst;
+
+	solicit_buckets_init();
+
+	return api_out(0, 0);
+}
+
+static struct api_out nh4_solicit_get(const void *request, void **response) {
+	struct gr_ip4_nh_solicit_get_resp *resp;
+
+	(void)request;
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->conf = solicit_conf;
+	resp->stats = solicit_stats;
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+void ip4_nexthop_cleanup(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen) {
+	struct nexthop **nhs = NULL, **n, *nh;
+	const void *key;
+	uint32_t iter;
+	int32_t idx;
+	void *data;
+
+	// collect first, keys cannot be deleted while iterating over the hash table
+	iter = 0;
+	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
+		nh = ip4_nexthop_get(idx);
+		if (nh->flags & (GR_IP4_NH_F_LOCAL | GR_IP4_NH_F_GROUP))
 			continue;
+		if (nh->vrf_id != vrf_id || !ip4_addr_same_subnet(nh->ip, ip, prefixlen))
+			continue;
+		// still referenced by routes or groups
+		if (nh->ref_count > 1)
+			continue;
+		arrpush(nhs, nh);
+	}
+
+	arrforeach (n, nhs)
+		ip4_nexthop_decref(*n);
+	arrfree(nhs);
+}
+
+static void nh_probe(struct nexthop *nh) {
+	unsigned probes = nh->ucast_probes + nh->bcast_probes;
+	uint64_t now = rte_get_tsc_cycles();
+	uint64_t hz = rte_get_tsc_hz();
+
+	if (nh->iface_id >= MAX_IFACES
+	    || !gr_token_bucket_take(&iface_buckets[nh->iface_id], now, hz)
+	    || !gr_token_bucket_take(&solicit_bucket, now, hz)) {
+		// try again on the next tick, this does not count as a probe
+		solicit_stats.rate_limited++;
+		nh_timer_arm(nh, hz / NH_TIMER_HZ);
+		return;
+	}
+
+	// Probe counters are only modified here. The datapath reads them to choose between a
+	// unicast and a broadcast request.
+	if (nh->ucast_probes < IP4_NH_UCAST_PROBES)
+		nh->ucast_probes++;
+	else
+		nh->bcast_probes++;
+	nh->last_request = now;
+
+	if (arp_output_request_solicit(nh) < 0) {
+		LOG(ERR, "arp_output_request_solicit: %s", strerror(errno));
+	} else {
+		nh_ctls[nh - nh_array].last_solicit = now;
+		solicit_stats.sent++;
+	}
+
+	// wait one more second after each unanswered probe
+	nh_timer_arm(nh, (probes + 1) * hz);
+}
+
+static void nh_timer_cb(struct gr_timer *t) {
+	struct nexthop *nh = &nh_array[container_of(t, struct nh_ctl, timer) - nh_ctls];
+	uint64_t now = rte_get_tsc_cycles();
+	uint64_t hz = rte_get_tsc_hz();
+	char buf[INET_ADDRSTRLEN];
+	unsigned probes;
 
-		reply_age = (now - nh->last_reply) / rte_get_tsc_hz();
-		request_age = (now - nh->last_request) / rte_get_tsc_hz();
-		probes = nh->ucast_probes + nh->bcast_probes;
-
-		if (nh->flags & (GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE) && request_age > probes) {
-			if (probes >= max_probes && !(nh->flags & GR_IP4_NH_F_GATEWAY)) {
-				inet_ntop(AF_INET, &nh->ip, buf, sizeof(buf));
-				LOG(DEBUG,
-				    "%s vrf=%u failed_probes=%u held_pkts=%u: %s -> failed",
-				    buf,
-				    nh->vrf_id,
-				    probes,
-				    nh->held_pkts_num,
-				    gr_ip4_nh_f_name(
-					    nh->flags & (GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE)
-				    ));
-				nh->flags &= ~(GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE);
-				nh->flags |= GR_IP4_NH_F_FAILED;
-			} else {
-				if (arp_output_request_solicit(nh) < 0)
-					LOG(ERR, "arp_output_request_solicit: %s", strerror(errno));
-			}
-		} else if (nh->flags & GR_IP4_NH_F_REACHABLE
-			   && reply_age > IP4_NH_LIFETIME_REACHABLE) {
-			nh->flags &= ~GR_IP4_NH_F_REACHABLE;
-			nh->flags |= GR_IP4_NH_F_STALE;
-		} else if (nh->flags & GR_IP4_NH_F_FAILED
-			   && request_age > IP4_NH_LIFETIME_UNREACHABLE) {
+	// Timers are not stopped when next hops are destroyed. The entry may be free or reused.
+	if (nh->ref_count == 0)
+		return;
+	if (nh->flags & (GR_IP4_NH_F_STATIC | GR_IP4_NH_F_LOCAL | GR_IP4_NH_F_GROUP))
+		return;
+
+	// Not used by any route anymore, let it expire as a regular neighbor.
+	if (nh->flags & GR_IP4_NH_F_GATEWAY && nh->ref_count <= 1)
+		atomic_fetch_and(&nh->flags, ~GR_IP4_NH_F_GATEWAY);
+
+	probes = nh->ucast_probes + nh->bcast_probes;
+
+	if (!(nh->flags & GR_IP4_NH_F_REACHABLE) && atomic_load(&nh->held_pkts_num) > 0
+	    && atomic_load(&nh->held_since) + hold_conf.hold_time * hz <= now)
+		held_pkts_free(nh, NULL);
+
+	if (nh->flags & (GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE)) {
+		if (probes >= IP4_NH_UCAST_PROBES + IP4_NH_BCAST_PROBES
+		    && !(nh->flags & GR_IP4_NH_F_GATEWAY)) {
+			inet_ntop(AF_INET, &nh->ip, buf, sizeof(buf));
+			LOG(DEBUG,
+			    "%s vrf=%u failed_probes=%u held_pkts=%u: %s -> failed",
+			    buf,
+			    nh->vrf_id,
+			    probes,
+			    nh->held_pkts_num,
+			    gr_ip4_nh_f_name(
+				    nh->flags & (GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE)
+			    ));
+			atomic_fetch_or(&nh->flags, GR_IP4_NH_F_FAILED);
+			atomic_fetch_and(&nh->flags, ~(GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE));
+			held_pkts_free(nh, NULL);
+			nh_timer_arm(nh, IP4_NH_LIFETIME_UNREACHABLE * hz);
+		} else {
+			nh_probe(nh);
+		}
+	} else if (nh->flags & GR_IP4_NH_F_REACHABLE) {
+		// the next hop may have been refreshed since the timer was armed
+		if (nh->last_reply + IP4_NH_LIFETIME_REACHABLE * hz > now) {
+			nh_timer_arm(nh, nh->last_reply + IP4_NH_LIFETIME_REACHABLE * hz - now);
+		} else {
+			struct rte_mbuf *closed = HELD_PKTS_CLOSED;
+			atomic_fetch_or(&nh->flags, GR_IP4_NH_F_STALE);
+			atomic_fetch_and(&nh->flags, ~GR_IP4_NH_F_REACHABLE);
+			// hold packets again until the next hop is confirmed
+			atomic_compare_exchange_strong(&nh->held_pkts, &closed, NULL);
+			nh_probe(nh);
+		}
+	} else if (nh->flags & GR_IP4_NH_F_FAILED) {
+		if (nh->ref_count > 1
+		    || nh->last_request + IP4_NH_LIFETIME_UNREACHABLE * hz > now) {
+			nh_timer_arm(nh, IP4_NH_LIFETIME_UNREACHABLE * hz);
+		} else {
 			inet_ntop(AF_INET, &nh->ip, buf, sizeof(buf));
 			LOG(DEBUG,
 			    "%s vrf=%u failed_probes=%u held_pkts=%u: failed -> <destroy>",
@@ -254,21 +818,63 @@ static void nexthop_gc(evutil_socket_t, short, void *) {
 			    nh->vrf_id,
 			    probes,
 			    nh->held_pkts_num);
-
-			// this also does ip4_nexthop_decref(), freeing the next hop
+			// release the neighbor table reference, freeing the next hop
 			// and buffered packets.
-			if (ip4_route_delete(nh->vrf_id, nh->ip, 32) < 0)
-				LOG(ERR, "ip4_route_delete: %s", strerror(errno));
+			ip4_nexthop_decref(nh);
 		}
+	} else {
+		// Never resolved. It may still be refreshed by ARP requests.
+		nh_timer_arm(nh, IP4_NH_LIFETIME_REACHABLE * hz);
 	}
 }
 
-static struct event *nh_gc_timer;
+static void nh4_solicit_cb(void *obj) {
+	struct nexthop *nh = obj;
+
+	// the next hop may have been destroyed or resolved in the meantime
+	if (nh->ref_count == 0 || !(nh->flags & (GR_IP4_NH_F_PENDING | GR_IP4_NH_F_STALE)))
+		return;
+	// A worker may set the pending flag right after the next hop was resolved.
+	if (nh->flags & GR_IP4_NH_F_REACHABLE) {
+		atomic_fetch_and(&nh->flags, ~GR_IP4_NH_F_PENDING);
+		return;
+	}
+
+	// Several workers may ask for the same next hop at once. Probes are retried by the
+	// next hop timer, ignore requests made less than one probe interval after a probe.
+	if (rte_get_tsc_cycles() - nh_ctls[nh - nh_array].last_solicit < rte_get_tsc_hz()) {
+		solicit_stats.coalesced++;
+		return;
+	}
+
+	nh_probe(nh);
+}
+
+int ip4_nexthop_solicit(struct nexthop *nh) {
+	return post_to_control(nh4_solicit_cb, nh);
+}
+
+static void nh4_release_cb(void *obj) {
+	ip4_nexthop_decref(obj);
+}
+
+void ip4_nexthop_release(struct nexthop *nh) {
+	// The reference is leaked if the control plane lags behind. This is better than
+	// modifying the reference count from a worker.
+	if (post_to_control(nh4_release_cb, nh) < 0)
+		LOG(ERR, "post_to_control: %s", strerror(errno));
+}
+
+static void nh_timer_run(evutil_socket_t, short, void *) {
+	gr_timer_wheel_run(&nh_wheel, cycles_to_ticks(rte_get_tsc_cycles()));
+}
+
+static struct event *nh_timer_ev;
 
 static void nh4_init(struct event_base *ev_base) {
 	struct rte_hash_parameters params = {
 		.name = "ip4_nh",
-		.entries = IP4_MAX_NEXT_HOPS,
+		.entries = gr_args()->max_nexthops,
 		.key_len = sizeof(struct nexthop_key),
 		.extra_flag = RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF
 			| RTE_HASH_EXTRA_FLAGS_TRANS_MEM_SUPPORT,
@@ -286,21 +892,46 @@ static void nh4_init(struct event_base *ev_base) {
 	if (nh_array == NULL)
 		ABORT("rte_calloc(nh4_array) failed");
 
-	nh_gc_timer = event_new(ev_base, -1, EV_PERSIST | EV_FINALIZE, nexthop_gc, NULL);
-	if (nh_gc_timer == NULL)
+	nh_ctls = calloc(rte_hash_max_key_id(nh_hash) + 1, sizeof(*nh_ctls));
+	if (nh_ctls == NULL)
+		ABORT("calloc(nh_ctls) failed");
+	iface_buckets = calloc(MAX_IFACES, sizeof(*iface_buckets));
+	if (iface_buckets == NULL)
+		ABORT("calloc(iface_buckets) failed");
+	solicit_buckets_init();
+	gr_timer_wheel_init(&nh_wheel, cycles_to_ticks(rte_get_tsc_cycles()));
+
+	nh_timer_ev = event_new(ev_base, -1, EV_PERSIST | EV_FINALIZE, nh_timer_run, NULL);
+	if (nh_timer_ev == NULL)
 		ABORT("event_new() failed");
-	struct timeval tv = {.tv_sec = 1};
-	if (event_add(nh_gc_timer, &tv) < 0)
+	struct timeval tv = {.tv_usec = 1000000 / NH_TIMER_HZ};
+	if (event_add(nh_timer_ev, &tv) < 0)
 		ABORT("event_add() failed");
 }
 
 static void nh4_fini(struct event_base *) {
-	event_free(nh_gc_timer);
-	nh_gc_timer = NULL;
+	struct nexthop *nh;
+	const void *key;
+	uint32_t iter;
+	void *data;
+	int32_t idx;
+
+	event_free(nh_timer_ev);
+	nh_timer_ev = NULL;
+	iter = 0;
+	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
+		nh = ip4_nexthop_get(idx);
+		if (nh->flags & GR_IP4_NH_F_GROUP)
+			free(atomic_load(&nh->group));
+	}
 	rte_hash_free(nh_hash);
 	nh_hash = NULL;
 	rte_free(nh_array);
 	nh_array = NULL;
+	free(nh_ctls);
+	nh_ctls = NULL;
+	free(iface_buckets);
+	iface_buckets = NULL;
 }
 
 static struct gr_api_handler nh4_add_handler = {
@@ -319,6 +950,44 @@ static struct gr_api_handler nh4_list_handler = {
 	.callback = nh4_list,
 };
 
+static struct gr_api_handler nh4_group_set_handler = {
+	.name = "ipv4 nexthop group set",
+	.request_type = GR_IP4_NH_GROUP_SET,
+	.callback = nh4_group_set,
+};
+static struct gr_api_handler nh4_group_del_handler = {
+	.name = "ipv4 nexthop group del",
+	.request_type = GR_IP4_NH_GROUP_DEL,
+	.callback = nh4_group_del,
+};
+static struct gr_api_handler nh4_group_list_handler = {
+	.name = "ipv4 nexthop group list",
+	.request_type = GR_IP4_NH_GROUP_LIST,
+	.callback = nh4_group_list,
+};
+
+static struct gr_api_handler nh4_hold_set_handler = {
+	.name = "ipv4 nexthop hold set",
+	.request_type = GR_IP4_NH_HOLD_SET,
+	.callback = nh4_hold_set,
+};
+static struct gr_api_handler nh4_hold_get_handler = {
+	.name = "ipv4 nexthop hold get",
+	.request_type = GR_IP4_NH_HOLD_GET,
+	.callback = nh4_hold_get,
+};
+
+static struct gr_api_handler nh4_solicit_set_handler = {
+	.name = "ipv4 nexthop solicit set",
+	.request_type = GR_IP4_NH_SOLICIT_SET,
+	.callback = nh4_solicit_set,
+};
+static struct gr_api_handler nh4_solicit_get_handler = {
+	.name = "ipv4 nexthop solicit get",
+	.request_type = GR_IP4_NH_SOLICIT_GET,
+	.callback = nh4_solicit_get,
+};
+
 static struct gr_module nh4_module = {
 	.name = "ipv4 nexthop",
 	.init = nh4_init,
@@ -330,5 +999,12 @@ RTE_INIT(control_ip_init) {
 	gr_register_api_handler(&nh4_add_handler);
 	gr_register_api_handler(&nh4_del_handler);
 	gr_register_api_handler(&nh4_list_handler);
+	gr_register_api_handler(&nh4_group_set_handler);
+	gr_register_api_handler(&nh4_group_del_handler);
+	gr_register_api_handler(&nh4_group_list_handler);
+	gr_register_api_handler(&nh4_hold_set_handler);
+	gr_register_api_handler(&nh4_hold_get_handler);
+	gr_register_api_handler(&nh4_solicit_set_handler);
+	gr_register_api_handler(&nh4_solicit_get_handler);
 	gr_register_module(&nh4_module);
 }
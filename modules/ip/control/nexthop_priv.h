@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_IP4_NEXTHOP_PRIV
+#define _GR_IP4_NEXTHOP_PRIV
+
+#include <gr_net_types.h>
+
+#include <stdint.h>
+
+struct nexthop_key {
+	ip4_addr_t ip;
+	// XXX: Using uint16_t to hold vrf_id causes the compiler to add 2 bytes
+	// padding at the end of the structure. When the structure is
+	// initialized on the stack, the padding bytes have undetermined
+	// contents.
+	//
+	// This structure is used to compute a hash key. In order to get
+	// deterministic results, use uint32_t to store the vrf_id so that the
+	// compiler does not insert any padding.
+	uint32_t vrf_id;
+};
+
+// Next hop groups are stored in the same hash table as regular next hops. Their key holds the
+// group ID instead of an address and this bit is set in the VRF ID to avoid collisions.
+#define NH_KEY_GROUP (UINT32_C(1) << 16)
+
+#endif
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2024 Robin Jarry
 
+#include <gr.h>
 #include <gr_api.h>
 #include <gr_control.h>
 #include <gr_ip4.h>
@@ -8,104 +9,643 @@
 #include <gr_log.h>
 #include <gr_net_types.h>
 #include <gr_queue.h>
+#include <gr_stb_ds.h>
+#include <gr_worker.h>
 
 #include <event2/event.h>
 #include <rte_bitmap.h>
 #include <rte_build_config.h>
 #include <rte_ethdev.h>
 #include <rte_fib.h>
+#include <rte_fib6.h>
 #include <rte_hash.h>
 #include <rte_malloc.h>
 #include <rte_memory.h>
 #include <rte_rcu_qsbr.h>
 #include <rte_rib.h>
+#include <rte_rib6.h>
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/queue.h>
 
-static struct rte_fib **vrf_fibs;
-#define BLACKHOLE (IP4_MAX_NEXT_HOPS + 1)
-
-static struct rte_fib_conf fib_conf = {
-	.type = RTE_FIB_DIR24_8,
-	.default_nh = BLACKHOLE,
-	.max_routes = IP4_MAX_ROUTES,
-	.rib_ext_sz = 0,
-	.dir24_8 = {
-		.nh_sz = RTE_FIB_DIR24_8_4B,
-		.num_tbl8 = 1 << 15,
-	},
+// VRF with a dedicated FIB. rte_fib has no IPv4 trie implementation, TRIE FIBs are IPv6 tries
+// keyed by the IPv4 address followed by zeroes.
+struct vrf_fib {
+	union {
+		struct rte_fib *fib; // DIR24_8
+		struct rte_fib6 *fib6; // TRIE
+	};
+	uint64_t blackhole; // default next hop value returned by the fib when no route matches
+	uint32_t n_routes;
+	struct gr_ip4_fib_conf conf;
+	bool promoted; // created with promoted_fib_conf when the compact fib was full
 };
 
-static struct rte_fib *get_fib(uint16_t vrf_id) {
-	struct rte_fib *fib;
+static _Atomic(struct vrf_fib *) *vrf_fibs;
+
+// VRFs without a dedicated FIB store their routes in a shared compact FIB. It is an IPv6 trie
+// keyed by the 16 bits VRF ID followed by the 32 bits IPv4 address. The VRF ID is a prefix of
+// every key. Its memory footprint depends on the number of routes, not on the number of VRFs.
+// It holds up to max_routes routes. A VRF is promoted to a dedicated FIB when it reaches
+// IP4_VRF_COMPACT_MAX_ROUTES routes or when the compact FIB has no room left for its next route.
+static _Atomic(struct rte_fib6 *) compact_fib;
+static uint16_t *compact_n_routes;
+#define COMPACT_VRF_DEPTH 16
+#define COMPACT_BLACKHOLE ((UINT64_C(1) << 31) - 1)
+// IPv4 addresses are at the start of the keys of dedicated tries.
+#define TRIE_DEPTH 0
+
+// max_routes is initialized from the command line arguments, num_tbl8 is derived from the
+// max_routes of each FIB
+static struct gr_ip4_fib_conf default_fib_conf = {
+	.type = GR_IP4_FIB_TYPE_DIR24_8,
+	.nh_size = 4,
+};
+
+// Initial configuration of VRFs promoted out of the compact FIB. nh_size and max_routes are
+// initialized from the command line arguments.
+static struct gr_ip4_fib_conf promoted_fib_conf = {
+	.type = GR_IP4_FIB_TYPE_DIR24_8,
+	.num_tbl8 = IP4_VRF_PROMOTED_NUM_TBL8,
+};
+
+static struct vrf_fib *get_fib(uint16_t vrf_id) {
+	struct vrf_fib *vf;
 
 	if (vrf_id >= IP4_MAX_VRFS)
 		return errno_set_null(EOVERFLOW);
 
-	fib = vrf_fibs[vrf_id];
-	if (fib == NULL)
+	vf = atomic_load_explicit(&vrf_fibs[vrf_id], memory_order_acquire);
+	if (vf == NULL)
 		return errno_set_null(ENONET);
 
-	return fib;
+	return vf;
 }
 
-static struct rte_fib *get_or_create_fib(uint16_t vrf_id) {
-	struct rte_fib *fib;
+static inline bool is_trie(const struct vrf_fib *vf) {
+	return vf->conf.type == GR_IP4_FIB_TYPE_TRIE;
+}
 
-	if (vrf_id >= IP4_MAX_VRFS)
-		return errno_set_null(EOVERFLOW);
+// IPv6 trie key of an IPv4 address. The address follows a prefix of base_depth bits which is
+// the VRF ID in the compact FIB and empty in dedicated tries.
+static inline void fib6_key(
+	uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE],
+	uint8_t base_depth,
+	uint16_t vrf_id,
+	ip4_addr_t ip
+) {
+	memset(key, 0, RTE_FIB6_IPV6_ADDR_SIZE);
+	if (base_depth == COMPACT_VRF_DEPTH) {
+		key[0] = vrf_id >> 8;
+		key[1] = vrf_id & 0xff;
+	}
+	memcpy(&key[base_depth / 8], &ip, sizeof(ip));
+}
 
-	fib = vrf_fibs[vrf_id];
-	if (fib == NULL) {
-		char name[64];
+static inline void
+compact_key(uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE], uint16_t vrf_id, ip4_addr_t ip) {
+	fib6_key(key, COMPACT_VRF_DEPTH, vrf_id, ip);
+}
 
-		snprintf(name, sizeof(name), "vrf_%u", vrf_id);
-		fib = rte_fib_create(name, SOCKET_ID_ANY, &fib_conf);
+static inline void trie_key(uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE], ip4_addr_t ip) {
+	fib6_key(key, TRIE_DEPTH, 0, ip);
+}
+
+static struct rte_fib6 *compact_fib_get_or_create(void) {
+	struct rte_fib6 *fib = atomic_load(&compact_fib);
+
+	if (fib == NULL) {
+		struct rte_fib6_conf conf = {
+			.type = RTE_FIB6_TRIE,
+			.default_nh = COMPACT_BLACKHOLE,
+			.max_routes = gr_args()->max_routes,
+			.rib_ext_sz = 0,
+			.trie = {
+				.nh_sz = RTE_FIB6_TRIE_4B,
+				.num_tbl8 = ip4_vrf_compact_num_tbl8(gr_args()->max_routes),
+			},
+		};
+		fib = rte_fib6_create("vrf_compact", SOCKET_ID_ANY, &conf);
 		if (fib == NULL)
 			return errno_set_null(rte_errno);
-
-		vrf_fibs[vrf_id] = fib;
+		atomic_store_explicit(&compact_fib, fib, memory_order_release);
+		LOG(INFO,
+		    "compact fib: %u routes, %u tbl8 groups, %zu MiB",
+		    conf.max_routes,
+		    conf.trie.num_tbl8,
+		    (IP4_VRF_COMPACT_TBL24_SIZE + conf.trie.num_tbl8 * IP4_VRF_COMPACT_TBL8_SIZE)
+			    >> 20);
 	}
 
 	return fib;
 }
 
+static int compact_add(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx) {
+	uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE];
+	struct rte_fib6 *fib;
+	int ret;
+
+	if ((fib = compact_fib_get_or_create()) == NULL)
+		return -errno;
+	if (nh_idx >= COMPACT_BLACKHOLE)
+		return errno_set(ERANGE);
+
+	compact_key(key, vrf_id, ip);
+	if ((ret = rte_fib6_add(fib, key, COMPACT_VRF_DEPTH + prefixlen, nh_idx)) < 0)
+		return errno_set(-ret);
+
+	compact_n_routes[vrf_id]++;
+
+	return 0;
+}
+
+static int compact_del(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen) {
+	uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE];
+	struct rte_fib6 *fib = atomic_load(&compact_fib);
+	int ret;
+
+	if (fib == NULL)
+		return errno_set(ENOENT);
+
+	compact_key(key, vrf_id, ip);
+	if ((ret = rte_fib6_delete(fib, key, COMPACT_VRF_DEPTH + prefixlen)) < 0)
+		return errno_set(-ret);
+
+	compact_n_routes[vrf_id]--;
+
+	return 0;
+}
+
+// Invoked for every route of a VRF. Returning a negative value stops the walk.
+typedef int (*route_walk_cb_t)(void *priv, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx);
+
+// Routes are walked in rte_rib_get_nxt() order: a prefix comes after the more specific ones
+// that it covers and sibling prefixes are sorted by address. The default route comes last.
+static bool route_walked_after(ip4_addr_t ip, uint8_t prefixlen, const struct ip4_net *after) {
+	uint8_t depth = RTE_MIN(prefixlen, after->prefixlen);
+	uint32_t mask = depth ? ~UINT32_C(0) << (32 - depth) : 0;
+	uint32_t a = rte_be_to_cpu_32(ip) & mask;
+	uint32_t b = rte_be_to_cpu_32(after->ip) & mask;
+
+	if (a != b)
+		return a > b;
+
+	return prefixlen < after->prefixlen;
+}
+
+// Walk the IPv4 routes stored in an IPv6 trie after a key prefix of base_depth bits. If after
+// is not NULL, resume the walk after this route.
+static int fib6_walk(
+	struct rte_fib6 *fib,
+	uint8_t base_depth,
+	uint16_t vrf_id,
+	const struct ip4_net *after,
+	route_walk_cb_t cb,
+	void *priv
+) {
+	uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE], node_key[RTE_FIB6_IPV6_ADDR_SIZE];
+	struct rte_rib6 *rib = rte_fib6_get_rib(fib);
+	struct rte_rib6_node *rn = NULL;
+	bool skip = false;
+	uint8_t depth;
+	uint64_t nh_idx;
+	ip4_addr_t ip;
+	int ret;
+
+	if (after != NULL) {
+		if (after->prefixlen == 0)
+			return 0;
+		fib6_key(key, base_depth, vrf_id, after->ip);
+		rn = rte_rib6_lookup_exact(rib, key, base_depth + after->prefixlen);
+		// Deleted since it was returned, skip the routes which were walked before it.
+		skip = rn == NULL;
+	}
+	fib6_key(key, base_depth, vrf_id, 0);
+
+	while ((rn = rte_rib6_get_nxt(rib, key, base_depth, rn, RTE_RIB6_GET_NXT_ALL)) != NULL) {
+		rte_rib6_get_depth(rn, &depth);
+		if (depth == base_depth)
+			continue; // default route, reported last
+		rte_rib6_get_ip(rn, node_key);
+		memcpy(&ip, &node_key[base_depth / 8], sizeof(ip));
+		if (skip && !route_walked_after(ip, depth - base_depth, after))
+			continue;
+		skip = false;
+		rte_rib6_get_nh(rn, &nh_idx);
+		if ((ret = cb(priv, ip, depth - base_depth, nh_idx)) < 0)
+			return ret;
+	}
+	if ((rn = rte_rib6_lookup_exact(rib, key, base_depth)) != NULL) {
+		rte_rib6_get_nh(rn, &nh_idx);
+		if ((ret = cb(priv, 0, 0, nh_idx)) < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+// Walk the routes of a VRF in the compact FIB.
+static int compact_walk(
+	uint16_t vrf_id,
+	const struct ip4_net *after,
+	route_walk_cb_t cb,
+	void *priv
+) {
+	struct rte_fib6 *fib = atomic_load(&compact_fib);
+
+	if (fib == NULL || compact_n_routes[vrf_id] == 0)
+		return 0;
+
+	return fib6_walk(fib, COMPACT_VRF_DEPTH, vrf_id, after, cb, priv);
+}
+
+// Walk the routes of a dedicated FIB. If after is not NULL, resume the walk after this route.
+static int dedicated_walk(
+	const struct vrf_fib *vf,
+	const struct ip4_net *after,
+	route_walk_cb_t cb,
+	void *priv
+) {
+	struct rte_rib_node *rn = NULL;
+	struct rte_rib *rib;
+	bool skip = false;
+	uint8_t prefixlen;
+	uint64_t nh_idx;
+	uint32_t ip;
+	int ret;
+
+	if (is_trie(vf))
+		return fib6_walk(vf->fib6, TRIE_DEPTH, 0, after, cb, priv);
+
+	rib = rte_fib_get_rib(vf->fib);
+	if (after != NULL) {
+		if (after->prefixlen == 0)
+			return 0;
+		rn = rte_rib_lookup_exact(rib, rte_be_to_cpu_32(after->ip), after->prefixlen);
+		// Deleted since it was returned, skip the routes which were walked before it.
+		skip = rn == NULL;
+	}
+
+	while ((rn = rte_rib_get_nxt(rib, 0, 0, rn, RTE_RIB_GET_NXT_ALL)) != NULL) {
+		rte_rib_get_ip(rn, &ip);
+		rte_rib_get_depth(rn, &prefixlen);
+		if (skip && !route_walked_after(rte_cpu_to_be_32(ip), prefixlen, after))
+			continue;
+		skip = false;
+		rte_rib_get_nh(rn, &nh_idx);
+		if ((ret = cb(priv, rte_cpu_to_be_32(ip), prefixlen, nh_idx)) < 0)
+			return ret;
+	}
+	// FIXME: remove this when rte_rib_get_nxt returns a default route, if any is configured
+	if ((rn = rte_rib_lookup_exact(rib, 0, 0)) != NULL) {
+		rte_rib_get_nh(rn, &nh_idx);
+		if ((ret = cb(priv, 0, 0, nh_idx)) < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int
+vrf_routes_walk(uint16_t vrf_id, const struct ip4_net *after, route_walk_cb_t cb, void *priv) {
+	const struct vrf_fib *vf = get_fib(vrf_id);
+	if (vf != NULL)
+		return dedicated_walk(vf, after, cb, priv);
+	if (vrf_id >= IP4_MAX_VRFS)
+		return -errno;
+	return compact_walk(vrf_id, after, cb, priv);
+}
+
+static uint32_t vrf_routes_count(uint16_t vrf_id) {
+	const struct vrf_fib *vf = get_fib(vrf_id);
+	if (vf != NULL)
+		return vf->n_routes;
+	if (vrf_id >= IP4_MAX_VRFS)
+		return 0;
+	return compact_n_routes[vrf_id];
+}
+
+static struct vrf_fib *vrf_fib_create(uint16_t vrf_id, const struct gr_ip4_fib_conf *conf) {
+	struct rte_fib6_conf fib6_conf = {.rib_ext_sz = 0};
+	struct rte_fib_conf fib_conf = {.rib_ext_sz = 0};
+	static unsigned generation;
+	struct vrf_fib *vf;
+	char name[64];
+
+	if ((vf = calloc(1, sizeof(*vf))) == NULL)
+		return errno_set_null(ENOMEM);
+
+	vf->conf = *conf;
+	if (vf->conf.nh_size == 0)
+		vf->conf.nh_size = default_fib_conf.nh_size;
+	if (vf->conf.max_routes == 0)
+		vf->conf.max_routes = default_fib_conf.max_routes;
+	if (vf->conf.num_tbl8 == 0)
+		vf->conf.num_tbl8 = ip4_fib_num_tbl8(vf->conf.max_routes);
+
+	switch (vf->conf.nh_size) {
+	case 2:
+		fib_conf.dir24_8.nh_sz = RTE_FIB_DIR24_8_2B;
+		fib6_conf.trie.nh_sz = RTE_FIB6_TRIE_2B;
+		break;
+	case 4:
+		fib_conf.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
+		fib6_conf.trie.nh_sz = RTE_FIB6_TRIE_4B;
+		break;
+	case 8:
+		fib_conf.dir24_8.nh_sz = RTE_FIB_DIR24_8_8B;
+		fib6_conf.trie.nh_sz = RTE_FIB6_TRIE_8B;
+		break;
+	default:
+		free(vf);
+		return errno_set_null(EINVAL);
+	}
+	vf->blackhole = ip4_fib_blackhole(vf->conf.nh_size);
+
+	snprintf(name, sizeof(name), "vrf_%u_%u", vrf_id, generation++);
+
+	switch (vf->conf.type) {
+	case GR_IP4_FIB_TYPE_DIR24_8:
+		fib_conf.type = RTE_FIB_DIR24_8;
+		fib_conf.default_nh = vf->blackhole;
+		fib_conf.max_routes = vf->conf.max_routes;
+		fib_conf.dir24_8.num_tbl8 = vf->conf.num_tbl8;
+		vf->fib = rte_fib_create(name, SOCKET_ID_ANY, &fib_conf);
+		break;
+	case GR_IP4_FIB_TYPE_TRIE:
+		// rte_fib has no IPv4 trie implementation. Use an IPv6 trie with the IPv4
+		// address in the first 32 bits of the key.
+		fib6_conf.type = RTE_FIB6_TRIE;
+		fib6_conf.default_nh = vf->blackhole;
+		fib6_conf.max_routes = vf->conf.max_routes;
+		fib6_conf.trie.num_tbl8 = vf->conf.num_tbl8;
+		vf->fib6 = rte_fib6_create(name, SOCKET_ID_ANY, &fib6_conf);
+		break;
+	default:
+		free(vf);
+		return errno_set_null(EINVAL);
+	}
+	if (vf->fib == NULL) {
+		free(vf);
+		return errno_set_null(rte_errno);
+	}
+
+	return vf;
+}
+
+static void vrf_fib_free(struct vrf_fib *vf) {
+	if (vf == NULL)
+		return;
+	if (is_trie(vf))
+		rte_fib6_free(vf->fib6);
+	else
+		rte_fib_free(vf->fib);
+	free(vf);
+}
+
+static int dedicated_add_cb(void *priv, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx) {
+	uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE];
+	struct vrf_fib *vf = priv;
+	int ret;
+
+	if (nh_idx >= vf->blackhole)
+		return errno_set(ERANGE);
+	if (is_trie(vf)) {
+		trie_key(key, ip);
+		ret = rte_fib6_add(vf->fib6, key, prefixlen, nh_idx);
+	} else {
+		ret = rte_fib_add(vf->fib, rte_be_to_cpu_32(ip), prefixlen, nh_idx);
+	}
+	if (ret < 0)
+		return errno_set(-ret);
+	vf->n_routes++;
+
+	return 0;
+}
+
+static int dedicated_del(struct vrf_fib *vf, ip4_addr_t ip, uint8_t prefixlen) {
+	uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE];
+	int ret;
+
+	if (is_trie(vf)) {
+		trie_key(key, ip);
+		ret = rte_fib6_delete(vf->fib6, key, prefixlen);
+	} else {
+		ret = rte_fib_delete(vf->fib, rte_be_to_cpu_32(ip), prefixlen);
+	}
+	if (ret < 0)
+		return errno_set(-ret);
+	vf->n_routes--;
+
+	return 0;
+}
+
+struct route_entry {
+	ip4_addr_t ip;
+	uint8_t prefixlen;
+	uint64_t nh_idx;
+};
+
+static int collect_cb(void *priv, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx) {
+	struct route_entry **routes = priv;
+	struct route_entry r = {.ip = ip, .prefixlen = prefixlen, .nh_idx = nh_idx};
+	arrpush(*routes, r);
+	return 0;
+}
+
+// Remove all routes of a VRF from the compact FIB.
+static void compact_flush(uint16_t vrf_id) {
+	struct route_entry *routes = NULL, *r;
+
+	compact_walk(vrf_id, NULL, collect_cb, &routes);
+	arrforeach (r, routes)
+		compact_del(vrf_id, r->ip, r->prefixlen);
+	arrfree(routes);
+}
+
+// Move all routes of a VRF into a new dedicated FIB and atomically switch to it.
+static int vrf_fib_replace(uint16_t vrf_id, const struct gr_ip4_fib_conf *conf) {
+	struct vrf_fib *vf, *old;
+	int ret;
+
+	if ((vf = vrf_fib_create(vrf_id, conf)) == NULL)
+		return -errno;
+
+	if ((ret = vrf_routes_walk(vrf_id, NULL, dedicated_add_cb, vf)) < 0) {
+		vrf_fib_free(vf);
+		return ret;
+	}
+
+	old = atomic_exchange_explicit(&vrf_fibs[vrf_id], vf, memory_order_acq_rel);
+	if (old != NULL) {
+		// wait for all datapath workers to stop using the old fib
+		gr_datapath_sync();
+		vrf_fib_free(old);
+	} else {
+		// lookups now use the dedicated fib, the compact entries are unused
+		compact_flush(vrf_id);
+	}
+
+	return 0;
+}
+
+static int compact_add_cb(void *priv, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx) {
+	uint16_t vrf_id = (uintptr_t)priv;
+	return compact_add(vrf_id, ip, prefixlen, nh_idx);
+}
+
+// Move all routes of a VRF back into the compact FIB.
+static int vrf_fib_demote(uint16_t vrf_id) {
+	struct vrf_fib *vf = get_fib(vrf_id);
+	int ret;
+
+	if (vf == NULL)
+		return 0;
+	if (vf->n_routes >= IP4_VRF_COMPACT_MAX_ROUTES)
+		return errno_set(E2BIG);
+
+	if ((ret = dedicated_walk(vf, NULL, compact_add_cb, (void *)(uintptr_t)vrf_id)) < 0) {
+		compact_flush(vrf_id);
+		return ret;
+	}
+
+	atomic_store_explicit(&vrf_fibs[vrf_id], NULL, memory_order_release);
+	gr_datapath_sync();
+	vrf_fib_free(vf);
+
+	return 0;
+}
+
 struct nexthop *ip4_route_lookup(uint16_t vrf_id, ip4_addr_t ip) {
-	uint32_t host_order_ip = rte_be_to_cpu_32(ip);
-	struct rte_fib *fib = get_fib(vrf_id);
+	const struct vrf_fib *vf;
+	struct rte_fib6 *fib6;
 	uint64_t nh_idx;
 
-	if (fib == NULL)
-		return NULL;
+	if (vrf_id >= IP4_MAX_VRFS)
+		return errno_set_null(EOVERFLOW);
 
-	rte_fib_lookup_bulk(fib, &host_order_ip, &nh_idx, 1);
-	if (nh_idx == BLACKHOLE)
-		return errno_set_null(EHOSTUNREACH);
+	vf = atomic_load_explicit(&vrf_fibs[vrf_id], memory_order_acquire);
+	if (likely(vf != NULL)) {
+		if (is_trie(vf)) {
+			uint8_t key[1][RTE_FIB6_IPV6_ADDR_SIZE];
+			trie_key(key[0], ip);
+			rte_fib6_lookup_bulk(vf->fib6, key, &nh_idx, 1);
+		} else {
+			uint32_t host_order_ip = rte_be_to_cpu_32(ip);
+			rte_fib_lookup_bulk(vf->fib, &host_order_ip, &nh_idx, 1);
+		}
+		if (nh_idx == vf->blackhole)
+			return errno_set_null(EHOSTUNREACH);
+	} else {
+		uint8_t key[1][RTE_FIB6_IPV6_ADDR_SIZE];
+		fib6 = atomic_load_explicit(&compact_fib, memory_order_acquire);
+		if (fib6 == NULL)
+			return errno_set_null(ENONET);
+		compact_key(key[0], vrf_id, ip);
+		rte_fib6_lookup_bulk(fib6, key, &nh_idx, 1);
+		if (nh_idx == COMPACT_BLACKHOLE)
+			return errno_set_null(EHOSTUNREACH);
+	}
 
 	return ip4_nexthop_get(nh_idx);
 }
 
+#define LOOKUP_BULK_CHUNK 64
+
+void ip4_route_lookup_bulk(
+	uint16_t vrf_id,
+	const ip4_addr_t *ips,
+	struct nexthop **nhs,
+	unsigned n
+) {
+	uint8_t keys[LOOKUP_BULK_CHUNK][RTE_FIB6_IPV6_ADDR_SIZE];
+	uint32_t host_order_ips[LOOKUP_BULK_CHUNK];
+	uint64_t nh_idx[LOOKUP_BULK_CHUNK];
+	const struct vrf_fib *vf = NULL;
+	struct rte_fib6 *fib6 = NULL;
+	uint64_t blackhole;
+
+	if (vrf_id < IP4_MAX_VRFS) {
+		vf = atomic_load_explicit(&vrf_fibs[vrf_id], memory_order_acquire);
+		if (vf == NULL)
+			fib6 = atomic_load_explicit(&compact_fib, memory_order_acquire);
+	}
+	if (vf == NULL && fib6 == NULL) {
+		memset(nhs, 0, n * sizeof(*nhs));
+		return;
+	}
+	blackhole = vf != NULL ? vf->blackhole : COMPACT_BLACKHOLE;
+
+	for (unsigned i = 0; i < n; i += LOOKUP_BULK_CHUNK) {
+		unsigned count = RTE_MIN(n - i, (unsigned)LOOKUP_BULK_CHUNK);
+
+		if (vf != NULL && is_trie(vf)) {
+			for (unsigned j = 0; j < count; j++)
+				trie_key(keys[j], ips[i + j]);
+			rte_fib6_lookup_bulk(vf->fib6, keys, nh_idx, count);
+		} else if (vf != NULL) {
+			for (unsigned j = 0; j < count; j++)
+				host_order_ips[j] = rte_be_to_cpu_32(ips[i + j]);
+			rte_fib_lookup_bulk(vf->fib, host_order_ips, nh_idx, count);
+		} else {
+			for (unsigned j = 0; j < count; j++)
+				compact_key(keys[j], vrf_id, ips[i + j]);
+			rte_fib6_lookup_bulk(fib6, keys, nh_idx, count);
+		}
+		for (unsigned j = 0; j < count; j++) {
+			if (nh_idx[j] == blackhole)
+				nhs[i + j] = NULL;
+			else
+				nhs[i + j] = ip4_nexthop_get(nh_idx[j]);
+		}
+	}
+}
+
 struct nexthop *ip4_route_lookup_exact(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen) {
-	uint32_t host_order_ip = rte_be_to_cpu_32(ip);
-	struct rte_fib *fib = get_fib(vrf_id);
-	struct rte_rib_node *rn;
-	struct rte_rib *rib;
+	struct vrf_fib *vf = get_fib(vrf_id);
 	uint64_t nh_idx;
 
-	if (fib == NULL)
-		return NULL;
-
-	rib = rte_fib_get_rib(fib);
-	rn = rte_rib_lookup_exact(rib, host_order_ip, prefixlen);
-	if (rn == NULL)
-		return errno_set_null(ENETUNREACH);
+	if (vf != NULL && is_trie(vf)) {
+		uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE];
+		struct rte_rib6_node *rn;
+
+		trie_key(key, ip);
+		rn = rte_rib6_lookup_exact(rte_fib6_get_rib(vf->fib6), key, prefixlen);
+		if (rn == NULL)
+			return errno_set_null(ENETUNREACH);
+		rte_rib6_get_nh(rn, &nh_idx);
+	} else if (vf != NULL) {
+		struct rte_rib *rib = rte_fib_get_rib(vf->fib);
+		struct rte_rib_node *rn;
+
+		rn = rte_rib_lookup_exact(rib, rte_be_to_cpu_32(ip), prefixlen);
+		if (rn == NULL)
+			return errno_set_null(ENETUNREACH);
+		rte_rib_get_nh(rn, &nh_idx);
+	} else {
+		uint8_t key[RTE_FIB6_IPV6_ADDR_SIZE];
+		struct rte_rib6_node *rn;
+		struct rte_fib6 *fib6;
+
+		if (vrf_id >= IP4_MAX_VRFS)
+			return NULL;
+		if ((fib6 = atomic_load(&compact_fib)) == NULL)
+			return errno_set_null(ENONET);
+
+		compact_key(key, vrf_id, ip);
+		rn = rte_rib6_lookup_exact(
+			rte_fib6_get_rib(fib6), key, COMPACT_VRF_DEPTH + prefixlen
+		);
+		if (rn == NULL)
+			return errno_set_null(ENETUNREACH);
+		rte_rib6_get_nh(rn, &nh_idx);
+	}
 
-	rte_rib_get_nh(rn, &nh_idx);
 	return ip4_nexthop_get(nh_idx);
 }
 
@@ -116,99 +656,180 @@ int ip4_route_insert(
 	uint32_t nh_idx,
 	struct nexthop *nh
 ) {
-	struct rte_fib *fib = get_or_create_fib(vrf_id);
-	uint32_t host_order_ip = rte_be_to_cpu_32(ip);
+	struct vrf_fib *vf;
 	int ret;
 
-	if (fib == NULL)
-		return -errno;
+	if (vrf_id >= IP4_MAX_VRFS)
+		return errno_set(EOVERFLOW);
 
 	if (ip4_route_lookup_exact(vrf_id, ip, prefixlen) != NULL)
 		return errno_set(EEXIST);
 
-	if ((ret = rte_fib_add(fib, host_order_ip, prefixlen, nh_idx)) < 0)
+	vf = get_fib(vrf_id);
+	if (vf != NULL)
+		ret = dedicated_add_cb(vf, ip, prefixlen, nh_idx);
+	else if (compact_n_routes[vrf_id] >= IP4_VRF_COMPACT_MAX_ROUTES)
+		ret = errno_set(ENOSPC);
+	else
+		ret = compact_add(vrf_id, ip, prefixlen, nh_idx);
+
+	if (ret == -ENOSPC && (vf == NULL || vf->promoted)) {
+		// Too many routes for the compact fib or no tbl8 group left in it, promote the VRF
+		// to a small dedicated fib. When that one has no tbl8 group left, grow it to the
+		// default configuration. Explicitly configured fibs are never resized.
+		const struct gr_ip4_fib_conf *conf = &default_fib_conf;
+		if (vf == NULL)
+			conf = &promoted_fib_conf;
+		LOG(INFO,
+		    "vrf %u: promoting to a %s dedicated fib",
+		    vrf_id,
+		    vf == NULL ? "small" : "default");
+		if ((ret = vrf_fib_replace(vrf_id, conf)) < 0)
+			return ret;
+		vf = get_fib(vrf_id);
+		vf->promoted = conf == &promoted_fib_conf;
+		ret = dedicated_add_cb(vf, ip, prefixlen, nh_idx);
+	}
+	if (ret < 0)
 		return ret;
 
 	ip4_nexthop_incref(nh);
+	ip4_flow_cache_invalidate();
 
 	return 0;
 }
 
 int ip4_route_delete(uint16_t vrf_id, ip4_addr_t ip, uint8_t prefixlen) {
-	uint32_t host_order_ip = rte_be_to_cpu_32(ip);
-	struct rte_fib *fib = get_fib(vrf_id);
+	struct vrf_fib *vf = get_fib(vrf_id);
 	struct nexthop *nh;
 	int ret;
 
-	if (fib == NULL)
-		return -errno;
-
 	nh = ip4_route_lookup_exact(vrf_id, ip, prefixlen);
 	if (nh == NULL)
 		return errno_set(ENOENT);
 
-	if ((ret = rte_fib_delete(fib, host_order_ip, prefixlen)) < 0)
-		return errno_set(-ret);
+	if (vf != NULL)
+		ret = dedicated_del(vf, ip, prefixlen);
+	else
+		ret = compact_del(vrf_id, ip, prefixlen);
+	if (ret < 0)
+		return ret;
 
+	ip4_flow_cache_invalidate();
 	ip4_nexthop_decref(nh);
 
 	return 0;
 }
 
-static struct api_out route4_add(const void *request, void **response) {
-	const struct gr_ip4_route_add_req *req = request;
-	struct rte_fib *fib;
-	struct nexthop *nh;
+static int route4_add_one(const struct gr_ip4_route_add_req *req) {
+	struct nexthop *nh, *link;
 	uint32_t nh_idx;
+	bool same;
 	int ret;
 
-	(void)response;
-
 	nh = ip4_route_lookup_exact(req->vrf_id, req->dest.ip, req->dest.prefixlen);
 	if (nh != NULL) {
-		if (req->nh == nh->ip && req->exist_ok)
-			return api_out(0, 0);
-		return api_out(EEXIST, 0);
+		if (nh->flags & GR_IP4_NH_F_GROUP)
+			same = req->group_id == nh->ip;
+		else
+			same = req->group_id == 0 && req->nh == nh->ip;
+		if (same && req->exist_ok)
+			return 0;
+		return errno_set(EEXIST);
 	}
 
-	if (ip4_route_lookup(req->vrf_id, req->nh) == NULL)
-		return api_out(EHOSTUNREACH, 0);
+	if (req->group_id != 0) {
+		if (ip4_nexthop_group_lookup(req->vrf_id, req->group_id, &nh_idx, &nh) < 0)
+			return -errno;
+		return ip4_route_insert(req->vrf_id, req->dest.ip, req->dest.prefixlen, nh_idx, nh);
+	}
 
-	if ((fib = get_or_create_fib(req->vrf_id)) == NULL)
-		return api_out(errno, 0);
+	if ((link = ip4_route_lookup(req->vrf_id, req->nh)) == NULL)
+		return errno_set(EHOSTUNREACH);
 
-	if (ip4_nexthop_lookup(req->vrf_id, req->nh, &nh_idx, &nh) < 0)
-		if (ip4_nexthop_add(req->vrf_id, req->nh, &nh_idx, &nh) < 0)
-			return api_out(errno, 0);
+	ret = ip4_nexthop_lookup_add(req->vrf_id, req->nh, link->iface_id, &nh_idx, &nh);
+	if (ret < 0)
+		return ret;
 
-	if ((ret = rte_fib_add(fib, ntohl(req->dest.ip), req->dest.prefixlen, nh_idx)) < 0)
-		return api_out(-ret, 0);
+	ret = ip4_route_insert(req->vrf_id, req->dest.ip, req->dest.prefixlen, nh_idx, nh);
+	if (ret < 0)
+		return ret;
 
-	ip4_nexthop_incref(nh);
 	nh->flags |= GR_IP4_NH_F_GATEWAY;
 
-	return api_out(0, 0);
+	return 0;
 }
 
-static struct api_out route4_del(const void *request, void **response) {
-	const struct gr_ip4_route_del_req *req = request;
+static int route4_del_one(const struct gr_ip4_route_del_req *req) {
 	struct nexthop *nh;
 
-	(void)response;
-
 	if ((nh = ip4_route_lookup_exact(req->vrf_id, req->dest.ip, req->dest.prefixlen)) == NULL) {
 		if (req->missing_ok)
-			return api_out(0, 0);
-		return api_out(ENOENT, 0);
+			return 0;
+		return errno_set(ENOENT);
 	}
 
-	if (!(nh->flags & GR_IP4_NH_F_GATEWAY))
-		return api_out(EBUSY, 0);
+	if (!(nh->flags & (GR_IP4_NH_F_GATEWAY | GR_IP4_NH_F_GROUP)))
+		return errno_set(EBUSY);
+
+	return ip4_route_delete(req->vrf_id, req->dest.ip, req->dest.prefixlen);
+}
+
+static struct api_out route4_add(const void *request, void **response) {
+	(void)response;
+	return api_out(-route4_add_one(request), 0);
+}
+
+static struct api_out route4_del(const void *request, void **response) {
+	(void)response;
+	return api_out(-route4_del_one(request), 0);
+}
+
+static struct gr_ip4_route_bulk_resp *bulk_resp_alloc(uint16_t n, size_t *len) {
+	struct gr_ip4_route_bulk_resp *resp;
+
+	*len = sizeof(*resp) + n * sizeof(resp->status[0]);
+	if ((resp = calloc(1, *len)) == NULL)
+		return errno_set_null(ENOMEM);
+	resp->n_status = n;
+
+	return resp;
+}
+
+static struct api_out route4_add_bulk(const void *request, void **response) {
+	const struct gr_ip4_route_add_bulk_req *req = request;
+	struct gr_ip4_route_bulk_resp *resp;
+	size_t len;
 
-	if (ip4_route_delete(req->vrf_id, req->dest.ip, req->dest.prefixlen) < 0)
+	if (req->n_routes > GR_IP4_ROUTE_BULK_MAX)
+		return api_out(E2BIG, 0);
+	if ((resp = bulk_resp_alloc(req->n_routes, &len)) == NULL)
 		return api_out(errno, 0);
 
-	return api_out(0, 0);
+	for (uint16_t i = 0; i < req->n_routes; i++)
+		resp->status[i] = -route4_add_one(&req->routes[i]);
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static struct api_out route4_del_bulk(const void *request, void **response) {
+	const struct gr_ip4_route_del_bulk_req *req = request;
+	struct gr_ip4_route_bulk_resp *resp;
+	size_t len;
+
+	if (req->n_routes > GR_IP4_ROUTE_BULK_MAX)
+		return api_out(E2BIG, 0);
+	if ((resp = bulk_resp_alloc(req->n_routes, &len)) == NULL)
+		return api_out(errno, 0);
+
+	for (uint16_t i = 0; i < req->n_routes; i++)
+		resp->status[i] = -route4_del_one(&req->routes[i]);
+
+	*response = resp;
+
+	return api_out(0, len);
 }
 
 static struct api_out route4_get(const void *request, void **response) {
@@ -233,129 +854,219 @@ static struct api_out route4_get(const void *request, void **response) {
 	return api_out(0, sizeof(*resp));
 }
 
+struct route_list_ctx {
+	struct gr_ip4_route_list_resp *resp;
+	uint32_t max_routes;
+};
+
+static int route_list_cb(void *priv, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx) {
+	struct route_list_ctx *ctx = priv;
+	const struct nexthop *nh = ip4_nexthop_get(nh_idx);
+	struct gr_ip4_route *r;
+
+	if (ctx->resp->n_routes == ctx->max_routes) {
+		// chunk is full, the next one resumes after the last returned route
+		if (ctx->resp->n_routes > 0)
+			ctx->resp->next = ctx->resp->routes[ctx->resp->n_routes - 1].dest;
+		return errno_set(ENOBUFS);
+	}
+
+	r = &ctx->resp->routes[ctx->resp->n_routes++];
+	r->dest.ip = ip;
+	r->dest.prefixlen = prefixlen;
+	if (nh->flags & GR_IP4_NH_F_GROUP)
+		r->group_id = nh->ip;
+	else
+		r->nh = nh->ip;
+
+	return 0;
+}
+
 static struct api_out route4_list(const void *request, void **response) {
 	const struct gr_ip4_route_list_req *req = request;
-	struct gr_ip4_route_list_resp *resp = NULL;
-	struct rte_fib *fib = get_fib(req->vrf_id);
-	struct rte_rib_node *rn = NULL;
-	struct gr_ip4_route *r;
-	struct rte_rib *rib;
-	struct nexthop *nh;
-	size_t num, len;
-	uint64_t nh_idx;
-	uint32_t ip;
+	const struct ip4_net *after = NULL;
+	struct route_list_ctx ctx;
+	size_t len;
+	int ret;
 
-	(void)request;
+	if (req->vrf_id >= IP4_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
 
-	if (fib == NULL)
-		return api_out(errno, 0);
+	// The cursor is the last route of the previous chunk. The default route is always
+	// walked last, a zero cursor means the first chunk.
+	if (req->cursor.ip != 0 || req->cursor.prefixlen != 0)
+		after = &req->cursor;
+
+	ctx.max_routes = RTE_MIN(
+		vrf_routes_count(req->vrf_id), GR_API_LIST_MAX(struct gr_ip4_route)
+	);
+	len = sizeof(*ctx.resp) + ctx.max_routes * sizeof(struct gr_ip4_route);
+	if ((ctx.resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
 
-	rib = rte_fib_get_rib(fib);
+	ret = vrf_routes_walk(req->vrf_id, after, route_list_cb, &ctx);
+	if (ret < 0 && ret != -ENOBUFS) {
+		free(ctx.resp);
+		return api_out(-ret, 0);
+	}
 
-	num = 0;
-	while ((rn = rte_rib_get_nxt(rib, 0, 0, rn, RTE_RIB_GET_NXT_ALL)) != NULL)
-		num++;
-	// FIXME: remove this when rte_rib_get_nxt returns a default route, if any is configured
-	if (rte_rib_lookup_exact(rib, 0, 0) != NULL)
-		num++;
+	*response = ctx.resp;
+
+	return api_out(0, sizeof(*ctx.resp) + ctx.resp->n_routes * sizeof(struct gr_ip4_route));
+}
+
+static struct api_out vrf4_set(const void *request, void **response) {
+	const struct gr_ip4_vrf_set_req *req = request;
+	struct gr_ip4_fib_conf conf;
+	const struct vrf_fib *vf;
+	int ret;
+
+	(void)response;
 
-	len = sizeof(*resp) + num * sizeof(struct gr_ip4_route);
+	if (req->vrf_id >= IP4_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+
+	// merge the requested attributes with the current configuration
+	vf = atomic_load(&vrf_fibs[req->vrf_id]);
+	conf = vf != NULL ? vf->conf : default_fib_conf;
+	if (req->set_attrs & GR_IP4_VRF_SET_TYPE)
+		conf.type = req->fib.type;
+	if (req->set_attrs & GR_IP4_VRF_SET_NH_SIZE)
+		conf.nh_size = req->fib.nh_size;
+	if (req->set_attrs & GR_IP4_VRF_SET_NUM_TBL8)
+		conf.num_tbl8 = req->fib.num_tbl8;
+	else if (req->set_attrs & GR_IP4_VRF_SET_MAX_ROUTES)
+		conf.num_tbl8 = 0; // scale with the new max_routes
+	if (req->set_attrs & GR_IP4_VRF_SET_MAX_ROUTES)
+		conf.max_routes = req->fib.max_routes;
+
+	// All next hop indexes must be below the blackhole value.
+	if (conf.type != GR_IP4_FIB_TYPE_COMPACT && conf.nh_size == 2
+	    && gr_args()->max_nexthops > ip4_fib_blackhole(conf.nh_size))
+		return api_out(ERANGE, 0);
+
+	if (conf.type == GR_IP4_FIB_TYPE_COMPACT)
+		ret = vrf_fib_demote(req->vrf_id);
+	else if (vf != NULL && memcmp(&conf, &vf->conf, sizeof(conf)) == 0)
+		ret = 0;
+	else
+		ret = vrf_fib_replace(req->vrf_id, &conf);
+
+	return api_out(-ret, 0);
+}
+
+static struct api_out vrf4_list(const void *request, void **response) {
+	struct gr_ip4_vrf_list_resp *resp = NULL;
+	const struct vrf_fib *vf;
+	struct gr_ip4_vrf *vrf;
+	uint16_t num = 0;
+	size_t len;
+
+	(void)request;
+
+	for (uint16_t vrf_id = 0; vrf_id < IP4_MAX_VRFS; vrf_id++) {
+		if (atomic_load(&vrf_fibs[vrf_id]) != NULL || compact_n_routes[vrf_id] > 0)
+			num++;
+	}
+
+	len = sizeof(*resp) + num * sizeof(struct gr_ip4_vrf);
 	if ((resp = calloc(1, len)) == NULL)
 		return api_out(ENOMEM, 0);
 
-	while ((rn = rte_rib_get_nxt(rib, 0, 0, rn, RTE_RIB_GET_NXT_ALL)) != NULL) {
-		r = &resp->routes[resp->n_routes++];
-		rte_rib_get_nh(rn, &nh_idx);
-		nh = ip4_nexthop_get(nh_idx);
-		rte_rib_get_ip(rn, &ip);
-		rte_rib_get_depth(rn, &r->dest.prefixlen);
-		r->dest.ip = htonl(ip);
-		r->nh = nh->ip;
-	}
-	// FIXME: remove this when rte_rib_get_nxt returns a default route, if any is configured
-	if ((rn = rte_rib_lookup_exact(rib, 0, 0)) != NULL) {
-		r = &resp->routes[resp->n_routes++];
-		rte_rib_get_nh(rn, &nh_idx);
-		nh = ip4_nexthop_get(nh_idx);
-		r->dest.ip = 0;
-		r->dest.prefixlen = 0;
-		r->nh = nh->ip;
+	for (uint16_t vrf_id = 0; vrf_id < IP4_MAX_VRFS; vrf_id++) {
+		if ((vf = atomic_load(&vrf_fibs[vrf_id])) != NULL) {
+			vrf = &resp->vrfs[resp->n_vrfs++];
+			vrf->vrf_id = vrf_id;
+			vrf->fib = vf->conf;
+			vrf->n_routes = vf->n_routes;
+		} else if (compact_n_routes[vrf_id] > 0) {
+			vrf = &resp->vrfs[resp->n_vrfs++];
+			vrf->vrf_id = vrf_id;
+			vrf->fib.type = GR_IP4_FIB_TYPE_COMPACT;
+			vrf->fib.nh_size = 4;
+			vrf->fib.num_tbl8 = ip4_vrf_compact_num_tbl8(gr_args()->max_routes);
+			vrf->fib.max_routes = IP4_VRF_COMPACT_MAX_ROUTES;
+			vrf->n_routes = compact_n_routes[vrf_id];
+		}
 	}
+
 	*response = resp;
 
 	return api_out(0, len);
 }
 
 static void route4_init(struct event_base *) {
-	vrf_fibs = rte_calloc(
-		__func__, IP4_MAX_VRFS, sizeof(struct rte_fib *), RTE_CACHE_LINE_SIZE
-	);
+	default_fib_conf.max_routes = gr_args()->max_routes;
+	promoted_fib_conf.max_routes = gr_args()->max_routes;
+	if (gr_args()->max_nexthops <= ip4_fib_blackhole(2))
+		promoted_fib_conf.nh_size = 2;
+	else
+		promoted_fib_conf.nh_size = 4;
+	vrf_fibs = rte_calloc(__func__, IP4_MAX_VRFS, sizeof(*vrf_fibs), RTE_CACHE_LINE_SIZE);
 	if (vrf_fibs == NULL)
 		ABORT("rte_calloc(vrf_fibs): %s", rte_strerror(rte_errno));
+	compact_n_routes = rte_calloc(
+		__func__, IP4_MAX_VRFS, sizeof(*compact_n_routes), RTE_CACHE_LINE_SIZE
+	);
+	if (compact_n_routes == NULL)
+		ABORT("rte_calloc(compact_n_routes): %s", rte_strerror(rte_errno));
 }
 
 static void route4_fini(struct event_base *) {
 	for (uint16_t vrf_id = 0; vrf_id < IP4_MAX_VRFS; vrf_id++) {
-		rte_fib_free(vrf_fibs[vrf_id]);
+		vrf_fib_free(vrf_fibs[vrf_id]);
 		vrf_fibs[vrf_id] = NULL;
 	}
 	rte_free(vrf_fibs);
 	vrf_fibs = NULL;
+	rte_fib6_free(compact_fib);
+	compact_fib = NULL;
+	rte_free(compact_n_routes);
+	compact_n_routes = NULL;
 }
 
-void ip4_route_cleanup(uint16_t vrf_id, struct nexthop *nh) {
-	uint8_t prefixlen, local_prefixlen;
-	struct rte_rib_node *rn = NULL;
-	struct rte_rib *rib;
+struct cleanup_ctx {
 	ip4_addr_t local_ip;
-	uint64_t nh_idx;
-	ip4_addr_t ip;
-
-	local_ip = nh->ip;
-	local_prefixlen = nh->prefixlen;
-
-	rib = rte_fib_get_rib(get_fib(vrf_id));
-	while ((rn = rte_rib_get_nxt(rib, 0, 0, rn, RTE_RIB_GET_NXT_ALL)) != NULL) {
-		rte_rib_get_nh(rn, &nh_idx);
-		nh = ip4_nexthop_get(nh_idx);
-
-		if (nh && ip4_addr_same_subnet(nh->ip, local_ip, local_prefixlen)) {
-			rte_rib_get_ip(rn, &ip);
-			rte_rib_get_depth(rn, &prefixlen);
-			ip = rte_cpu_to_be_32(ip);
-
-			LOG(DEBUG,
-			    "delete " IP4_ADDR_FMT "/%d via " IP4_ADDR_FMT,
-			    IP4_ADDR_SPLIT(&ip),
-			    prefixlen,
-			    IP4_ADDR_SPLIT(&nh->ip));
-
-			ip4_route_delete(vrf_id, ip, prefixlen);
-			ip4_route_delete(vrf_id, ip, 32);
-		}
-	}
+	uint8_t local_prefixlen;
+	struct route_entry *routes;
+};
 
-	if ((rn = rte_rib_lookup_exact(rib, 0, 0)) != NULL || true) {
-		rte_rib_get_nh(rn, &nh_idx);
-		nh = ip4_nexthop_get(nh_idx);
+static int cleanup_cb(void *priv, ip4_addr_t ip, uint8_t prefixlen, uint64_t nh_idx) {
+	struct cleanup_ctx *ctx = priv;
+	const struct nexthop *nh = ip4_nexthop_get(nh_idx);
+	struct route_entry r = {.ip = ip, .prefixlen = prefixlen, .nh_idx = nh_idx};
 
-		if (nh && ip4_addr_same_subnet(nh->ip, local_ip, local_prefixlen)) {
-			rte_rib_get_ip(rn, &ip);
-			rte_rib_get_depth(rn, &prefixlen);
-			ip = rte_cpu_to_be_32(ip);
+	if (nh && !(nh->flags & GR_IP4_NH_F_GROUP)
+	    && ip4_addr_same_subnet(nh->ip, ctx->local_ip, ctx->local_prefixlen))
+		arrpush(ctx->routes, r);
 
-			LOG(DEBUG,
-			    "delete " IP4_ADDR_FMT "/%d via " IP4_ADDR_FMT,
-			    IP4_ADDR_SPLIT(&ip),
-			    prefixlen,
-			    IP4_ADDR_SPLIT(&nh->ip));
+	return 0;
+}
 
-			ip4_route_delete(vrf_id, nh->ip, nh->prefixlen);
-			ip4_route_delete(vrf_id, nh->ip, 32);
-		}
+void ip4_route_cleanup(uint16_t vrf_id, struct nexthop *nh) {
+	struct cleanup_ctx ctx = {
+		.local_ip = nh->ip,
+		.local_prefixlen = nh->prefixlen,
+		.routes = NULL,
+	};
+	struct route_entry *r;
+
+	// collect first, routes cannot be deleted while walking the rib
+	vrf_routes_walk(vrf_id, NULL, cleanup_cb, &ctx);
+
+	arrforeach (r, ctx.routes) {
+		nh = ip4_nexthop_get(r->nh_idx);
+		LOG(DEBUG,
+		    "delete " IP4_ADDR_FMT "/%d via " IP4_ADDR_FMT,
+		    IP4_ADDR_SPLIT(&r->ip),
+		    r->prefixlen,
+		    IP4_ADDR_SPLIT(&nh->ip));
+		ip4_route_delete(vrf_id, r->ip, r->prefixlen);
 	}
+	arrfree(ctx.routes);
 
-	ip4_route_delete(vrf_id, local_ip, 32);
+	ip4_route_delete(vrf_id, ctx.local_ip, 32);
+	ip4_nexthop_cleanup(vrf_id, ctx.local_ip, ctx.local_prefixlen);
 }
 
 static struct gr_api_handler route4_add_handler = {
@@ -368,6 +1079,16 @@ static struct gr_api_handler route4_del_handler = {
 	.request_type = GR_IP4_ROUTE_DEL,
 	.callback = route4_del,
 };
+static struct gr_api_handler route4_add_bulk_handler = {
+	.name = "ipv4 route add bulk",
+	.request_type = GR_IP4_ROUTE_ADD_BULK,
+	.callback = route4_add_bulk,
+};
+static struct gr_api_handler route4_del_bulk_handler = {
+	.name = "ipv4 route del bulk",
+	.request_type = GR_IP4_ROUTE_DEL_BULK,
+	.callback = route4_del_bulk,
+};
 static struct gr_api_handler route4_get_handler = {
 	.name = "ipv4 route get",
 	.request_type = GR_IP4_ROUTE_GET,
@@ -379,6 +1100,17 @@ static struct gr_api_handler route4_list_handler = {
 	.callback = route4_list,
 };
 
+static struct gr_api_handler vrf4_set_handler = {
+	.name = "ipv4 vrf set",
+	.request_type = GR_IP4_VRF_SET,
+	.callback = vrf4_set,
+};
+static struct gr_api_handler vrf4_list_handler = {
+	.name = "ipv4 vrf list",
+	.request_type = GR_IP4_VRF_LIST,
+	.callback = vrf4_list,
+};
+
 static struct gr_module route4_module = {
 	.name = "ipv4 route",
 	.init = route4_init,
@@ -389,7 +1121,11 @@ static struct gr_module route4_module = {
 RTE_INIT(control_ip_init) {
 	gr_register_api_handler(&route4_add_handler);
 	gr_register_api_handler(&route4_del_handler);
+	gr_register_api_handler(&route4_add_bulk_handler);
+	gr_register_api_handler(&route4_del_bulk_handler);
 	gr_register_api_handler(&route4_get_handler);
 	gr_register_api_handler(&route4_list_handler);
+	gr_register_api_handler(&vrf4_set_handler);
+	gr_register_api_handler(&vrf4_list_handler);
 	gr_register_module(&route4_module);
 }
@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+// Capacity planning benchmark. Loads a synthetic IPv4 table into the default VRF through the
+// same code paths as the API handlers and reports the memory footprint of the FIB and of the
+// next hop table as well as the lookup rate on a single core.
+//
+// Usage: route_bench [NUM_ROUTES [NUM_NEXTHOPS]]
+
+#include "nexthop_priv.h"
+
+#include <gr.h>
+#include <gr_control.h>
+#include <gr_control_output.h>
+#include <gr_iface.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_worker.h>
+
+#include <event2/event.h>
+#include <rte_byteorder.h>
+#include <rte_cycles.h>
+#include <rte_eal.h>
+#include <rte_errno.h>
+#include <rte_graph.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_ROUTES (1 << 20)
+#define DEFAULT_NEXTHOPS (1 << 16)
+#define LOOKUP_ADDRS (1 << 20)
+#define LOOKUP_PASSES 32
+
+// mocked types/functions
+int gr_rte_log_type;
+static struct gr_args args;
+static struct gr_api_handler *handlers[32];
+static unsigned n_handlers;
+static struct gr_module *modules[8];
+static unsigned n_modules;
+
+const struct gr_args *gr_args(void) {
+	return &args;
+}
+void gr_register_api_handler(struct gr_api_handler *h) {
+	if (n_handlers < RTE_DIM(handlers))
+		handlers[n_handlers++] = h;
+}
+void gr_register_module(struct gr_module *m) {
+	if (n_modules < RTE_DIM(modules))
+		modules[n_modules++] = m;
+}
+struct rte_rcu_qsbr *gr_datapath_rcu(void) {
+	return NULL;
+}
+struct iface *iface_from_id(uint16_t) {
+	return NULL;
+}
+void ip4_flow_cache_invalidate(void) { }
+int post_to_control(control_output_cb_t, void *) {
+	return 0;
+}
+int arp_output_request_solicit(struct nexthop *) {
+	return 0;
+}
+int arp_input_flush_held(struct nexthop *) {
+	return 0;
+}
+
+static int api_call(uint32_t request_type, const void *request) {
+	void *response = NULL;
+	struct api_out out;
+
+	for (unsigned i = 0; i < n_handlers; i++) {
+		if (handlers[i]->request_type != request_type)
+			continue;
+		out = handlers[i]->callback(request, &response);
+		free(response);
+		return -out.status;
+	}
+
+	return -ENOTSUP;
+}
+
+static size_t heap_used(void) {
+	struct rte_malloc_socket_stats stats;
+	size_t total = 0;
+
+	for (unsigned i = 0; i < rte_socket_count(); i++) {
+		if (rte_malloc_get_socket_stats(rte_socket_id_by_idx(i), &stats) == 0)
+			total += stats.heap_allocsz_bytes;
+	}
+
+	return total;
+}
+
+// Rough approximation of the prefix length distribution of a full Internet table.
+static uint8_t random_depth(void) {
+	uint64_t r = rte_rand_max(100);
+	if (r < 55)
+		return 24;
+	if (r < 90)
+		return 16 + rte_rand_max(8);
+	if (r < 97)
+		return 8 + rte_rand_max(8);
+	return 25 + rte_rand_max(8);
+}
+
+static double elapsed(uint64_t start) {
+	return (double)(rte_rdtsc() - start) / rte_get_tsc_hz();
+}
+
+int main(int argc, char **argv) {
+	char *eal_args[] = {
+		argv[0],
+		"--no-shconf",
+		"--no-huge",
+		"--no-pci",
+		"-m",
+		"4096",
+		"--log-level=*:warning",
+	};
+	uint32_t num_routes = DEFAULT_ROUTES, num_nexthops = DEFAULT_NEXTHOPS;
+	struct gr_ip4_vrf_set_req vrf_req = {
+		.vrf_id = 0,
+		.set_attrs = GR_IP4_VRF_SET_TYPE,
+		.fib = {.type = GR_IP4_FIB_TYPE_DIR24_8},
+	};
+	size_t mem_start, mem_nh, mem_fib;
+	struct event_base *ev_base;
+	uint64_t start, lookups;
+	uint32_t *nh_ids, n, i;
+	struct nexthop **nhs;
+	struct nexthop *nh;
+	ip4_addr_t *addrs;
+	double t;
+	int ret;
+
+	if (argc > 1)
+		num_routes = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		num_nexthops = strtoul(argv[2], NULL, 0);
+	if (num_routes == 0 || num_nexthops == 0) {
+		fprintf(stderr, "usage: %s [NUM_ROUTES [NUM_NEXTHOPS]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (rte_eal_init(RTE_DIM(eal_args), eal_args) < 0) {
+		fprintf(stderr, "rte_eal_init: %s\n", rte_strerror(rte_errno));
+		return EXIT_FAILURE;
+	}
+	if ((ev_base = event_base_new()) == NULL) {
+		fprintf(stderr, "event_base_new failed\n");
+		return EXIT_FAILURE;
+	}
+	rte_srand(42);
+	mem_start = heap_used();
+
+	// next hops, size the tables like the command line arguments would
+	args.max_routes = num_routes;
+	args.max_nexthops = num_nexthops;
+	for (i = 0; i < n_modules; i++)
+		modules[i]->init(ev_base);
+	if ((nh_ids = calloc(num_nexthops, sizeof(*nh_ids))) == NULL) {
+		fprintf(stderr, "calloc(nh_ids) failed\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < num_nexthops; i++) {
+		ret = ip4_nexthop_add(0, rte_cpu_to_be_32(0x0a000000 + i), &nh_ids[i], &nh);
+		if (ret < 0) {
+			fprintf(stderr, "ip4_nexthop_add: %s\n", rte_strerror(-ret));
+			return EXIT_FAILURE;
+		}
+	}
+	mem_nh = heap_used();
+
+	// routes, in a dedicated FIB configured like the default VRF FIB
+	if ((ret = api_call(GR_IP4_VRF_SET, &vrf_req)) < 0) {
+		fprintf(stderr, "vrf set: %s\n", rte_strerror(-ret));
+		return EXIT_FAILURE;
+	}
+	start = rte_rdtsc();
+	n = 0;
+	while (n < num_routes) {
+		uint8_t depth = random_depth();
+		uint32_t ip = (uint32_t)rte_rand() & (UINT32_MAX << (32 - depth));
+		uint32_t idx = nh_ids[rte_rand_max(num_nexthops)];
+		nh = ip4_nexthop_get(idx);
+		ret = ip4_route_insert(0, rte_cpu_to_be_32(ip), depth, idx, nh);
+		if (ret == -EEXIST)
+			continue;
+		if (ret < 0) {
+			fprintf(stderr, "ip4_route_insert: %s\n", rte_strerror(-ret));
+			return EXIT_FAILURE;
+		}
+		n++;
+	}
+	t = elapsed(start);
+	mem_fib = heap_used();
+
+	printf("routes:           %u\n", num_routes);
+	printf("next hops:        %u\n", num_nexthops);
+	printf("insert rate:      %.0f routes/s\n", num_routes / t);
+	printf("next hops memory: %.1f MiB (%zu bytes per next hop, %zu bytes hash key)\n",
+	       (mem_nh - mem_start) / 1048576.0,
+	       (mem_nh - mem_start) / num_nexthops,
+	       sizeof(struct nexthop_key));
+	printf("fib memory:       %.1f MiB (%zu bytes per route)\n",
+	       (mem_fib - mem_nh) / 1048576.0,
+	       (mem_fib - mem_nh) / num_routes);
+
+	// lookups, in bursts as done by the ip_input node
+	addrs = rte_malloc(NULL, LOOKUP_ADDRS * sizeof(*addrs), 0);
+	nhs = rte_malloc(NULL, RTE_GRAPH_BURST_SIZE * sizeof(*nhs), 0);
+	if (addrs == NULL || nhs == NULL) {
+		fprintf(stderr, "rte_malloc failed\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < LOOKUP_ADDRS; i++)
+		addrs[i] = (ip4_addr_t)rte_rand();
+
+	start = rte_rdtsc();
+	lookups = 0;
+	for (unsigned pass = 0; pass < LOOKUP_PASSES; pass++) {
+		for (i = 0; i < LOOKUP_ADDRS; i += RTE_GRAPH_BURST_SIZE) {
+			ip4_route_lookup_bulk(0, &addrs[i], nhs, RTE_GRAPH_BURST_SIZE);
+			lookups += RTE_GRAPH_BURST_SIZE;
+		}
+	}
+	t = elapsed(start);
+
+	printf("lookup rate:      %.2f Mlookups/s (%.1f cycles per lookup)\n",
+	       lookups / t / 1e6,
+	       (double)(t * rte_get_tsc_hz()) / lookups);
+
+	rte_free(nhs);
+	rte_free(addrs);
+	free(nh_ids);
+	for (i = 0; i < n_modules; i++)
+		modules[i]->fini(ev_base);
+	event_base_free(ev_base);
+	rte_eal_cleanup();
+
+	return EXIT_SUCCESS;
+}
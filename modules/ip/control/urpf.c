@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip4.h>
+#include <gr_ip4_datapath.h>
+
+#include <rte_common.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+static struct api_out urpf_set(const void *request, void **response) {
+	const struct gr_ip4_urpf_set_req *req = request;
+
+	(void)response;
+
+	if (iface_from_id(req->urpf.iface_id) == NULL)
+		return api_out(errno, 0);
+
+	switch (req->urpf.mode) {
+	case GR_IP4_URPF_OFF:
+	case GR_IP4_URPF_STRICT:
+	case GR_IP4_URPF_LOOSE:
+		break;
+	default:
+		return api_out(EINVAL, 0);
+	}
+
+	ip_input_urpf_set(req->urpf.iface_id, req->urpf.mode);
+
+	return api_out(0, 0);
+}
+
+static struct api_out urpf_list(const void *request, void **response) {
+	struct gr_ip4_urpf_list_resp *resp;
+	struct iface *iface = NULL;
+	uint16_t n = 0;
+	size_t len;
+
+	(void)request;
+
+	while ((iface = iface_next(GR_IFACE_TYPE_UNDEF, iface)) != NULL) {
+		if (ip_input_urpf_get(iface->id) != GR_IP4_URPF_OFF)
+			n++;
+	}
+
+	len = sizeof(*resp) + n * sizeof(struct gr_ip4_urpf);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	while ((iface = iface_next(GR_IFACE_TYPE_UNDEF, iface)) != NULL) {
+		uint8_t mode = ip_input_urpf_get(iface->id);
+		if (mode == GR_IP4_URPF_OFF || resp->n_urpfs == n)
+			continue;
+		resp->urpfs[resp->n_urpfs].iface_id = iface->id;
+		resp->urpfs[resp->n_urpfs].mode = mode;
+		resp->n_urpfs++;
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_urpfs * sizeof(struct gr_ip4_urpf));
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	if (event == IFACE_EVENT_PRE_REMOVE)
+		ip_input_urpf_set(iface->id, GR_IP4_URPF_OFF);
+}
+
+static struct gr_api_handler urpf_set_handler = {
+	.name = "ipv4 urpf set",
+	.request_type = GR_IP4_URPF_SET,
+	.callback = urpf_set,
+};
+static struct gr_api_handler urpf_list_handler = {
+	.name = "ipv4 urpf list",
+	.request_type = GR_IP4_URPF_LIST,
+	.callback = urpf_list,
+};
+
+static struct iface_event_handler iface_event_urpf_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(urpf_constructor) {
+	gr_register_api_handler(&urpf_set_handler);
+	gr_register_api_handler(&urpf_list_handler);
+	iface_event_register_handler(&iface_event_urpf_handler);
+}
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2024 Robin Jarry
 
+#include "copp_priv.h"
+
+#include <gr_control_input.h>
 #include <gr_eth_input.h>
 #include <gr_graph.h>
 #include <gr_ip4_control.h>
@@ -10,8 +13,11 @@
 
 #include <rte_arp.h>
 #include <rte_byteorder.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
 #include <rte_ether.h>
 #include <rte_graph_worker.h>
+#include <rte_malloc.h>
 
 enum {
 	OP_REQUEST = 0,
@@ -20,52 +26,37 @@ enum {
 	PROTO_UNSUPP,
 	ERROR,
 	DROP,
-	IP_OUTPUT,
+	COPP_DROP,
 	EDGE_COUNT,
 };
 
-static inline void update_nexthop(
-	struct rte_graph *graph,
-	struct rte_node *node,
-	struct nexthop *nh,
-	uint64_t now,
-	uint16_t iface_id,
-	const struct rte_arp_hdr *arp
-) {
-	struct rte_mbuf *m, *next;
-
-	// Static next hops never need updating.
-	if (nh->flags & GR_IP4_NH_F_STATIC)
-		return;
-
-	rte_spinlock_lock(&nh->lock);
-
-	// Refresh all fields.
-	nh->last_reply = now;
-	nh->iface_id = iface_id;
-	nh->flags |= GR_IP4_NH_F_REACHABLE;
-	nh->flags &= ~(GR_IP4_NH_F_STALE | GR_IP4_NH_F_PENDING | GR_IP4_NH_F_FAILED);
-	nh->ucast_probes = 0;
-	nh->bcast_probes = 0;
-	rte_ether_addr_copy(&arp->arp_data.arp_sha, &nh->lladdr);
-
-	// Flush all held packets.
-	m = nh->held_pkts_head;
-	while (m != NULL) {
-		next = queue_mbuf_data(m)->next;
-		ip_output_mbuf_data(m)->nh = nh;
-		rte_node_enqueue_x1(graph, node, IP_OUTPUT, m);
-		m = next;
+// Neighbor entries are only modified by the control plane. Replies are handed over as is,
+// requests are copied since they must also be answered.
+static inline int learn_nexthop(struct rte_mbuf *mbuf, const struct iface *iface, bool copy) {
+	struct arp_learn_mbuf_data *data;
+	struct rte_mbuf *m = mbuf;
+
+	if (copy) {
+		m = rte_pktmbuf_copy(mbuf, mbuf->pool, 0, sizeof(struct rte_arp_hdr));
+		if (m == NULL)
+			return errno_set(ENOBUFS);
+	}
+	data = arp_learn_mbuf_data(m);
+	data->iface_id = iface->id;
+	data->vrf_id = iface->vrf_id;
+
+	if (ip4_nexthop_learn(m) < 0) {
+		if (copy)
+			rte_pktmbuf_free(m);
+		return -errno;
 	}
-	nh->held_pkts_head = NULL;
-	nh->held_pkts_tail = NULL;
-	nh->held_pkts_num = 0;
 
-	rte_spinlock_unlock(&nh->lock);
+	return 0;
 }
 
 static uint16_t
 arp_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct copp_ctx *ctx = node->ctx_ptr;
 	struct nexthop *remote, *local;
 	struct arp_mbuf_data *arp_data;
 	const struct iface *iface;
@@ -74,9 +65,10 @@ arp_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 	rte_edge_t next;
 	ip4_addr_t sip;
 	uint32_t idx;
-	uint64_t now;
+	uint64_t now, hz;
 
 	now = rte_get_tsc_cycles();
+	hz = rte_get_tsc_hz();
 
 	for (uint16_t i = 0; i < nb_objs; i++) {
 		mbuf = objs[i];
@@ -104,29 +96,34 @@ arp_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 		}
 
 		sip = arp->arp_data.arp_sip;
+		// Police before any neighbor lookup or update is done.
+		if (!copp_allow(ctx, GR_IP4_COPP_ARP, sip, now, hz)) {
+			next = COPP_DROP;
+			goto next;
+		}
 		iface = eth_input_mbuf_data(mbuf)->iface;
 		local = ip4_addr_get_preferred(iface->id, sip);
-		remote = ip4_route_lookup(iface->vrf_id, sip);
-
-		if (remote != NULL && remote->ip == sip) {
-			update_nexthop(graph, node, remote, now, iface->id, arp);
-		} else if (local != NULL && local->ip == arp->arp_data.arp_tip) {
-			// Request/reply to our address but no next hop entry exists.
-			// Create a new next hop and its associated /32 route to allow
-			// faster lookups for next packets.
-			if (ip4_nexthop_add(iface->vrf_id, sip, &idx, &remote) < 0) {
-				next = ERROR;
-				goto next;
+
+		if (ip4_nexthop_lookup(iface->vrf_id, sip, &idx, &remote) == 0) {
+			// Static next hops never need updating.
+			if (!(remote->flags & GR_IP4_NH_F_STATIC)) {
+				if (next == OP_REPLY) {
+					// consumed by the control plane
+					if (learn_nexthop(mbuf, iface, false) == 0)
+						continue;
+					goto next;
+				}
+				learn_nexthop(mbuf, iface, true);
 			}
-			ip4_route_insert(iface->vrf_id, sip, 32, idx, remote);
-			update_nexthop(graph, node, remote, now, iface->id, arp);
-		} else {
+		} else if (local == NULL || local->ip != arp->arp_data.arp_tip) {
+			// Neighbor entries are only created by the control plane. Requests
+			// to our address from unknown neighbors are answered without
+			// learning them.
 			next = DROP;
 			goto next;
 		}
 		arp_data = arp_mbuf_data(mbuf);
 		arp_data->local = local;
-		arp_data->remote = remote;
 next:
 		rte_node_enqueue_x1(graph, node, next, mbuf);
 	}
@@ -134,6 +131,72 @@ next:
 	return nb_objs;
 }
 
+static control_input_t arp_flush;
+
+int arp_input_flush_held(struct nexthop *nh) {
+	int ret;
+	if (nh == NULL)
+		return errno_set(EINVAL);
+	ip4_nexthop_incref(nh);
+	ret = post_to_stack(arp_flush, nh);
+	if (ret < 0) {
+		ip4_nexthop_decref(nh);
+		return errno_set(-ret);
+	}
+	return 0;
+}
+
+enum {
+	FLUSH_IP_OUTPUT = 0,
+	FLUSH_EDGE_COUNT,
+};
+
+static uint16_t arp_input_flush_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	struct rte_mbuf *mbuf, *m, *next;
+	struct nexthop *nh;
+	uint16_t sent = 0;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		nh = control_input_mbuf_data(mbuf)->data;
+
+		m = ip4_nexthop_flush(nh);
+		while (m != NULL) {
+			next = queue_mbuf_data(m)->next;
+			ip_output_mbuf_data(m)->nh = nh;
+			ip_output_mbuf_data(m)->flow = NULL;
+			rte_node_enqueue_x1(graph, node, FLUSH_IP_OUTPUT, m);
+			m = next;
+			sent++;
+		}
+		ip4_nexthop_release(nh);
+
+		// the control message buffer does not hold any packet
+		rte_pktmbuf_free(mbuf);
+	}
+
+	return sent;
+}
+
+static int arp_input_init(const struct rte_graph *, struct rte_node *node) {
+	node->ctx_ptr = rte_zmalloc(__func__, sizeof(struct copp_ctx), RTE_CACHE_LINE_SIZE);
+	if (node->ctx_ptr == NULL) {
+		LOG(ERR, "rte_zmalloc(): %s", rte_strerror(rte_errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void arp_input_fini(const struct rte_graph *, struct rte_node *node) {
+	rte_free(node->ctx_ptr);
+	node->ctx_ptr = NULL;
+}
+
 static void arp_input_register(void) {
 	gr_eth_input_add_type(RTE_BE16(RTE_ETHER_TYPE_ARP), "arp_input");
 }
@@ -142,6 +205,8 @@ static struct rte_node_register node = {
 	.name = "arp_input",
 
 	.process = arp_input_process,
+	.init = arp_input_init,
+	.fini = arp_input_fini,
 
 	.nb_edges = EDGE_COUNT,
 	.next_nodes = {
@@ -151,7 +216,7 @@ static struct rte_node_register node = {
 		[PROTO_UNSUPP] = "arp_input_proto_unsupp",
 		[ERROR] = "arp_input_error",
 		[DROP] = "arp_input_drop",
-		[IP_OUTPUT] = "ip_output",
+		[COPP_DROP] = "copp_arp_drop",
 	},
 };
 
@@ -162,8 +227,29 @@ static struct gr_node_info info = {
 
 GR_NODE_REGISTER(info);
 
+static void arp_input_flush_register(void) {
+	arp_flush = gr_control_input_register_handler("arp_input_flush");
+}
+
+static struct rte_node_register flush_node = {
+	.name = "arp_input_flush",
+	.process = arp_input_flush_process,
+	.nb_edges = FLUSH_EDGE_COUNT,
+	.next_nodes = {
+		[FLUSH_IP_OUTPUT] = "ip_output",
+	},
+};
+
+static struct gr_node_info flush_info = {
+	.node = &flush_node,
+	.register_callback = arp_input_flush_register,
+};
+
+GR_NODE_REGISTER(flush_info);
+
 GR_DROP_REGISTER(arp_input_reply);
 GR_DROP_REGISTER(arp_input_op_unsupp);
 GR_DROP_REGISTER(arp_input_proto_unsupp);
 GR_DROP_REGISTER(arp_input_error);
 GR_DROP_REGISTER(arp_input_drop);
+GR_DROP_REGISTER(copp_arp_drop);
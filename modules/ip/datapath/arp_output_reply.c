@@ -39,7 +39,7 @@ static uint16_t arp_output_reply_process(
 	for (uint16_t i = 0; i < nb_objs; i++) {
 		mbuf = objs[i];
 		arp_data = arp_mbuf_data(mbuf);
-		if (arp_data->local == NULL || arp_data->remote == NULL) {
+		if (arp_data->local == NULL) {
 			// mbuf is not an ARP request
 			next = ERROR;
 			goto next;
@@ -50,17 +50,18 @@ static uint16_t arp_output_reply_process(
 			next = ERROR;
 			goto next;
 		}
-		// Reuse mbuf to craft an ARP reply.
+		// Reuse mbuf to craft an ARP reply. The requester may not be in the neighbor
+		// table, answer to the addresses found in the request.
 		arp = rte_pktmbuf_mtod(mbuf, struct rte_arp_hdr *);
 		arp->arp_hardware = RTE_BE16(RTE_ARP_HRD_ETHER);
 		arp->arp_protocol = RTE_BE16(RTE_ETHER_TYPE_IPV4);
 		arp->arp_opcode = RTE_BE16(RTE_ARP_OP_REPLY);
-		rte_ether_addr_copy(&arp_data->remote->lladdr, &arp->arp_data.arp_tha);
+		rte_ether_addr_copy(&arp->arp_data.arp_sha, &arp->arp_data.arp_tha);
 		if (iface_get_eth_addr(iface->id, &arp->arp_data.arp_sha) < 0) {
 			next = ERROR;
 			goto next;
 		}
-		arp->arp_data.arp_tip = arp_data->remote->ip;
+		arp->arp_data.arp_tip = arp->arp_data.arp_sip;
 		arp->arp_data.arp_sip = arp_data->local->ip;
 
 		// Prepare ethernet layer info.
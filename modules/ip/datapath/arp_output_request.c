@@ -52,9 +52,7 @@ static uint16_t arp_output_request_process(
 	struct rte_mbuf *mbuf;
 	rte_edge_t next;
 	uint16_t sent;
-	uint64_t now;
 
-	now = rte_get_tsc_cycles();
 	sent = 0;
 
 	for (unsigned i = 0; i < n_objs; i++) {
@@ -86,21 +84,18 @@ static uint16_t arp_output_request_process(
 
 		// Prepare ethernet layer info.
 		eth_data = eth_output_mbuf_data(mbuf);
-		if (nh->ucast_probes < IP4_NH_UCAST_PROBES) {
+		// the control plane counts broadcast probes after the unicast ones failed
+		if (nh->bcast_probes == 0)
 			rte_ether_addr_copy(&arp->arp_data.arp_tha, &eth_data->dst);
-			nh->ucast_probes++;
-		} else {
+		else
 			memset(&eth_data->dst, 0xff, sizeof(eth_data->dst));
-			nh->bcast_probes++;
-		}
-		nh->last_request = now;
 		eth_data->ether_type = RTE_BE16(RTE_ETHER_TYPE_ARP);
 		eth_data->iface = iface_from_id(nh->iface_id);
 
-		ip4_nexthop_decref(nh);
 		next = OUTPUT;
 		sent++;
 next:
+		ip4_nexthop_release(nh);
 		rte_node_enqueue_x1(graph, node, next, mbuf);
 	}
 
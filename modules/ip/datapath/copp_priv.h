@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _COPP_PRIV_H
+#define _COPP_PRIV_H
+
+#include <gr_ip4.h>
+#include <gr_ip4_control.h>
+#include <gr_net_types.h>
+#include <gr_token_bucket.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of source prefixes tracked for each class by each node instance. Must be a power
+// of 2.
+#define COPP_SRC_BUCKETS 256
+
+struct copp_class {
+	struct gr_token_bucket global;
+	struct gr_token_bucket_src src[COPP_SRC_BUCKETS];
+};
+
+// Each graph has its own instance of every node, the buckets are never shared between
+// workers and do not need any locking.
+struct copp_ctx {
+	struct copp_class classes[GR_IP4_COPP_CLASS_COUNT];
+};
+
+// Returns false if a locally delivered packet exceeds the limits of its class.
+static inline bool
+copp_allow(struct copp_ctx *ctx, uint8_t class, ip4_addr_t src, uint64_t now, uint64_t hz) {
+	const struct gr_ip4_copp_conf *conf = ip4_copp_conf();
+	const struct gr_ip4_copp_limit *limit = &conf->limits[class];
+	struct copp_class *c = &ctx->classes[class];
+	ip4_addr_t prefix;
+	bool allowed;
+
+	prefix = src & htonl((uint32_t)(UINT64_MAX << (32 - conf->src_prefixlen)));
+	allowed = gr_token_bucket_src_take(
+		c->src, COPP_SRC_BUCKETS, prefix, limit->src_rate, limit->src_burst, now, hz
+	);
+	if (!allowed)
+		return false;
+
+	return gr_token_bucket_take_conf(&c->global, limit->rate, limit->burst, now, hz);
+}
+
+#endif
@@ -11,18 +11,51 @@
 
 #include <rte_byteorder.h>
 #include <rte_graph_worker.h>
+#include <rte_hash.h>
 #include <rte_ip.h>
 
 #include <stdint.h>
 
+struct ip4_flow_key {
+	ip4_addr_t src;
+	ip4_addr_t dst;
+	uint32_t ports; // Zero if not TCP/UDP or not the first fragment.
+	uint16_t vrf_id;
+	uint8_t proto;
+};
+
+// Forwarding decision of a flow, cached by each worker.
+struct ip4_flow {
+	struct ip4_flow_key key;
+	// Zero until resolved by ip_output. See ip4_flow_cache_generation().
+	uint32_t gen;
+	uint32_t pending_gen;
+	// Packet which will resolve the flow in ip_output. Other packets leave it alone.
+	const struct rte_mbuf *pending;
+	struct nexthop *nh;
+	const struct iface *iface;
+};
+
 GR_MBUF_PRIV_DATA_TYPE(ip_output_mbuf_data, {
 	struct nexthop *nh;
 	const struct iface *input_iface;
+	// Flow cache entry to fill with the forwarding decision, NULL if none. Nodes sending
+	// packets to ip_output which did not come from ip_input must clear it.
+	struct ip4_flow *flow;
 });
 
-GR_MBUF_PRIV_DATA_TYPE(arp_mbuf_data, {
-	struct nexthop *local;
-	struct nexthop *remote;
+// Packets addressed to a virtual service, see ip_input_add_vip_lookup().
+GR_MBUF_PRIV_DATA_TYPE(ip_vip_mbuf_data, {
+	const struct iface *input_iface;
+	const void *vip;
+});
+
+GR_MBUF_PRIV_DATA_TYPE(arp_mbuf_data, { struct nexthop *local; });
+
+// ARP packets posted to the control plane to refresh a neighbor entry.
+GR_MBUF_PRIV_DATA_TYPE(arp_learn_mbuf_data, {
+	uint16_t iface_id;
+	uint16_t vrf_id;
 });
 
 GR_MBUF_PRIV_DATA_TYPE(ip_local_mbuf_data, {
@@ -35,7 +68,127 @@ GR_MBUF_PRIV_DATA_TYPE(ip_local_mbuf_data, {
 
 void ip_input_local_add_proto(uint8_t proto, const char *next_node);
 void ip_output_add_tunnel(uint16_t iface_type_id, const char *next_node);
+// Local packets to this UDP port are sent to next_node without their UDP header. They are
+// policed in the GR_IP4_COPP_TUNNEL class.
+void udp_input_add_tunnel(rte_be16_t dst_port, const char *next_node);
+bool udp_input_is_tunnel(rte_be16_t dst_port);
+
+// Ingress hooks see the packets received on interfaces which enabled them, after ip_input has
+// resolved the next hop and filled ip_output_mbuf_data. They are called in this order. Several
+// hooks may be enabled on the same interface, each hook node must hand the packets it accepts
+// over with ip_input_hook_next() instead of sending them to ip_forward or ip_input_local.
+typedef enum {
+	IP_INPUT_HOOK_NAT,
+	IP_INPUT_HOOK_CONNTRACK,
+	IP_INPUT_HOOK_ACL,
+	IP_INPUT_HOOK_COUNT,
+} ip_input_hook_t;
+
+// Egress hooks see the packets sent on interfaces which enabled them, after ip_output has
+// filled eth_output_mbuf_data. They are called in this order.
+typedef enum {
+	IP_OUTPUT_HOOK_ACL,
+	IP_OUTPUT_HOOK_NAT,
+	IP_OUTPUT_HOOK_COUNT,
+} ip_output_hook_t;
+
+void ip_input_add_hook(ip_input_hook_t, const char *next_node);
+void ip_output_add_hook(ip_output_hook_t, const char *next_node);
+// Must be called from the control plane.
+void ip_input_hook_enable(uint16_t iface_id, ip_input_hook_t, bool enabled);
+void ip_output_hook_enable(uint16_t iface_id, ip_output_hook_t, bool enabled);
+// Edge from a hook node to the next enabled hook. After the last one, ingress packets go to
+// ip_forward or ip_input_local and egress packets go to eth_output.
+rte_edge_t ip_input_hook_next(ip_input_hook_t, struct rte_mbuf *);
+rte_edge_t ip_output_hook_next(ip_output_hook_t, struct rte_mbuf *);
+// Virtual services are matched by ip_input before the flow cache and route lookups, only in
+// the VRFs which enabled them. The lookup function returns the virtual service of a packet or
+// NULL. Matching packets are sent to next_node with ip_vip_mbuf_data filled and do not go
+// through the ingress hooks.
+typedef const void *(*ip_input_vip_lookup_t)(uint16_t vrf_id, const struct rte_ipv4_hdr *);
+void ip_input_add_vip_lookup(ip_input_vip_lookup_t, const char *next_node);
+// Must be called from the control plane.
+void ip_input_vip_enable(uint16_t vrf_id, bool enabled);
+// Reverse path check of the packets received on an interface (GR_IP4_URPF_*).
+// Must be called from the control plane.
+void ip_input_urpf_set(uint16_t iface_id, uint8_t mode);
+uint8_t ip_input_urpf_get(uint16_t iface_id);
+
+// Next hop towards the remote endpoint of a tunnel interface, resolved by a worker.
+struct ip4_encap_nh {
+	struct nexthop *nh;
+	uint32_t gen; // ip4_flow_cache_generation() when resolved
+};
+
+// Init and fini callbacks of the tunnel output nodes. Each worker has its own array of struct
+// ip4_encap_nh indexed by interface ID in node->ctx_ptr.
+int ip4_encap_nh_init(const struct rte_graph *, struct rte_node *);
+void ip4_encap_nh_fini(const struct rte_graph *, struct rte_node *);
+
+// Next hop towards the remote endpoint of a tunnel. Route changes bump the generation, resolved
+// next hops are updated in place.
+static inline struct nexthop *ip4_encap_nh_get(
+	struct rte_node *node,
+	const struct iface *iface,
+	ip4_addr_t remote,
+	uint32_t gen
+) {
+	struct ip4_encap_nh *encap = &((struct ip4_encap_nh *)node->ctx_ptr)[iface->id];
+
+	if (unlikely(encap->gen != gen || encap->nh == NULL)) {
+		encap->nh = ip4_route_lookup(iface->vrf_id, remote);
+		encap->gen = gen;
+	}
+
+	return encap->nh;
+}
+
+// Look up at most RTE_HASH_LOOKUP_BULK_MAX tunnels at once in a hash of interfaces indexed by
+// tunnel keys. Interfaces of unknown tunnels are set to NULL.
+void ip4_tunnel_get_iface_bulk(
+	const struct rte_hash *,
+	const void **keys,
+	unsigned n,
+	struct iface **ifaces
+);
+
 int arp_output_request_solicit(struct nexthop *nh);
+// Send the packets held by a next hop to ip_output from a datapath worker.
+int arp_input_flush_held(struct nexthop *nh);
+// Ask the control plane to resolve the destination of a packet routed via a connected route.
+int ip4_nexthop_resolve(struct rte_mbuf *);
+// Ask the control plane to refresh a neighbor entry from a received ARP packet. The mbuf must
+// start with the ARP header and have arp_learn_mbuf_data filled.
+int ip4_nexthop_learn(struct rte_mbuf *);
+// Ask the control plane to start probing a next hop.
+int ip4_nexthop_solicit(struct nexthop *);
+// Ask the control plane to release a reference held by a worker. Reference counts are only
+// modified by the control plane.
+void ip4_nexthop_release(struct nexthop *);
+
+typedef enum {
+	IP4_NH_OK_TO_SEND,
+	IP4_NH_HELD,
+	IP4_NH_HOLD_QUEUE_FULL,
+	IP4_NH_FAILED,
+} ip4_nh_hold_status_t;
+
+// Store a packet in the next hop hold queue until it becomes reachable. This is lock-free and
+// may be called from any thread.
+ip4_nh_hold_status_t ip4_nexthop_hold(struct nexthop *, struct rte_mbuf *);
+// Take all held packets in the order they were queued. New packets will not be held until the
+// next hop needs to be resolved again.
+struct rte_mbuf *ip4_nexthop_flush(struct nexthop *);
+
+// Decrement the TTL of a forwarded packet and update the checksum incrementally.
+static inline void ip_decrement_ttl(struct rte_ipv4_hdr *ip) {
+	rte_be32_t csum;
+
+	ip->time_to_live -= 1;
+	csum = ip->hdr_checksum + RTE_BE16(0x0100);
+	csum += csum >= 0xffff;
+	ip->hdr_checksum = csum;
+}
 
 #define IPV4_VERSION_IHL 0x45
 #define IPV4_DEFAULT_TTL 64
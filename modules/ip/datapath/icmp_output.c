@@ -44,6 +44,7 @@ icmp_output_process(struct rte_graph *graph, struct rte_node *node, void **objs,
 		ip_output_mbuf_data(mbuf)->nh = ip4_route_lookup(
 			local_data->vrf_id, local_data->dst
 		);
+		ip_output_mbuf_data(mbuf)->flow = NULL;
 		rte_node_enqueue_x1(graph, node, OUTPUT, mbuf);
 	}
 
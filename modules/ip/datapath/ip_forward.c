@@ -2,6 +2,7 @@
 // Copyright (c) 2024 Robin Jarry
 
 #include <gr_graph.h>
+#include <gr_ip4_datapath.h>
 
 #include <rte_fib.h>
 #include <rte_graph_worker.h>
@@ -18,7 +19,6 @@ static uint16_t
 ip_forward_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
 	struct rte_ipv4_hdr *ip;
 	struct rte_mbuf *mbuf;
-	rte_be32_t csum;
 	uint16_t i;
 
 	for (i = 0; i < nb_objs; i++) {
@@ -29,10 +29,7 @@ ip_forward_process(struct rte_graph *graph, struct rte_node *node, void **objs,
 			rte_node_enqueue_x1(graph, node, TTL_EXCEEDED, mbuf);
 			continue;
 		}
-		ip->time_to_live -= 1;
-		csum = ip->hdr_checksum + RTE_BE16(0x0100);
-		csum += csum >= 0xffff;
-		ip->hdr_checksum = csum;
+		ip_decrement_ttl(ip);
 		rte_node_enqueue_x1(graph, node, OUTPUT, mbuf);
 	}
 
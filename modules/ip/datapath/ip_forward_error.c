@@ -7,40 +7,84 @@
 #include <gr_ip4_datapath.h>
 #include <gr_log.h>
 #include <gr_mbuf.h>
+#include <gr_token_bucket.h>
 
 #include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
 #include <rte_graph_worker.h>
 #include <rte_icmp.h>
 #include <rte_ip.h>
+#include <rte_malloc.h>
 
 enum edges {
 	ICMP_OUTPUT = 0,
 	NO_HEADROOM,
 	NO_IP,
+	RATE_LIMITED,
+	SRC_RATE_LIMITED,
 	EDGE_COUNT,
 };
 
+// Number of source prefixes tracked by each node instance. Must be a power of 2.
+#define SRC_BUCKETS 1024
+
+// Each graph has its own instance of every node, the buckets are never shared between
+// workers and do not need any locking. Every ICMP error type also gets its own budget.
+struct error_ctx {
+	uint8_t icmp_type;
+	struct gr_token_bucket global;
+	struct gr_token_bucket_src src[SRC_BUCKETS];
+};
+
+static inline rte_edge_t
+error_rate_limit(struct error_ctx *ctx, ip4_addr_t src, uint64_t now, uint64_t hz) {
+	const struct gr_ip4_icmp_error_conf *conf = ip4_icmp_error_conf();
+	ip4_addr_t prefix;
+	bool allowed;
+
+	prefix = src & htonl((uint32_t)(UINT64_MAX << (32 - conf->src_prefixlen)));
+	allowed = gr_token_bucket_src_take(
+		ctx->src, SRC_BUCKETS, prefix, conf->src_rate, conf->src_burst, now, hz
+	);
+	if (!allowed)
+		return SRC_RATE_LIMITED;
+	if (!gr_token_bucket_take_conf(&ctx->global, conf->rate, conf->burst, now, hz))
+		return RATE_LIMITED;
+
+	return ICMP_OUTPUT;
+}
+
 static uint16_t ip_forward_error_process(
 	struct rte_graph *graph,
 	struct rte_node *node,
 	void **objs,
 	uint16_t nb_objs
 ) {
+	struct error_ctx *ctx = node->ctx_ptr;
 	struct ip_local_mbuf_data *ip_data;
 	const struct iface *input_iface;
 	struct rte_icmp_hdr *icmp;
 	struct rte_ipv4_hdr *ip;
 	struct rte_mbuf *mbuf;
 	struct nexthop *nh;
-	uint8_t icmp_type;
 	uint16_t vrf_id;
+	rte_edge_t edge;
+	uint64_t now, hz;
 
-	icmp_type = node->ctx[0];
+	now = rte_get_tsc_cycles();
+	hz = rte_get_tsc_hz();
 
 	for (uint16_t i = 0; i < nb_objs; i++) {
 		mbuf = objs[i];
 
 		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
+		edge = error_rate_limit(ctx, ip->src_addr, now, hz);
+		if (edge != ICMP_OUTPUT) {
+			rte_node_enqueue_x1(graph, node, edge, mbuf);
+			continue;
+		}
+
 		icmp = (struct rte_icmp_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*icmp));
 		if (unlikely(icmp == NULL)) {
 			rte_node_enqueue_x1(graph, node, NO_HEADROOM, mbuf);
@@ -65,7 +109,7 @@ static uint16_t ip_forward_error_process(
 		ip_data->len = sizeof(*icmp) + rte_ipv4_hdr_len(ip) + 8;
 		ip_data->proto = IPPROTO_ICMP;
 
-		icmp->icmp_type = icmp_type;
+		icmp->icmp_type = ctx->icmp_type;
 		icmp->icmp_code = 0; // time to live exceeded in transit
 		icmp->icmp_cksum = 0;
 		icmp->icmp_ident = 0;
@@ -77,14 +121,33 @@ static uint16_t ip_forward_error_process(
 	return nb_objs;
 }
 
-static int ttl_exceeded_init(const struct rte_graph *, struct rte_node *node) {
-	node->ctx[0] = GR_IP_ICMP_TTL_EXCEEDED;
+static int error_init(struct rte_node *node, uint8_t icmp_type) {
+	const struct gr_ip4_icmp_error_conf *conf = ip4_icmp_error_conf();
+	struct error_ctx *ctx;
+
+	ctx = rte_zmalloc(__func__, sizeof(*ctx), RTE_CACHE_LINE_SIZE);
+	if (ctx == NULL) {
+		LOG(ERR, "rte_zmalloc(): %s", rte_strerror(rte_errno));
+		return -1;
+	}
+	ctx->icmp_type = icmp_type;
+	gr_token_bucket_init(&ctx->global, conf->rate, conf->burst, rte_get_tsc_cycles());
+	node->ctx_ptr = ctx;
+
 	return 0;
 }
 
+static int ttl_exceeded_init(const struct rte_graph *, struct rte_node *node) {
+	return error_init(node, GR_IP_ICMP_TTL_EXCEEDED);
+}
+
 static int no_route_init(const struct rte_graph *, struct rte_node *node) {
-	node->ctx[0] = GR_IP_ICMP_DEST_UNREACHABLE;
-	return 0;
+	return error_init(node, GR_IP_ICMP_DEST_UNREACHABLE);
+}
+
+static void error_fini(const struct rte_graph *, struct rte_node *node) {
+	rte_free(node->ctx_ptr);
+	node->ctx_ptr = NULL;
 }
 
 struct rte_node_register ip_forward_ttl_exceeded_node = {
@@ -95,8 +158,11 @@ struct rte_node_register ip_forward_ttl_exceeded_node = {
 		[ICMP_OUTPUT] = "icmp_output",
 		[NO_HEADROOM] = "error_no_headroom",
 		[NO_IP] = "error_no_local_ip",
+		[RATE_LIMITED] = "icmp_error_rate_limited",
+		[SRC_RATE_LIMITED] = "icmp_error_src_rate_limited",
 	},
 	.init = ttl_exceeded_init,
+	.fini = error_fini,
 };
 
 static struct rte_node_register no_route_node = {
@@ -107,8 +173,11 @@ static struct rte_node_register no_route_node = {
 		[ICMP_OUTPUT] = "icmp_output",
 		[NO_HEADROOM] = "error_no_headroom",
 		[NO_IP] = "error_no_local_ip",
+		[RATE_LIMITED] = "icmp_error_rate_limited",
+		[SRC_RATE_LIMITED] = "icmp_error_src_rate_limited",
 	},
 	.init = no_route_init,
+	.fini = error_fini,
 };
 
 static struct gr_node_info info_ttl_exceeded = {
@@ -123,3 +192,5 @@ GR_NODE_REGISTER(info_ttl_exceeded);
 GR_NODE_REGISTER(info_no_route);
 
 GR_DROP_REGISTER(error_no_local_ip);
+GR_DROP_REGISTER(icmp_error_rate_limited);
+GR_DROP_REGISTER(icmp_error_src_rate_limited);
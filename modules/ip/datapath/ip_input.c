@@ -1,103 +1,397 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2024 Robin Jarry
 
+#include "ip_input_priv.h"
+
 #include <gr_eth_input.h>
+#include <gr_eth_output.h>
 #include <gr_graph.h>
 #include <gr_ip4_control.h>
 #include <gr_ip4_datapath.h>
 #include <gr_log.h>
 
+#include <rte_bitops.h>
 #include <rte_byteorder.h>
 #include <rte_errno.h>
 #include <rte_ether.h>
 #include <rte_fib.h>
 #include <rte_graph_worker.h>
 #include <rte_ip.h>
+#include <rte_jhash.h>
+#include <rte_malloc.h>
 #include <rte_mbuf.h>
 #include <rte_mbuf_dyn.h>
 
+#include <assert.h>
+#include <netinet/in.h>
+
 enum edges {
 	FORWARD = 0,
 	LOCAL,
 	NO_ROUTE,
 	BAD_CHECKSUM,
 	BAD_LENGTH,
+	BAD_VERSION,
+	FLOW_HIT,
+	RPF_FAILED,
 	EDGE_COUNT,
 };
 
+// Edges of ip_input (last row) and of each hook node towards the other hooks and towards
+// ip_forward and ip_input_local (last columns).
+#define HOOK_FORWARD IP_INPUT_HOOK_COUNT
+#define HOOK_LOCAL (IP_INPUT_HOOK_COUNT + 1)
+static const char *hook_nodes[IP_INPUT_HOOK_COUNT];
+static rte_edge_t hook_edges[IP_INPUT_HOOK_COUNT + 1][IP_INPUT_HOOK_COUNT + 2];
+// Bit mask of the hooks enabled on each interface.
+static uint8_t iface_hooks[MAX_IFACES];
+
+static_assert(IP_INPUT_HOOK_COUNT <= 8);
+
+// Reverse path check mode of each interface.
+static uint8_t iface_urpf[MAX_IFACES];
+
+// Virtual services lookup and the VRFs which have virtual services.
+static ip_input_vip_lookup_t vip_lookup;
+static rte_edge_t vip_edge;
+static bool vrf_vips[IP4_MAX_VRFS];
+
+// Number of source addresses looked up at once by urpf_lookup().
+#define URPF_BATCH 32
+
+void ip_input_add_hook(ip_input_hook_t hook, const char *next_node) {
+	LOG(DEBUG, "ip_input: hook=%u -> %s", hook, next_node);
+	if (hook >= IP_INPUT_HOOK_COUNT)
+		ABORT("invalid hook=%u", hook);
+	if (hook_nodes[hook] != NULL)
+		ABORT("next node already registered for hook=%u", hook);
+
+	hook_nodes[hook] = next_node;
+	hook_edges[IP_INPUT_HOOK_COUNT][hook] = gr_node_attach_parent("ip_input", next_node);
+	hook_edges[hook][HOOK_FORWARD] = gr_node_attach_parent(next_node, "ip_forward");
+	hook_edges[hook][HOOK_LOCAL] = gr_node_attach_parent(next_node, "ip_input_local");
+	for (unsigned h = 0; h < IP_INPUT_HOOK_COUNT; h++) {
+		if (hook_nodes[h] == NULL || h == hook)
+			continue;
+		if (h < hook)
+			hook_edges[h][hook] = gr_node_attach_parent(hook_nodes[h], next_node);
+		else
+			hook_edges[hook][h] = gr_node_attach_parent(next_node, hook_nodes[h]);
+	}
+}
+
+void ip_input_hook_enable(uint16_t iface_id, ip_input_hook_t hook, bool enabled) {
+	if (iface_id >= ARRAY_DIM(iface_hooks) || hook >= IP_INPUT_HOOK_COUNT)
+		return;
+	if (enabled && hook_nodes[hook] != NULL)
+		iface_hooks[iface_id] |= 1 << hook;
+	else
+		iface_hooks[iface_id] &= ~(1 << hook);
+	ip4_flow_cache_invalidate();
+}
+
+void ip_input_add_vip_lookup(ip_input_vip_lookup_t lookup, const char *next_node) {
+	LOG(DEBUG, "ip_input: vip -> %s", next_node);
+	if (vip_lookup != NULL)
+		ABORT("vip lookup already registered");
+
+	vip_lookup = lookup;
+	vip_edge = gr_node_attach_parent("ip_input", next_node);
+}
+
+void ip_input_vip_enable(uint16_t vrf_id, bool enabled) {
+	if (vrf_id >= ARRAY_DIM(vrf_vips))
+		return;
+	vrf_vips[vrf_id] = enabled && vip_lookup != NULL;
+}
+
+void ip_input_urpf_set(uint16_t iface_id, uint8_t mode) {
+	if (iface_id >= ARRAY_DIM(iface_urpf))
+		return;
+	iface_urpf[iface_id] = mode;
+	ip4_flow_cache_invalidate();
+}
+
+uint8_t ip_input_urpf_get(uint16_t iface_id) {
+	if (iface_id >= ARRAY_DIM(iface_urpf))
+		return GR_IP4_URPF_OFF;
+	return iface_urpf[iface_id];
+}
+
+rte_edge_t ip_input_hook_next(ip_input_hook_t hook, struct rte_mbuf *mbuf) {
+	const struct ip_output_mbuf_data *d = ip_output_mbuf_data(mbuf);
+	const struct rte_ipv4_hdr *ip;
+	uint8_t next;
+
+	// Hooks may have been disabled since the packet was diverted.
+	next = iface_hooks[d->input_iface->id] & ~((2 << hook) - 1);
+	if (next != 0)
+		return hook_edges[hook][rte_ctz32(next)];
+
+	// Same decision as ip_input. Hooks may have changed the destination and next hop.
+	ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
+	if (d->nh->flags & GR_IP4_NH_F_LOCAL && ip->dst_addr == d->nh->ip)
+		return hook_edges[hook][HOOK_LOCAL];
+
+	return hook_edges[hook][HOOK_FORWARD];
+}
+
+static inline struct ip4_flow *flow_lookup(
+	struct ip4_flow *flows,
+	struct ip4_flow_key *key,
+	const struct rte_ipv4_hdr *ip,
+	uint16_t vrf_id
+) {
+	const rte_be16_t frag_mask = RTE_BE16(RTE_IPV4_HDR_MF_FLAG | RTE_IPV4_HDR_OFFSET_MASK);
+	uint32_t hash;
+
+	key->src = ip->src_addr;
+	key->dst = ip->dst_addr;
+	key->ports = 0;
+	key->vrf_id = vrf_id;
+	key->proto = ip->next_proto_id;
+
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		if (!(ip->fragment_offset & frag_mask)) {
+			const uint8_t *l4 = (const uint8_t *)ip + rte_ipv4_hdr_len(ip);
+			key->ports = *(const unaligned_uint32_t *)l4;
+		}
+		break;
+	}
+
+	hash = rte_jhash_3words(key->src, key->dst, key->ports, (vrf_id << 8) | key->proto);
+
+	return &flows[hash & (IP4_FLOW_CACHE_SIZE - 1)];
+}
+
+static inline bool flow_key_eq(const struct ip4_flow_key *a, const struct ip4_flow_key *b) {
+	return a->src == b->src && a->dst == b->dst && a->ports == b->ports
+		&& a->vrf_id == b->vrf_id && a->proto == b->proto;
+}
+
+// Forward a packet of a known flow directly to eth_output. Returns false if the packet must go
+// through the regular route and neighbor lookups.
+static inline bool flow_forward(
+	const struct ip4_flow *flow,
+	const struct ip4_flow_key *key,
+	uint32_t gen,
+	struct rte_mbuf *mbuf,
+	struct rte_ipv4_hdr *ip
+) {
+	struct eth_output_mbuf_data *eth_data;
+	const struct nexthop *nh = flow->nh;
+
+	if (flow->gen != gen || !flow_key_eq(&flow->key, key))
+		return false;
+	// ip_forward sends the ICMP error.
+	if (ip->time_to_live <= 1)
+		return false;
+	// Same check as ip4_nexthop_hold(). Neighbors may move to another interface.
+	if (!(nh->flags & GR_IP4_NH_F_REACHABLE) || nh->iface_id != flow->iface->id)
+		return false;
+
+	ip_decrement_ttl(ip);
+	eth_data = eth_output_mbuf_data(mbuf);
+	rte_ether_addr_copy(&nh->lladdr, &eth_data->dst);
+	eth_data->ether_type = RTE_BE16(RTE_ETHER_TYPE_IPV4);
+	eth_data->iface = flow->iface;
+
+	return true;
+}
+
+// Resolve the routes towards the source addresses of the packets received on interfaces with
+// reverse path checks enabled. Consecutive packets from the same VRF are looked up in bulk.
+//
+// The mode of each packet is stored in modes so that the check uses the same mode as the
+// lookup, even if it is changed by the control plane in the meantime.
+static inline void
+urpf_lookup(void *const *objs, unsigned n, uint8_t *modes, struct nexthop **nhs) {
+	struct nexthop *run_nhs[URPF_BATCH];
+	ip4_addr_t srcs[URPF_BATCH];
+	uint8_t idx[URPF_BATCH];
+	const struct iface *iface;
+	uint16_t vrf_id = 0;
+	unsigned count = 0;
+
+	for (unsigned i = 0; i < n; i++) {
+		const struct rte_mbuf *mbuf = objs[i];
+
+		iface = eth_input_mbuf_data(mbuf)->iface;
+		modes[i] = iface_urpf[iface->id];
+		nhs[i] = NULL;
+		if (modes[i] == GR_IP4_URPF_OFF)
+			continue;
+		if (count > 0 && iface->vrf_id != vrf_id) {
+			ip4_route_lookup_bulk(vrf_id, srcs, run_nhs, count);
+			for (unsigned j = 0; j < count; j++)
+				nhs[idx[j]] = run_nhs[j];
+			count = 0;
+		}
+		vrf_id = iface->vrf_id;
+		srcs[count] = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *)->src_addr;
+		idx[count++] = i;
+	}
+	if (count > 0) {
+		ip4_route_lookup_bulk(vrf_id, srcs, run_nhs, count);
+		for (unsigned j = 0; j < count; j++)
+			nhs[idx[j]] = run_nhs[j];
+	}
+}
+
+// RFC 3704: strict mode requires the best route to the source to use the input interface, loose
+// mode only requires a route to exist. All members of ECMP routes are accepted.
+static inline bool urpf_check(uint8_t mode, const struct nexthop *nh, const struct iface *iface) {
+	const struct nh_group *group;
+
+	if (nh == NULL)
+		return false;
+	if (mode == GR_IP4_URPF_LOOSE)
+		return true;
+	if (!(nh->flags & GR_IP4_NH_F_GROUP))
+		return nh->iface_id == iface->id;
+
+	group = atomic_load_explicit(&nh->group, memory_order_acquire);
+	if (group == NULL)
+		return false;
+	for (uint16_t m = 0; m < group->n_members; m++) {
+		if (group->members[m]->iface_id == iface->id)
+			return true;
+	}
+
+	return false;
+}
+
 static uint16_t
 ip_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	uint16_t n_vec = RTE_ALIGN_FLOOR(nb_objs, CKSUM_LANES);
+	ip_input_hdr_status_t hdr_status[CKSUM_LANES];
+	struct ip4_flow *flows = node->ctx_ptr;
+	struct nexthop *rpf_nhs[URPF_BATCH];
+	uint8_t rpf_modes[URPF_BATCH];
+	struct ip4_flow_key key;
 	const struct iface *iface;
 	struct rte_ipv4_hdr *ip;
+	const void *vip;
+	struct ip4_flow *flow;
 	struct rte_mbuf *mbuf;
 	struct nexthop *nh;
+	uint32_t gen = 0;
 	rte_edge_t next;
 	uint16_t i;
 
+	if (ip4_flow_cache_conf()->enabled)
+		gen = ip4_flow_cache_generation();
+
 	for (i = 0; i < nb_objs; i++) {
 		iface = NULL;
+		flow = NULL;
 		nh = NULL;
 		mbuf = objs[i];
 		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
 
-		// RFC 1812 section 5.2.2 IP Header Validation
-		//
-		// (1) The packet length reported by the Link Layer must be large
-		//     enough to hold the minimum length legal IP datagram (20 bytes).
-		// XXX: already checked by hardware
-
-		// (2) The IP checksum must be correct.
-		switch (mbuf->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK) {
-		case RTE_MBUF_F_RX_IP_CKSUM_NONE:
-		case RTE_MBUF_F_RX_IP_CKSUM_UNKNOWN:
-			// if this is not checked in H/W, check it.
-			if (rte_ipv4_cksum(ip)) {
-				next = BAD_CHECKSUM;
-				goto next_packet;
-			}
+		// Headers are validated CKSUM_LANES at a time, the remaining ones one by one.
+		if (i >= n_vec)
+			hdr_status[i % CKSUM_LANES] = ip_input_check(mbuf);
+		else if (i % CKSUM_LANES == 0)
+			ip_input_check_x4(&objs[i], hdr_status);
+		if (i % URPF_BATCH == 0)
+			urpf_lookup(&objs[i], RTE_MIN(nb_objs - i, URPF_BATCH), rpf_modes, rpf_nhs);
+
+		switch (hdr_status[i % CKSUM_LANES]) {
+		case IP_INPUT_HDR_OK:
 			break;
-		case RTE_MBUF_F_RX_IP_CKSUM_BAD:
-			next = BAD_CHECKSUM;
+		case IP_INPUT_HDR_BAD_VERSION:
+			next = BAD_VERSION;
 			goto next_packet;
-		}
-
-		// (3) The IP version number must be 4.  If the version number is not 4
-		//     then the packet may be another version of IP, such as IPng or
-		//     ST-II.
-		// (4) The IP header length field must be large enough to hold the
-		//     minimum length legal IP datagram (20 bytes = 5 words).
-		// XXX: already checked by hardware
-
-		// (5) The IP total length field must be large enough to hold the IP
-		//     datagram header, whose length is specified in the IP header
-		//     length field.
-		if (rte_cpu_to_be_16(ip->total_length) < sizeof(struct rte_ipv4_hdr)) {
+		case IP_INPUT_HDR_BAD_LENGTH:
 			next = BAD_LENGTH;
 			goto next_packet;
+		case IP_INPUT_HDR_BAD_CHECKSUM:
+			next = BAD_CHECKSUM;
+			goto next_packet;
 		}
 
 		iface = eth_input_mbuf_data(mbuf)->iface;
+		// RFC 3704 reverse path check, before any flow cache hit since the flow key does
+		// not include the input interface.
+		if (unlikely(rpf_modes[i % URPF_BATCH] != GR_IP4_URPF_OFF)
+		    && !urpf_check(rpf_modes[i % URPF_BATCH], rpf_nhs[i % URPF_BATCH], iface)) {
+			next = RPF_FAILED;
+			goto next_packet;
+		}
+		// Virtual services take precedence over cached flows and routes.
+		if (unlikely(vrf_vips[iface->vrf_id])) {
+			vip = vip_lookup(iface->vrf_id, ip);
+			if (vip != NULL) {
+				ip_vip_mbuf_data(mbuf)->input_iface = iface;
+				ip_vip_mbuf_data(mbuf)->vip = vip;
+				rte_node_enqueue_x1(graph, node, vip_edge, mbuf);
+				continue;
+			}
+		}
+		if (gen != 0 && iface_hooks[iface->id] == 0) {
+			flow = flow_lookup(flows, &key, ip, iface->vrf_id);
+			if (flow_forward(flow, &key, gen, mbuf, ip)) {
+				rte_node_enqueue_x1(graph, node, FLOW_HIT, mbuf);
+				continue;
+			}
+		}
 		nh = ip4_route_lookup(iface->vrf_id, ip->dst_addr);
 		if (nh == NULL) {
 			next = NO_ROUTE;
+			flow = NULL;
 			goto next_packet;
 		}
 		// If the resolved next hop is local and the destination IP is ourselves,
 		// send to ip_local.
-		if (nh->flags & GR_IP4_NH_F_LOCAL && ip->dst_addr == nh->ip)
+		if (nh->flags & GR_IP4_NH_F_LOCAL && ip->dst_addr == nh->ip) {
 			next = LOCAL;
-		else
+			flow = NULL;
+		} else {
 			next = FORWARD;
+		}
+		if (unlikely(iface_hooks[iface->id] != 0))
+			next = hook_edges[IP_INPUT_HOOK_COUNT][rte_ctz32(iface_hooks[iface->id])];
+		if (flow != NULL) {
+			// Let ip_output store the forwarding decision. This evicts any other
+			// flow using the same slot.
+			flow->key = key;
+			flow->gen = 0;
+			flow->pending_gen = gen;
+			flow->pending = mbuf;
+		}
 		// Store the resolved next hop for ip_output to avoid a second route lookup.
 next_packet:
 		ip_output_mbuf_data(mbuf)->nh = nh;
 		ip_output_mbuf_data(mbuf)->input_iface = iface;
+		ip_output_mbuf_data(mbuf)->flow = flow;
 		rte_node_enqueue_x1(graph, node, next, mbuf);
 	}
 
 	return nb_objs;
 }
 
+static int ip_input_init(const struct rte_graph *graph, struct rte_node *node) {
+	size_t len = IP4_FLOW_CACHE_SIZE * sizeof(struct ip4_flow);
+
+	// Each worker has its own flow cache, allocated even when disabled so that it can be
+	// enabled at runtime.
+	node->ctx_ptr = rte_zmalloc_socket(__func__, len, RTE_CACHE_LINE_SIZE, graph->socket);
+	if (node->ctx_ptr == NULL) {
+		LOG(ERR, "rte_zmalloc_socket(): %s", rte_strerror(rte_errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static void ip_input_fini(const struct rte_graph *, struct rte_node *node) {
+	rte_free(node->ctx_ptr);
+	node->ctx_ptr = NULL;
+}
+
 static void ip_input_register(void) {
 	gr_eth_input_add_type(RTE_BE16(RTE_ETHER_TYPE_IPV4), "ip_input");
 }
@@ -106,6 +400,8 @@ static struct rte_node_register input_node = {
 	.name = "ip_input",
 
 	.process = ip_input_process,
+	.init = ip_input_init,
+	.fini = ip_input_fini,
 
 	.nb_edges = EDGE_COUNT,
 	.next_nodes = {
@@ -114,6 +410,9 @@ static struct rte_node_register input_node = {
 		[NO_ROUTE] = "ip_input_no_route",
 		[BAD_CHECKSUM] = "ip_input_bad_checksum",
 		[BAD_LENGTH] = "ip_input_bad_length",
+		[BAD_VERSION] = "ip_input_bad_version",
+		[FLOW_HIT] = "eth_output",
+		[RPF_FAILED] = "ip_input_rpf_failed",
 	},
 };
 
@@ -126,3 +425,5 @@ GR_NODE_REGISTER(info);
 
 GR_DROP_REGISTER(ip_input_bad_checksum);
 GR_DROP_REGISTER(ip_input_bad_length);
+GR_DROP_REGISTER(ip_input_bad_version);
+GR_DROP_REGISTER(ip_input_rpf_failed);
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _IP_INPUT_PRIV_H
+#define _IP_INPUT_PRIV_H
+
+#include <rte_byteorder.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+#include <netinet/ip.h>
+#include <stdint.h>
+#include <string.h>
+
+// Number of headers validated at once by ip_input_check_x4().
+#define CKSUM_LANES 4
+
+typedef uint64_t u64x4 __attribute__((vector_size(CKSUM_LANES * sizeof(uint64_t))));
+typedef int64_t i64x4 __attribute__((vector_size(CKSUM_LANES * sizeof(int64_t))));
+
+typedef enum {
+	IP_INPUT_HDR_OK,
+	IP_INPUT_HDR_BAD_VERSION,
+	IP_INPUT_HDR_BAD_LENGTH,
+	IP_INPUT_HDR_BAD_CHECKSUM,
+} ip_input_hdr_status_t;
+
+// RFC 1812 section 5.2.2 IP Header Validation
+//
+// (1) The packet length reported by the Link Layer must be large enough to hold the minimum
+//     length legal IP datagram (20 bytes).
+// (2) The IP checksum must be correct.
+// (3) The IP version number must be 4.
+// (4) The IP header length field must be large enough to hold the minimum length legal IP
+//     datagram (20 bytes = 5 words).
+// (5) The IP total length field must be large enough to hold the IP datagram header, whose
+//     length is specified in the IP header length field.
+//
+// The total length must also fit in the received packet and the whole header must be in the
+// first segment. The checksum is only computed when the hardware did not verify it.
+static inline ip_input_hdr_status_t ip_input_check(const struct rte_mbuf *mbuf) {
+	const struct rte_ipv4_hdr *ip;
+	uint16_t hdr_len, total_len;
+
+	if (rte_pktmbuf_data_len(mbuf) < sizeof(*ip))
+		return IP_INPUT_HDR_BAD_LENGTH;
+
+	ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
+	if ((ip->version_ihl >> 4) != IPVERSION)
+		return IP_INPUT_HDR_BAD_VERSION;
+
+	hdr_len = rte_ipv4_hdr_len(ip);
+	total_len = rte_be_to_cpu_16(ip->total_length);
+	if (hdr_len < sizeof(*ip) || hdr_len > rte_pktmbuf_data_len(mbuf) || total_len < hdr_len
+	    || total_len > rte_pktmbuf_pkt_len(mbuf))
+		return IP_INPUT_HDR_BAD_LENGTH;
+
+	switch (mbuf->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK) {
+	case RTE_MBUF_F_RX_IP_CKSUM_NONE:
+	case RTE_MBUF_F_RX_IP_CKSUM_UNKNOWN:
+		if (rte_ipv4_cksum(ip))
+			return IP_INPUT_HDR_BAD_CHECKSUM;
+		break;
+	case RTE_MBUF_F_RX_IP_CKSUM_BAD:
+		return IP_INPUT_HDR_BAD_CHECKSUM;
+	}
+
+	return IP_INPUT_HDR_OK;
+}
+
+// Same checks as ip_input_check() on CKSUM_LANES packets at once. The header words are
+// transposed so that each lane accumulates the one's complement sum of a single header and
+// the length fields of all lanes are compared together. The compiler maps the vector
+// operations to whatever SIMD instructions the target provides.
+//
+// Headers with options are handed over to ip_input_check() which sums the whole header.
+static inline void ip_input_check_x4(void *const *objs, ip_input_hdr_status_t *status) {
+	uint32_t hdr[CKSUM_LANES][sizeof(struct rte_ipv4_hdr) / sizeof(uint32_t)];
+	u64x4 vi = {0}, total_len = {0}, data_len = {0}, pkt_len = {0}, cksum = {0};
+	i64x4 bad_version, bad_length, bad_cksum, sw_cksum, options;
+	const uint64_t min_len = sizeof(struct rte_ipv4_hdr);
+	u64x4 sum = {0}, hdr_len, w;
+
+	for (unsigned l = 0; l < CKSUM_LANES; l++) {
+		const struct rte_mbuf *mbuf = objs[l];
+		const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr *)hdr[l];
+
+		// Mbuf data buffers are much larger than a header, this never reads out of
+		// bounds. Garbage from short packets is rejected by the length checks.
+		memcpy(hdr[l], rte_pktmbuf_mtod(mbuf, const void *), sizeof(hdr[l]));
+		vi[l] = ip->version_ihl;
+		total_len[l] = rte_be_to_cpu_16(ip->total_length);
+		data_len[l] = rte_pktmbuf_data_len(mbuf);
+		pkt_len[l] = rte_pktmbuf_pkt_len(mbuf);
+		cksum[l] = mbuf->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK;
+	}
+	for (unsigned j = 0; j < RTE_DIM(hdr[0]); j++) {
+		for (unsigned l = 0; l < CKSUM_LANES; l++)
+			w[l] = hdr[l][j];
+		sum += w;
+	}
+	// fold the 64-bit sums into 16 bits
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	hdr_len = (vi & 0xf) * 4;
+	bad_version = (vi >> 4) != IPVERSION;
+	bad_length = (data_len < min_len) | (hdr_len < min_len) | (hdr_len > data_len)
+		| (total_len < hdr_len) | (total_len > pkt_len);
+	options = hdr_len > min_len;
+	sw_cksum = (cksum == RTE_MBUF_F_RX_IP_CKSUM_NONE)
+		| (cksum == RTE_MBUF_F_RX_IP_CKSUM_UNKNOWN);
+	bad_cksum = (cksum == RTE_MBUF_F_RX_IP_CKSUM_BAD) | (sw_cksum & (sum != 0xffff));
+
+	for (unsigned l = 0; l < CKSUM_LANES; l++) {
+		if (bad_version[l])
+			status[l] = IP_INPUT_HDR_BAD_VERSION;
+		else if (bad_length[l])
+			status[l] = IP_INPUT_HDR_BAD_LENGTH;
+		else if (options[l])
+			status[l] = ip_input_check(objs[l]);
+		else if (bad_cksum[l])
+			status[l] = IP_INPUT_HDR_BAD_CHECKSUM;
+		else
+			status[l] = IP_INPUT_HDR_OK;
+	}
+}
+
+#endif
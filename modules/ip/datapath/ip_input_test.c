@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "ip_input_priv.h"
+
+#include <gr_cmocka.h>
+
+#include <rte_byteorder.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define BUF_SIZE 128
+#define SW RTE_MBUF_F_RX_IP_CKSUM_NONE
+#define UNKNOWN RTE_MBUF_F_RX_IP_CKSUM_UNKNOWN
+#define GOOD RTE_MBUF_F_RX_IP_CKSUM_GOOD
+#define BAD RTE_MBUF_F_RX_IP_CKSUM_BAD
+#define OK IP_INPUT_HDR_OK
+#define E_VERSION IP_INPUT_HDR_BAD_VERSION
+#define E_LENGTH IP_INPUT_HDR_BAD_LENGTH
+#define E_CKSUM IP_INPUT_HDR_BAD_CHECKSUM
+
+struct hdr_case {
+	const char *name;
+	uint8_t version_ihl;
+	uint16_t total_len;
+	uint16_t data_len;
+	uint16_t pkt_len;
+	uint64_t ol_flags;
+	bool corrupt;
+	ip_input_hdr_status_t expected;
+};
+
+static const struct hdr_case cases[] = {
+	// name, version_ihl, total_len, data_len, pkt_len, ol_flags, corrupt, expected
+	{"good", 0x45, 84, 84, 84, SW, false, OK},
+	{"unknown", 0x45, 84, 84, 84, UNKNOWN, false, OK},
+	{"padded", 0x45, 28, 60, 60, SW, false, OK},
+	{"segmented", 0x45, 1500, 84, 1500, SW, false, OK},
+	{"options", 0x46, 84, 84, 84, SW, false, OK},
+	{"max options", 0x4f, 100, 100, 100, SW, false, OK},
+	{"hw good", 0x45, 84, 84, 84, GOOD, true, OK},
+	{"hw good options", 0x47, 84, 84, 84, GOOD, true, OK},
+	{"hw bad", 0x45, 84, 84, 84, BAD, false, E_CKSUM},
+	{"cksum", 0x45, 84, 84, 84, SW, true, E_CKSUM},
+	{"unknown cksum", 0x45, 84, 84, 84, UNKNOWN, true, E_CKSUM},
+	{"options cksum", 0x46, 84, 84, 84, SW, true, E_CKSUM},
+	{"version 6", 0x65, 84, 84, 84, SW, false, E_VERSION},
+	{"version 0", 0x05, 84, 84, 84, GOOD, false, E_VERSION},
+	{"ihl 4", 0x44, 84, 84, 84, SW, false, E_LENGTH},
+	{"ihl 0", 0x40, 84, 84, 84, GOOD, false, E_LENGTH},
+	{"total < 20", 0x45, 19, 84, 84, SW, false, E_LENGTH},
+	{"total < ihl", 0x46, 22, 84, 84, SW, false, E_LENGTH},
+	{"total > pkt", 0x45, 85, 84, 84, GOOD, false, E_LENGTH},
+	{"runt", 0x45, 20, 19, 19, SW, false, E_LENGTH},
+	{"split options", 0x4f, 84, 40, 84, SW, false, E_LENGTH},
+};
+
+struct test_pkt {
+	struct rte_mbuf mbuf;
+	uint8_t buf[BUF_SIZE];
+};
+
+static void pkt_init(struct test_pkt *p, const struct hdr_case *c) {
+	struct rte_ipv4_hdr *ip = (struct rte_ipv4_hdr *)p->buf;
+	unsigned hdr_len = (c->version_ihl & 0xf) * 4;
+
+	memset(p, 0, sizeof(*p));
+	p->mbuf.buf_addr = p->buf;
+	p->mbuf.data_off = 0;
+	p->mbuf.data_len = c->data_len;
+	p->mbuf.pkt_len = c->pkt_len;
+	p->mbuf.ol_flags = c->ol_flags;
+
+	// NOP options after the fixed header
+	memset(p->buf + sizeof(*ip), IPOPT_NOP, BUF_SIZE - sizeof(*ip));
+	ip->version_ihl = c->version_ihl;
+	ip->total_length = rte_cpu_to_be_16(c->total_len);
+	ip->packet_id = RTE_BE16(0x1234);
+	ip->time_to_live = 64;
+	ip->next_proto_id = IPPROTO_UDP;
+	ip->src_addr = RTE_BE32(0xc0a80001);
+	ip->dst_addr = RTE_BE32(0xc0a80102);
+	if (hdr_len >= sizeof(*ip))
+		ip->hdr_checksum = rte_ipv4_cksum(ip);
+	if (c->corrupt)
+		ip->hdr_checksum ^= RTE_BE16(0x0100);
+}
+
+static void scalar(void **) {
+	struct test_pkt p;
+
+	for (unsigned i = 0; i < RTE_DIM(cases); i++) {
+		const struct hdr_case *c = &cases[i];
+		pkt_init(&p, c);
+		if (ip_input_check(&p.mbuf) != c->expected)
+			fail_msg("%s: got %d", c->name, ip_input_check(&p.mbuf));
+	}
+}
+
+// Every case in every lane, the other lanes hold valid headers.
+static void vector_single_lane(void **) {
+	ip_input_hdr_status_t status[CKSUM_LANES];
+	struct test_pkt pkts[CKSUM_LANES];
+	void *objs[CKSUM_LANES];
+
+	for (unsigned i = 0; i < RTE_DIM(cases); i++) {
+		for (unsigned lane = 0; lane < CKSUM_LANES; lane++) {
+			for (unsigned l = 0; l < CKSUM_LANES; l++) {
+				pkt_init(&pkts[l], l == lane ? &cases[i] : &cases[0]);
+				objs[l] = &pkts[l].mbuf;
+			}
+			ip_input_check_x4(objs, status);
+			for (unsigned l = 0; l < CKSUM_LANES; l++) {
+				const struct hdr_case *c = l == lane ? &cases[i] : &cases[0];
+				if (status[l] != c->expected)
+					fail_msg("%s: lane %u got %d", c->name, l, status[l]);
+			}
+		}
+	}
+}
+
+// A different case in each lane, checked against the scalar code.
+static void vector_mixed(void **) {
+	ip_input_hdr_status_t status[CKSUM_LANES];
+	const struct hdr_case *lanes[CKSUM_LANES];
+	struct test_pkt pkts[CKSUM_LANES];
+	void *objs[CKSUM_LANES];
+
+	for (unsigned i = 0; i < RTE_DIM(cases); i++) {
+		for (unsigned l = 0; l < CKSUM_LANES; l++) {
+			lanes[l] = &cases[(i + l * 7) % RTE_DIM(cases)];
+			pkt_init(&pkts[l], lanes[l]);
+			objs[l] = &pkts[l].mbuf;
+		}
+		ip_input_check_x4(objs, status);
+		for (unsigned l = 0; l < CKSUM_LANES; l++) {
+			if (status[l] != lanes[l]->expected)
+				fail_msg("%s: lane %u got %d", lanes[l]->name, l, status[l]);
+			assert_int_equal(status[l], ip_input_check(objs[l]));
+		}
+	}
+}
+
+int main(void) {
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(scalar),
+		cmocka_unit_test(vector_single_lane),
+		cmocka_unit_test(vector_mixed),
+	};
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
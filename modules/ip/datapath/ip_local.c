@@ -1,18 +1,57 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2024 Robin Jarry
 
+#include "copp_priv.h"
+
 #include <gr_datapath.h>
 #include <gr_graph.h>
 #include <gr_ip4_datapath.h>
 #include <gr_log.h>
 
+#include <rte_cycles.h>
+#include <rte_errno.h>
 #include <rte_graph_worker.h>
 #include <rte_ip.h>
+#include <rte_malloc.h>
 #include <rte_mbuf.h>
+#include <rte_udp.h>
+
+#include <netinet/in.h>
 
-#define UNKNOWN_PROTO 0
+enum {
+	UNKNOWN_PROTO = 0,
+	COPP_ICMP,
+	COPP_TUNNEL,
+	COPP_OTHER,
+	EDGE_COUNT,
+};
 static rte_edge_t edges[256] = {UNKNOWN_PROTO};
 
+static inline uint8_t copp_class(const struct rte_mbuf *mbuf, const struct rte_ipv4_hdr *ip) {
+	const struct rte_udp_hdr *udp;
+
+	switch (ip->next_proto_id) {
+	case IPPROTO_ICMP:
+		return GR_IP4_COPP_ICMP;
+	case IPPROTO_IPIP:
+		return GR_IP4_COPP_TUNNEL;
+	case IPPROTO_UDP:
+		if (rte_pktmbuf_data_len(mbuf) < rte_ipv4_hdr_len(ip) + sizeof(*udp))
+			break;
+		udp = (const struct rte_udp_hdr *)((const uint8_t *)ip + rte_ipv4_hdr_len(ip));
+		if (udp_input_is_tunnel(udp->dst_port))
+			return GR_IP4_COPP_TUNNEL;
+		break;
+	}
+	return GR_IP4_COPP_OTHER;
+}
+
+static const rte_edge_t copp_edges[GR_IP4_COPP_CLASS_COUNT] = {
+	[GR_IP4_COPP_ICMP] = COPP_ICMP,
+	[GR_IP4_COPP_TUNNEL] = COPP_TUNNEL,
+	[GR_IP4_COPP_OTHER] = COPP_OTHER,
+};
+
 void ip_input_local_add_proto(uint8_t proto, const char *next_node) {
 	LOG(DEBUG, "ip_input_local: proto=%hhu -> %s", proto, next_node);
 	if (edges[proto] != UNKNOWN_PROTO)
@@ -26,16 +65,28 @@ static uint16_t ip_input_local_process(
 	void **objs,
 	uint16_t nb_objs
 ) {
+	struct copp_ctx *ctx = node->ctx_ptr;
 	struct rte_ipv4_hdr *ip;
 	struct rte_mbuf *mbuf;
+	uint64_t now, hz;
 	rte_edge_t next;
+	uint8_t class;
 	uint16_t i;
 
+	now = rte_get_tsc_cycles();
+	hz = rte_get_tsc_hz();
+
 	for (i = 0; i < nb_objs; i++) {
 		mbuf = objs[i];
 		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
 		next = edges[ip->next_proto_id];
 		if (next != UNKNOWN_PROTO) {
+			// Police before any protocol processing is done.
+			class = copp_class(mbuf, ip);
+			if (!copp_allow(ctx, class, ip->src_addr, now, hz)) {
+				next = copp_edges[class];
+				goto next;
+			}
 			struct ip_local_mbuf_data *data = ip_local_mbuf_data(mbuf);
 			uint16_t vrf_id = ip_output_mbuf_data(mbuf)->nh->vrf_id;
 			data->src = ip->src_addr;
@@ -45,18 +96,38 @@ static uint16_t ip_input_local_process(
 			data->proto = ip->next_proto_id;
 			rte_pktmbuf_adj(mbuf, sizeof(*ip));
 		}
+next:
 		rte_node_enqueue_x1(graph, node, next, mbuf);
 	}
 
 	return nb_objs;
 }
 
+static int ip_input_local_init(const struct rte_graph *, struct rte_node *node) {
+	node->ctx_ptr = rte_zmalloc(__func__, sizeof(struct copp_ctx), RTE_CACHE_LINE_SIZE);
+	if (node->ctx_ptr == NULL) {
+		LOG(ERR, "rte_zmalloc(): %s", rte_strerror(rte_errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void ip_input_local_fini(const struct rte_graph *, struct rte_node *node) {
+	rte_free(node->ctx_ptr);
+	node->ctx_ptr = NULL;
+}
+
 static struct rte_node_register input_node = {
 	.name = "ip_input_local",
 	.process = ip_input_local_process,
-	.nb_edges = 1,
+	.init = ip_input_local_init,
+	.fini = ip_input_local_fini,
+	.nb_edges = EDGE_COUNT,
 	.next_nodes = {
 		[UNKNOWN_PROTO] = "ip_input_local_unknown_proto",
+		[COPP_ICMP] = "copp_icmp_drop",
+		[COPP_TUNNEL] = "copp_tunnel_drop",
+		[COPP_OTHER] = "copp_other_drop",
 	},
 };
 
@@ -67,3 +138,6 @@ static struct gr_node_info info = {
 GR_NODE_REGISTER(info);
 
 GR_DROP_REGISTER(ip_input_local_unknown_proto);
+GR_DROP_REGISTER(copp_icmp_drop);
+GR_DROP_REGISTER(copp_tunnel_drop);
+GR_DROP_REGISTER(copp_other_drop);
@@ -12,18 +12,24 @@
 #include <gr_log.h>
 #include <gr_mbuf.h>
 
+#include <rte_bitops.h>
 #include <rte_byteorder.h>
 #include <rte_ether.h>
 #include <rte_fib.h>
 #include <rte_graph_worker.h>
 #include <rte_ip.h>
+#include <rte_jhash.h>
 #include <rte_mbuf.h>
 
+#include <assert.h>
+#include <stdatomic.h>
+
 enum {
 	ETH_OUTPUT = 0,
 	NO_ROUTE,
 	ERROR,
 	QUEUE_FULL,
+	NH_FAILED,
 	EDGE_COUNT,
 };
 
@@ -38,37 +44,97 @@ void ip_output_add_tunnel(uint16_t iface_type_id, const char *next_node) {
 	edges[iface_type_id] = gr_node_attach_parent("ip_output", next_node);
 }
 
-typedef enum {
-	OK_TO_SEND,
-	HELD,
-	HOLD_QUEUE_FULL,
-} hold_status_t;
-
-static inline hold_status_t maybe_hold_packet(struct nexthop *nh, struct rte_mbuf *mbuf) {
-	hold_status_t status;
-
-	if (nh->flags & GR_IP4_NH_F_REACHABLE) {
-		status = OK_TO_SEND;
-	} else if (nh->held_pkts_num < IP4_NH_MAX_HELD_PKTS) {
-		queue_mbuf_data(mbuf)->next = NULL;
-		rte_spinlock_lock(&nh->lock);
-		if (nh->held_pkts_head == NULL)
-			nh->held_pkts_head = mbuf;
+// Edges of ip_output (last row) and of each hook node towards the other hooks and towards
+// eth_output (last column).
+#define HOOK_ETH_OUTPUT IP_OUTPUT_HOOK_COUNT
+static const char *hook_nodes[IP_OUTPUT_HOOK_COUNT];
+static rte_edge_t hook_edges[IP_OUTPUT_HOOK_COUNT + 1][IP_OUTPUT_HOOK_COUNT + 1];
+// Bit mask of the hooks enabled on each interface.
+static uint8_t iface_hooks[MAX_IFACES];
+
+static_assert(IP_OUTPUT_HOOK_COUNT <= 8);
+
+void ip_output_add_hook(ip_output_hook_t hook, const char *next_node) {
+	LOG(DEBUG, "ip_output: hook=%u -> %s", hook, next_node);
+	if (hook >= IP_OUTPUT_HOOK_COUNT)
+		ABORT("invalid hook=%u", hook);
+	if (hook_nodes[hook] != NULL)
+		ABORT("next node already registered for hook=%u", hook);
+
+	hook_nodes[hook] = next_node;
+	hook_edges[IP_OUTPUT_HOOK_COUNT][hook] = gr_node_attach_parent("ip_output", next_node);
+	hook_edges[hook][HOOK_ETH_OUTPUT] = gr_node_attach_parent(next_node, "eth_output");
+	for (unsigned h = 0; h < IP_OUTPUT_HOOK_COUNT; h++) {
+		if (hook_nodes[h] == NULL || h == hook)
+			continue;
+		if (h < hook)
+			hook_edges[h][hook] = gr_node_attach_parent(hook_nodes[h], next_node);
 		else
-			queue_mbuf_data(nh->held_pkts_tail)->next = mbuf;
-		nh->held_pkts_tail = mbuf;
-		nh->held_pkts_num++;
-		rte_spinlock_unlock(&nh->lock);
-		if (!(nh->flags & GR_IP4_NH_F_PENDING)) {
-			arp_output_request_solicit(nh);
-			nh->flags |= GR_IP4_NH_F_PENDING;
+			hook_edges[hook][h] = gr_node_attach_parent(next_node, hook_nodes[h]);
+	}
+}
+
+void ip_output_hook_enable(uint16_t iface_id, ip_output_hook_t hook, bool enabled) {
+	if (iface_id >= ARRAY_DIM(iface_hooks) || hook >= IP_OUTPUT_HOOK_COUNT)
+		return;
+	if (enabled && hook_nodes[hook] != NULL)
+		iface_hooks[iface_id] |= 1 << hook;
+	else
+		iface_hooks[iface_id] &= ~(1 << hook);
+	ip4_flow_cache_invalidate();
+}
+
+rte_edge_t ip_output_hook_next(ip_output_hook_t hook, struct rte_mbuf *mbuf) {
+	const struct iface *iface = eth_output_mbuf_data(mbuf)->iface;
+	uint8_t next;
+
+	// Hooks may have been disabled since the packet was diverted.
+	next = iface_hooks[iface->id] & ~((2 << hook) - 1);
+	if (next != 0)
+		return hook_edges[hook][rte_ctz32(next)];
+
+	return hook_edges[hook][HOOK_ETH_OUTPUT];
+}
+
+static inline uint32_t flow_hash(const struct rte_mbuf *mbuf, const struct rte_ipv4_hdr *ip) {
+	const rte_be16_t frag_mask = RTE_BE16(RTE_IPV4_HDR_MF_FLAG | RTE_IPV4_HDR_OFFSET_MASK);
+	uint32_t ports = 0;
+
+	if (mbuf->ol_flags & RTE_MBUF_F_RX_RSS_HASH)
+		return mbuf->hash.rss;
+
+	// Only the first fragment has ports. Ignore them so that all fragments of a packet
+	// have the same hash.
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		if (!(ip->fragment_offset & frag_mask)) {
+			const uint8_t *l4 = (const uint8_t *)ip + rte_ipv4_hdr_len(ip);
+			ports = *(const unaligned_uint32_t *)l4;
 		}
-		status = HELD;
-	} else {
-		status = HOLD_QUEUE_FULL;
+		break;
 	}
 
-	return status;
+	return rte_jhash_3words(ip->src_addr, ip->dst_addr, ports, ip->next_proto_id);
+}
+
+static inline struct nexthop *nh_group_select(
+	const struct nexthop *nh,
+	const struct rte_mbuf *mbuf,
+	const struct rte_ipv4_hdr *ip
+) {
+	const struct nh_group *group = atomic_load_explicit(&nh->group, memory_order_acquire);
+	uint32_t hash;
+
+	if (group == NULL || group->n_members == 0)
+		return NULL;
+
+	// RSS spreads flows on rx queues using the lowest bits of the hash. Multiply it by the
+	// golden ratio so that all of its bits contribute to the selected member. Otherwise,
+	// each worker would only use a subset of the members.
+	hash = flow_hash(mbuf, ip) * UINT32_C(0x9e3779b1);
+
+	return group->members[((uint64_t)hash * group->n_members) >> 32];
 }
 
 static uint16_t
@@ -76,6 +142,7 @@ ip_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 	struct eth_output_mbuf_data *eth_data;
 	const struct iface *iface;
 	struct rte_ipv4_hdr *ip;
+	struct ip4_flow *flow;
 	struct rte_mbuf *mbuf;
 	struct nexthop *nh;
 	uint16_t i, sent;
@@ -88,7 +155,16 @@ ip_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 		mbuf = objs[i];
 		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
 
+		// Held packets may come back here on another worker.
+		flow = ip_output_mbuf_data(mbuf)->flow;
+		ip_output_mbuf_data(mbuf)->flow = NULL;
+
 		nh = ip_output_mbuf_data(mbuf)->nh;
+		if (nh != NULL && nh->flags & GR_IP4_NH_F_GROUP) {
+			// Select a member per flow so that packets of a flow are not reordered.
+			nh = nh_group_select(nh, mbuf, ip);
+			ip_output_mbuf_data(mbuf)->nh = nh;
+		}
 		if (nh == NULL) {
 			next = NO_ROUTE;
 			goto next;
@@ -106,30 +182,34 @@ ip_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 
 		if (nh->flags & GR_IP4_NH_F_LINK && ip->dst_addr != nh->ip) {
 			// The resolved next hop is associated with a "connected" route.
-			// We currently do not have an explicit entry for this destination IP.
-			// Create a new next hop and its associated /32 route so that next
-			// packets take it in priority with a single route lookup.
+			// Look for the destination in the neighbor table. If it is not known
+			// yet, the control plane will create the entry and hold the packet
+			// until the destination is resolved.
 			struct nexthop *remote;
-			if (ip4_nexthop_add(nh->vrf_id, ip->dst_addr, &idx, &remote) < 0) {
-				next = ERROR;
-				goto next;
+			if (ip4_nexthop_lookup(nh->vrf_id, ip->dst_addr, &idx, &remote) < 0) {
+				if (ip4_nexthop_resolve(mbuf) < 0) {
+					next = QUEUE_FULL;
+					goto next;
+				}
+				continue;
 			}
-			ip4_route_insert(nh->vrf_id, ip->dst_addr, 32, idx, remote);
-			remote->iface_id = nh->iface_id;
 			ip_output_mbuf_data(mbuf)->nh = remote;
 			nh = remote;
 		}
 
-		switch (maybe_hold_packet(nh, mbuf)) {
-		case HELD:
+		switch (ip4_nexthop_hold(nh, mbuf)) {
+		case IP4_NH_HELD:
 			// The packet was stored in the next hop hold queue to be flushed upon
 			// reception of an ARP request or reply from the destination IP.
 			continue;
-		case HOLD_QUEUE_FULL:
-			//
+		case IP4_NH_HOLD_QUEUE_FULL:
 			next = QUEUE_FULL;
 			goto next;
-		case OK_TO_SEND:
+		case IP4_NH_FAILED:
+			// Resolution failed recently, drop until the next hop expires.
+			next = NH_FAILED;
+			goto next;
+		case IP4_NH_OK_TO_SEND:
 			// Next hop is reachable.
 			break;
 		}
@@ -139,6 +219,15 @@ ip_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, u
 		rte_ether_addr_copy(&nh->lladdr, &eth_data->dst);
 		eth_data->ether_type = RTE_BE16(RTE_ETHER_TYPE_IPV4);
 		eth_data->iface = iface;
+		if (unlikely(iface_hooks[iface->id] != 0)) {
+			next = hook_edges[IP_OUTPUT_HOOK_COUNT][rte_ctz32(iface_hooks[iface->id])];
+		} else if (flow != NULL && flow->pending == mbuf) {
+			// Next packets of this flow will skip ip_forward and ip_output.
+			flow->nh = nh;
+			flow->iface = iface;
+			flow->pending = NULL;
+			flow->gen = flow->pending_gen;
+		}
 		sent++;
 next:
 		rte_node_enqueue_x1(graph, node, next, mbuf);
@@ -156,6 +245,7 @@ static struct rte_node_register output_node = {
 		[ERROR] = "ip_output_error",
 		[NO_ROUTE] = "ip_output_no_route",
 		[QUEUE_FULL] = "arp_queue_full",
+		[NH_FAILED] = "arp_failed",
 	},
 };
 
@@ -168,3 +258,4 @@ GR_NODE_REGISTER(info);
 GR_DROP_REGISTER(ip_output_error);
 GR_DROP_REGISTER(ip_output_no_route);
 GR_DROP_REGISTER(arp_queue_full);
+GR_DROP_REGISTER(arp_failed);
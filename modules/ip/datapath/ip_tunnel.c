@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_iface.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+
+#include <rte_errno.h>
+#include <rte_graph_worker.h>
+#include <rte_hash.h>
+#include <rte_malloc.h>
+
+int ip4_encap_nh_init(const struct rte_graph *graph, struct rte_node *node) {
+	node->ctx_ptr = rte_zmalloc_socket(
+		__func__,
+		MAX_IFACES * sizeof(struct ip4_encap_nh),
+		RTE_CACHE_LINE_SIZE,
+		graph->socket
+	);
+	if (node->ctx_ptr == NULL) {
+		LOG(ERR, "rte_zmalloc_socket(): %s", rte_strerror(rte_errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+void ip4_encap_nh_fini(const struct rte_graph *, struct rte_node *node) {
+	rte_free(node->ctx_ptr);
+	node->ctx_ptr = NULL;
+}
+
+void ip4_tunnel_get_iface_bulk(
+	const struct rte_hash *hash,
+	const void **keys,
+	unsigned n,
+	struct iface **ifaces
+) {
+	uint64_t hit_mask = 0;
+
+	if (rte_hash_lookup_bulk_data(hash, keys, n, &hit_mask, (void **)ifaces) < 0)
+		hit_mask = 0;
+
+	for (unsigned i = 0; i < n; i++) {
+		if (!(hit_mask & (UINT64_C(1) << i)))
+			ifaces[i] = NULL;
+	}
+}
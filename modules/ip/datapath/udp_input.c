@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_datapath.h>
+#include <gr_graph.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_byteorder.h>
+#include <rte_graph_worker.h>
+#include <rte_mbuf.h>
+#include <rte_udp.h>
+
+#include <netinet/in.h>
+
+enum {
+	UNKNOWN_PORT = 0,
+	BAD_LENGTH,
+	EDGE_COUNT,
+};
+static rte_edge_t edges[1 << 16] = {UNKNOWN_PORT};
+
+void udp_input_add_tunnel(rte_be16_t dst_port, const char *next_node) {
+	LOG(DEBUG, "udp_input: port=%u -> %s", rte_be_to_cpu_16(dst_port), next_node);
+	if (edges[dst_port] != UNKNOWN_PORT)
+		ABORT("next node already registered for port=%u", rte_be_to_cpu_16(dst_port));
+	edges[dst_port] = gr_node_attach_parent("udp_input", next_node);
+}
+
+bool udp_input_is_tunnel(rte_be16_t dst_port) {
+	return edges[dst_port] != UNKNOWN_PORT;
+}
+
+static uint16_t
+udp_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct ip_local_mbuf_data *ip_data;
+	const struct rte_udp_hdr *udp;
+	struct rte_mbuf *mbuf;
+	rte_edge_t next;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		ip_data = ip_local_mbuf_data(mbuf);
+
+		if (ip_data->len < sizeof(*udp) || rte_pktmbuf_data_len(mbuf) < sizeof(*udp)) {
+			next = BAD_LENGTH;
+			goto next;
+		}
+		udp = rte_pktmbuf_mtod(mbuf, const struct rte_udp_hdr *);
+		next = edges[udp->dst_port];
+		if (next != UNKNOWN_PORT) {
+			// Tunnels do not verify the UDP checksum which is usually zero (RFC 7348).
+			ip_data->len -= sizeof(*udp);
+			rte_pktmbuf_adj(mbuf, sizeof(*udp));
+		}
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static void udp_input_register(void) {
+	ip_input_local_add_proto(IPPROTO_UDP, "udp_input");
+}
+
+static struct rte_node_register udp_input_node = {
+	.name = "udp_input",
+
+	.process = udp_input_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[UNKNOWN_PORT] = "udp_input_unknown_port",
+		[BAD_LENGTH] = "udp_input_bad_length",
+		// other edges are updated dynamically with udp_input_add_tunnel
+	},
+};
+
+static struct gr_node_info udp_input_info = {
+	.node = &udp_input_node,
+	.register_callback = udp_input_register,
+};
+
+GR_NODE_REGISTER(udp_input_info);
+
+GR_DROP_REGISTER(udp_input_unknown_port);
+GR_DROP_REGISTER(udp_input_bad_length);
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip6.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_net_types.h>
+
+#include <event2/event.h>
+#include <rte_errno.h>
+#include <rte_ether.h>
+#include <rte_malloc.h>
+#include <rte_memory.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+static struct hoplist6 *iface_addrs;
+
+struct nexthop6 *ip6_addr_get_preferred(uint16_t iface_id, const struct in6_addr *dst) {
+	struct hoplist6 *addrs;
+
+	if (iface_id >= MAX_IFACES)
+		return errno_set_null(ENODEV);
+
+	addrs = &iface_addrs[iface_id];
+	if (addrs->count == 0)
+		return errno_set_null(ENOENT);
+
+	for (unsigned i = 0; i < addrs->count; i++) {
+		struct nexthop6 *nh = addrs->nh[i];
+		if (ip6_addr_same_subnet(dst, &nh->ip, nh->prefixlen))
+			return nh;
+	}
+
+	return addrs->nh[0];
+}
+
+struct hoplist6 *ip6_addr_get_all(uint16_t iface_id) {
+	struct hoplist6 *addrs;
+
+	if (iface_id >= MAX_IFACES)
+		return errno_set_null(ENODEV);
+
+	addrs = &iface_addrs[iface_id];
+	if (addrs->count == 0)
+		return errno_set_null(ENOENT);
+
+	return addrs;
+}
+
+// Neighbor solicitations are sent to the solicited-node multicast group of the target address.
+// Make sure the interface does not filter them out.
+static int mcast_filter(uint16_t iface_id, const struct in6_addr *ip, bool add) {
+	struct rte_ether_addr mac;
+	struct in6_addr mcast;
+	int ret;
+
+	ip6_solicited_node(&mcast, ip);
+	ip6_mcast_lladdr(&mac, &mcast);
+
+	if (add)
+		ret = iface_add_eth_addr(iface_id, &mac);
+	else
+		ret = iface_del_eth_addr(iface_id, &mac);
+
+	if (ret < 0 && errno == EOPNOTSUPP)
+		return 0;
+
+	return ret;
+}
+
+static struct api_out addr6_add(const void *request, void **response) {
+	const struct gr_ip6_addr_add_req *req = request;
+	const struct iface *iface;
+	struct hoplist6 *ifaddrs;
+	unsigned addr_index;
+	struct nexthop6 *nh;
+	uint32_t nh_idx;
+	int ret;
+
+	(void)response;
+
+	if (ip6_addr_is_unspec(&req->addr.addr.ip) || ip6_addr_is_mcast(&req->addr.addr.ip))
+		return api_out(EINVAL, 0);
+
+	iface = iface_from_id(req->addr.iface_id);
+	if (iface == NULL)
+		return api_out(errno, 0);
+
+	ifaddrs = &iface_addrs[iface->id];
+
+	for (addr_index = 0; addr_index < ifaddrs->count; addr_index++) {
+		nh = ifaddrs->nh[addr_index];
+		if (req->exist_ok && memcmp(&req->addr.addr.ip, &nh->ip, sizeof(nh->ip)) == 0
+		    && req->addr.addr.prefixlen == nh->prefixlen)
+			return api_out(0, 0);
+	}
+
+	if (ifaddrs->count == IP6_HOPLIST_MAX_SIZE)
+		return api_out(ENOSPC, 0);
+
+	if (ip6_nexthop_lookup(iface->vrf_id, &req->addr.addr.ip, &nh_idx, &nh) == 0)
+		return api_out(EADDRINUSE, 0);
+
+	if ((ret = ip6_nexthop_add(iface->vrf_id, &req->addr.addr.ip, &nh_idx, &nh)) < 0)
+		return api_out(-ret, 0);
+
+	nh->iface_id = req->addr.iface_id;
+	nh->prefixlen = req->addr.addr.prefixlen;
+	nh->flags = GR_IP6_NH_F_LOCAL | GR_IP6_NH_F_LINK | GR_IP6_NH_F_REACHABLE
+		| GR_IP6_NH_F_STATIC;
+
+	if (iface_get_eth_addr(iface->id, &nh->lladdr) < 0)
+		if (errno != EOPNOTSUPP)
+			goto err;
+
+	if (mcast_filter(iface->id, &nh->ip, true) < 0)
+		goto err;
+
+	ret = ip6_route_insert(iface->vrf_id, &nh->ip, nh->prefixlen, nh_idx, nh);
+	if (ret < 0) {
+		mcast_filter(iface->id, &nh->ip, false);
+		goto err;
+	}
+
+	ifaddrs->nh[addr_index] = nh;
+	ifaddrs->count++;
+
+	return api_out(0, 0);
+err:
+	ret = errno;
+	ip6_nexthop_decref(nh);
+	return api_out(ret, 0);
+}
+
+static struct api_out addr6_del(const void *request, void **response) {
+	const struct gr_ip6_addr_del_req *req = request;
+	struct nexthop6 *nh = NULL;
+	struct hoplist6 *addrs;
+	unsigned i;
+
+	(void)response;
+
+	if ((addrs = ip6_addr_get_all(req->addr.iface_id)) == NULL) {
+		if (errno == ENOENT && req->missing_ok)
+			return api_out(0, 0);
+		return api_out(errno, 0);
+	}
+
+	for (i = 0; i < addrs->count; i++) {
+		if (memcmp(&addrs->nh[i]->ip, &req->addr.addr.ip, sizeof(req->addr.addr.ip)) == 0
+		    && addrs->nh[i]->prefixlen == req->addr.addr.prefixlen) {
+			nh = addrs->nh[i];
+			break;
+		}
+	}
+	if (nh == NULL) {
+		if (req->missing_ok)
+			return api_out(0, 0);
+		return api_out(ENOENT, 0);
+	}
+
+	mcast_filter(nh->iface_id, &nh->ip, false);
+	ip6_route_cleanup(nh->vrf_id, nh);
+
+	// shift the remaining addresses
+	for (; i < addrs->count; i++) {
+		if (i + 1 < addrs->count)
+			addrs->nh[i] = addrs->nh[i + 1];
+	}
+	addrs->count--;
+
+	return api_out(0, 0);
+}
+
+static struct api_out addr6_list(const void *request, void **response) {
+	const struct gr_ip6_addr_list_req *req = request;
+	struct gr_ip6_addr_list_resp *resp = NULL;
+	const struct hoplist6 *addrs;
+	struct gr_ip6_ifaddr *addr;
+	uint16_t iface_id, num;
+	size_t len;
+
+	num = 0;
+	for (iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		addrs = ip6_addr_get_all(iface_id);
+		if (addrs == NULL || addrs->count == 0 || addrs->nh[0]->vrf_id != req->vrf_id)
+			continue;
+		num += addrs->count;
+	}
+
+	len = sizeof(*resp) + num * sizeof(struct gr_ip6_ifaddr);
+	if ((resp = calloc(len, 1)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		addrs = ip6_addr_get_all(iface_id);
+		if (addrs == NULL || addrs->count == 0 || addrs->nh[0]->vrf_id != req->vrf_id)
+			continue;
+		for (unsigned i = 0; i < addrs->count; i++) {
+			addr = &resp->addrs[resp->n_addrs++];
+			addr->addr.ip = addrs->nh[i]->ip;
+			addr->addr.prefixlen = addrs->nh[i]->prefixlen;
+			addr->iface_id = iface_id;
+		}
+	}
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	struct hoplist6 *ifaddrs;
+
+	if (event != IFACE_EVENT_PRE_REMOVE)
+		return;
+
+	if ((ifaddrs = ip6_addr_get_all(iface->id)) == NULL)
+		return;
+
+	for (unsigned i = 0; i < ifaddrs->count; i++) {
+		mcast_filter(iface->id, &ifaddrs->nh[i]->ip, false);
+		ip6_route_cleanup(iface->vrf_id, ifaddrs->nh[i]);
+	}
+
+	memset(ifaddrs, 0, sizeof(*ifaddrs));
+}
+
+static void addr6_init(struct event_base *) {
+	iface_addrs = rte_calloc(__func__, MAX_IFACES, sizeof(*iface_addrs), RTE_CACHE_LINE_SIZE);
+	if (iface_addrs == NULL)
+		ABORT("rte_calloc(addrs)");
+}
+
+static void addr6_fini(struct event_base *) {
+	rte_free(iface_addrs);
+	iface_addrs = NULL;
+}
+
+static struct gr_api_handler addr6_add_handler = {
+	.name = "ipv6 address add",
+	.request_type = GR_IP6_ADDR_ADD,
+	.callback = addr6_add,
+};
+static struct gr_api_handler addr6_del_handler = {
+	.name = "ipv6 address del",
+	.request_type = GR_IP6_ADDR_DEL,
+	.callback = addr6_del,
+};
+static struct gr_api_handler addr6_list_handler = {
+	.name = "ipv6 address list",
+	.request_type = GR_IP6_ADDR_LIST,
+	.callback = addr6_list,
+};
+static struct gr_module addr6_module = {
+	.name = "ipv6 address",
+	.init = addr6_init,
+	.fini = addr6_fini,
+	.fini_prio = 2000,
+};
+
+static struct iface_event_handler iface_event_address6_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(address6_constructor) {
+	gr_register_api_handler(&addr6_add_handler);
+	gr_register_api_handler(&addr6_del_handler);
+	gr_register_api_handler(&addr6_list_handler);
+	gr_register_module(&addr6_module);
+	iface_event_register_handler(&iface_event_address6_handler);
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_IP6_CONTROL
+#define _GR_IP6_CONTROL
+
+#include <gr_ip6.h>
+#include <gr_net_types.h>
+
+#include <rte_ether.h>
+#include <rte_fib6.h>
+#include <rte_hash.h>
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+struct __rte_cache_aligned nexthop6 {
+	// fields used by ip6_output first
+	// Workers set GR_IP6_NH_F_PENDING concurrently with the control plane state
+	// transitions. Always modify with atomic_fetch_or() and atomic_fetch_and().
+	_Atomic(gr_ip6_nh_flags_t) flags;
+	struct rte_ether_addr lladdr;
+	uint16_t vrf_id;
+	uint16_t iface_id;
+	struct in6_addr ip;
+	uint32_t ref_count;
+	uint8_t prefixlen;
+	uint8_t ucast_probes : 4, mcast_probes : 4;
+	// packets waiting for neighbor resolution
+	_Atomic(uint16_t) held_pkts_num;
+	// lock-free stack of held packets, see ip6_nexthop_hold()
+	_Atomic(struct rte_mbuf *) held_pkts;
+	// when the oldest held packet was queued
+	_Atomic(uint64_t) held_since;
+	uint64_t last_request, last_reply;
+};
+
+#define IP6_HOPLIST_MAX_SIZE 8
+
+struct hoplist6 {
+	unsigned count;
+	struct nexthop6 *nh[IP6_HOPLIST_MAX_SIZE];
+};
+
+// Max number of packets to hold per next hop waiting for resolution (default: 256).
+#define IP6_NH_MAX_HELD_PKTS 256
+// Held packets lifetime (default: 3 sec).
+#define IP6_NH_HOLD_TIME 3
+// Reachable next hop lifetime after last advertisement received (RFC 4861 REACHABLE_TIME).
+#define IP6_NH_LIFETIME_REACHABLE 30
+// Unreachable next hop lifetime after last unreplied solicitation was sent (default: 1 min).
+#define IP6_NH_LIFETIME_UNREACHABLE 60
+// Max number of unicast solicitations sent after IP6_NH_LIFETIME_REACHABLE.
+#define IP6_NH_UCAST_PROBES 3
+// Max number of multicast solicitations sent after unicast probes failed.
+#define IP6_NH_MCAST_PROBES 3
+// Max neighbor solicitations per second for all interfaces (default: 1000, burst: 100).
+#define IP6_NH_SOLICIT_RATE 1000
+#define IP6_NH_SOLICIT_BURST 100
+
+#define IP6_MAX_VRFS 4096
+#define IP6_DEFAULT_NUM_TBL8 (1 << 15)
+
+struct nexthop6 *ip6_nexthop_get(uint32_t idx);
+int ip6_nexthop_lookup(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint32_t *idx,
+	struct nexthop6 **nh
+);
+int ip6_nexthop_add(uint16_t vrf_id, const struct in6_addr *ip, uint32_t *idx, struct nexthop6 **);
+// Get a neighbor entry, create it with a neighbor table reference if it does not exist.
+int ip6_nexthop_lookup_add(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint16_t iface_id,
+	uint32_t *idx,
+	struct nexthop6 **nh
+);
+// Flush unused neighbor entries of a connected subnet.
+void ip6_nexthop_cleanup(uint16_t vrf_id, const struct in6_addr *ip, uint8_t prefixlen);
+void ip6_nexthop_incref(struct nexthop6 *);
+void ip6_nexthop_decref(struct nexthop6 *);
+
+int ip6_route_insert(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint8_t prefixlen,
+	uint32_t nh_idx,
+	struct nexthop6 *
+);
+int ip6_route_delete(uint16_t vrf_id, const struct in6_addr *ip, uint8_t prefixlen);
+struct nexthop6 *ip6_route_lookup(uint16_t vrf_id, const struct in6_addr *ip);
+// Resolve n destinations of the same VRF at once. Unreachable destinations get a NULL next hop.
+void ip6_route_lookup_bulk(
+	uint16_t vrf_id,
+	uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	struct nexthop6 **nhs,
+	unsigned n
+);
+struct nexthop6 *
+ip6_route_lookup_exact(uint16_t vrf_id, const struct in6_addr *ip, uint8_t prefixlen);
+void ip6_route_cleanup(uint16_t vrf_id, struct nexthop6 *nh);
+
+// get the default address for a given interface
+struct nexthop6 *ip6_addr_get_preferred(uint16_t iface_id, const struct in6_addr *dst);
+// get all addresses for a given interface
+struct hoplist6 *ip6_addr_get_all(uint16_t iface_id);
+
+#endif
@@ -0,0 +1,647 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr.h>
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_control_output.h>
+#include <gr_iface.h>
+#include <gr_ip6.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_net_types.h>
+#include <gr_queue.h>
+#include <gr_stb_ds.h>
+#include <gr_timer_wheel.h>
+#include <gr_token_bucket.h>
+
+#include <event2/event.h>
+#include <rte_errno.h>
+#include <rte_hash.h>
+#include <rte_ip.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static struct nexthop6 *nh_array;
+static struct rte_hash *nh_hash;
+
+// 20 bytes, the compiler does not insert any padding.
+struct nexthop_key {
+	struct in6_addr ip;
+	uint32_t vrf_id;
+};
+
+// Neighbor state transitions and solicitations are driven by per next hop timers. The timer
+// wheel is advanced with this frequency.
+#define NH_TIMER_HZ 10
+
+static struct gr_timer_wheel nh_wheel;
+
+// Control plane only state, indexed like nh_array.
+struct nh_ctl {
+	struct gr_timer timer;
+	uint64_t last_solicit;
+};
+
+static struct nh_ctl *nh_ctls;
+static struct gr_token_bucket solicit_bucket;
+
+static inline uint64_t cycles_to_ticks(uint64_t cycles) {
+	return cycles / (rte_get_tsc_hz() / NH_TIMER_HZ);
+}
+
+static void nh_timer_cb(struct gr_timer *);
+
+static void nh_timer_arm(struct nexthop6 *nh, uint64_t cycles) {
+	struct gr_timer *t = &nh_ctls[nh - nh_array].timer;
+	gr_timer_add(&nh_wheel, t, cycles_to_ticks(cycles), nh_timer_cb);
+}
+
+// Stored in the held packets stack of reachable next hops. Packets are not held anymore until
+// the next hop needs to be resolved again.
+#define HELD_PKTS_CLOSED ((struct rte_mbuf *)UINTPTR_MAX)
+
+ip6_nh_hold_status_t ip6_nexthop_hold(struct nexthop6 *nh, struct rte_mbuf *mbuf) {
+	struct rte_mbuf *head;
+
+	if (nh->flags & GR_IP6_NH_F_REACHABLE)
+		return IP6_NH_OK_TO_SEND;
+	// Negative cache. Do not try to resolve again until the entry expires.
+	if (nh->flags & GR_IP6_NH_F_FAILED)
+		return IP6_NH_FAILED;
+
+	if (atomic_fetch_add_explicit(&nh->held_pkts_num, 1, memory_order_relaxed)
+	    >= IP6_NH_MAX_HELD_PKTS) {
+		atomic_fetch_sub_explicit(&nh->held_pkts_num, 1, memory_order_relaxed);
+		return IP6_NH_HOLD_QUEUE_FULL;
+	}
+
+	// Push the packet on the stack. Consumers always take the whole stack at once, there
+	// is no ABA problem.
+	head = atomic_load_explicit(&nh->held_pkts, memory_order_relaxed);
+	do {
+		if (head == HELD_PKTS_CLOSED) {
+			// resolved in the meantime
+			atomic_fetch_sub_explicit(&nh->held_pkts_num, 1, memory_order_relaxed);
+			return IP6_NH_OK_TO_SEND;
+		}
+		queue_mbuf_data(mbuf)->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&nh->held_pkts, &head, mbuf, memory_order_release, memory_order_relaxed
+	));
+
+	if (head == NULL)
+		atomic_store_explicit(&nh->held_since, rte_get_tsc_cycles(), memory_order_relaxed);
+
+	// Only the worker which sets the flag asks the control plane for resolution.
+	if (!(atomic_fetch_or(&nh->flags, GR_IP6_NH_F_PENDING) & GR_IP6_NH_F_PENDING)) {
+		if (ip6_nexthop_solicit(nh) < 0)
+			atomic_fetch_and(&nh->flags, ~GR_IP6_NH_F_PENDING);
+	}
+
+	return IP6_NH_HELD;
+}
+
+// Take all held packets and reverse the stack to return them in the order they were queued.
+static struct rte_mbuf *held_pkts_take(struct nexthop6 *nh, struct rte_mbuf *replace) {
+	struct rte_mbuf *m, *next, *list = NULL;
+	unsigned n = 0;
+
+	m = atomic_exchange_explicit(&nh->held_pkts, replace, memory_order_acq_rel);
+	if (m == HELD_PKTS_CLOSED)
+		return NULL;
+
+	while (m != NULL) {
+		next = queue_mbuf_data(m)->next;
+		queue_mbuf_data(m)->next = list;
+		list = m;
+		m = next;
+		n++;
+	}
+	atomic_fetch_sub_explicit(&nh->held_pkts_num, n, memory_order_relaxed);
+
+	return list;
+}
+
+struct rte_mbuf *ip6_nexthop_flush(struct nexthop6 *nh) {
+	return held_pkts_take(nh, HELD_PKTS_CLOSED);
+}
+
+// Free all held packets. The stack is replaced with NULL to hold packets again or with
+// HELD_PKTS_CLOSED to stop holding them.
+static void held_pkts_free(struct nexthop6 *nh, struct rte_mbuf *replace) {
+	struct rte_mbuf *m, *next;
+
+	m = held_pkts_take(nh, replace);
+	while (m != NULL) {
+		next = queue_mbuf_data(m)->next;
+		rte_pktmbuf_free(m);
+		m = next;
+	}
+}
+
+struct nexthop6 *ip6_nexthop_get(uint32_t idx) {
+	return &nh_array[idx];
+}
+
+int ip6_nexthop_lookup(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint32_t *idx,
+	struct nexthop6 **nh
+) {
+	struct nexthop_key key = {*ip, vrf_id};
+	int32_t nh_idx;
+
+	if ((nh_idx = rte_hash_lookup(nh_hash, &key)) < 0)
+		return errno_set(-nh_idx);
+
+	*idx = nh_idx;
+	*nh = &nh_array[nh_idx];
+
+	return 0;
+}
+
+int ip6_nexthop_add(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint32_t *idx,
+	struct nexthop6 **nh
+) {
+	struct nexthop_key key = {*ip, vrf_id};
+	int32_t nh_idx = rte_hash_add_key(nh_hash, &key);
+
+	if (nh_idx < 0)
+		return errno_set(-nh_idx);
+
+	nh_array[nh_idx].vrf_id = vrf_id;
+	nh_array[nh_idx].ip = *ip;
+
+	*idx = nh_idx;
+	*nh = &nh_array[nh_idx];
+
+	return 0;
+}
+
+int ip6_nexthop_lookup_add(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint16_t iface_id,
+	uint32_t *idx,
+	struct nexthop6 **nh
+) {
+	if (ip6_nexthop_lookup(vrf_id, ip, idx, nh) == 0)
+		return 0;
+	if (ip6_nexthop_add(vrf_id, ip, idx, nh) < 0)
+		return -errno;
+
+	(*nh)->iface_id = iface_id;
+	// reference held by the neighbor table, released when the entry expires
+	ip6_nexthop_incref(*nh);
+	nh_ctls[*idx].last_solicit = 0;
+	nh_timer_arm(*nh, IP6_NH_LIFETIME_REACHABLE * rte_get_tsc_hz());
+
+	return 0;
+}
+
+void ip6_nexthop_decref(struct nexthop6 *nh) {
+	if (nh->ref_count <= 1) {
+		struct nexthop_key key = {nh->ip, nh->vrf_id};
+		held_pkts_free(nh, NULL);
+		rte_hash_del_key(nh_hash, &key);
+		memset(nh, 0, sizeof(*nh));
+	} else {
+		nh->ref_count--;
+	}
+}
+
+void ip6_nexthop_incref(struct nexthop6 *nh) {
+	nh->ref_count++;
+}
+
+void ip6_nexthop_cleanup(uint16_t vrf_id, const struct in6_addr *ip, uint8_t prefixlen) {
+	struct nexthop6 **nhs = NULL, **n, *nh;
+	const void *key;
+	uint32_t iter;
+	int32_t idx;
+	void *data;
+
+	// collect first, keys cannot be deleted while iterating over the hash table
+	iter = 0;
+	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
+		nh = ip6_nexthop_get(idx);
+		if (nh->flags & GR_IP6_NH_F_LOCAL)
+			continue;
+		if (nh->vrf_id != vrf_id || !ip6_addr_same_subnet(&nh->ip, ip, prefixlen))
+			continue;
+		// still referenced by routes
+		if (nh->ref_count > 1)
+			continue;
+		arrpush(nhs, nh);
+	}
+
+	arrforeach (n, nhs)
+		ip6_nexthop_decref(*n);
+	arrfree(nhs);
+}
+
+static struct api_out nh6_add(const void *request, void **response) {
+	const struct gr_ip6_nh_add_req *req = request;
+	struct nexthop6 *nh;
+	uint32_t nh_idx;
+	int ret;
+
+	(void)response;
+
+	if (ip6_addr_is_unspec(&req->nh.host) || ip6_addr_is_mcast(&req->nh.host))
+		return api_out(EINVAL, 0);
+	if (req->nh.vrf_id >= IP6_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+	if (iface_from_id(req->nh.iface_id) == NULL)
+		return api_out(errno, 0);
+
+	if (ip6_nexthop_lookup(req->nh.vrf_id, &req->nh.host, &nh_idx, &nh) == 0) {
+		if (req->exist_ok && req->nh.iface_id == nh->iface_id
+		    && rte_is_same_ether_addr(&req->nh.mac, &nh->lladdr))
+			return api_out(0, 0);
+		return api_out(EEXIST, 0);
+	}
+
+	ret = ip6_nexthop_lookup_add(
+		req->nh.vrf_id, &req->nh.host, req->nh.iface_id, &nh_idx, &nh
+	);
+	if (ret < 0)
+		return api_out(-ret, 0);
+
+	rte_ether_addr_copy(&req->nh.mac, &nh->lladdr);
+	nh->flags = GR_IP6_NH_F_STATIC | GR_IP6_NH_F_REACHABLE;
+
+	return api_out(0, 0);
+}
+
+static struct api_out nh6_del(const void *request, void **response) {
+	const struct gr_ip6_nh_del_req *req = request;
+	struct nexthop6 *nh;
+	uint32_t idx;
+
+	(void)response;
+
+	if (req->vrf_id >= IP6_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+
+	if (ip6_nexthop_lookup(req->vrf_id, &req->host, &idx, &nh) < 0) {
+		if (errno == ENOENT && req->missing_ok)
+			return api_out(0, 0);
+		return api_out(errno, 0);
+	}
+	// only the neighbor table reference must remain
+	if ((nh->flags & (GR_IP6_NH_F_LOCAL | GR_IP6_NH_F_LINK)) || nh->ref_count > 1)
+		return api_out(EBUSY, 0);
+
+	ip6_nexthop_decref(nh);
+
+	return api_out(0, 0);
+}
+
+static struct api_out nh6_list(const void *request, void **response) {
+	const struct gr_ip6_nh_list_req *req = request;
+	struct gr_ip6_nh_list_resp *resp = NULL;
+	struct gr_ip6_nh *api_nh;
+	struct nexthop6 *nh;
+	const void *key;
+	uint32_t iter;
+	int32_t idx;
+	void *data;
+	size_t len;
+
+	len = sizeof(*resp) + GR_API_LIST_MAX(struct gr_ip6_nh) * sizeof(struct gr_ip6_nh);
+	if ((resp = calloc(len, 1)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	// The cursor is the position of the hash table iterator.
+	iter = req->cursor;
+	while ((idx = rte_hash_iterate(nh_hash, &key, &data, &iter)) >= 0) {
+		nh = ip6_nexthop_get(idx);
+		if (nh->vrf_id != req->vrf_id && req->vrf_id != UINT16_MAX)
+			continue;
+		api_nh = &resp->nhs[resp->n_nhs++];
+		api_nh->host = nh->ip;
+		api_nh->iface_id = nh->iface_id;
+		api_nh->vrf_id = nh->vrf_id;
+		rte_ether_addr_copy(&nh->lladdr, &api_nh->mac);
+		api_nh->flags = nh->flags;
+		if (nh->last_reply > 0)
+			api_nh->age = (rte_get_tsc_cycles() - nh->last_reply) / rte_get_tsc_hz();
+		api_nh->held_pkts = atomic_load(&nh->held_pkts_num);
+		if (resp->n_nhs == GR_API_LIST_MAX(struct gr_ip6_nh)) {
+			resp->next = iter;
+			break;
+		}
+	}
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp) + resp->n_nhs * sizeof(struct gr_ip6_nh));
+}
+
+static void nh6_resolve_cb(void *obj) {
+	struct rte_mbuf *mbuf = obj;
+	const struct rte_ipv6_hdr *ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv6_hdr *);
+	struct nexthop6 *link = ip6_output_mbuf_data(mbuf)->nh;
+	struct in6_addr dst;
+	struct nexthop6 *nh;
+	uint32_t idx;
+
+	// the address may have been removed in the meantime
+	if (!(link->flags & GR_IP6_NH_F_LINK))
+		goto free;
+
+	memcpy(&dst, ip->dst_addr, sizeof(dst));
+	if (ip6_nexthop_lookup_add(link->vrf_id, &dst, link->iface_id, &idx, &nh) < 0)
+		goto free;
+
+	ip6_output_mbuf_data(mbuf)->nh = nh;
+	// If the neighbor was resolved since the packet was posted, it is dropped. This only
+	// happens for the first packets sent to a destination.
+	if (ip6_nexthop_hold(nh, mbuf) == IP6_NH_HELD)
+		return;
+free:
+	rte_pktmbuf_free(mbuf);
+}
+
+int ip6_nexthop_resolve(struct rte_mbuf *mbuf) {
+	return post_to_control(nh6_resolve_cb, mbuf);
+}
+
+static void nh6_learn_cb(void *obj) {
+	struct rte_mbuf *mbuf = obj;
+	const struct ndp_learn_mbuf_data *data = ndp_learn_mbuf_data(mbuf);
+	struct rte_mbuf *head = NULL;
+	struct nexthop6 *nh;
+	uint32_t idx;
+
+	// the neighbor may have been removed in the meantime
+	if (ip6_nexthop_lookup(data->vrf_id, &data->ip, &idx, &nh) < 0)
+		goto free;
+	if (nh->flags & (GR_IP6_NH_F_STATIC | GR_IP6_NH_F_LOCAL))
+		goto free;
+
+	if (rte_is_zero_ether_addr(&data->lladdr)) {
+		// only confirms the reachability of a resolved neighbor
+		if (nh->last_reply == 0)
+			goto free;
+	} else if (nh->iface_id != data->iface_id
+		   || !rte_is_same_ether_addr(&nh->lladdr, &data->lladdr)) {
+		// Workers read these fields without synchronization, only write them when
+		// they change.
+		nh->iface_id = data->iface_id;
+		rte_ether_addr_copy(&data->lladdr, &nh->lladdr);
+	}
+	nh->last_reply = rte_get_tsc_cycles();
+	nh->ucast_probes = 0;
+	nh->mcast_probes = 0;
+	atomic_fetch_or(&nh->flags, GR_IP6_NH_F_REACHABLE);
+	atomic_fetch_and(
+		&nh->flags, ~(GR_IP6_NH_F_STALE | GR_IP6_NH_F_PENDING | GR_IP6_NH_F_FAILED)
+	);
+
+	// Stop holding packets. The ones held in the meantime must be sent by a worker.
+	if (!atomic_compare_exchange_strong(&nh->held_pkts, &head, HELD_PKTS_CLOSED)
+	    && head != HELD_PKTS_CLOSED && ndp_na_input_flush_held(nh) < 0) {
+		LOG(ERR, "ndp_na_input_flush_held: %s", strerror(errno));
+		held_pkts_free(nh, HELD_PKTS_CLOSED);
+	}
+free:
+	rte_pktmbuf_free(mbuf);
+}
+
+int ip6_nexthop_learn(struct rte_mbuf *mbuf) {
+	return post_to_control(nh6_learn_cb, mbuf);
+}
+
+static void nh_probe(struct nexthop6 *nh) {
+	unsigned probes = nh->ucast_probes + nh->mcast_probes;
+	uint64_t now = rte_get_tsc_cycles();
+	uint64_t hz = rte_get_tsc_hz();
+
+	if (!gr_token_bucket_take(&solicit_bucket, now, hz)) {
+		// try again on the next tick, this does not count as a probe
+		nh_timer_arm(nh, hz / NH_TIMER_HZ);
+		return;
+	}
+
+	// Probe counters are only modified here. The datapath reads them to choose between a
+	// unicast and a multicast solicitation.
+	if (nh->last_reply != 0 && nh->ucast_probes < IP6_NH_UCAST_PROBES)
+		nh->ucast_probes++;
+	else
+		nh->mcast_probes++;
+	nh->last_request = now;
+
+	if (ndp_ns_output_solicit(nh) < 0)
+		LOG(ERR, "ndp_ns_output_solicit: %s", strerror(errno));
+	else
+		nh_ctls[nh - nh_array].last_solicit = now;
+
+	// wait one more second after each unanswered probe (RFC 4861 RETRANS_TIMER)
+	nh_timer_arm(nh, (probes + 1) * hz);
+}
+
+static void nh_timer_cb(struct gr_timer *t) {
+	struct nexthop6 *nh = &nh_array[container_of(t, struct nh_ctl, timer) - nh_ctls];
+	uint64_t now = rte_get_tsc_cycles();
+	uint64_t hz = rte_get_tsc_hz();
+	char buf[INET6_ADDRSTRLEN];
+	unsigned probes;
+
+	// Timers are not stopped when next hops are destroyed. The entry may be free or reused.
+	if (nh->ref_count == 0)
+		return;
+	if (nh->flags & (GR_IP6_NH_F_STATIC | GR_IP6_NH_F_LOCAL))
+		return;
+
+	// Not used by any route anymore, let it expire as a regular neighbor.
+	if (nh->flags & GR_IP6_NH_F_GATEWAY && nh->ref_count <= 1)
+		atomic_fetch_and(&nh->flags, ~GR_IP6_NH_F_GATEWAY);
+
+	probes = nh->ucast_probes + nh->mcast_probes;
+
+	if (!(nh->flags & GR_IP6_NH_F_REACHABLE) && atomic_load(&nh->held_pkts_num) > 0
+	    && atomic_load(&nh->held_since) + IP6_NH_HOLD_TIME * hz <= now)
+		held_pkts_free(nh, NULL);
+
+	if (nh->flags & (GR_IP6_NH_F_PENDING | GR_IP6_NH_F_STALE)) {
+		if (probes >= IP6_NH_UCAST_PROBES + IP6_NH_MCAST_PROBES
+		    && !(nh->flags & GR_IP6_NH_F_GATEWAY)) {
+			inet_ntop(AF_INET6, &nh->ip, buf, sizeof(buf));
+			LOG(DEBUG,
+			    "%s vrf=%u failed_probes=%u held_pkts=%u: %s -> failed",
+			    buf,
+			    nh->vrf_id,
+			    probes,
+			    nh->held_pkts_num,
+			    gr_ip6_nh_f_name(
+				    nh->flags & (GR_IP6_NH_F_PENDING | GR_IP6_NH_F_STALE)
+			    ));
+			atomic_fetch_or(&nh->flags, GR_IP6_NH_F_FAILED);
+			atomic_fetch_and(&nh->flags, ~(GR_IP6_NH_F_PENDING | GR_IP6_NH_F_STALE));
+			held_pkts_free(nh, NULL);
+			nh_timer_arm(nh, IP6_NH_LIFETIME_UNREACHABLE * hz);
+		} else {
+			nh_probe(nh);
+		}
+	} else if (nh->flags & GR_IP6_NH_F_REACHABLE) {
+		// the next hop may have been refreshed since the timer was armed
+		if (nh->last_reply + IP6_NH_LIFETIME_REACHABLE * hz > now) {
+			nh_timer_arm(nh, nh->last_reply + IP6_NH_LIFETIME_REACHABLE * hz - now);
+		} else {
+			struct rte_mbuf *closed = HELD_PKTS_CLOSED;
+			atomic_fetch_or(&nh->flags, GR_IP6_NH_F_STALE);
+			atomic_fetch_and(&nh->flags, ~GR_IP6_NH_F_REACHABLE);
+			// hold packets again until the next hop is confirmed
+			atomic_compare_exchange_strong(&nh->held_pkts, &closed, NULL);
+			nh_probe(nh);
+		}
+	} else if (nh->flags & GR_IP6_NH_F_FAILED) {
+		if (nh->ref_count > 1
+		    || nh->last_request + IP6_NH_LIFETIME_UNREACHABLE * hz > now) {
+			nh_timer_arm(nh, IP6_NH_LIFETIME_UNREACHABLE * hz);
+		} else {
+			inet_ntop(AF_INET6, &nh->ip, buf, sizeof(buf));
+			LOG(DEBUG,
+			    "%s vrf=%u failed_probes=%u: failed -> <destroy>",
+			    buf,
+			    nh->vrf_id,
+			    probes);
+			// release the neighbor table reference
+			ip6_nexthop_decref(nh);
+		}
+	} else {
+		// Never resolved. It may still be refreshed by neighbor solicitations.
+		nh_timer_arm(nh, IP6_NH_LIFETIME_REACHABLE * hz);
+	}
+}
+
+static void nh6_solicit_cb(void *obj) {
+	struct nexthop6 *nh = obj;
+
+	// the next hop may have been destroyed or resolved in the meantime
+	if (nh->ref_count == 0 || !(nh->flags & (GR_IP6_NH_F_PENDING | GR_IP6_NH_F_STALE)))
+		return;
+	// A worker may set the pending flag right after the next hop was resolved.
+	if (nh->flags & GR_IP6_NH_F_REACHABLE) {
+		atomic_fetch_and(&nh->flags, ~GR_IP6_NH_F_PENDING);
+		return;
+	}
+
+	// Several workers may ask for the same next hop at once. Probes are retried by the
+	// next hop timer, ignore requests made less than one probe interval after a probe.
+	if (rte_get_tsc_cycles() - nh_ctls[nh - nh_array].last_solicit < rte_get_tsc_hz())
+		return;
+
+	nh_probe(nh);
+}
+
+int ip6_nexthop_solicit(struct nexthop6 *nh) {
+	return post_to_control(nh6_solicit_cb, nh);
+}
+
+static void nh6_release_cb(void *obj) {
+	ip6_nexthop_decref(obj);
+}
+
+void ip6_nexthop_release(struct nexthop6 *nh) {
+	// The reference is leaked if the control plane lags behind. This is better than
+	// modifying the reference count from a worker.
+	if (post_to_control(nh6_release_cb, nh) < 0)
+		LOG(ERR, "post_to_control: %s", strerror(errno));
+}
+
+static void nh_timer_run(evutil_socket_t, short, void *) {
+	gr_timer_wheel_run(&nh_wheel, cycles_to_ticks(rte_get_tsc_cycles()));
+}
+
+static struct event *nh_timer_ev;
+
+static void nh6_init(struct event_base *ev_base) {
+	struct rte_hash_parameters params = {
+		.name = "ip6_nh",
+		.entries = gr_args()->max_nexthops,
+		.key_len = sizeof(struct nexthop_key),
+		.extra_flag = RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF
+			| RTE_HASH_EXTRA_FLAGS_TRANS_MEM_SUPPORT,
+	};
+	nh_hash = rte_hash_create(&params);
+	if (nh_hash == NULL)
+		ABORT("rte_hash_create: %s", rte_strerror(rte_errno));
+
+	nh_array = rte_calloc(
+		"nh6_array",
+		rte_hash_max_key_id(nh_hash) + 1,
+		sizeof(struct nexthop6),
+		RTE_CACHE_LINE_SIZE
+	);
+	if (nh_array == NULL)
+		ABORT("rte_calloc(nh6_array) failed");
+
+	nh_ctls = calloc(rte_hash_max_key_id(nh_hash) + 1, sizeof(*nh_ctls));
+	if (nh_ctls == NULL)
+		ABORT("calloc(nh_ctls) failed");
+	gr_token_bucket_init(
+		&solicit_bucket, IP6_NH_SOLICIT_RATE, IP6_NH_SOLICIT_BURST, rte_get_tsc_cycles()
+	);
+	gr_timer_wheel_init(&nh_wheel, cycles_to_ticks(rte_get_tsc_cycles()));
+
+	nh_timer_ev = event_new(ev_base, -1, EV_PERSIST | EV_FINALIZE, nh_timer_run, NULL);
+	if (nh_timer_ev == NULL)
+		ABORT("event_new() failed");
+	struct timeval tv = {.tv_usec = 1000000 / NH_TIMER_HZ};
+	if (event_add(nh_timer_ev, &tv) < 0)
+		ABORT("event_add() failed");
+}
+
+static void nh6_fini(struct event_base *) {
+	event_free(nh_timer_ev);
+	nh_timer_ev = NULL;
+	rte_hash_free(nh_hash);
+	nh_hash = NULL;
+	rte_free(nh_array);
+	nh_array = NULL;
+	free(nh_ctls);
+	nh_ctls = NULL;
+}
+
+static struct gr_api_handler nh6_add_handler = {
+	.name = "ipv6 nexthop add",
+	.request_type = GR_IP6_NH_ADD,
+	.callback = nh6_add,
+};
+static struct gr_api_handler nh6_del_handler = {
+	.name = "ipv6 nexthop del",
+	.request_type = GR_IP6_NH_DEL,
+	.callback = nh6_del,
+};
+static struct gr_api_handler nh6_list_handler = {
+	.name = "ipv6 nexthop list",
+	.request_type = GR_IP6_NH_LIST,
+	.callback = nh6_list,
+};
+
+static struct gr_module nh6_module = {
+	.name = "ipv6 nexthop",
+	.init = nh6_init,
+	.fini = nh6_fini,
+	.fini_prio = 20000,
+};
+
+RTE_INIT(control_ip6_init) {
+	gr_register_api_handler(&nh6_add_handler);
+	gr_register_api_handler(&nh6_del_handler);
+	gr_register_api_handler(&nh6_list_handler);
+	gr_register_module(&nh6_module);
+}
@@ -0,0 +1,477 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr.h>
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_ip6.h>
+#include <gr_ip6_control.h>
+#include <gr_log.h>
+#include <gr_net_types.h>
+#include <gr_stb_ds.h>
+
+#include <event2/event.h>
+#include <rte_build_config.h>
+#include <rte_errno.h>
+#include <rte_fib6.h>
+#include <rte_malloc.h>
+#include <rte_rib6.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// One FIB per VRF, created when the first route is added.
+static _Atomic(struct rte_fib6 *) *vrf_fibs;
+static uint32_t *vrf_n_routes;
+
+// The lowest bit of TRIE table entries is reserved.
+// Use the largest possible next hop value as blackhole.
+#define BLACKHOLE ((UINT64_C(1) << 31) - 1)
+
+// Max number of addresses looked up at once.
+#define LOOKUP_BULK_SIZE 64
+
+static struct rte_fib6 *get_fib(uint16_t vrf_id) {
+	struct rte_fib6 *fib;
+
+	if (vrf_id >= IP6_MAX_VRFS)
+		return errno_set_null(EOVERFLOW);
+
+	fib = atomic_load_explicit(&vrf_fibs[vrf_id], memory_order_acquire);
+	if (fib == NULL)
+		return errno_set_null(ENONET);
+
+	return fib;
+}
+
+static struct rte_fib6 *get_or_create_fib(uint16_t vrf_id) {
+	struct rte_fib6_conf conf = {
+		.type = RTE_FIB6_TRIE,
+		.default_nh = BLACKHOLE,
+		.max_routes = gr_args()->max_routes,
+		.rib_ext_sz = 0,
+		.trie = {
+			.nh_sz = RTE_FIB6_TRIE_4B,
+			.num_tbl8 = IP6_DEFAULT_NUM_TBL8,
+		},
+	};
+	struct rte_fib6 *fib;
+	char name[64];
+
+	if ((fib = get_fib(vrf_id)) != NULL || errno != ENONET)
+		return fib;
+
+	snprintf(name, sizeof(name), "vrf6_%u", vrf_id);
+	if ((fib = rte_fib6_create(name, SOCKET_ID_ANY, &conf)) == NULL)
+		return errno_set_null(rte_errno);
+
+	atomic_store_explicit(&vrf_fibs[vrf_id], fib, memory_order_release);
+
+	return fib;
+}
+
+struct nexthop6 *ip6_route_lookup(uint16_t vrf_id, const struct in6_addr *ip) {
+	uint8_t key[1][RTE_FIB6_IPV6_ADDR_SIZE];
+	struct rte_fib6 *fib;
+	uint64_t nh_idx;
+
+	if ((fib = get_fib(vrf_id)) == NULL)
+		return NULL;
+
+	memcpy(key[0], ip, sizeof(key[0]));
+	rte_fib6_lookup_bulk(fib, key, &nh_idx, 1);
+	if (nh_idx == BLACKHOLE)
+		return errno_set_null(EHOSTUNREACH);
+
+	return ip6_nexthop_get(nh_idx);
+}
+
+void ip6_route_lookup_bulk(
+	uint16_t vrf_id,
+	uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	struct nexthop6 **nhs,
+	unsigned n
+) {
+	uint64_t nh_idx[LOOKUP_BULK_SIZE];
+	struct rte_fib6 *fib;
+	unsigned i, j, num;
+
+	if (vrf_id >= IP6_MAX_VRFS
+	    || (fib = atomic_load_explicit(&vrf_fibs[vrf_id], memory_order_acquire)) == NULL) {
+		memset(nhs, 0, n * sizeof(*nhs));
+		return;
+	}
+
+	for (i = 0; i < n; i += num) {
+		num = RTE_MIN(n - i, LOOKUP_BULK_SIZE);
+		rte_fib6_lookup_bulk(fib, &ips[i], nh_idx, num);
+		for (j = 0; j < num; j++) {
+			if (nh_idx[j] == BLACKHOLE)
+				nhs[i + j] = NULL;
+			else
+				nhs[i + j] = ip6_nexthop_get(nh_idx[j]);
+		}
+	}
+}
+
+struct nexthop6 *
+ip6_route_lookup_exact(uint16_t vrf_id, const struct in6_addr *ip, uint8_t prefixlen) {
+	struct rte_rib6_node *rn;
+	struct rte_fib6 *fib;
+	uint64_t nh_idx;
+
+	if ((fib = get_fib(vrf_id)) == NULL)
+		return NULL;
+
+	rn = rte_rib6_lookup_exact(rte_fib6_get_rib(fib), ip->s6_addr, prefixlen);
+	if (rn == NULL)
+		return errno_set_null(ENETUNREACH);
+	rte_rib6_get_nh(rn, &nh_idx);
+
+	return ip6_nexthop_get(nh_idx);
+}
+
+int ip6_route_insert(
+	uint16_t vrf_id,
+	const struct in6_addr *ip,
+	uint8_t prefixlen,
+	uint32_t nh_idx,
+	struct nexthop6 *nh
+) {
+	struct rte_fib6 *fib;
+	int ret;
+
+	if ((fib = get_or_create_fib(vrf_id)) == NULL)
+		return -errno;
+	if (ip6_route_lookup_exact(vrf_id, ip, prefixlen) != NULL)
+		return errno_set(EEXIST);
+	if (nh_idx >= BLACKHOLE)
+		return errno_set(ERANGE);
+
+	if ((ret = rte_fib6_add(fib, ip->s6_addr, prefixlen, nh_idx)) < 0)
+		return errno_set(-ret);
+
+	vrf_n_routes[vrf_id]++;
+	ip6_nexthop_incref(nh);
+
+	return 0;
+}
+
+int ip6_route_delete(uint16_t vrf_id, const struct in6_addr *ip, uint8_t prefixlen) {
+	struct nexthop6 *nh;
+	int ret;
+
+	if ((nh = ip6_route_lookup_exact(vrf_id, ip, prefixlen)) == NULL)
+		return errno_set(ENOENT);
+
+	if ((ret = rte_fib6_delete(get_fib(vrf_id), ip->s6_addr, prefixlen)) < 0)
+		return errno_set(-ret);
+
+	vrf_n_routes[vrf_id]--;
+	ip6_nexthop_decref(nh);
+
+	return 0;
+}
+
+// Invoked for every route of a VRF. Returning a negative value stops the walk.
+typedef int (*route_walk_cb_t)(
+	void *priv,
+	const struct in6_addr *ip,
+	uint8_t prefixlen,
+	uint64_t nh_idx
+);
+
+// Routes are walked in rte_rib6_get_nxt() order: a prefix comes after the more specific ones
+// that it covers and sibling prefixes are sorted by address. The default route comes last.
+static bool
+route_walked_after(const struct in6_addr *ip, uint8_t prefixlen, const struct ip6_net *after) {
+	uint8_t depth = RTE_MIN(prefixlen, after->prefixlen);
+
+	for (unsigned i = 0; i < sizeof(ip->s6_addr) && depth > 0; i++) {
+		uint8_t mask = depth >= 8 ? 0xff : (uint8_t)(0xff << (8 - depth));
+		uint8_t a = ip->s6_addr[i] & mask;
+		uint8_t b = after->ip.s6_addr[i] & mask;
+		if (a != b)
+			return a > b;
+		depth -= RTE_MIN(depth, 8);
+	}
+
+	return prefixlen < after->prefixlen;
+}
+
+// Walk the routes of a VRF. If after is not NULL, resume the walk after this route.
+static int
+vrf_routes_walk(uint16_t vrf_id, const struct ip6_net *after, route_walk_cb_t cb, void *priv) {
+	static const uint8_t zero[RTE_FIB6_IPV6_ADDR_SIZE];
+	struct rte_rib6_node *rn = NULL;
+	struct rte_fib6 *fib;
+	struct rte_rib6 *rib;
+	struct in6_addr ip;
+	bool skip = false;
+	uint8_t prefixlen;
+	uint64_t nh_idx;
+	int ret;
+
+	if ((fib = get_fib(vrf_id)) == NULL)
+		return errno == ENONET ? 0 : -errno;
+
+	rib = rte_fib6_get_rib(fib);
+
+	if (after != NULL) {
+		if (after->prefixlen == 0)
+			return 0;
+		rn = rte_rib6_lookup_exact(rib, after->ip.s6_addr, after->prefixlen);
+		// Deleted since it was returned, skip the routes which were walked before it.
+		skip = rn == NULL;
+	}
+
+	while ((rn = rte_rib6_get_nxt(rib, zero, 0, rn, RTE_RIB6_GET_NXT_ALL)) != NULL) {
+		rte_rib6_get_depth(rn, &prefixlen);
+		if (prefixlen == 0)
+			continue; // default route, reported last
+		rte_rib6_get_ip(rn, ip.s6_addr);
+		if (skip && !route_walked_after(&ip, prefixlen, after))
+			continue;
+		skip = false;
+		rte_rib6_get_nh(rn, &nh_idx);
+		if ((ret = cb(priv, &ip, prefixlen, nh_idx)) < 0)
+			return ret;
+	}
+	// FIXME: remove this when rte_rib6_get_nxt returns a default route, if any is configured
+	if ((rn = rte_rib6_lookup_exact(rib, zero, 0)) != NULL) {
+		rte_rib6_get_nh(rn, &nh_idx);
+		if ((ret = cb(priv, &in6addr_any, 0, nh_idx)) < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static struct api_out route6_add(const void *request, void **response) {
+	const struct gr_ip6_route_add_req *req = request;
+	struct nexthop6 *nh, *link;
+	uint32_t nh_idx;
+	int ret;
+
+	(void)response;
+
+	nh = ip6_route_lookup_exact(req->vrf_id, &req->dest.ip, req->dest.prefixlen);
+	if (nh != NULL) {
+		if (req->exist_ok && memcmp(&req->nh, &nh->ip, sizeof(nh->ip)) == 0)
+			return api_out(0, 0);
+		return api_out(EEXIST, 0);
+	}
+
+	if ((link = ip6_route_lookup(req->vrf_id, &req->nh)) == NULL)
+		return api_out(EHOSTUNREACH, 0);
+
+	ret = ip6_nexthop_lookup_add(req->vrf_id, &req->nh, link->iface_id, &nh_idx, &nh);
+	if (ret < 0)
+		return api_out(-ret, 0);
+
+	ret = ip6_route_insert(req->vrf_id, &req->dest.ip, req->dest.prefixlen, nh_idx, nh);
+	if (ret < 0)
+		return api_out(-ret, 0);
+
+	nh->flags |= GR_IP6_NH_F_GATEWAY;
+
+	return api_out(0, 0);
+}
+
+static struct api_out route6_del(const void *request, void **response) {
+	const struct gr_ip6_route_del_req *req = request;
+	struct nexthop6 *nh;
+
+	(void)response;
+
+	nh = ip6_route_lookup_exact(req->vrf_id, &req->dest.ip, req->dest.prefixlen);
+	if (nh == NULL) {
+		if (req->missing_ok)
+			return api_out(0, 0);
+		return api_out(ENOENT, 0);
+	}
+
+	if (!(nh->flags & GR_IP6_NH_F_GATEWAY))
+		return api_out(EBUSY, 0);
+
+	return api_out(-ip6_route_delete(req->vrf_id, &req->dest.ip, req->dest.prefixlen), 0);
+}
+
+static struct api_out route6_get(const void *request, void **response) {
+	const struct gr_ip6_route_get_req *req = request;
+	struct gr_ip6_route_get_resp *resp = NULL;
+	struct nexthop6 *nh;
+
+	if ((nh = ip6_route_lookup(req->vrf_id, &req->dest)) == NULL)
+		return api_out(ENETUNREACH, 0);
+
+	if ((resp = calloc(1, sizeof(*resp))) == NULL)
+		return api_out(ENOMEM, 0);
+
+	resp->nh.host = nh->ip;
+	resp->nh.iface_id = nh->iface_id;
+	resp->nh.vrf_id = nh->vrf_id;
+	rte_ether_addr_copy(&nh->lladdr, &resp->nh.mac);
+	resp->nh.flags = nh->flags;
+
+	*response = resp;
+
+	return api_out(0, sizeof(*resp));
+}
+
+struct route_list_ctx {
+	struct gr_ip6_route_list_resp *resp;
+	uint32_t max_routes;
+};
+
+static int
+route_list_cb(void *priv, const struct in6_addr *ip, uint8_t prefixlen, uint64_t nh_idx) {
+	struct route_list_ctx *ctx = priv;
+	struct gr_ip6_route *r;
+
+	if (ctx->resp->n_routes == ctx->max_routes) {
+		// chunk is full, the next one resumes after the last returned route
+		if (ctx->resp->n_routes > 0)
+			ctx->resp->next = ctx->resp->routes[ctx->resp->n_routes - 1].dest;
+		return errno_set(ENOBUFS);
+	}
+
+	r = &ctx->resp->routes[ctx->resp->n_routes++];
+	r->dest.ip = *ip;
+	r->dest.prefixlen = prefixlen;
+	r->nh = ip6_nexthop_get(nh_idx)->ip;
+
+	return 0;
+}
+
+static struct api_out route6_list(const void *request, void **response) {
+	const struct gr_ip6_route_list_req *req = request;
+	const struct ip6_net *after = NULL;
+	struct route_list_ctx ctx;
+	size_t len;
+	int ret;
+
+	if (req->vrf_id >= IP6_MAX_VRFS)
+		return api_out(EOVERFLOW, 0);
+
+	// The cursor is the last route of the previous chunk. The default route is always
+	// walked last, a zero cursor means the first chunk.
+	if (!IN6_IS_ADDR_UNSPECIFIED(&req->cursor.ip) || req->cursor.prefixlen != 0)
+		after = &req->cursor;
+
+	ctx.max_routes = RTE_MIN(vrf_n_routes[req->vrf_id], GR_API_LIST_MAX(struct gr_ip6_route));
+	len = sizeof(*ctx.resp) + ctx.max_routes * sizeof(struct gr_ip6_route);
+	if ((ctx.resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	ret = vrf_routes_walk(req->vrf_id, after, route_list_cb, &ctx);
+	if (ret < 0 && ret != -ENOBUFS) {
+		free(ctx.resp);
+		return api_out(-ret, 0);
+	}
+
+	*response = ctx.resp;
+
+	return api_out(0, sizeof(*ctx.resp) + ctx.resp->n_routes * sizeof(struct gr_ip6_route));
+}
+
+struct route_entry {
+	struct in6_addr ip;
+	uint8_t prefixlen;
+};
+
+struct cleanup_ctx {
+	const struct nexthop6 *local;
+	struct route_entry *routes;
+};
+
+static int cleanup_cb(void *priv, const struct in6_addr *ip, uint8_t prefixlen, uint64_t nh_idx) {
+	struct cleanup_ctx *ctx = priv;
+	const struct nexthop6 *nh = ip6_nexthop_get(nh_idx);
+	struct route_entry r = {.ip = *ip, .prefixlen = prefixlen};
+
+	if (nh != ctx->local
+	    && ip6_addr_same_subnet(&nh->ip, &ctx->local->ip, ctx->local->prefixlen))
+		arrpush(ctx->routes, r);
+
+	return 0;
+}
+
+void ip6_route_cleanup(uint16_t vrf_id, struct nexthop6 *local) {
+	struct cleanup_ctx ctx = {.local = local, .routes = NULL};
+	struct in6_addr ip = local->ip;
+	uint8_t prefixlen = local->prefixlen;
+	struct route_entry *r;
+
+	// collect first, routes cannot be deleted while walking the rib
+	vrf_routes_walk(vrf_id, NULL, cleanup_cb, &ctx);
+
+	arrforeach (r, ctx.routes)
+		ip6_route_delete(vrf_id, &r->ip, r->prefixlen);
+	arrfree(ctx.routes);
+
+	// the connected route holds the last reference to the local address
+	ip6_route_delete(vrf_id, &ip, prefixlen);
+	ip6_nexthop_cleanup(vrf_id, &ip, prefixlen);
+}
+
+static void route6_init(struct event_base *) {
+	vrf_fibs = rte_calloc(__func__, IP6_MAX_VRFS, sizeof(*vrf_fibs), RTE_CACHE_LINE_SIZE);
+	if (vrf_fibs == NULL)
+		ABORT("rte_calloc(vrf_fibs): %s", rte_strerror(rte_errno));
+	vrf_n_routes = rte_calloc(
+		__func__, IP6_MAX_VRFS, sizeof(*vrf_n_routes), RTE_CACHE_LINE_SIZE
+	);
+	if (vrf_n_routes == NULL)
+		ABORT("rte_calloc(vrf_n_routes): %s", rte_strerror(rte_errno));
+}
+
+static void route6_fini(struct event_base *) {
+	for (uint16_t vrf_id = 0; vrf_id < IP6_MAX_VRFS; vrf_id++) {
+		rte_fib6_free(vrf_fibs[vrf_id]);
+		vrf_fibs[vrf_id] = NULL;
+	}
+	rte_free(vrf_fibs);
+	vrf_fibs = NULL;
+	rte_free(vrf_n_routes);
+	vrf_n_routes = NULL;
+}
+
+static struct gr_api_handler route6_add_handler = {
+	.name = "ipv6 route add",
+	.request_type = GR_IP6_ROUTE_ADD,
+	.callback = route6_add,
+};
+static struct gr_api_handler route6_del_handler = {
+	.name = "ipv6 route del",
+	.request_type = GR_IP6_ROUTE_DEL,
+	.callback = route6_del,
+};
+static struct gr_api_handler route6_get_handler = {
+	.name = "ipv6 route get",
+	.request_type = GR_IP6_ROUTE_GET,
+	.callback = route6_get,
+};
+static struct gr_api_handler route6_list_handler = {
+	.name = "ipv6 route list",
+	.request_type = GR_IP6_ROUTE_LIST,
+	.callback = route6_list,
+};
+
+static struct gr_module route6_module = {
+	.name = "ipv6 route",
+	.init = route6_init,
+	.fini = route6_fini,
+	.fini_prio = 10000,
+};
+
+RTE_INIT(control_ip6_init) {
+	gr_register_api_handler(&route6_add_handler);
+	gr_register_api_handler(&route6_del_handler);
+	gr_register_api_handler(&route6_get_handler);
+	gr_register_api_handler(&route6_list_handler);
+	gr_register_module(&route6_module);
+}
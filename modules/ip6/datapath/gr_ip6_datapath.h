@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_IP6_DATAPATH_H
+#define _GR_IP6_DATAPATH_H
+
+#include <gr_iface.h>
+#include <gr_ip6_control.h>
+#include <gr_mbuf.h>
+#include <gr_net_types.h>
+
+#include <rte_byteorder.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+
+#include <netinet/icmp6.h>
+#include <stdint.h>
+#include <string.h>
+
+GR_MBUF_PRIV_DATA_TYPE(ip6_output_mbuf_data, {
+	struct nexthop6 *nh;
+	const struct iface *input_iface;
+});
+
+GR_MBUF_PRIV_DATA_TYPE(ip6_local_mbuf_data, {
+	struct in6_addr src;
+	struct in6_addr dst;
+	uint16_t len;
+	uint16_t vrf_id;
+	uint8_t proto;
+	uint8_t hop_limit;
+	const struct iface *iface;
+});
+
+// Neighbor discovery information posted to the control plane to refresh a neighbor entry.
+GR_MBUF_PRIV_DATA_TYPE(ndp_learn_mbuf_data, {
+	struct in6_addr ip;
+	// zero when the message only confirms the reachability of a resolved neighbor
+	struct rte_ether_addr lladdr;
+	uint16_t iface_id;
+	uint16_t vrf_id;
+});
+
+GR_MBUF_PRIV_DATA_TYPE(ndp_na_output_mbuf_data, {
+	struct nexthop6 *local;
+	struct in6_addr dst;
+	struct rte_ether_addr lladdr;
+});
+
+void ip6_input_local_add_proto(uint8_t proto, const char *next_node);
+int ndp_ns_output_solicit(struct nexthop6 *nh);
+// Send the packets held by a next hop to ip6_output from a datapath worker.
+int ndp_na_input_flush_held(struct nexthop6 *nh);
+// Ask the control plane to resolve the destination of a packet routed via a connected route.
+int ip6_nexthop_resolve(struct rte_mbuf *);
+// Ask the control plane to refresh a neighbor entry. The mbuf contents are ignored, only
+// ndp_learn_mbuf_data is used.
+int ip6_nexthop_learn(struct rte_mbuf *);
+// Ask the control plane to start probing a next hop.
+int ip6_nexthop_solicit(struct nexthop6 *);
+// Ask the control plane to release a reference held by a worker. Reference counts are only
+// modified by the control plane.
+void ip6_nexthop_release(struct nexthop6 *);
+
+typedef enum {
+	IP6_NH_OK_TO_SEND,
+	IP6_NH_HELD,
+	IP6_NH_HOLD_QUEUE_FULL,
+	IP6_NH_FAILED,
+} ip6_nh_hold_status_t;
+
+// Store a packet in the next hop hold queue until it becomes reachable. This is lock-free and
+// may be called from any thread.
+ip6_nh_hold_status_t ip6_nexthop_hold(struct nexthop6 *, struct rte_mbuf *);
+// Take all held packets in the order they were queued.
+struct rte_mbuf *ip6_nexthop_flush(struct nexthop6 *);
+
+#define IPV6_VERSION_FLOW RTE_BE32(0x60000000)
+#define IPV6_VERSION_MASK RTE_BE32(0xf0000000)
+#define IPV6_DEFAULT_HOP_LIMIT 64
+// Neighbor discovery messages must not have been forwarded (RFC 4861).
+#define IPV6_NDP_HOP_LIMIT 255
+// Every IPv6 link must support this MTU (RFC 8200).
+#define IPV6_MIN_MTU 1280
+
+static inline void ip6_set_fields(struct rte_ipv6_hdr *ip, const struct ip6_local_mbuf_data *data) {
+	ip->vtc_flow = IPV6_VERSION_FLOW;
+	ip->payload_len = rte_cpu_to_be_16(data->len);
+	ip->proto = data->proto;
+	ip->hop_limits = data->hop_limit ? data->hop_limit : IPV6_DEFAULT_HOP_LIMIT;
+	memcpy(ip->src_addr, &data->src, sizeof(ip->src_addr));
+	memcpy(ip->dst_addr, &data->dst, sizeof(ip->dst_addr));
+}
+
+// Upper layer checksum including the IPv6 pseudo header (RFC 8200 section 8.1). Returns zero
+// when verifying a valid packet.
+static inline uint16_t ip6_local_cksum(const struct ip6_local_mbuf_data *data, const void *l4) {
+	struct {
+		struct in6_addr src;
+		struct in6_addr dst;
+		rte_be32_t len;
+		rte_be32_t proto;
+	} phdr = {
+		.src = data->src,
+		.dst = data->dst,
+		.len = rte_cpu_to_be_32(data->len),
+		.proto = rte_cpu_to_be_32(data->proto),
+	};
+	uint32_t sum;
+
+	sum = __rte_raw_cksum(&phdr, sizeof(phdr), 0);
+	sum = __rte_raw_cksum(l4, data->len, sum);
+
+	return ~__rte_raw_cksum_reduce(sum);
+}
+
+static inline bool ip6_addr_is_mcast(const struct in6_addr *ip) {
+	return ip->s6_addr[0] == 0xff;
+}
+
+static inline bool ip6_addr_is_unspec(const struct in6_addr *ip) {
+	static const struct in6_addr unspec = IN6ADDR_ANY_INIT;
+	return memcmp(ip, &unspec, sizeof(*ip)) == 0;
+}
+
+// ff02::1:ffXX:XXXX
+static inline void ip6_solicited_node(struct in6_addr *mcast, const struct in6_addr *ip) {
+	memset(mcast, 0, sizeof(*mcast));
+	mcast->s6_addr[0] = 0xff;
+	mcast->s6_addr[1] = 0x02;
+	mcast->s6_addr[11] = 0x01;
+	mcast->s6_addr[12] = 0xff;
+	memcpy(&mcast->s6_addr[13], &ip->s6_addr[13], 3);
+}
+
+// 33:33:XX:XX:XX:XX (RFC 2464 section 7)
+static inline void ip6_mcast_lladdr(struct rte_ether_addr *mac, const struct in6_addr *mcast) {
+	mac->addr_bytes[0] = 0x33;
+	mac->addr_bytes[1] = 0x33;
+	memcpy(&mac->addr_bytes[2], &mcast->s6_addr[12], 4);
+}
+
+// Neighbor discovery link-layer address option for ethernet (RFC 4861 section 4.6.1).
+struct ndp_opt_lladdr {
+	uint8_t type;
+	uint8_t len; // in units of 8 bytes
+	struct rte_ether_addr mac;
+} __attribute__((packed));
+
+// Find a link-layer address option in a neighbor discovery message.
+static inline const struct ndp_opt_lladdr *
+ndp_opt_lladdr_find(const void *opts, uint16_t len, uint8_t type) {
+	const uint8_t *p = opts;
+
+	while (len >= 8) {
+		const struct ndp_opt_lladdr *opt = (const void *)p;
+		uint16_t opt_len = opt->len * 8;
+		if (opt_len == 0 || opt_len > len)
+			break;
+		if (opt->type == type && opt_len >= sizeof(*opt))
+			return opt;
+		p += opt_len;
+		len -= opt_len;
+	}
+
+	return NULL;
+}
+
+// Neighbor entries are only modified by the control plane. Post the information found in a
+// solicitation or advertisement. The mbuf is consumed on success.
+static inline int ndp_learn_nexthop(
+	struct rte_mbuf *m,
+	uint16_t vrf_id,
+	uint16_t iface_id,
+	const struct in6_addr *ip,
+	const struct rte_ether_addr *lladdr
+) {
+	struct ndp_learn_mbuf_data *data = ndp_learn_mbuf_data(m);
+
+	data->ip = *ip;
+	if (lladdr != NULL)
+		rte_ether_addr_copy(lladdr, &data->lladdr);
+	else
+		memset(&data->lladdr, 0, sizeof(data->lladdr));
+	data->iface_id = iface_id;
+	data->vrf_id = vrf_id;
+
+	return ip6_nexthop_learn(m);
+}
+
+#endif
@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_datapath.h>
+#include <gr_graph.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_byteorder.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+
+#include <netinet/icmp6.h>
+
+enum {
+	OUTPUT = 0,
+	NEIGH_SOLICIT,
+	NEIGH_ADVERT,
+	INVALID,
+	UNSUPPORTED,
+	EDGE_COUNT,
+};
+
+#define ICMP6_MIN_SIZE 8
+
+static uint16_t
+icmp6_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct ip6_local_mbuf_data *ip_data;
+	const struct nexthop6 *local;
+	struct icmp6_hdr *icmp;
+	struct rte_mbuf *mbuf;
+	struct in6_addr ip;
+	rte_edge_t next;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		icmp = rte_pktmbuf_mtod(mbuf, struct icmp6_hdr *);
+		ip_data = ip6_local_mbuf_data(mbuf);
+
+		if (ip_data->len < ICMP6_MIN_SIZE || ip6_local_cksum(ip_data, icmp) != 0) {
+			next = INVALID;
+			goto next;
+		}
+		switch (icmp->icmp6_type) {
+		case ICMP6_ECHO_REQUEST:
+			if (icmp->icmp6_code != 0) {
+				next = INVALID;
+				goto next;
+			}
+			icmp->icmp6_type = ICMP6_ECHO_REPLY;
+			ip = ip_data->dst;
+			ip_data->dst = ip_data->src;
+			if (ip6_addr_is_mcast(&ip)) {
+				// Answer with one of the addresses of the input interface.
+				local = ip6_addr_get_preferred(ip_data->iface->id, &ip_data->dst);
+				if (local == NULL) {
+					next = UNSUPPORTED;
+					goto next;
+				}
+				ip = local->ip;
+			}
+			ip_data->src = ip;
+			ip_data->hop_limit = 0;
+			next = OUTPUT;
+			break;
+		case ND_NEIGHBOR_SOLICIT:
+			next = NEIGH_SOLICIT;
+			break;
+		case ND_NEIGHBOR_ADVERT:
+			next = NEIGH_ADVERT;
+			break;
+		default:
+			next = UNSUPPORTED;
+		}
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static void icmp6_input_register(void) {
+	ip6_input_local_add_proto(IPPROTO_ICMPV6, "icmp6_input");
+}
+
+static struct rte_node_register icmp6_input_node = {
+	.name = "icmp6_input",
+
+	.process = icmp6_input_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[OUTPUT] = "icmp6_output",
+		[NEIGH_SOLICIT] = "ndp_ns_input",
+		[NEIGH_ADVERT] = "ndp_na_input",
+		[INVALID] = "icmp6_input_invalid",
+		[UNSUPPORTED] = "icmp6_input_unsupported",
+	},
+};
+
+static struct gr_node_info icmp6_input_info = {
+	.node = &icmp6_input_node,
+	.register_callback = icmp6_input_register,
+};
+
+GR_NODE_REGISTER(icmp6_input_info);
+
+GR_DROP_REGISTER(icmp6_input_invalid);
+GR_DROP_REGISTER(icmp6_input_unsupported);
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_datapath.h>
+#include <gr_graph.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+
+#include <netinet/icmp6.h>
+#include <netinet/in.h>
+
+enum {
+	OUTPUT = 0,
+	NO_HEADROOM,
+	EDGE_COUNT,
+};
+
+static uint16_t icmp6_output_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	struct ip6_local_mbuf_data *local_data;
+	struct icmp6_hdr *icmp;
+	struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	struct nexthop6 *nh;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		local_data = ip6_local_mbuf_data(mbuf);
+
+		icmp = rte_pktmbuf_mtod(mbuf, struct icmp6_hdr *);
+		icmp->icmp6_cksum = 0;
+		icmp->icmp6_cksum = ip6_local_cksum(local_data, icmp);
+
+		ip = (struct rte_ipv6_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*ip));
+		if (unlikely(ip == NULL)) {
+			rte_node_enqueue_x1(graph, node, NO_HEADROOM, mbuf);
+			continue;
+		}
+		ip6_set_fields(ip, local_data);
+		nh = ip6_route_lookup(local_data->vrf_id, &local_data->dst);
+		ip6_output_mbuf_data(mbuf)->nh = nh;
+		rte_node_enqueue_x1(graph, node, OUTPUT, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static struct rte_node_register icmp6_output_node = {
+	.name = "icmp6_output",
+
+	.process = icmp6_output_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[OUTPUT] = "ip6_output",
+		[NO_HEADROOM] = "error_no_headroom",
+	},
+};
+
+static struct gr_node_info icmp6_output_info = {
+	.node = &icmp6_output_node,
+};
+
+GR_NODE_REGISTER(icmp6_output_info);
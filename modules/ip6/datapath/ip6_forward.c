@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_graph.h>
+
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+enum edges {
+	OUTPUT = 0,
+	HOP_LIMIT_EXCEEDED,
+	EDGE_COUNT,
+};
+
+static uint16_t
+ip6_forward_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	uint16_t i;
+
+	for (i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv6_hdr *);
+
+		if (ip->hop_limits <= 1) {
+			rte_node_enqueue_x1(graph, node, HOP_LIMIT_EXCEEDED, mbuf);
+			continue;
+		}
+		// No header checksum in IPv6.
+		ip->hop_limits -= 1;
+		rte_node_enqueue_x1(graph, node, OUTPUT, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static struct rte_node_register forward_node = {
+	.name = "ip6_forward",
+
+	.process = ip6_forward_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[OUTPUT] = "ip6_output",
+		[HOP_LIMIT_EXCEEDED] = "ip6_forward_hop_limit_exceeded",
+	},
+};
+
+static struct gr_node_info info = {
+	.node = &forward_node,
+};
+
+GR_NODE_REGISTER(info);
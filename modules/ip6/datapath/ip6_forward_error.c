@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_datapath.h>
+#include <gr_graph.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_common.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+
+#include <netinet/icmp6.h>
+
+enum edges {
+	ICMP_OUTPUT = 0,
+	NO_HEADROOM,
+	NO_IP,
+	SUPPRESSED,
+	EDGE_COUNT,
+};
+
+// RFC 4443 section 2.4 (c), error messages must not exceed the minimum IPv6 MTU.
+#define ICMP6_ERROR_MAX_PAYLOAD                                                                    \
+	(IPV6_MIN_MTU - sizeof(struct rte_ipv6_hdr) - sizeof(struct icmp6_hdr))
+
+static uint16_t ip6_forward_error_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	struct ip6_local_mbuf_data *ip_data;
+	const struct iface *input_iface;
+	const struct nexthop6 *local;
+	const struct in6_addr *src;
+	struct rte_ipv6_hdr *ip;
+	struct icmp6_hdr *icmp;
+	struct rte_mbuf *mbuf;
+	uint8_t icmp_type;
+	rte_edge_t next;
+	uint32_t len;
+
+	icmp_type = node->ctx[0];
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+
+		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv6_hdr *);
+		src = (const struct in6_addr *)ip->src_addr;
+		// RFC 4443 section 2.4 (e), never reply to packets that do not identify
+		// a single node.
+		if (ip6_addr_is_unspec(src) || ip6_addr_is_mcast(src)) {
+			next = SUPPRESSED;
+			goto next;
+		}
+
+		// Get the local router IP address from the input iface
+		input_iface = ip6_output_mbuf_data(mbuf)->input_iface;
+		if ((local = ip6_addr_get_preferred(input_iface->id, src)) == NULL) {
+			next = NO_IP;
+			goto next;
+		}
+
+		// Include as much of the invoking packet as possible.
+		len = rte_pktmbuf_pkt_len(mbuf);
+		if (len > ICMP6_ERROR_MAX_PAYLOAD) {
+			rte_pktmbuf_trim(mbuf, len - ICMP6_ERROR_MAX_PAYLOAD);
+			len = ICMP6_ERROR_MAX_PAYLOAD;
+		}
+
+		ip_data = ip6_local_mbuf_data(mbuf);
+		ip_data->vrf_id = input_iface->vrf_id;
+		ip_data->iface = input_iface;
+		ip_data->dst = *src;
+		ip_data->src = local->ip;
+		ip_data->len = sizeof(*icmp) + len;
+		ip_data->proto = IPPROTO_ICMPV6;
+		ip_data->hop_limit = 0;
+
+		icmp = (struct icmp6_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*icmp));
+		if (unlikely(icmp == NULL)) {
+			next = NO_HEADROOM;
+			goto next;
+		}
+		icmp->icmp6_type = icmp_type;
+		icmp->icmp6_code = 0; // hop limit exceeded in transit or no route to destination
+		icmp->icmp6_cksum = 0;
+		icmp->icmp6_data32[0] = 0;
+		next = ICMP_OUTPUT;
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static int hop_limit_exceeded_init(const struct rte_graph *, struct rte_node *node) {
+	node->ctx[0] = ICMP6_TIME_EXCEEDED;
+	return 0;
+}
+
+static int no_route_init(const struct rte_graph *, struct rte_node *node) {
+	node->ctx[0] = ICMP6_DST_UNREACH;
+	return 0;
+}
+
+static struct rte_node_register hop_limit_exceeded_node = {
+	.name = "ip6_forward_hop_limit_exceeded",
+	.process = ip6_forward_error_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[ICMP_OUTPUT] = "icmp6_output",
+		[NO_HEADROOM] = "error_no_headroom",
+		[NO_IP] = "error_no_local_ip",
+		[SUPPRESSED] = "icmp6_error_suppressed",
+	},
+	.init = hop_limit_exceeded_init,
+};
+
+static struct rte_node_register no_route_node = {
+	.name = "ip6_input_no_route",
+	.process = ip6_forward_error_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[ICMP_OUTPUT] = "icmp6_output",
+		[NO_HEADROOM] = "error_no_headroom",
+		[NO_IP] = "error_no_local_ip",
+		[SUPPRESSED] = "icmp6_error_suppressed",
+	},
+	.init = no_route_init,
+};
+
+static struct gr_node_info info_hop_limit_exceeded = {
+	.node = &hop_limit_exceeded_node,
+};
+
+static struct gr_node_info info_no_route = {
+	.node = &no_route_node,
+};
+
+GR_NODE_REGISTER(info_hop_limit_exceeded);
+GR_NODE_REGISTER(info_no_route);
+
+GR_DROP_REGISTER(icmp6_error_suppressed);
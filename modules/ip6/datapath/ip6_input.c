@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_eth_input.h>
+#include <gr_graph.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+
+#include <rte_byteorder.h>
+#include <rte_ether.h>
+#include <rte_fib6.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+enum edges {
+	FORWARD = 0,
+	LOCAL,
+	NO_ROUTE,
+	BAD_VERSION,
+	BAD_LENGTH,
+	BAD_ADDR,
+	EDGE_COUNT,
+};
+
+// Packets destined to the same VRF are resolved with a single FIB lookup.
+struct lookup_batch {
+	uint16_t vrf_id;
+	unsigned n;
+	struct rte_mbuf *mbufs[RTE_GRAPH_BURST_SIZE];
+	uint8_t dst[RTE_GRAPH_BURST_SIZE][RTE_FIB6_IPV6_ADDR_SIZE];
+	struct nexthop6 *nhs[RTE_GRAPH_BURST_SIZE];
+};
+
+static void batch_flush(struct rte_graph *graph, struct rte_node *node, struct lookup_batch *b) {
+	const struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	struct nexthop6 *nh;
+	rte_edge_t next;
+
+	ip6_route_lookup_bulk(b->vrf_id, b->dst, b->nhs, b->n);
+
+	for (unsigned i = 0; i < b->n; i++) {
+		mbuf = b->mbufs[i];
+		nh = b->nhs[i];
+		if (nh == NULL) {
+			next = NO_ROUTE;
+		} else {
+			// If the resolved next hop is local and the destination IP is ourselves,
+			// send to ip6_local.
+			ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv6_hdr *);
+			if (nh->flags & GR_IP6_NH_F_LOCAL
+			    && memcmp(ip->dst_addr, &nh->ip, sizeof(nh->ip)) == 0)
+				next = LOCAL;
+			else
+				next = FORWARD;
+		}
+		// Store the resolved next hop for ip6_output to avoid a second route lookup.
+		ip6_output_mbuf_data(mbuf)->nh = nh;
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	b->n = 0;
+}
+
+static uint16_t
+ip6_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct lookup_batch batch = {.n = 0};
+	const struct iface *iface;
+	struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	rte_edge_t next;
+	uint32_t len;
+	uint16_t i;
+
+	for (i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		iface = eth_input_mbuf_data(mbuf)->iface;
+
+		// RFC 8200 section 3, IPv6 Header Format
+		if (unlikely(rte_pktmbuf_data_len(mbuf) < sizeof(*ip))) {
+			next = BAD_LENGTH;
+			goto next_packet;
+		}
+		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv6_hdr *);
+		if (unlikely((ip->vtc_flow & IPV6_VERSION_MASK) != IPV6_VERSION_FLOW)) {
+			next = BAD_VERSION;
+			goto next_packet;
+		}
+		// The payload length must fit in the received frame. Remove the ethernet padding
+		// if any. Jumbograms (payload length 0) are not supported.
+		len = sizeof(*ip) + rte_be_to_cpu_16(ip->payload_len);
+		if (unlikely(len > rte_pktmbuf_pkt_len(mbuf))) {
+			next = BAD_LENGTH;
+			goto next_packet;
+		}
+		if (len < rte_pktmbuf_pkt_len(mbuf))
+			rte_pktmbuf_trim(mbuf, rte_pktmbuf_pkt_len(mbuf) - len);
+
+		// RFC 4291 section 2.7, multicast addresses must not be used as source addresses
+		if (unlikely(ip6_addr_is_mcast((const struct in6_addr *)ip->src_addr))) {
+			next = BAD_ADDR;
+			goto next_packet;
+		}
+
+		ip6_output_mbuf_data(mbuf)->input_iface = iface;
+
+		if (ip6_addr_is_mcast((const struct in6_addr *)ip->dst_addr)) {
+			// Multicast routing is not supported. Only link scope groups joined by
+			// the interface addresses are accepted by the port filters.
+			ip6_output_mbuf_data(mbuf)->nh = NULL;
+			next = LOCAL;
+			goto next_packet;
+		}
+
+		if (batch.n == RTE_DIM(batch.mbufs)
+		    || (batch.n > 0 && batch.vrf_id != iface->vrf_id))
+			batch_flush(graph, node, &batch);
+
+		batch.vrf_id = iface->vrf_id;
+		batch.mbufs[batch.n] = mbuf;
+		memcpy(batch.dst[batch.n], ip->dst_addr, sizeof(batch.dst[0]));
+		batch.n++;
+		continue;
+next_packet:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	if (batch.n > 0)
+		batch_flush(graph, node, &batch);
+
+	return nb_objs;
+}
+
+static void ip6_input_register(void) {
+	gr_eth_input_add_type(RTE_BE16(RTE_ETHER_TYPE_IPV6), "ip6_input");
+}
+
+static struct rte_node_register input_node = {
+	.name = "ip6_input",
+
+	.process = ip6_input_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[FORWARD] = "ip6_forward",
+		[LOCAL] = "ip6_input_local",
+		[NO_ROUTE] = "ip6_input_no_route",
+		[BAD_VERSION] = "ip6_input_bad_version",
+		[BAD_LENGTH] = "ip6_input_bad_length",
+		[BAD_ADDR] = "ip6_input_bad_addr",
+	},
+};
+
+static struct gr_node_info info = {
+	.node = &input_node,
+	.register_callback = ip6_input_register,
+};
+
+GR_NODE_REGISTER(info);
+
+GR_DROP_REGISTER(ip6_input_bad_version);
+GR_DROP_REGISTER(ip6_input_bad_length);
+GR_DROP_REGISTER(ip6_input_bad_addr);
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_datapath.h>
+#include <gr_eth_output.h>
+#include <gr_graph.h>
+#include <gr_iface.h>
+#include <gr_ip6.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_byteorder.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+enum {
+	ETH_OUTPUT = 0,
+	NO_ROUTE,
+	ERROR,
+	QUEUE_FULL,
+	NH_FAILED,
+	EDGE_COUNT,
+};
+
+static uint16_t
+ip6_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct eth_output_mbuf_data *eth_data;
+	const struct iface *iface;
+	struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	struct nexthop6 *nh;
+	uint16_t i, sent;
+	rte_edge_t next;
+	uint32_t idx;
+
+	sent = 0;
+
+	for (i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv6_hdr *);
+
+		nh = ip6_output_mbuf_data(mbuf)->nh;
+		if (nh == NULL) {
+			next = NO_ROUTE;
+			goto next;
+		}
+		iface = iface_from_id(nh->iface_id);
+		if (iface == NULL) {
+			next = ERROR;
+			goto next;
+		}
+
+		if (nh->flags & GR_IP6_NH_F_LINK && memcmp(ip->dst_addr, &nh->ip, sizeof(nh->ip))) {
+			// The resolved next hop is associated with a "connected" route.
+			// Look for the destination in the neighbor table. If it is not known
+			// yet, the control plane will create the entry and hold the packet
+			// until the destination is resolved.
+			const struct in6_addr *dst = (const struct in6_addr *)ip->dst_addr;
+			struct nexthop6 *remote;
+			if (ip6_nexthop_lookup(nh->vrf_id, dst, &idx, &remote) < 0) {
+				if (ip6_nexthop_resolve(mbuf) < 0) {
+					next = QUEUE_FULL;
+					goto next;
+				}
+				continue;
+			}
+			ip6_output_mbuf_data(mbuf)->nh = remote;
+			nh = remote;
+		}
+
+		switch (ip6_nexthop_hold(nh, mbuf)) {
+		case IP6_NH_HELD:
+			// The packet was stored in the next hop hold queue to be flushed upon
+			// reception of a neighbor solicitation or advertisement from the
+			// destination IP.
+			continue;
+		case IP6_NH_HOLD_QUEUE_FULL:
+			next = QUEUE_FULL;
+			goto next;
+		case IP6_NH_FAILED:
+			// Resolution failed recently, drop until the next hop expires.
+			next = NH_FAILED;
+			goto next;
+		case IP6_NH_OK_TO_SEND:
+			// Next hop is reachable.
+			break;
+		}
+
+		// Prepare ethernet layer info.
+		eth_data = eth_output_mbuf_data(mbuf);
+		rte_ether_addr_copy(&nh->lladdr, &eth_data->dst);
+		eth_data->ether_type = RTE_BE16(RTE_ETHER_TYPE_IPV6);
+		eth_data->iface = iface;
+		sent++;
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return sent;
+}
+
+static struct rte_node_register output_node = {
+	.name = "ip6_output",
+	.process = ip6_output_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[ETH_OUTPUT] = "eth_output",
+		[ERROR] = "ip6_output_error",
+		[NO_ROUTE] = "ip6_output_no_route",
+		[QUEUE_FULL] = "ndp_queue_full",
+		[NH_FAILED] = "ndp_failed",
+	},
+};
+
+static struct gr_node_info info = {
+	.node = &output_node,
+};
+
+GR_NODE_REGISTER(info);
+
+GR_DROP_REGISTER(ip6_output_error);
+GR_DROP_REGISTER(ip6_output_no_route);
+GR_DROP_REGISTER(ndp_queue_full);
+GR_DROP_REGISTER(ndp_failed);
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_control_input.h>
+#include <gr_graph.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_errno.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+
+#include <netinet/icmp6.h>
+
+enum {
+	DONE = 0,
+	INVALID,
+	UNKNOWN,
+	EDGE_COUNT,
+};
+
+static uint16_t ndp_na_input_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	const struct ip6_local_mbuf_data *data;
+	const struct rte_ether_addr *lladdr;
+	const struct ndp_opt_lladdr *tlla;
+	struct nd_neighbor_advert *na;
+	struct rte_mbuf *mbuf;
+	uint16_t vrf_id, iface_id;
+	struct nexthop6 *nh;
+	rte_edge_t next;
+	uint32_t idx;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		na = rte_pktmbuf_mtod(mbuf, struct nd_neighbor_advert *);
+		data = ip6_local_mbuf_data(mbuf);
+
+		// RFC 4861 section 7.1.2, Validation of Neighbor Advertisements
+		if (data->hop_limit != IPV6_NDP_HOP_LIMIT || na->nd_na_code != 0
+		    || data->len < sizeof(*na) || ip6_addr_is_mcast(&na->nd_na_target)
+		    || (ip6_addr_is_mcast(&data->dst)
+			&& na->nd_na_flags_reserved & ND_NA_FLAG_SOLICITED)) {
+			next = INVALID;
+			goto next;
+		}
+
+		// Neighbor entries are only created by the control plane. Unsolicited
+		// advertisements for unknown targets are ignored.
+		if (ip6_nexthop_lookup(data->vrf_id, &na->nd_na_target, &idx, &nh) < 0) {
+			next = UNKNOWN;
+			goto next;
+		}
+
+		// Static next hops never need updating.
+		if (nh->flags & (GR_IP6_NH_F_STATIC | GR_IP6_NH_F_LOCAL)) {
+			next = DONE;
+			goto next;
+		}
+
+		// Without target link-layer address, the advertisement only confirms the
+		// reachability of a neighbor that is already known.
+		tlla = ndp_opt_lladdr_find(na + 1, data->len - sizeof(*na), ND_OPT_TARGET_LINKADDR);
+		lladdr = tlla != NULL ? &tlla->mac : NULL;
+		if (lladdr == NULL && nh->last_reply == 0) {
+			next = DONE;
+			goto next;
+		}
+		// consumed by the control plane
+		vrf_id = data->vrf_id;
+		iface_id = data->iface->id;
+		if (ndp_learn_nexthop(mbuf, vrf_id, iface_id, &na->nd_na_target, lladdr) == 0)
+			continue;
+		next = DONE;
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static struct rte_node_register node = {
+	.name = "ndp_na_input",
+
+	.process = ndp_na_input_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[DONE] = "ndp_na_input_done",
+		[INVALID] = "ndp_na_input_invalid",
+		[UNKNOWN] = "ndp_na_input_unknown",
+	},
+};
+
+static struct gr_node_info info = {
+	.node = &node,
+};
+
+GR_NODE_REGISTER(info);
+
+static control_input_t ndp_flush;
+
+int ndp_na_input_flush_held(struct nexthop6 *nh) {
+	int ret;
+	if (nh == NULL)
+		return errno_set(EINVAL);
+	ip6_nexthop_incref(nh);
+	ret = post_to_stack(ndp_flush, nh);
+	if (ret < 0) {
+		ip6_nexthop_decref(nh);
+		return errno_set(-ret);
+	}
+	return 0;
+}
+
+enum {
+	FLUSH_IP6_OUTPUT = 0,
+	FLUSH_EDGE_COUNT,
+};
+
+static uint16_t ndp_na_input_flush_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	struct rte_mbuf *mbuf, *m, *next;
+	struct nexthop6 *nh;
+	uint16_t sent = 0;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		nh = control_input_mbuf_data(mbuf)->data;
+
+		m = ip6_nexthop_flush(nh);
+		while (m != NULL) {
+			next = queue_mbuf_data(m)->next;
+			ip6_output_mbuf_data(m)->nh = nh;
+			rte_node_enqueue_x1(graph, node, FLUSH_IP6_OUTPUT, m);
+			m = next;
+			sent++;
+		}
+		ip6_nexthop_release(nh);
+
+		// the control message buffer does not hold any packet
+		rte_pktmbuf_free(mbuf);
+	}
+
+	return sent;
+}
+
+static void ndp_na_input_flush_register(void) {
+	ndp_flush = gr_control_input_register_handler("ndp_na_input_flush");
+}
+
+static struct rte_node_register flush_node = {
+	.name = "ndp_na_input_flush",
+	.process = ndp_na_input_flush_process,
+	.nb_edges = FLUSH_EDGE_COUNT,
+	.next_nodes = {
+		[FLUSH_IP6_OUTPUT] = "ip6_output",
+	},
+};
+
+static struct gr_node_info flush_info = {
+	.node = &flush_node,
+	.register_callback = ndp_na_input_flush_register,
+};
+
+GR_NODE_REGISTER(flush_info);
+
+GR_DROP_REGISTER(ndp_na_input_done);
+GR_DROP_REGISTER(ndp_na_input_invalid);
+GR_DROP_REGISTER(ndp_na_input_unknown);
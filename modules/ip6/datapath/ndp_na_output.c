@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_datapath.h>
+#include <gr_eth_output.h>
+#include <gr_graph.h>
+#include <gr_iface.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+
+#include <rte_byteorder.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+#include <netinet/icmp6.h>
+
+enum {
+	OUTPUT = 0,
+	ERROR,
+	EDGE_COUNT,
+};
+
+static uint16_t ndp_na_output_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	struct ndp_na_output_mbuf_data na_data;
+	struct eth_output_mbuf_data *eth_data;
+	struct ip6_local_mbuf_data ip_data;
+	struct nd_neighbor_advert *na;
+	struct ndp_opt_lladdr *tlla;
+	const struct iface *iface;
+	struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	rte_edge_t next;
+	uint16_t num;
+
+	num = 0;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		// Copy the private data, it shares the same area with eth_output_mbuf_data.
+		na_data = *ndp_na_output_mbuf_data(mbuf);
+
+		iface = iface_from_id(na_data.local->iface_id);
+		if (iface == NULL) {
+			next = ERROR;
+			goto next;
+		}
+
+		// Reuse the solicitation mbuf to craft the advertisement.
+		if (rte_pktmbuf_trim(mbuf, rte_pktmbuf_pkt_len(mbuf)) < 0) {
+			next = ERROR;
+			goto next;
+		}
+		na = (struct nd_neighbor_advert *)rte_pktmbuf_append(
+			mbuf, sizeof(*na) + sizeof(*tlla)
+		);
+		if (na == NULL) {
+			next = ERROR;
+			goto next;
+		}
+		na->nd_na_type = ND_NEIGHBOR_ADVERT;
+		na->nd_na_code = 0;
+		na->nd_na_cksum = 0;
+		na->nd_na_flags_reserved = ND_NA_FLAG_ROUTER | ND_NA_FLAG_OVERRIDE;
+		if (!ip6_addr_is_mcast(&na_data.dst))
+			na->nd_na_flags_reserved |= ND_NA_FLAG_SOLICITED;
+		na->nd_na_target = na_data.local->ip;
+		tlla = (struct ndp_opt_lladdr *)(na + 1);
+		tlla->type = ND_OPT_TARGET_LINKADDR;
+		tlla->len = sizeof(*tlla) / 8;
+		if (iface_get_eth_addr(iface->id, &tlla->mac) < 0) {
+			next = ERROR;
+			goto next;
+		}
+
+		ip_data.src = na_data.local->ip;
+		ip_data.dst = na_data.dst;
+		ip_data.len = sizeof(*na) + sizeof(*tlla);
+		ip_data.vrf_id = na_data.local->vrf_id;
+		ip_data.proto = IPPROTO_ICMPV6;
+		ip_data.hop_limit = IPV6_NDP_HOP_LIMIT;
+		ip_data.iface = iface;
+		na->nd_na_cksum = ip6_local_cksum(&ip_data, na);
+
+		ip = (struct rte_ipv6_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*ip));
+		if (ip == NULL) {
+			next = ERROR;
+			goto next;
+		}
+		ip6_set_fields(ip, &ip_data);
+
+		// Prepare ethernet layer info.
+		eth_data = eth_output_mbuf_data(mbuf);
+		rte_ether_addr_copy(&na_data.lladdr, &eth_data->dst);
+		eth_data->ether_type = RTE_BE16(RTE_ETHER_TYPE_IPV6);
+		eth_data->iface = iface;
+		next = OUTPUT;
+		num++;
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return num;
+}
+
+static struct rte_node_register node = {
+	.name = "ndp_na_output",
+	.process = ndp_na_output_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[OUTPUT] = "eth_output",
+		[ERROR] = "ndp_na_output_error",
+	},
+};
+
+static struct gr_node_info info = {
+	.node = &node,
+};
+
+GR_NODE_REGISTER(info);
+
+GR_DROP_REGISTER(ndp_na_output_error);
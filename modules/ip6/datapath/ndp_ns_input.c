@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_graph.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+
+#include <netinet/icmp6.h>
+
+enum {
+	OUTPUT = 0,
+	INVALID,
+	NOT_FOR_US,
+	EDGE_COUNT,
+};
+
+// ff02::1
+static const struct in6_addr all_nodes = {.s6_addr = {0xff, 0x02, [15] = 0x01}};
+
+// The solicitation is answered, the control plane gets its own buffer. Learning is best
+// effort.
+static inline void learn_nexthop(
+	struct rte_mbuf *mbuf,
+	const struct ip6_local_mbuf_data *data,
+	const struct rte_ether_addr *lladdr
+) {
+	struct rte_mbuf *m = rte_pktmbuf_alloc(mbuf->pool);
+
+	if (m == NULL)
+		return;
+	if (ndp_learn_nexthop(m, data->vrf_id, data->iface->id, &data->src, lladdr) < 0)
+		rte_pktmbuf_free(m);
+}
+
+static uint16_t ndp_ns_input_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	struct ndp_na_output_mbuf_data *na_data;
+	const struct ndp_opt_lladdr *slla;
+	struct ip6_local_mbuf_data data;
+	struct nexthop6 *local, *remote;
+	struct nd_neighbor_solicit *ns;
+	struct rte_ether_addr lladdr;
+	struct rte_mbuf *mbuf;
+	rte_edge_t next;
+	uint32_t idx;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		ns = rte_pktmbuf_mtod(mbuf, struct nd_neighbor_solicit *);
+		// Copy the local data, it shares the private area with ndp_na_output_mbuf_data.
+		data = *ip6_local_mbuf_data(mbuf);
+
+		// RFC 4861 section 7.1.1, Validation of Neighbor Solicitations
+		if (data.hop_limit != IPV6_NDP_HOP_LIMIT || ns->nd_ns_code != 0
+		    || data.len < sizeof(*ns) || ip6_addr_is_mcast(&ns->nd_ns_target)) {
+			next = INVALID;
+			goto next;
+		}
+		slla = ndp_opt_lladdr_find(ns + 1, data.len - sizeof(*ns), ND_OPT_SOURCE_LINKADDR);
+		if (ip6_addr_is_unspec(&data.src)
+		    && (slla != NULL || !ip6_addr_is_mcast(&data.dst))) {
+			next = INVALID;
+			goto next;
+		}
+
+		if (ip6_nexthop_lookup(data.vrf_id, &ns->nd_ns_target, &idx, &local) < 0
+		    || !(local->flags & GR_IP6_NH_F_LOCAL) || local->iface_id != data.iface->id) {
+			next = NOT_FOR_US;
+			goto next;
+		}
+
+		if (ip6_addr_is_unspec(&data.src)) {
+			// Duplicate address detection from another node, the reply is multicast
+			// to all nodes.
+			data.src = all_nodes;
+			ip6_mcast_lladdr(&lladdr, &all_nodes);
+		} else if (ip6_nexthop_lookup(data.vrf_id, &data.src, &idx, &remote) == 0) {
+			if (slla != NULL
+			    && !(remote->flags & (GR_IP6_NH_F_STATIC | GR_IP6_NH_F_LOCAL))) {
+				learn_nexthop(mbuf, &data, &slla->mac);
+				rte_ether_addr_copy(&slla->mac, &lladdr);
+			} else if (remote->flags & GR_IP6_NH_F_REACHABLE) {
+				rte_ether_addr_copy(&remote->lladdr, &lladdr);
+			} else {
+				next = INVALID;
+				goto next;
+			}
+		} else if (slla != NULL) {
+			// Neighbor entries are only created by the control plane. Solicitations
+			// from unknown neighbors are answered without learning them.
+			rte_ether_addr_copy(&slla->mac, &lladdr);
+		} else {
+			next = INVALID;
+			goto next;
+		}
+
+		na_data = ndp_na_output_mbuf_data(mbuf);
+		na_data->local = local;
+		na_data->dst = data.src;
+		rte_ether_addr_copy(&lladdr, &na_data->lladdr);
+		next = OUTPUT;
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static struct rte_node_register node = {
+	.name = "ndp_ns_input",
+
+	.process = ndp_ns_input_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[OUTPUT] = "ndp_na_output",
+		[INVALID] = "ndp_ns_input_invalid",
+		[NOT_FOR_US] = "ndp_ns_input_not_for_us",
+	},
+};
+
+static struct gr_node_info info = {
+	.node = &node,
+};
+
+GR_NODE_REGISTER(info);
+
+GR_DROP_REGISTER(ndp_ns_input_invalid);
+GR_DROP_REGISTER(ndp_ns_input_not_for_us);
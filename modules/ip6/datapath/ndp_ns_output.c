@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_control_input.h>
+#include <gr_datapath.h>
+#include <gr_eth_output.h>
+#include <gr_graph.h>
+#include <gr_iface.h>
+#include <gr_ip6_control.h>
+#include <gr_ip6_datapath.h>
+#include <gr_log.h>
+
+#include <rte_byteorder.h>
+#include <rte_errno.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+
+#include <netinet/icmp6.h>
+
+enum {
+	OUTPUT = 0,
+	ERROR,
+	EDGE_COUNT,
+};
+
+static control_input_t ndp_solicit;
+
+int ndp_ns_output_solicit(struct nexthop6 *nh) {
+	int ret;
+	if (nh == NULL)
+		return errno_set(EINVAL);
+	ip6_nexthop_incref(nh);
+	ret = post_to_stack(ndp_solicit, nh);
+	if (ret < 0) {
+		ip6_nexthop_decref(nh);
+		return errno_set(-ret);
+	}
+	return 0;
+}
+
+static uint16_t ndp_ns_output_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t n_objs
+) {
+	struct eth_output_mbuf_data *eth_data;
+	struct ip6_local_mbuf_data ip_data;
+	struct nd_neighbor_solicit *ns;
+	struct ndp_opt_lladdr *slla;
+	struct nexthop6 *local, *nh;
+	const struct iface *iface;
+	struct rte_ipv6_hdr *ip;
+	struct rte_mbuf *mbuf;
+	rte_edge_t next;
+	uint16_t sent;
+
+	sent = 0;
+
+	for (unsigned i = 0; i < n_objs; i++) {
+		mbuf = objs[i];
+		nh = (struct nexthop6 *)control_input_mbuf_data(mbuf)->data;
+		local = ip6_addr_get_preferred(nh->iface_id, &nh->ip);
+		iface = iface_from_id(nh->iface_id);
+		if (local == NULL || iface == NULL) {
+			next = ERROR;
+			goto release;
+		}
+
+		ns = (struct nd_neighbor_solicit *)rte_pktmbuf_append(
+			mbuf, sizeof(*ns) + sizeof(*slla)
+		);
+		if (ns == NULL) {
+			next = ERROR;
+			goto release;
+		}
+		ns->nd_ns_type = ND_NEIGHBOR_SOLICIT;
+		ns->nd_ns_code = 0;
+		ns->nd_ns_cksum = 0;
+		ns->nd_ns_reserved = 0;
+		ns->nd_ns_target = nh->ip;
+		slla = (struct ndp_opt_lladdr *)(ns + 1);
+		slla->type = ND_OPT_SOURCE_LINKADDR;
+		slla->len = sizeof(*slla) / 8;
+		if (iface_get_eth_addr(iface->id, &slla->mac) < 0) {
+			next = ERROR;
+			goto release;
+		}
+
+		// Prepare ethernet layer info. Stale neighbors are probed with unicast
+		// solicitations first (RFC 4861 section 7.3.3). Unknown or unresponsive neighbors
+		// are solicited on their solicited-node multicast group.
+		eth_data = eth_output_mbuf_data(mbuf);
+		// The control plane counts multicast probes after the unicast ones failed.
+		if (nh->mcast_probes == 0) {
+			ip_data.dst = nh->ip;
+			rte_ether_addr_copy(&nh->lladdr, &eth_data->dst);
+		} else {
+			ip6_solicited_node(&ip_data.dst, &nh->ip);
+			ip6_mcast_lladdr(&eth_data->dst, &ip_data.dst);
+		}
+		eth_data->ether_type = RTE_BE16(RTE_ETHER_TYPE_IPV6);
+		eth_data->iface = iface;
+
+		ip_data.src = local->ip;
+		ip_data.len = sizeof(*ns) + sizeof(*slla);
+		ip_data.vrf_id = nh->vrf_id;
+		ip_data.proto = IPPROTO_ICMPV6;
+		ip_data.hop_limit = IPV6_NDP_HOP_LIMIT;
+		ip_data.iface = iface;
+		ns->nd_ns_cksum = ip6_local_cksum(&ip_data, ns);
+
+		ip = (struct rte_ipv6_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*ip));
+		if (ip == NULL) {
+			next = ERROR;
+			goto release;
+		}
+		ip6_set_fields(ip, &ip_data);
+
+		next = OUTPUT;
+		sent++;
+release:
+		ip6_nexthop_release(nh);
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return sent;
+}
+
+static void ndp_ns_output_register(void) {
+	ndp_solicit = gr_control_input_register_handler("ndp_ns_output");
+}
+
+static struct rte_node_register ndp_ns_output_node = {
+	.name = "ndp_ns_output",
+	.process = ndp_ns_output_process,
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[OUTPUT] = "eth_output",
+		[ERROR] = "ndp_ns_output_error",
+	},
+};
+
+static struct gr_node_info ndp_ns_output_info = {
+	.node = &ndp_ns_output_node,
+	.register_callback = ndp_ns_output_register,
+};
+
+GR_NODE_REGISTER(ndp_ns_output_info);
+
+GR_DROP_REGISTER(ndp_ns_output_error);
@@ -8,6 +8,7 @@
 #include <gr_iface.h>
 #include <gr_infra.h>
 #include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
 #include <gr_log.h>
 #include <gr_port.h>
 
@@ -15,32 +16,30 @@
 #include <rte_ethdev.h>
 #include <rte_ether.h>
 #include <rte_hash.h>
+#include <rte_ip.h>
 
+#include <netinet/in.h>
 #include <string.h>
 
-struct ipip_key {
-	ip4_addr_t local;
-	ip4_addr_t remote;
-	// XXX: Using uint16_t causes the compiler to add 2 bytes padding at the
-	// end of the structure. When the structure is initialized on the stack,
-	// the padding bytes have undetermined contents.
-	//
-	// This structure is used to compute a hash key. In order to get
-	// deterministic results, use uint32_t to store the vrf_id so that the
-	// compiler does not insert any padding.
-	uint32_t vrf_id;
-};
-
 static struct rte_hash *ipip_hash;
 
-struct iface *ipip_get_iface(ip4_addr_t local, ip4_addr_t remote, uint16_t vrf_id) {
-	struct ipip_key key = {local, remote, vrf_id};
-	void *data;
+void ipip_get_iface_bulk(const struct ipip_key **keys, unsigned n, struct iface **ifaces) {
+	ip4_tunnel_get_iface_bulk(ipip_hash, (const void **)keys, n, ifaces);
+}
 
-	if (rte_hash_lookup_data(ipip_hash, &key, &data) < 0)
-		return NULL;
+static void ipip_template_init(struct iface_info_ipip *ipip) {
+	struct rte_ipv4_hdr *ip = &ipip->template;
+	struct ip_local_mbuf_data tunnel = {
+		.src = ipip->local,
+		.dst = ipip->remote,
+		.len = 0,
+		.proto = IPPROTO_IPIP,
+	};
 
-	return data;
+	ip_set_fields(ip, &tunnel);
+	ip->total_length = 0;
+	ip->hdr_checksum = 0;
+	ipip->template_sum = __rte_raw_cksum(ip, sizeof(*ip), 0);
 }
 
 static int iface_ipip_reconfig(
@@ -78,6 +77,9 @@ static int iface_ipip_reconfig(
 		cur->local = next->local;
 		cur->remote = next->remote;
 		iface->vrf_id = vrf_id;
+		ipip_template_init(cur);
+		// Workers cache the next hop towards the remote endpoint.
+		ip4_flow_cache_invalidate();
 	}
 
 	if (set_attrs & GR_IFACE_SET_FLAGS)
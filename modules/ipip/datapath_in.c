@@ -12,8 +12,10 @@
 #include <gr_mbuf.h>
 
 #include <rte_byteorder.h>
+#include <rte_common.h>
 #include <rte_ether.h>
 #include <rte_graph_worker.h>
+#include <rte_hash.h>
 #include <rte_ip.h>
 
 #include <netinet/in.h>
@@ -26,42 +28,43 @@ enum {
 
 static uint16_t
 ipip_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	const struct ipip_key *key_ptrs[RTE_HASH_LOOKUP_BULK_MAX];
+	struct ipip_key keys[RTE_HASH_LOOKUP_BULK_MAX];
+	struct iface *ifaces[RTE_HASH_LOOKUP_BULK_MAX];
 	struct eth_input_mbuf_data *eth_data;
 	struct ip_local_mbuf_data *ip_data;
-	ip4_addr_t last_src, last_dst;
-	uint16_t last_vrf_id;
 	struct rte_mbuf *mbuf;
-	struct iface *ipip;
 	rte_edge_t next;
-
-	ipip = NULL;
-	last_src = 0;
-	last_dst = 0;
-	last_vrf_id = UINT16_MAX;
-
-	for (uint16_t i = 0; i < nb_objs; i++) {
-		mbuf = objs[i];
-		ip_data = ip_local_mbuf_data(mbuf);
-
-		if (ip_data->dst != last_dst || ip_data->src != last_src
-		    || ip_data->vrf_id != last_vrf_id) {
-			ipip = ipip_get_iface(ip_data->dst, ip_data->src, ip_data->vrf_id);
-			last_dst = ip_data->dst;
-			last_src = ip_data->src;
-			last_vrf_id = ip_data->vrf_id;
-		}
-		if (ipip == NULL) {
-			next = NO_TUNNEL;
-			goto next;
+	unsigned n;
+
+	for (uint16_t i = 0; i < nb_objs; i += n) {
+		n = RTE_MIN(nb_objs - i, RTE_HASH_LOOKUP_BULK_MAX);
+
+		// Resolve the tunnels of the whole batch with a single hash lookup.
+		for (unsigned j = 0; j < n; j++) {
+			ip_data = ip_local_mbuf_data(objs[i + j]);
+			keys[j].local = ip_data->dst;
+			keys[j].remote = ip_data->src;
+			keys[j].vrf_id = ip_data->vrf_id;
+			key_ptrs[j] = &keys[j];
 		}
-		// The hw checksum offload only works on the outer IP.
-		// Clear the offload flag so that ip_input will check it in software.
-		mbuf->ol_flags |= RTE_MBUF_F_RX_IP_CKSUM_NONE;
-		eth_data = eth_input_mbuf_data(mbuf);
-		eth_data->iface = ipip;
-		next = IP_INPUT;
+		ipip_get_iface_bulk(key_ptrs, n, ifaces);
+
+		for (unsigned j = 0; j < n; j++) {
+			mbuf = objs[i + j];
+			if (ifaces[j] == NULL) {
+				next = NO_TUNNEL;
+				goto next;
+			}
+			// The hw checksum offload only works on the outer IP.
+			// Clear the offload flag so that ip_input will check it in software.
+			mbuf->ol_flags |= RTE_MBUF_F_RX_IP_CKSUM_NONE;
+			eth_data = eth_input_mbuf_data(mbuf);
+			eth_data->iface = ifaces[j];
+			next = IP_INPUT;
 next:
-		rte_node_enqueue_x1(graph, node, next, mbuf);
+			rte_node_enqueue_x1(graph, node, next, mbuf);
+		}
 	}
 
 	return nb_objs;
@@ -9,7 +9,6 @@
 #include <gr_ip4_control.h>
 #include <gr_ip4_datapath.h>
 #include <gr_ipip.h>
-#include <gr_log.h>
 #include <gr_mbuf.h>
 
 #include <rte_byteorder.h>
@@ -30,12 +29,16 @@ static uint16_t
 ipip_output_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
 	struct ip_output_mbuf_data *ip_data;
 	const struct iface_info_ipip *ipip;
-	struct ip_local_mbuf_data tunnel;
 	const struct rte_ipv4_hdr *inner;
 	struct rte_ipv4_hdr *outer;
 	const struct iface *iface;
 	struct rte_mbuf *mbuf;
+	rte_be16_t len;
 	rte_edge_t next;
+	uint32_t gen;
+
+	// Route changes bump the generation, see ip4_encap_nh_get().
+	gen = ip4_flow_cache_generation();
 
 	for (uint16_t i = 0; i < nb_objs; i++) {
 		mbuf = objs[i];
@@ -49,22 +52,22 @@ ipip_output_process(struct rte_graph *graph, struct rte_node *node, void **objs,
 		}
 		ipip = (const struct iface_info_ipip *)iface->info;
 
-		// Encapsulate with another IPv4 header.
+		// Encapsulate with a copy of the precomputed outer header. Only the total length
+		// and checksum depend on the packet.
 		inner = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
-		tunnel.src = ipip->local;
-		tunnel.dst = ipip->remote;
-		tunnel.len = rte_be_to_cpu_16(inner->total_length);
-		tunnel.vrf_id = iface->vrf_id;
-		tunnel.proto = IPPROTO_IPIP;
+		len = rte_cpu_to_be_16(rte_be_to_cpu_16(inner->total_length) + sizeof(*outer));
 		outer = (struct rte_ipv4_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*outer));
 		if (unlikely(outer == NULL)) {
 			rte_node_enqueue_x1(graph, node, NO_HEADROOM, mbuf);
 			continue;
 		}
-		ip_set_fields(outer, &tunnel);
+		*outer = ipip->template;
+		outer->total_length = len;
+		outer->hdr_checksum = ~__rte_raw_cksum_reduce(ipip->template_sum + len);
 
 		// Resolve nexthop for the encapsulated packet.
-		ip_data->nh = ip4_route_lookup(iface->vrf_id, ipip->remote);
+		ip_data->nh = ip4_encap_nh_get(node, iface, ipip->remote, gen);
+		ip_data->flow = NULL;
 		next = IP_OUTPUT;
 next:
 		rte_node_enqueue_x1(graph, node, next, mbuf);
@@ -81,6 +84,8 @@ static struct rte_node_register ipip_output_node = {
 	.name = "ipip_output",
 
 	.process = ipip_output_process,
+	.init = ip4_encap_nh_init,
+	.fini = ip4_encap_nh_fini,
 
 	.nb_edges = EDGE_COUNT,
 	.next_nodes = {
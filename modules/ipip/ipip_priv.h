@@ -7,13 +7,33 @@
 #include <gr_iface.h>
 #include <gr_net_types.h>
 
+#include <rte_ip.h>
+
 #include <stdint.h>
 
 struct __rte_aligned(alignof(void *)) iface_info_ipip {
 	ip4_addr_t local;
 	ip4_addr_t remote;
+	// Outer header of encapsulated packets without total length and checksum.
+	struct rte_ipv4_hdr template;
+	// One's complement sum of the template, see ipip_output_process().
+	uint32_t template_sum;
+};
+
+struct ipip_key {
+	ip4_addr_t local;
+	ip4_addr_t remote;
+	// XXX: Using uint16_t causes the compiler to add 2 bytes padding at the
+	// end of the structure. When the structure is initialized on the stack,
+	// the padding bytes have undetermined contents.
+	//
+	// This structure is used to compute a hash key. In order to get
+	// deterministic results, use uint32_t to store the vrf_id so that the
+	// compiler does not insert any padding.
+	uint32_t vrf_id;
 };
 
-struct iface *ipip_get_iface(ip4_addr_t local, ip4_addr_t remote, uint16_t vrf_id);
+// See ip4_tunnel_get_iface_bulk().
+void ipip_get_iface_bulk(const struct ipip_key **keys, unsigned n, struct iface **ifaces);
 
 #endif
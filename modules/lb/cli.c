@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_cli_iface.h>
+#include <gr_lb.h>
+#include <gr_net_types.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LB_ADD_CTX(root) CLI_CONTEXT(root, CTX_ADD, CTX_ARG("lb", "Create load balancer services."))
+#define LB_DEL_CTX(root) CLI_CONTEXT(root, CTX_DEL, CTX_ARG("lb", "Delete load balancer services."))
+#define LB_SHOW_CTX(root) CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("lb", "Show load balancer services."))
+
+#define PROTO_RE "^(tcp|udp|icmp|[0-9]{1,3})$"
+#define VIP_ARGS "vip VIP proto PROTO [(port PORT),(vrf VRF)]"
+
+static int parse_proto(const char *s, uint8_t *proto) {
+	unsigned long p;
+	char *end;
+
+	if (strcmp(s, "tcp") == 0) {
+		*proto = IPPROTO_TCP;
+		return 0;
+	}
+	if (strcmp(s, "udp") == 0) {
+		*proto = IPPROTO_UDP;
+		return 0;
+	}
+	if (strcmp(s, "icmp") == 0) {
+		*proto = IPPROTO_ICMP;
+		return 0;
+	}
+	p = strtoul(s, &end, 10);
+	if (*end != '\0' || p > UINT8_MAX)
+		return errno_set(EINVAL);
+	*proto = p;
+
+	return 0;
+}
+
+static const char *proto_str(uint8_t proto, char *buf, size_t len) {
+	switch (proto) {
+	case IPPROTO_TCP:
+		return "tcp";
+	case IPPROTO_UDP:
+		return "udp";
+	case IPPROTO_ICMP:
+		return "icmp";
+	}
+	snprintf(buf, len, "%u", proto);
+	return buf;
+}
+
+static int parse_vip(const struct ec_pnode *p, struct gr_lb_vip *vip) {
+	if (inet_pton(AF_INET, arg_str(p, "VIP"), &vip->addr) != 1)
+		return errno_set(EINVAL);
+	if (parse_proto(arg_str(p, "PROTO"), &vip->proto) < 0)
+		return -1;
+	if (arg_u16(p, "PORT", &vip->port) < 0 && errno != ENOENT)
+		return -1;
+	if (arg_u16(p, "VRF", &vip->vrf_id) < 0 && errno != ENOENT)
+		return -1;
+
+	return 0;
+}
+
+static cmd_status_t vip_add(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_lb_vip_add_req req = {0};
+
+	if (parse_vip(p, &req.vip) < 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_LB_VIP_ADD, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t vip_del(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_lb_vip_del_req req = {0};
+
+	if (parse_vip(p, &req.vip) < 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_LB_VIP_DEL, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t vip_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_lb_vip_list_resp *resp;
+	char addr[INET_ADDRSTRLEN], buf[8];
+	struct libscols_table *table;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_LB_VIP_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "VRF", 0, 0);
+	scols_table_new_column(table, "VIP", 0, 0);
+	scols_table_new_column(table, "PROTO", 0, 0);
+	scols_table_new_column(table, "PORT", 0, 0);
+	scols_table_new_column(table, "BACKENDS", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < resp->n_vips; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_lb_vip_status *s = &resp->vips[i];
+		inet_ntop(AF_INET, &s->vip.addr, addr, sizeof(addr));
+		scols_line_sprintf(line, 0, "%u", s->vip.vrf_id);
+		scols_line_sprintf(line, 1, "%s", addr);
+		scols_line_sprintf(line, 2, "%s", proto_str(s->vip.proto, buf, sizeof(buf)));
+		if (s->vip.port != 0)
+			scols_line_sprintf(line, 3, "%u", s->vip.port);
+		else
+			scols_line_set_data(line, 3, "any");
+		scols_line_sprintf(line, 4, "%u", s->n_backends);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t backend_add(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_lb_backend_add_req req = {0};
+	struct gr_iface iface;
+
+	if (parse_vip(p, &req.vip) < 0)
+		return CMD_ERROR;
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.iface_id = iface.id;
+
+	if (gr_api_client_send_recv(c, GR_LB_BACKEND_ADD, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t backend_del(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_lb_backend_del_req req = {0};
+	struct gr_iface iface;
+
+	if (parse_vip(p, &req.vip) < 0)
+		return CMD_ERROR;
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.iface_id = iface.id;
+
+	if (gr_api_client_send_recv(c, GR_LB_BACKEND_DEL, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t backend_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_lb_backend_list_resp *resp;
+	struct gr_lb_backend_list_req req = {0};
+	struct libscols_table *table;
+	struct gr_iface iface;
+	void *resp_ptr = NULL;
+	uint32_t total = 0;
+
+	if (parse_vip(p, &req.vip) < 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_LB_BACKEND_LIST, sizeof(req), &req, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	for (uint16_t i = 0; i < resp->n_backends; i++)
+		total += resp->backends[i].entries;
+
+	table = scols_new_table();
+	scols_table_new_column(table, "IFACE", 0, 0);
+	scols_table_new_column(table, "ENTRIES", 0, 0);
+	scols_table_new_column(table, "SHARE", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < resp->n_backends; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_lb_backend *b = &resp->backends[i];
+		if (iface_from_id(c, b->iface_id, &iface) == 0)
+			scols_line_sprintf(line, 0, "%s", iface.name);
+		else
+			scols_line_sprintf(line, 0, "%u", b->iface_id);
+		scols_line_sprintf(line, 1, "%u", b->entries);
+		scols_line_sprintf(line, 2, "%.1f%%", 100.0 * b->entries / total);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		LB_ADD_CTX(root),
+		VIP_ARGS,
+		vip_add,
+		"Create a virtual service.",
+		with_help("Virtual IP address.", ec_node_re("VIP", IPV4_RE)),
+		with_help("IP protocol name or number.", ec_node_re("PROTO", PROTO_RE)),
+		with_help("TCP/UDP destination port.", ec_node_uint("PORT", 1, UINT16_MAX, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		LB_DEL_CTX(root),
+		VIP_ARGS,
+		vip_del,
+		"Delete a virtual service.",
+		with_help("Virtual IP address.", ec_node_re("VIP", IPV4_RE)),
+		with_help("IP protocol name or number.", ec_node_re("PROTO", PROTO_RE)),
+		with_help("TCP/UDP destination port.", ec_node_uint("PORT", 1, UINT16_MAX, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		LB_ADD_CTX(root),
+		"backend IFACE " VIP_ARGS,
+		backend_add,
+		"Add a backend to a virtual service.",
+		with_help(
+			"IPIP interface to the backend, it must have an IPv4 address.",
+			ec_node_dyn("IFACE", complete_iface_names, NULL)
+		),
+		with_help("Virtual IP address.", ec_node_re("VIP", IPV4_RE)),
+		with_help("IP protocol name or number.", ec_node_re("PROTO", PROTO_RE)),
+		with_help("TCP/UDP destination port.", ec_node_uint("PORT", 1, UINT16_MAX, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		LB_DEL_CTX(root),
+		"backend IFACE " VIP_ARGS,
+		backend_del,
+		"Remove a backend from a virtual service.",
+		with_help(
+			"IPIP interface to the backend.",
+			ec_node_dyn("IFACE", complete_iface_names, NULL)
+		),
+		with_help("Virtual IP address.", ec_node_re("VIP", IPV4_RE)),
+		with_help("IP protocol name or number.", ec_node_re("PROTO", PROTO_RE)),
+		with_help("TCP/UDP destination port.", ec_node_uint("PORT", 1, UINT16_MAX, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(LB_SHOW_CTX(root), "vip", vip_show, "Show virtual services.");
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		LB_SHOW_CTX(root),
+		"backend " VIP_ARGS,
+		backend_show,
+		"Show the backends of a virtual service and their share of the traffic.",
+		with_help("Virtual IP address.", ec_node_re("VIP", IPV4_RE)),
+		with_help("IP protocol name or number.", ec_node_re("PROTO", PROTO_RE)),
+		with_help("TCP/UDP destination port.", ec_node_uint("PORT", 1, UINT16_MAX, 10)),
+		with_help("L3 routing domain ID.", ec_node_uint("VRF", 0, UINT16_MAX - 1, 10))
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "lb",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
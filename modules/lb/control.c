@@ -0,0 +1,450 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "lb_priv.h"
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_ipip.h>
+#include <gr_log.h>
+#include <gr_worker.h>
+
+#include <event2/event.h>
+#include <rte_hash.h>
+#include <rte_jhash.h>
+#include <rte_malloc.h>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct rte_hash *vip_hash;
+static unsigned n_vips;
+// Number of virtual services in each VRF.
+static uint16_t vrf_vips[IP4_MAX_VRFS];
+
+const struct rte_hash *lb_vip_hash(void) {
+	return vip_hash;
+}
+
+static int vip_key(const struct gr_lb_vip *vip, struct lb_key *key) {
+	if (vip->vrf_id >= IP4_MAX_VRFS)
+		return errno_set(EOVERFLOW);
+	if (vip->addr == 0)
+		return errno_set(EINVAL);
+
+	switch (vip->proto) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		if (vip->port == 0)
+			return errno_set(EINVAL);
+		break;
+	default:
+		if (vip->port != 0)
+			return errno_set(EINVAL);
+	}
+
+	memset(key, 0, sizeof(*key));
+	key->addr = vip->addr;
+	key->port = rte_cpu_to_be_16(vip->port);
+	key->vrf_id = vip->vrf_id;
+	key->proto = vip->proto;
+
+	return 0;
+}
+
+static struct lb_vip *vip_lookup(const struct gr_lb_vip *conf) {
+	struct lb_key key;
+	void *data;
+
+	if (vip_key(conf, &key) < 0)
+		return NULL;
+	if (rte_hash_lookup_data(vip_hash, &key, &data) < 0)
+		return errno_set_null(ENOENT);
+
+	return data;
+}
+
+// Backends are ordered by name so that load balancers with the same configuration build the
+// same lookup tables.
+static int backend_cmp(const void *a, const void *b) {
+	const struct iface *ia = iface_from_id(*(const uint16_t *)a);
+	const struct iface *ib = iface_from_id(*(const uint16_t *)b);
+
+	return strcmp(ia->name, ib->name);
+}
+
+// Fill the lookup table as described in "Maglev: A Fast and Reliable Software Network Load
+// Balancer" (NSDI 2016). Each backend has a permutation of the table entries derived from its
+// name. The backends take turns claiming their next free entry in their permutation.
+static void table_populate(struct lb_table *t, const uint16_t *backends) {
+	uint32_t offset[GR_LB_VIP_MAX_BACKENDS];
+	uint32_t skip[GR_LB_VIP_MAX_BACKENDS];
+	uint32_t next[GR_LB_VIP_MAX_BACKENDS];
+	const struct iface *iface;
+	uint32_t filled = 0;
+	uint32_t c, h, len;
+
+	for (uint16_t i = 0; i < t->n_backends; i++) {
+		iface = iface_from_id(backends[i]);
+		len = strlen(iface->name);
+		offset[i] = rte_jhash(iface->name, len, 0) % LB_TABLE_SIZE;
+		h = rte_jhash(iface->name, len, UINT32_C(0x9e3779b9));
+		skip[i] = h % (LB_TABLE_SIZE - 1) + 1;
+		next[i] = 0;
+	}
+
+	memset(t->entries, 0xff, sizeof(t->entries));
+
+	for (;;) {
+		for (uint16_t i = 0; i < t->n_backends; i++) {
+			// The table size is prime, each permutation goes through all entries.
+			do {
+				c = (offset[i] + (uint64_t)next[i] * skip[i]) % LB_TABLE_SIZE;
+				next[i]++;
+			} while (t->entries[c] != UINT16_MAX);
+
+			t->entries[c] = i;
+			if (++filled == LB_TABLE_SIZE)
+				return;
+		}
+	}
+}
+
+// Must not be used by the datapath workers anymore.
+static void table_free(struct lb_table *table) {
+	if (table == NULL)
+		return;
+	for (uint16_t i = 0; i < table->n_backends; i++) {
+		if (table->backends[i] != NULL)
+			ip4_nexthop_decref(table->backends[i]);
+	}
+	rte_free(table);
+}
+
+// Build a new lookup table from the backends of a virtual service and replace the one used by
+// the datapath workers.
+static int vip_update(struct lb_vip *vip) {
+	struct lb_table *table = NULL, *old;
+	uint16_t backends[GR_LB_VIP_MAX_BACKENDS];
+	struct nexthop *nh;
+
+	if (vip->n_backends > 0) {
+		table = rte_zmalloc(
+			__func__,
+			sizeof(*table) + vip->n_backends * sizeof(table->backends[0]),
+			RTE_CACHE_LINE_SIZE
+		);
+		if (table == NULL)
+			return errno_set(ENOMEM);
+
+		memcpy(backends, vip->backends, vip->n_backends * sizeof(backends[0]));
+		qsort(backends, vip->n_backends, sizeof(backends[0]), backend_cmp);
+
+		table->n_backends = vip->n_backends;
+		for (uint16_t i = 0; i < vip->n_backends; i++) {
+			// Packets sent to the connected next hop of an IPIP interface are
+			// encapsulated by ipip_output.
+			nh = ip4_addr_get_preferred(backends[i], vip->conf.addr);
+			if (nh == NULL) {
+				table_free(table);
+				return errno_set(EADDRNOTAVAIL);
+			}
+			ip4_nexthop_incref(nh);
+			table->backends[i] = nh;
+		}
+		table_populate(table, backends);
+	}
+
+	old = atomic_exchange_explicit(&vip->table, table, memory_order_acq_rel);
+	if (old != NULL) {
+		gr_datapath_sync();
+		table_free(old);
+	}
+
+	return 0;
+}
+
+static struct api_out lb_vip_add(const void *request, void **response) {
+	const struct gr_lb_vip_add_req *req = request;
+	struct lb_vip *vip;
+	struct lb_key key;
+	int ret;
+
+	(void)response;
+
+	if (vip_key(&req->vip, &key) < 0)
+		return api_out(errno, 0);
+	if (rte_hash_lookup(vip_hash, &key) >= 0)
+		return api_out(EEXIST, 0);
+
+	vip = rte_zmalloc(__func__, sizeof(*vip), RTE_CACHE_LINE_SIZE);
+	if (vip == NULL)
+		return api_out(ENOMEM, 0);
+	vip->conf = req->vip;
+
+	if ((ret = rte_hash_add_key_data(vip_hash, &key, vip)) < 0) {
+		rte_free(vip);
+		return api_out(-ret, 0);
+	}
+	n_vips++;
+	// Only packets received in this VRF are matched against its virtual services.
+	if (vrf_vips[key.vrf_id]++ == 0)
+		ip_input_vip_enable(key.vrf_id, true);
+
+	return api_out(0, 0);
+}
+
+static int vip_del(struct lb_vip *vip) {
+	struct lb_table *table;
+	struct lb_key key;
+	int32_t pos;
+
+	vip_key(&vip->conf, &key);
+	if ((pos = rte_hash_del_key(vip_hash, &key)) < 0)
+		return errno_set(-pos);
+	n_vips--;
+	if (--vrf_vips[key.vrf_id] == 0)
+		ip_input_vip_enable(key.vrf_id, false);
+
+	// Workers may still be using the virtual service and its key slot.
+	gr_datapath_sync();
+	rte_hash_free_key_with_position(vip_hash, pos);
+	table = atomic_load(&vip->table);
+	table_free(table);
+	rte_free(vip);
+
+	return 0;
+}
+
+static struct api_out lb_vip_del(const void *request, void **response) {
+	const struct gr_lb_vip_del_req *req = request;
+	struct lb_vip *vip;
+
+	(void)response;
+
+	if ((vip = vip_lookup(&req->vip)) == NULL)
+		return api_out(errno, 0);
+	if (vip_del(vip) < 0)
+		return api_out(errno, 0);
+
+	return api_out(0, 0);
+}
+
+static struct api_out lb_vip_list(const void *request, void **response) {
+	struct gr_lb_vip_list_resp *resp;
+	const struct lb_vip *vip;
+	uint32_t iter = 0;
+	const void *key;
+	void *data;
+	size_t len;
+
+	(void)request;
+
+	len = sizeof(*resp) + n_vips * sizeof(resp->vips[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	while (rte_hash_iterate(vip_hash, &key, &data, &iter) >= 0) {
+		vip = data;
+		resp->vips[resp->n_vips].vip = vip->conf;
+		resp->vips[resp->n_vips].n_backends = vip->n_backends;
+		resp->n_vips++;
+	}
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static struct api_out lb_backend_add(const void *request, void **response) {
+	const struct gr_lb_backend_add_req *req = request;
+	const struct iface *iface;
+	struct lb_vip *vip;
+
+	(void)response;
+
+	if ((vip = vip_lookup(&req->vip)) == NULL)
+		return api_out(errno, 0);
+	if ((iface = iface_from_id(req->iface_id)) == NULL)
+		return api_out(errno, 0);
+	// Packets are sent through ipip_output which encapsulates them for the backend.
+	if (iface->type_id != GR_IFACE_TYPE_IPIP)
+		return api_out(EMEDIUMTYPE, 0);
+
+	for (uint16_t i = 0; i < vip->n_backends; i++) {
+		if (vip->backends[i] == req->iface_id)
+			return api_out(EEXIST, 0);
+	}
+	if (vip->n_backends == GR_LB_VIP_MAX_BACKENDS)
+		return api_out(ENOSPC, 0);
+
+	vip->backends[vip->n_backends++] = req->iface_id;
+	if (vip_update(vip) < 0) {
+		vip->n_backends--;
+		return api_out(errno, 0);
+	}
+
+	return api_out(0, 0);
+}
+
+static int backend_del(struct lb_vip *vip, uint16_t iface_id) {
+	uint16_t i;
+
+	for (i = 0; i < vip->n_backends; i++) {
+		if (vip->backends[i] == iface_id)
+			break;
+	}
+	if (i == vip->n_backends)
+		return errno_set(ENOENT);
+
+	vip->backends[i] = vip->backends[--vip->n_backends];
+	if (vip_update(vip) < 0) {
+		vip->backends[vip->n_backends++] = iface_id;
+		return -errno;
+	}
+
+	return 0;
+}
+
+static struct api_out lb_backend_del(const void *request, void **response) {
+	const struct gr_lb_backend_del_req *req = request;
+	struct lb_vip *vip;
+
+	(void)response;
+
+	if ((vip = vip_lookup(&req->vip)) == NULL)
+		return api_out(errno, 0);
+	if (backend_del(vip, req->iface_id) < 0)
+		return api_out(errno, 0);
+
+	return api_out(0, 0);
+}
+
+static struct api_out lb_backend_list(const void *request, void **response) {
+	const struct gr_lb_backend_list_req *req = request;
+	struct gr_lb_backend_list_resp *resp;
+	const struct lb_table *table;
+	const struct lb_vip *vip;
+	size_t len;
+
+	if ((vip = vip_lookup(&req->vip)) == NULL)
+		return api_out(errno, 0);
+
+	len = sizeof(*resp) + vip->n_backends * sizeof(resp->backends[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	table = atomic_load(&vip->table);
+	if (table != NULL) {
+		resp->n_backends = table->n_backends;
+		for (uint16_t i = 0; i < table->n_backends; i++)
+			resp->backends[i].iface_id = table->backends[i]->iface_id;
+		for (uint32_t c = 0; c < LB_TABLE_SIZE; c++)
+			resp->backends[table->entries[c]].entries++;
+	}
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	uint32_t iter = 0;
+	const void *key;
+	void *data;
+
+	if (event != IFACE_EVENT_PRE_REMOVE || iface->type_id != GR_IFACE_TYPE_IPIP)
+		return;
+
+	while (rte_hash_iterate(vip_hash, &key, &data, &iter) >= 0) {
+		if (backend_del(data, iface->id) < 0 && errno != ENOENT)
+			LOG(ERR, "backend_del(%s): %s", iface->name, strerror(errno));
+	}
+}
+
+static void lb_init(struct event_base *) {
+	struct rte_hash_parameters params = {
+		.name = "lb_vip",
+		.entries = GR_LB_MAX_VIPS,
+		.key_len = sizeof(struct lb_key),
+		.socket_id = SOCKET_ID_ANY,
+		.extra_flag = RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF
+			| RTE_HASH_EXTRA_FLAGS_TRANS_MEM_SUPPORT,
+	};
+	vip_hash = rte_hash_create(&params);
+	if (vip_hash == NULL)
+		ABORT("rte_hash_create(lb_vip)");
+}
+
+static void lb_fini(struct event_base *) {
+	uint32_t iter = 0;
+	struct lb_vip *vip;
+	const void *key;
+	void *data;
+
+	while (rte_hash_iterate(vip_hash, &key, &data, &iter) >= 0) {
+		vip = data;
+		table_free(atomic_load(&vip->table));
+		rte_free(vip);
+	}
+	rte_hash_free(vip_hash);
+	vip_hash = NULL;
+}
+
+static struct gr_api_handler vip_add_handler = {
+	.name = "lb vip add",
+	.request_type = GR_LB_VIP_ADD,
+	.callback = lb_vip_add,
+};
+static struct gr_api_handler vip_del_handler = {
+	.name = "lb vip del",
+	.request_type = GR_LB_VIP_DEL,
+	.callback = lb_vip_del,
+};
+static struct gr_api_handler vip_list_handler = {
+	.name = "lb vip list",
+	.request_type = GR_LB_VIP_LIST,
+	.callback = lb_vip_list,
+};
+static struct gr_api_handler backend_add_handler = {
+	.name = "lb backend add",
+	.request_type = GR_LB_BACKEND_ADD,
+	.callback = lb_backend_add,
+};
+static struct gr_api_handler backend_del_handler = {
+	.name = "lb backend del",
+	.request_type = GR_LB_BACKEND_DEL,
+	.callback = lb_backend_del,
+};
+static struct gr_api_handler backend_list_handler = {
+	.name = "lb backend list",
+	.request_type = GR_LB_BACKEND_LIST,
+	.callback = lb_backend_list,
+};
+
+static struct gr_module lb_module = {
+	.name = "lb",
+	.init = lb_init,
+	.fini = lb_fini,
+	.fini_prio = 1000,
+};
+
+static struct iface_event_handler iface_event_lb_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(lb_constructor) {
+	gr_register_module(&lb_module);
+	gr_register_api_handler(&vip_add_handler);
+	gr_register_api_handler(&vip_del_handler);
+	gr_register_api_handler(&vip_list_handler);
+	gr_register_api_handler(&backend_add_handler);
+	gr_register_api_handler(&backend_del_handler);
+	gr_register_api_handler(&backend_list_handler);
+	iface_event_register_handler(&iface_event_lb_handler);
+}
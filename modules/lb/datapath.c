@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "lb_priv.h"
+
+#include <gr_graph.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_byteorder.h>
+#include <rte_graph_worker.h>
+#include <rte_hash.h>
+#include <rte_ip.h>
+#include <rte_jhash.h>
+
+#include <netinet/in.h>
+#include <stdatomic.h>
+
+enum {
+	IP_OUTPUT = 0,
+	NO_BACKEND,
+	EDGE_COUNT,
+};
+
+// TCP/UDP source and destination ports of a packet, NULL if it has none.
+static inline const rte_be16_t *lb_l4_ports(const struct rte_ipv4_hdr *ip) {
+	const rte_be16_t frag_mask = RTE_BE16(RTE_IPV4_HDR_MF_FLAG | RTE_IPV4_HDR_OFFSET_MASK);
+
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		// Fragments cannot all be matched on ports. They are not load balanced.
+		if (!(ip->fragment_offset & frag_mask))
+			return (const rte_be16_t *)((const uint8_t *)ip + rte_ipv4_hdr_len(ip));
+		break;
+	}
+
+	return NULL;
+}
+
+// Called by ip_input for all packets received in VRFs which have virtual services.
+static const void *lb_vip_lookup(uint16_t vrf_id, const struct rte_ipv4_hdr *ip) {
+	const rte_be16_t *ports = lb_l4_ports(ip);
+	struct lb_key key = {
+		.addr = ip->dst_addr,
+		.port = ports != NULL ? ports[1] : 0,
+		.vrf_id = vrf_id,
+		.proto = ip->next_proto_id,
+	};
+	void *data;
+
+	if (rte_hash_lookup_data(lb_vip_hash(), &key, &data) < 0)
+		return NULL;
+
+	return data;
+}
+
+static uint16_t
+lb_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct ip_output_mbuf_data *d;
+	const struct rte_ipv4_hdr *ip;
+	const struct lb_table *table;
+	const struct iface *iface;
+	const struct lb_vip *vip;
+	const rte_be16_t *ports;
+	struct rte_mbuf *mbuf;
+	rte_edge_t edge;
+	uint32_t h;
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		// ip_vip_mbuf_data and ip_output_mbuf_data share the same storage.
+		iface = ip_vip_mbuf_data(mbuf)->input_iface;
+		vip = ip_vip_mbuf_data(mbuf)->vip;
+		table = atomic_load_explicit(&vip->table, memory_order_acquire);
+		if (table == NULL) {
+			edge = NO_BACKEND;
+			goto next;
+		}
+
+		// The hash does not depend on the worker nor on the NIC. All load balancers with
+		// the same backends send a flow to the same one.
+		ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
+		ports = lb_l4_ports(ip);
+		h = rte_jhash_3words(
+			ip->src_addr,
+			ports != NULL ? *(const unaligned_uint32_t *)ports : 0,
+			ip->next_proto_id,
+			0
+		);
+
+		// ip_output hands the packet over to ipip_output which encapsulates it for the
+		// selected backend. The inner TTL is left untouched.
+		d = ip_output_mbuf_data(mbuf);
+		d->nh = table->backends[table->entries[h % LB_TABLE_SIZE]];
+		d->input_iface = iface;
+		d->flow = NULL;
+		edge = IP_OUTPUT;
+next:
+		rte_node_enqueue_x1(graph, node, edge, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static void lb_register(void) {
+	ip_input_add_vip_lookup(lb_vip_lookup, "lb");
+}
+
+static struct rte_node_register lb_node = {
+	.name = "lb",
+
+	.process = lb_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[IP_OUTPUT] = "ip_output",
+		[NO_BACKEND] = "lb_no_backend",
+	},
+};
+
+static struct gr_node_info lb_info = {
+	.node = &lb_node,
+	.register_callback = lb_register,
+};
+
+GR_NODE_REGISTER(lb_info);
+
+GR_DROP_REGISTER(lb_no_backend);
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_API_LB
+#define _GR_API_LB
+
+#include <gr_api.h>
+#include <gr_net_types.h>
+
+#include <stdint.h>
+
+// Maximum number of virtual services.
+#define GR_LB_MAX_VIPS 1024
+// Maximum number of backends of a virtual service.
+#define GR_LB_VIP_MAX_BACKENDS 256
+
+// Virtual service. Packets received in the VRF for this address, protocol and port are sent to
+// one of the backends with IPIP encapsulation. Backends reply directly to the clients.
+struct gr_lb_vip {
+	uint16_t vrf_id;
+	ip4_addr_t addr;
+	uint8_t proto;
+	uint16_t port; // Destination port, must be zero unless proto is TCP or UDP.
+};
+
+struct gr_lb_vip_status {
+	struct gr_lb_vip vip;
+	uint16_t n_backends;
+};
+
+// Backend of a virtual service, reached through the connected route of an IPIP interface.
+// The interface must have an IPv4 address.
+struct gr_lb_backend {
+	uint16_t iface_id;
+	uint32_t entries; // Number of lookup table entries, proportional to the traffic share.
+};
+
+#define GR_LB_MODULE 0x10ad
+
+#define GR_LB_VIP_ADD REQUEST_TYPE(GR_LB_MODULE, 0x0001)
+
+struct gr_lb_vip_add_req {
+	struct gr_lb_vip vip;
+};
+
+// struct gr_lb_vip_add_resp { };
+
+#define GR_LB_VIP_DEL REQUEST_TYPE(GR_LB_MODULE, 0x0002)
+
+struct gr_lb_vip_del_req {
+	struct gr_lb_vip vip;
+};
+
+// struct gr_lb_vip_del_resp { };
+
+#define GR_LB_VIP_LIST REQUEST_TYPE(GR_LB_MODULE, 0x0003)
+
+// struct gr_lb_vip_list_req { };
+
+struct gr_lb_vip_list_resp {
+	uint16_t n_vips;
+	struct gr_lb_vip_status vips[/* n_vips */];
+};
+
+#define GR_LB_BACKEND_ADD REQUEST_TYPE(GR_LB_MODULE, 0x0004)
+
+struct gr_lb_backend_add_req {
+	struct gr_lb_vip vip;
+	uint16_t iface_id;
+};
+
+// struct gr_lb_backend_add_resp { };
+
+#define GR_LB_BACKEND_DEL REQUEST_TYPE(GR_LB_MODULE, 0x0005)
+
+struct gr_lb_backend_del_req {
+	struct gr_lb_vip vip;
+	uint16_t iface_id;
+};
+
+// struct gr_lb_backend_del_resp { };
+
+#define GR_LB_BACKEND_LIST REQUEST_TYPE(GR_LB_MODULE, 0x0006)
+
+struct gr_lb_backend_list_req {
+	struct gr_lb_vip vip;
+};
+
+struct gr_lb_backend_list_resp {
+	uint16_t n_backends;
+	struct gr_lb_backend backends[/* n_backends */];
+};
+
+#endif
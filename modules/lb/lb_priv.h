@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _LB_PRIV_H
+#define _LB_PRIV_H
+
+#include <gr_ip4_control.h>
+#include <gr_lb.h>
+#include <gr_net_types.h>
+
+#include <rte_byteorder.h>
+#include <rte_hash.h>
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Number of entries of the Maglev lookup tables. It must be prime. With 256 backends, their
+// shares of the entries differ by less than 1%.
+#define LB_TABLE_SIZE 65537
+
+struct lb_key {
+	ip4_addr_t addr;
+	rte_be16_t port;
+	uint16_t vrf_id;
+	// uint32_t to avoid padding bytes in the hash key.
+	uint32_t proto;
+};
+
+// Maglev lookup table of a virtual service. It is never modified once published, updates
+// replace it.
+struct lb_table {
+	uint16_t n_backends;
+	// Index of the backend for each value of the flow hash modulo LB_TABLE_SIZE.
+	uint16_t entries[LB_TABLE_SIZE];
+	// Connected next hops of the backend IPIP interfaces. Each one holds a reference.
+	struct nexthop *backends[/* n_backends */];
+};
+
+struct lb_vip {
+	struct gr_lb_vip conf;
+	uint16_t n_backends;
+	uint16_t backends[GR_LB_VIP_MAX_BACKENDS]; // Interface IDs.
+	// NULL when there are no backends.
+	_Atomic(struct lb_table *) table;
+};
+
+// Virtual services by struct lb_key, read without locking by the datapath workers.
+const struct rte_hash *lb_vip_hash(void);
+
+#endif
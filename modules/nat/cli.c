@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_cli_iface.h>
+#include <gr_nat.h>
+#include <gr_net_types.h>
+
+#include <ecoli.h>
+#include <libsmartcols.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NAT_ADD_CTX(root)                                                                          \
+	CLI_CONTEXT(root, CTX_ADD, CTX_ARG("nat44", "Create source NAT policies."))
+#define NAT_DEL_CTX(root)                                                                          \
+	CLI_CONTEXT(root, CTX_DEL, CTX_ARG("nat44", "Delete source NAT policies."))
+#define NAT_SHOW_CTX(root)                                                                         \
+	CLI_CONTEXT(root, CTX_SHOW, CTX_ARG("nat44", "Show source NAT policies."))
+
+static cmd_status_t nat44_add(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_nat44_policy_add_req req = {0};
+	struct gr_iface iface;
+	const char *s;
+
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.policy.iface_id = iface.id;
+
+	s = arg_str(p, "START");
+	if (s != NULL && inet_pton(AF_INET, s, &req.policy.pool_start) != 1) {
+		errno = EINVAL;
+		return CMD_ERROR;
+	}
+	s = arg_str(p, "END");
+	if (s != NULL && inet_pton(AF_INET, s, &req.policy.pool_end) != 1) {
+		errno = EINVAL;
+		return CMD_ERROR;
+	}
+
+	if (gr_api_client_send_recv(c, GR_NAT44_POLICY_ADD, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nat44_del(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_nat44_policy_del_req req = {0};
+	struct gr_iface iface;
+
+	if (iface_from_name(c, arg_str(p, "IFACE"), &iface) < 0)
+		return CMD_ERROR;
+	req.iface_id = iface.id;
+
+	if (gr_api_client_send_recv(c, GR_NAT44_POLICY_DEL, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t nat44_show(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_nat44_policy_list_resp *resp;
+	char start[INET_ADDRSTRLEN], end[INET_ADDRSTRLEN];
+	struct libscols_table *table;
+	struct gr_iface iface;
+	void *resp_ptr = NULL;
+
+	(void)p;
+
+	if (gr_api_client_send_recv(c, GR_NAT44_POLICY_LIST, 0, NULL, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	table = scols_new_table();
+	scols_table_new_column(table, "IFACE", 0, 0);
+	scols_table_new_column(table, "POOL", 0, 0);
+	scols_table_new_column(table, "SESSIONS", 0, 0);
+	scols_table_new_column(table, "ALLOC_FAILURES", 0, 0);
+	scols_table_set_column_separator(table, "  ");
+	for (uint16_t i = 0; i < resp->n_policies; i++) {
+		struct libscols_line *line = scols_table_new_line(table, NULL);
+		const struct gr_nat44_policy_status *s = &resp->policies[i];
+		if (iface_from_id(c, s->policy.iface_id, &iface) == 0)
+			scols_line_sprintf(line, 0, "%s", iface.name);
+		else
+			scols_line_sprintf(line, 0, "%u", s->policy.iface_id);
+		inet_ntop(AF_INET, &s->policy.pool_start, start, sizeof(start));
+		inet_ntop(AF_INET, &s->policy.pool_end, end, sizeof(end));
+		if (s->policy.pool_start == s->policy.pool_end)
+			scols_line_sprintf(line, 1, "%s", start);
+		else
+			scols_line_sprintf(line, 1, "%s-%s", start, end);
+		scols_line_sprintf(line, 2, "%u", s->sessions);
+		scols_line_sprintf(line, 3, "%lu", s->alloc_failures);
+	}
+	scols_print_table(table);
+	scols_unref_table(table);
+	free(resp_ptr);
+
+	return CMD_SUCCESS;
+}
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		NAT_ADD_CTX(root),
+		"iface IFACE [pool START [END]]",
+		nat44_add,
+		"Translate the source of packets sent on an interface.",
+		with_help("Output interface.", ec_node_dyn("IFACE", complete_iface_names, NULL)),
+		with_help(
+			"First pool address, the interface address if not specified.",
+			ec_node_re("START", IPV4_RE)
+		),
+		with_help("Last pool address.", ec_node_re("END", IPV4_RE))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		NAT_DEL_CTX(root),
+		"iface IFACE",
+		nat44_del,
+		"Stop translating packets sent on an interface.",
+		with_help("Output interface.", ec_node_dyn("IFACE", complete_iface_names, NULL))
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(NAT_SHOW_CTX(root), "policy", nat44_show, "Show source NAT policies.");
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "nat44",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+}
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "nat_priv.h"
+
+#include <gr_api.h>
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_worker.h>
+
+#include <rte_byteorder.h>
+#include <rte_common.h>
+#include <rte_malloc.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+static struct nat_policy policies[MAX_IFACES];
+static uint32_t last_epoch;
+
+struct nat_policy *nat44_policy(uint16_t iface_id) {
+	struct nat_policy *p = &policies[iface_id];
+
+	if (!atomic_load_explicit(&p->enabled, memory_order_acquire))
+		return NULL;
+
+	return p;
+}
+
+static struct api_out nat44_policy_add(const void *request, void **response) {
+	const struct gr_nat44_policy_add_req *req = request;
+	ip4_addr_t start = req->policy.pool_start;
+	ip4_addr_t end = req->policy.pool_end;
+	struct nat_policy *p;
+	struct hoplist *addrs;
+	uint32_t size;
+
+	(void)response;
+
+	if (iface_from_id(req->policy.iface_id) == NULL)
+		return api_out(errno, 0);
+
+	p = &policies[req->policy.iface_id];
+	if (atomic_load(&p->enabled))
+		return api_out(EEXIST, 0);
+
+	if (start == 0) {
+		// The interface address is resolved once. Changing it requires adding the policy
+		// again.
+		addrs = ip4_addr_get_all(req->policy.iface_id);
+		if (addrs == NULL || addrs->count == 0)
+			return api_out(EADDRNOTAVAIL, 0);
+		start = end = addrs->nh[0]->ip;
+	} else if (end == 0) {
+		end = start;
+	}
+	if (rte_be_to_cpu_32(end) < rte_be_to_cpu_32(start))
+		return api_out(EINVAL, 0);
+	size = rte_be_to_cpu_32(end) - rte_be_to_cpu_32(start) + 1;
+	if (size > GR_NAT44_POOL_MAX)
+		return api_out(ERANGE, 0);
+
+	p->owners = rte_zmalloc(__func__, size * NAT_BLOCKS_PER_ADDR, RTE_CACHE_LINE_SIZE);
+	if (p->owners == NULL)
+		return api_out(ENOMEM, 0);
+
+	p->epoch = ++last_epoch;
+	p->pool_start = start;
+	p->pool_end = end;
+	p->pool_size = size;
+	atomic_store(&p->sessions, 0);
+	atomic_store(&p->alloc_failures, 0);
+	atomic_store_explicit(&p->enabled, true, memory_order_release);
+
+	// Replies are translated back before any other ingress processing.
+	ip_input_hook_enable(req->policy.iface_id, IP_INPUT_HOOK_NAT, true);
+	ip_output_hook_enable(req->policy.iface_id, IP_OUTPUT_HOOK_NAT, true);
+
+	return api_out(0, 0);
+}
+
+static int policy_del(uint16_t iface_id) {
+	struct nat_policy *p = &policies[iface_id];
+
+	if (!atomic_load(&p->enabled))
+		return errno_set(ENOENT);
+
+	ip_input_hook_enable(iface_id, IP_INPUT_HOOK_NAT, false);
+	ip_output_hook_enable(iface_id, IP_OUTPUT_HOOK_NAT, false);
+	atomic_store_explicit(&p->enabled, false, memory_order_release);
+
+	// Mappings are discarded lazily by the workers. Wait until they are done with the block
+	// owners table.
+	gr_datapath_sync();
+	rte_free(p->owners);
+	p->owners = NULL;
+
+	return 0;
+}
+
+static struct api_out nat44_policy_del(const void *request, void **response) {
+	const struct gr_nat44_policy_del_req *req = request;
+
+	(void)response;
+
+	if (req->iface_id >= MAX_IFACES)
+		return api_out(ENODEV, 0);
+	if (policy_del(req->iface_id) < 0)
+		return api_out(errno, 0);
+
+	return api_out(0, 0);
+}
+
+static struct api_out nat44_policy_list(const void *request, void **response) {
+	struct gr_nat44_policy_list_resp *resp;
+	struct gr_nat44_policy_status *s;
+	struct nat_policy *p;
+	uint16_t n = 0;
+	size_t len;
+
+	(void)request;
+
+	for (uint16_t iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		if (nat44_policy(iface_id) != NULL)
+			n++;
+	}
+
+	len = sizeof(*resp) + n * sizeof(resp->policies[0]);
+	if ((resp = calloc(1, len)) == NULL)
+		return api_out(ENOMEM, 0);
+
+	for (uint16_t iface_id = 0; iface_id < MAX_IFACES; iface_id++) {
+		if ((p = nat44_policy(iface_id)) == NULL)
+			continue;
+		s = &resp->policies[resp->n_policies++];
+		s->policy.iface_id = iface_id;
+		s->policy.pool_start = p->pool_start;
+		s->policy.pool_end = p->pool_end;
+		s->sessions = atomic_load_explicit(&p->sessions, memory_order_relaxed);
+		s->alloc_failures = atomic_load_explicit(&p->alloc_failures, memory_order_relaxed);
+	}
+
+	*response = resp;
+
+	return api_out(0, len);
+}
+
+static void iface_event_handler(iface_event_t event, struct iface *iface) {
+	if (event == IFACE_EVENT_PRE_REMOVE && nat44_policy(iface->id) != NULL)
+		policy_del(iface->id);
+}
+
+static struct gr_api_handler nat44_policy_add_handler = {
+	.name = "nat44 policy add",
+	.request_type = GR_NAT44_POLICY_ADD,
+	.callback = nat44_policy_add,
+};
+static struct gr_api_handler nat44_policy_del_handler = {
+	.name = "nat44 policy del",
+	.request_type = GR_NAT44_POLICY_DEL,
+	.callback = nat44_policy_del,
+};
+static struct gr_api_handler nat44_policy_list_handler = {
+	.name = "nat44 policy list",
+	.request_type = GR_NAT44_POLICY_LIST,
+	.callback = nat44_policy_list,
+};
+
+static struct iface_event_handler iface_event_nat_handler = {
+	.callback = iface_event_handler,
+};
+
+RTE_INIT(nat_constructor) {
+	gr_register_api_handler(&nat44_policy_add_handler);
+	gr_register_api_handler(&nat44_policy_del_handler);
+	gr_register_api_handler(&nat44_policy_list_handler);
+	iface_event_register_handler(&iface_event_nat_handler);
+}
@@ -0,0 +1,705 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "nat_priv.h"
+
+#include <gr_eth_output.h>
+#include <gr_graph.h>
+#include <gr_iface.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_worker.h>
+
+#include <rte_byteorder.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_graph_worker.h>
+#include <rte_hash.h>
+#include <rte_hash_crc.h>
+#include <rte_icmp.h>
+#include <rte_ip.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_random.h>
+#include <rte_ring.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdio.h>
+
+// Maximum number of mappings and port blocks of each worker.
+#define NAT_WORKER_MAX_SESSIONS (1 << 16)
+#define NAT_WORKER_MAX_BLOCKS (NAT_WORKER_MAX_SESSIONS / NAT_BLOCK_PORTS)
+#define NAT_HANDOFF_RING_SIZE 1024
+// Number of mappings checked for expiry on each node invocation.
+#define NAT_SWEEP_BATCH 32
+
+// Idle timeouts in seconds (RFC 4787, RFC 5382 and RFC 5508).
+#define NAT_TIMEOUT_TCP 7440
+#define NAT_TIMEOUT_TCP_TRANS 240
+#define NAT_TIMEOUT_UDP 300
+#define NAT_TIMEOUT_ICMP 60
+
+#define NAT_NONE UINT32_MAX
+
+#define NAT_DIR_OUT 0 // Internal address and port, as sent by the host.
+#define NAT_DIR_IN 1 // Mapped address and port, as seen by the remote host.
+
+static_assert(RTE_MAX_LCORE < UINT8_MAX);
+
+enum in_edges {
+	IN_NO_ROUTE = 0,
+	IN_HANDOFF_FULL,
+	IN_EDGE_COUNT,
+};
+
+enum out_edges {
+	OUT_PORT_EXHAUSTED = 0,
+	OUT_EDGE_COUNT,
+};
+
+enum handoff_edges {
+	HANDOFF_NAT_IN = 0,
+	HANDOFF_EDGE_COUNT,
+};
+
+struct nat_key {
+	ip4_addr_t addr;
+	rte_be16_t port;
+	uint16_t iface_id;
+	uint8_t proto;
+	uint8_t dir;
+	uint16_t pad;
+};
+
+struct nat_session {
+	struct nat_key keys[2];
+	uint32_t epoch;
+	uint32_t expire;
+	uint32_t next_free;
+	uint16_t block; // Index in nat_worker.blocks.
+	uint8_t bit; // Port in the block.
+	bool active;
+};
+
+struct nat_block {
+	uint16_t iface_id;
+	uint32_t epoch;
+	uint32_t owner_idx; // Index in nat_policy.owners.
+	uint64_t used; // Bit mask of allocated ports.
+};
+
+// Mappings are private to the worker which owns their port block. The state is kept across
+// graph reloads.
+struct nat_worker {
+	struct rte_hash *hash;
+	struct rte_ring *handoff;
+	uint64_t tsc_hz;
+	uint32_t now;
+	uint32_t sweep;
+	uint32_t free_head;
+	uint16_t n_blocks;
+	uint16_t cur_block[MAX_IFACES];
+	struct nat_block blocks[NAT_WORKER_MAX_BLOCKS];
+	struct nat_session sessions[NAT_WORKER_MAX_SESSIONS];
+};
+
+static struct nat_worker *nat_workers[RTE_MAX_LCORE];
+
+static inline struct nat_worker *nat_worker_get(void) {
+	unsigned lcore_id = rte_lcore_id();
+
+	if (lcore_id >= RTE_MAX_LCORE)
+		return NULL;
+
+	return nat_workers[lcore_id];
+}
+
+// Transport header fields changed by the translation.
+struct nat_l4 {
+	rte_be16_t *port;
+	rte_be16_t *cksum; // NULL for UDP without checksum.
+	bool pseudo; // The checksum covers the IP addresses.
+	bool udp;
+	uint8_t tcp_flags;
+};
+
+static inline bool nat_l4_init(
+	struct nat_l4 *l4,
+	struct rte_mbuf *mbuf,
+	struct rte_ipv4_hdr *ip,
+	uint8_t icmp_type,
+	bool src
+) {
+	size_t ihl = rte_ipv4_hdr_len(ip);
+	uint32_t len = rte_pktmbuf_data_len(mbuf);
+	struct rte_icmp_hdr *icmp;
+	struct rte_tcp_hdr *tcp;
+	struct rte_udp_hdr *udp;
+
+	// Only the first fragment has ports.
+	if (ip->fragment_offset & RTE_BE16(RTE_IPV4_HDR_OFFSET_MASK))
+		return false;
+
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+		if (len < ihl + sizeof(*tcp))
+			return false;
+		tcp = rte_pktmbuf_mtod_offset(mbuf, struct rte_tcp_hdr *, ihl);
+		l4->port = src ? &tcp->src_port : &tcp->dst_port;
+		l4->cksum = &tcp->cksum;
+		l4->pseudo = true;
+		l4->udp = false;
+		l4->tcp_flags = tcp->tcp_flags;
+		return true;
+	case IPPROTO_UDP:
+		if (len < ihl + sizeof(*udp))
+			return false;
+		udp = rte_pktmbuf_mtod_offset(mbuf, struct rte_udp_hdr *, ihl);
+		l4->port = src ? &udp->src_port : &udp->dst_port;
+		l4->cksum = udp->dgram_cksum != 0 ? &udp->dgram_cksum : NULL;
+		l4->pseudo = true;
+		l4->udp = true;
+		return true;
+	case IPPROTO_ICMP:
+		if (len < ihl + sizeof(*icmp))
+			return false;
+		icmp = rte_pktmbuf_mtod_offset(mbuf, struct rte_icmp_hdr *, ihl);
+		if (icmp->icmp_type != icmp_type)
+			return false;
+		// Echo requests and replies are mapped by identifier.
+		l4->port = &icmp->icmp_ident;
+		l4->cksum = &icmp->icmp_cksum;
+		l4->pseudo = false;
+		l4->udp = false;
+		return true;
+	}
+
+	return false;
+}
+
+// Incremental checksum update (RFC 1624).
+static inline rte_be16_t cksum_update16(rte_be16_t cksum, uint16_t old, uint16_t new) {
+	uint32_t sum = (uint16_t)~cksum + (uint16_t)~old + new;
+
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum;
+}
+
+static inline rte_be16_t cksum_update32(rte_be16_t cksum, uint32_t old, uint32_t new) {
+	cksum = cksum_update16(cksum, old & 0xffff, new & 0xffff);
+	return cksum_update16(cksum, old >> 16, new >> 16);
+}
+
+static inline void nat_rewrite(
+	struct rte_ipv4_hdr *ip,
+	ip4_addr_t *addr,
+	struct nat_l4 *l4,
+	ip4_addr_t new_addr,
+	rte_be16_t new_port
+) {
+	rte_be16_t cksum;
+
+	ip->hdr_checksum = cksum_update32(ip->hdr_checksum, *addr, new_addr);
+	if (l4->cksum != NULL) {
+		cksum = *l4->cksum;
+		if (l4->pseudo)
+			cksum = cksum_update32(cksum, *addr, new_addr);
+		cksum = cksum_update16(cksum, *l4->port, new_port);
+		// Zero means no checksum for UDP.
+		if (l4->udp && cksum == 0)
+			cksum = 0xffff;
+		*l4->cksum = cksum;
+	}
+	*addr = new_addr;
+	*l4->port = new_port;
+}
+
+static inline uint32_t nat_timeout(uint8_t proto, const struct nat_l4 *l4) {
+	switch (proto) {
+	case IPPROTO_TCP:
+		// Closing connections do not need to be kept for long.
+		if (l4->tcp_flags & (RTE_TCP_FIN_FLAG | RTE_TCP_RST_FLAG))
+			return NAT_TIMEOUT_TCP_TRANS;
+		return NAT_TIMEOUT_TCP;
+	case IPPROTO_UDP:
+		return NAT_TIMEOUT_UDP;
+	}
+	return NAT_TIMEOUT_ICMP;
+}
+
+static inline bool nat_epoch_valid(uint16_t iface_id, uint32_t epoch) {
+	const struct nat_policy *p = nat44_policy(iface_id);
+	return p != NULL && p->epoch == epoch;
+}
+
+static void nat_session_free(struct nat_worker *w, struct nat_session *s) {
+	struct nat_block *b = &w->blocks[s->block];
+	uint16_t iface_id = s->keys[NAT_DIR_OUT].iface_id;
+	struct nat_policy *p;
+
+	rte_hash_del_key(w->hash, &s->keys[NAT_DIR_OUT]);
+	rte_hash_del_key(w->hash, &s->keys[NAT_DIR_IN]);
+	// The block may have been reused since the policy was removed.
+	if (b->iface_id == iface_id && b->epoch == s->epoch)
+		b->used &= ~(UINT64_C(1) << s->bit);
+	if ((p = nat44_policy(iface_id)) != NULL && p->epoch == s->epoch)
+		atomic_fetch_sub_explicit(&p->sessions, 1, memory_order_relaxed);
+
+	s->active = false;
+	s->next_free = w->free_head;
+	w->free_head = s - w->sessions;
+}
+
+static void nat_sweep(struct nat_worker *w) {
+	struct nat_session *s;
+
+	for (unsigned i = 0; i < NAT_SWEEP_BATCH; i++) {
+		s = &w->sessions[w->sweep];
+		w->sweep = (w->sweep + 1) % NAT_WORKER_MAX_SESSIONS;
+		if (!s->active)
+			continue;
+		if (s->expire <= w->now
+		    || !nat_epoch_valid(s->keys[NAT_DIR_OUT].iface_id, s->epoch))
+			nat_session_free(w, s);
+	}
+}
+
+// Claim a free block of the pool. Start from a random position to spread the workers over
+// the pool addresses.
+static int64_t nat_block_claim(struct nat_policy *p, uint8_t owner) {
+	uint32_t n = p->pool_size * NAT_BLOCKS_PER_ADDR;
+	uint32_t start = rte_rand_max(n);
+	uint8_t expected;
+	uint32_t idx;
+
+	for (uint32_t i = 0; i < n; i++) {
+		idx = (start + i) % n;
+		expected = 0;
+		if (atomic_load_explicit(&p->owners[idx], memory_order_relaxed) != 0)
+			continue;
+		if (atomic_compare_exchange_strong(&p->owners[idx], &expected, owner))
+			return idx;
+	}
+
+	return -1;
+}
+
+// Get a block of this worker with a free port, claim a new one if needed.
+static struct nat_block *
+nat_block_get(struct nat_worker *w, uint16_t iface_id, struct nat_policy *p) {
+	uint16_t slot = w->cur_block[iface_id];
+	uint16_t stale = UINT16_MAX;
+	struct nat_block *b;
+	int64_t idx;
+
+	b = &w->blocks[slot];
+	if (slot < w->n_blocks && b->iface_id == iface_id && b->epoch == p->epoch
+	    && b->used != UINT64_MAX)
+		return b;
+
+	for (slot = 0; slot < w->n_blocks; slot++) {
+		b = &w->blocks[slot];
+		if (b->iface_id == iface_id && b->epoch == p->epoch) {
+			if (b->used != UINT64_MAX)
+				goto found;
+			continue;
+		}
+		// Blocks of removed policies can be reused.
+		if (stale == UINT16_MAX && !nat_epoch_valid(b->iface_id, b->epoch))
+			stale = slot;
+	}
+	if (stale == UINT16_MAX && w->n_blocks == NAT_WORKER_MAX_BLOCKS)
+		return NULL;
+
+	if ((idx = nat_block_claim(p, rte_lcore_id() + 1)) < 0)
+		return NULL;
+
+	if (stale == UINT16_MAX)
+		stale = w->n_blocks++;
+	slot = stale;
+	b = &w->blocks[slot];
+	b->iface_id = iface_id;
+	b->epoch = p->epoch;
+	b->owner_idx = idx;
+	b->used = 0;
+found:
+	w->cur_block[iface_id] = slot;
+	return b;
+}
+
+static struct nat_session *nat_session_new(
+	struct nat_worker *w,
+	const struct nat_key *key,
+	struct nat_policy *p,
+	uint32_t timeout
+) {
+	struct nat_session *s;
+	struct nat_block *b;
+	uint32_t id, block;
+	unsigned bit;
+	void *data;
+
+	if (w->free_head == NAT_NONE)
+		return NULL;
+	if ((b = nat_block_get(w, key->iface_id, p)) == NULL)
+		return NULL;
+
+	id = w->free_head;
+	s = &w->sessions[id];
+	bit = rte_ctz64(~b->used);
+	block = b->owner_idx % NAT_BLOCKS_PER_ADDR;
+
+	s->keys[NAT_DIR_OUT] = *key;
+	s->keys[NAT_DIR_IN] = (struct nat_key) {
+		.addr = rte_cpu_to_be_32(
+			rte_be_to_cpu_32(p->pool_start) + b->owner_idx / NAT_BLOCKS_PER_ADDR
+		),
+		.port = rte_cpu_to_be_16(NAT_PORT_MIN + block * NAT_BLOCK_PORTS + bit),
+		.iface_id = key->iface_id,
+		.proto = key->proto,
+		.dir = NAT_DIR_IN,
+	};
+
+	data = (void *)(uintptr_t)id;
+	if (rte_hash_add_key_data(w->hash, &s->keys[NAT_DIR_OUT], data) < 0)
+		return NULL;
+	if (rte_hash_add_key_data(w->hash, &s->keys[NAT_DIR_IN], data) < 0) {
+		rte_hash_del_key(w->hash, &s->keys[NAT_DIR_OUT]);
+		return NULL;
+	}
+
+	w->free_head = s->next_free;
+	b->used |= UINT64_C(1) << bit;
+	s->block = b - w->blocks;
+	s->bit = bit;
+	s->epoch = p->epoch;
+	s->expire = w->now + timeout;
+	s->active = true;
+	atomic_fetch_add_explicit(&p->sessions, 1, memory_order_relaxed);
+
+	return s;
+}
+
+static inline void nat_worker_update(struct nat_worker *w) {
+	w->now = rte_get_tsc_cycles() / w->tsc_hz;
+	nat_sweep(w);
+}
+
+static uint16_t
+nat44_out_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct nat_worker *w = nat_worker_get();
+	const struct iface *iface;
+	struct rte_ipv4_hdr *ip;
+	struct nat_session *s;
+	struct rte_mbuf *mbuf;
+	struct nat_policy *p;
+	struct nat_l4 l4;
+	struct nat_key key;
+	uint32_t timeout;
+	rte_edge_t edge;
+	uint32_t offset;
+	void *data;
+
+	if (w != NULL)
+		nat_worker_update(w);
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		iface = eth_output_mbuf_data(mbuf)->iface;
+		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
+		edge = ip_output_hook_next(IP_OUTPUT_HOOK_NAT, mbuf);
+
+		if (w == NULL || (p = nat44_policy(iface->id)) == NULL)
+			goto next;
+		// Do not translate packets already using a pool address, such as the packets
+		// sent by grout itself when the pool is the interface address.
+		offset = rte_be_to_cpu_32(ip->src_addr) - rte_be_to_cpu_32(p->pool_start);
+		if (offset < p->pool_size)
+			goto next;
+		if (!nat_l4_init(&l4, mbuf, ip, RTE_IP_ICMP_ECHO_REQUEST, true))
+			goto next;
+
+		key = (struct nat_key) {
+			.addr = ip->src_addr,
+			.port = *l4.port,
+			.iface_id = iface->id,
+			.proto = ip->next_proto_id,
+			.dir = NAT_DIR_OUT,
+		};
+		timeout = nat_timeout(key.proto, &l4);
+
+		if (rte_hash_lookup_data(w->hash, &key, &data) >= 0) {
+			s = &w->sessions[(uintptr_t)data];
+			if (s->epoch != p->epoch) {
+				// Left over from a previous instance of the policy.
+				nat_session_free(w, s);
+				s = NULL;
+			}
+		} else {
+			s = NULL;
+		}
+		if (s == NULL && (s = nat_session_new(w, &key, p, timeout)) == NULL) {
+			atomic_fetch_add_explicit(&p->alloc_failures, 1, memory_order_relaxed);
+			edge = OUT_PORT_EXHAUSTED;
+			goto next;
+		}
+
+		s->expire = w->now + timeout;
+		nat_rewrite(
+			ip, &ip->src_addr, &l4, s->keys[NAT_DIR_IN].addr, s->keys[NAT_DIR_IN].port
+		);
+next:
+		rte_node_enqueue_x1(graph, node, edge, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static uint16_t
+nat44_in_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	struct nat_worker *w = nat_worker_get();
+	struct ip_output_mbuf_data *d;
+	struct nat_worker *owner_w;
+	struct rte_ipv4_hdr *ip;
+	struct nat_session *s;
+	struct rte_mbuf *mbuf;
+	struct nat_policy *p;
+	uint32_t offset, idx;
+	struct nexthop *nh;
+	struct nat_l4 l4;
+	struct nat_key key;
+	rte_edge_t edge;
+	uint16_t port;
+	uint8_t owner;
+	void *data;
+
+	if (w != NULL)
+		nat_worker_update(w);
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		d = ip_output_mbuf_data(mbuf);
+		ip = rte_pktmbuf_mtod(mbuf, struct rte_ipv4_hdr *);
+		edge = ip_input_hook_next(IP_INPUT_HOOK_NAT, mbuf);
+
+		if (w == NULL || (p = nat44_policy(d->input_iface->id)) == NULL)
+			goto next;
+		offset = rte_be_to_cpu_32(ip->dst_addr) - rte_be_to_cpu_32(p->pool_start);
+		if (offset >= p->pool_size)
+			goto next;
+		if (!nat_l4_init(&l4, mbuf, ip, RTE_IP_ICMP_ECHO_REPLY, false))
+			goto next;
+		port = rte_be_to_cpu_16(*l4.port);
+		if (port < NAT_PORT_MIN)
+			goto next;
+
+		idx = offset * NAT_BLOCKS_PER_ADDR + (port - NAT_PORT_MIN) / NAT_BLOCK_PORTS;
+		owner = atomic_load_explicit(&p->owners[idx], memory_order_relaxed);
+		if (owner == 0)
+			goto next;
+		if (owner - 1 != rte_lcore_id()) {
+			// Replies may be received by any worker. Only the block owner knows
+			// the mapping.
+			owner_w = nat_workers[owner - 1];
+			if (owner_w == NULL)
+				goto next;
+			if (rte_ring_enqueue(owner_w->handoff, mbuf) < 0) {
+				edge = IN_HANDOFF_FULL;
+				goto next;
+			}
+			continue;
+		}
+
+		key = (struct nat_key) {
+			.addr = ip->dst_addr,
+			.port = *l4.port,
+			.iface_id = d->input_iface->id,
+			.proto = ip->next_proto_id,
+			.dir = NAT_DIR_IN,
+		};
+		if (rte_hash_lookup_data(w->hash, &key, &data) < 0)
+			goto next;
+		s = &w->sessions[(uintptr_t)data];
+		if (s->epoch != p->epoch)
+			goto next;
+
+		s->expire = w->now + nat_timeout(key.proto, &l4);
+		nat_rewrite(
+			ip, &ip->dst_addr, &l4, s->keys[NAT_DIR_OUT].addr, s->keys[NAT_DIR_OUT].port
+		);
+
+		// The destination changed, route the packet again.
+		nh = ip4_route_lookup(d->input_iface->vrf_id, ip->dst_addr);
+		if (nh == NULL) {
+			edge = IN_NO_ROUTE;
+			goto next;
+		}
+		d->nh = nh;
+		edge = ip_input_hook_next(IP_INPUT_HOOK_NAT, mbuf);
+next:
+		rte_node_enqueue_x1(graph, node, edge, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static uint16_t
+nat44_handoff_process(struct rte_graph *graph, struct rte_node *node, void **, uint16_t) {
+	struct nat_worker *w = nat_worker_get();
+	unsigned n;
+
+	if (w == NULL)
+		return 0;
+
+	n = rte_ring_dequeue_burst(w->handoff, node->objs, RTE_GRAPH_BURST_SIZE, NULL);
+	if (n > 0)
+		rte_node_enqueue(graph, node, HANDOFF_NAT_IN, node->objs, n);
+
+	return n;
+}
+
+static int nat_worker_alloc(unsigned lcore_id) {
+	int socket_id = rte_lcore_to_socket_id(lcore_id);
+	struct rte_hash_parameters params = {
+		.entries = 2 * NAT_WORKER_MAX_SESSIONS,
+		.key_len = sizeof(struct nat_key),
+		.hash_func = rte_hash_crc,
+		.socket_id = socket_id,
+		.extra_flag = RTE_HASH_EXTRA_FLAGS_EXT_TABLE,
+	};
+	char name[RTE_HASH_NAMESIZE];
+	struct nat_worker *w;
+
+	if (nat_workers[lcore_id] != NULL)
+		return 0;
+
+	w = rte_zmalloc_socket(__func__, sizeof(*w), RTE_CACHE_LINE_SIZE, socket_id);
+	if (w == NULL)
+		return errno_log(rte_errno, "rte_zmalloc_socket");
+
+	snprintf(name, sizeof(name), "nat44_%u", lcore_id);
+	params.name = name;
+	if ((w->hash = rte_hash_create(&params)) == NULL) {
+		rte_free(w);
+		return errno_log(rte_errno, "rte_hash_create");
+	}
+	snprintf(name, sizeof(name), "nat44_handoff_%u", lcore_id);
+	w->handoff = rte_ring_create(name, NAT_HANDOFF_RING_SIZE, socket_id, RING_F_SC_DEQ);
+	if (w->handoff == NULL) {
+		rte_hash_free(w->hash);
+		rte_free(w);
+		return errno_log(rte_errno, "rte_ring_create");
+	}
+
+	w->tsc_hz = rte_get_tsc_hz();
+	for (uint32_t i = 0; i < NAT_WORKER_MAX_SESSIONS; i++)
+		w->sessions[i].next_free = i + 1;
+	w->sessions[NAT_WORKER_MAX_SESSIONS - 1].next_free = NAT_NONE;
+	w->free_head = 0;
+
+	nat_workers[lcore_id] = w;
+
+	return 0;
+}
+
+static int nat44_in_init(const struct rte_graph *, struct rte_node *) {
+	struct worker *worker;
+
+	// Graphs are created after the worker threads have started. Allocate the state of new
+	// workers, it is kept when graphs are reloaded.
+	STAILQ_FOREACH (worker, &workers, next) {
+		if (worker->lcore_id >= RTE_MAX_LCORE)
+			continue;
+		if (nat_worker_alloc(worker->lcore_id) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void nat44_in_register(void) {
+	ip_input_add_hook(IP_INPUT_HOOK_NAT, "nat44_in");
+}
+
+static void nat44_in_unregister(void) {
+	struct nat_worker *w;
+
+	for (unsigned i = 0; i < RTE_MAX_LCORE; i++) {
+		if ((w = nat_workers[i]) == NULL)
+			continue;
+		rte_ring_free(w->handoff);
+		rte_hash_free(w->hash);
+		rte_free(w);
+		nat_workers[i] = NULL;
+	}
+}
+
+static void nat44_out_register(void) {
+	ip_output_add_hook(IP_OUTPUT_HOOK_NAT, "nat44_out");
+}
+
+static struct rte_node_register nat44_in_node = {
+	.name = "nat44_in",
+
+	.process = nat44_in_process,
+	.init = nat44_in_init,
+
+	.nb_edges = IN_EDGE_COUNT,
+	.next_nodes = {
+		[IN_NO_ROUTE] = "nat44_no_route",
+		[IN_HANDOFF_FULL] = "nat44_handoff_full",
+	},
+};
+
+static struct rte_node_register nat44_out_node = {
+	.name = "nat44_out",
+
+	.process = nat44_out_process,
+
+	.nb_edges = OUT_EDGE_COUNT,
+	.next_nodes = {
+		[OUT_PORT_EXHAUSTED] = "nat44_port_exhausted",
+	},
+};
+
+static struct rte_node_register nat44_handoff_node = {
+	.flags = RTE_NODE_SOURCE_F,
+	.name = "nat44_handoff",
+
+	.process = nat44_handoff_process,
+
+	.nb_edges = HANDOFF_EDGE_COUNT,
+	.next_nodes = {
+		[HANDOFF_NAT_IN] = "nat44_in",
+	},
+};
+
+static struct gr_node_info nat44_in_info = {
+	.node = &nat44_in_node,
+	.register_callback = nat44_in_register,
+	.unregister_callback = nat44_in_unregister,
+};
+
+static struct gr_node_info nat44_out_info = {
+	.node = &nat44_out_node,
+	.register_callback = nat44_out_register,
+};
+
+static struct gr_node_info nat44_handoff_info = {
+	.node = &nat44_handoff_node,
+};
+
+GR_NODE_REGISTER(nat44_in_info);
+GR_NODE_REGISTER(nat44_out_info);
+GR_NODE_REGISTER(nat44_handoff_info);
+
+GR_DROP_REGISTER(nat44_no_route);
+GR_DROP_REGISTER(nat44_handoff_full);
+GR_DROP_REGISTER(nat44_port_exhausted);
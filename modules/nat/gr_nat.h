@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_API_NAT
+#define _GR_API_NAT
+
+#include <gr_api.h>
+#include <gr_net_types.h>
+
+#include <stdint.h>
+
+// Maximum number of addresses in a NAT44 pool.
+#define GR_NAT44_POOL_MAX 256
+
+// Source NAT of the packets sent on an interface. TCP, UDP and ICMP echo flows get an
+// endpoint independent mapping to an address and port of the pool.
+struct gr_nat44_policy {
+	uint16_t iface_id;
+	ip4_addr_t pool_start; // Zero to use the first address of the interface.
+	ip4_addr_t pool_end; // Zero for a single address pool.
+};
+
+struct gr_nat44_policy_status {
+	struct gr_nat44_policy policy;
+	uint32_t sessions; // Active mappings on all workers.
+	uint64_t alloc_failures; // Flows dropped because no port was available.
+};
+
+#define GR_NAT_MODULE 0xa744
+
+#define GR_NAT44_POLICY_ADD REQUEST_TYPE(GR_NAT_MODULE, 0x0001)
+
+struct gr_nat44_policy_add_req {
+	struct gr_nat44_policy policy;
+};
+
+// struct gr_nat44_policy_add_resp { };
+
+#define GR_NAT44_POLICY_DEL REQUEST_TYPE(GR_NAT_MODULE, 0x0002)
+
+struct gr_nat44_policy_del_req {
+	uint16_t iface_id;
+};
+
+// struct gr_nat44_policy_del_resp { };
+
+#define GR_NAT44_POLICY_LIST REQUEST_TYPE(GR_NAT_MODULE, 0x0003)
+
+// struct gr_nat44_policy_list_req { };
+
+struct gr_nat44_policy_list_resp {
+	uint16_t n_policies;
+	struct gr_nat44_policy_status policies[/* n_policies */];
+};
+
+#endif
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _NAT_PRIV_H
+#define _NAT_PRIV_H
+
+#include <gr_nat.h>
+#include <gr_net_types.h>
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Mapped ports are allocated in blocks claimed by the workers. Each block of a pool is owned
+// by a single worker which allocates its ports without locking. Packets received for a port
+// of another worker are handed off to it.
+#define NAT_PORT_MIN 1024
+#define NAT_BLOCK_PORTS 64
+#define NAT_BLOCKS_PER_ADDR ((UINT16_MAX + 1 - NAT_PORT_MIN) / NAT_BLOCK_PORTS)
+
+struct nat_policy {
+	atomic_bool enabled;
+	// Changed each time the policy is added. Worker state of an older epoch is stale.
+	uint32_t epoch;
+	ip4_addr_t pool_start;
+	ip4_addr_t pool_end;
+	uint32_t pool_size;
+	// Owner lcore ID plus one of each block of each pool address, zero if not claimed.
+	// Blocks are only released when the policy is removed.
+	_Atomic(uint8_t) *owners;
+	_Atomic(uint32_t) sessions;
+	_Atomic(uint64_t) alloc_failures;
+};
+
+// Get the policy of an interface, NULL if source NAT is not enabled on it.
+struct nat_policy *nat44_policy(uint16_t iface_id);
+
+#endif
@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include <gr_api.h>
+#include <gr_cli.h>
+#include <gr_cli_iface.h>
+#include <gr_net_types.h>
+#include <gr_vxlan.h>
+
+#include <ecoli.h>
+
+#include <errno.h>
+
+static void vxlan_show(const struct gr_api_client *c, const struct gr_iface *iface) {
+	const struct gr_iface_info_vxlan *vxlan = (const struct gr_iface_info_vxlan *)iface->info;
+	char local[64], remote[64];
+
+	(void)c;
+
+	inet_ntop(AF_INET, &vxlan->local, local, sizeof(local));
+	inet_ntop(AF_INET, &vxlan->remote, remote, sizeof(remote));
+	printf("vni: %u\n", vxlan->vni);
+	printf("local: %s\n", local);
+	printf("remote: %s\n", remote);
+	printf("mac: " ETH_ADDR_FMT "\n", ETH_ADDR_SPLIT(&vxlan->mac));
+}
+
+static void vxlan_list_info(
+	const struct gr_api_client *c,
+	const struct gr_iface *iface,
+	char *buf,
+	size_t len
+) {
+	const struct gr_iface_info_vxlan *vxlan = (const struct gr_iface_info_vxlan *)iface->info;
+	char local[64], remote[64];
+
+	(void)c;
+
+	inet_ntop(AF_INET, &vxlan->local, local, sizeof(local));
+	inet_ntop(AF_INET, &vxlan->remote, remote, sizeof(remote));
+	snprintf(buf, len, "vni=%u local=%s remote=%s", vxlan->vni, local, remote);
+}
+
+static struct cli_iface_type vxlan_type = {
+	.type_id = GR_IFACE_TYPE_VXLAN,
+	.name = "vxlan",
+	.show = vxlan_show,
+	.list_info = vxlan_list_info,
+};
+
+static uint64_t parse_vxlan_args(
+	const struct gr_api_client *c,
+	const struct ec_pnode *p,
+	struct gr_iface *iface,
+	bool update
+) {
+	uint64_t set_attrs = parse_iface_args(c, p, iface, update);
+	struct gr_iface_info_vxlan *vxlan;
+	const char *local, *remote;
+
+	vxlan = (struct gr_iface_info_vxlan *)iface->info;
+
+	if (arg_u32(p, "VNI", &vxlan->vni) == 0)
+		set_attrs |= GR_VXLAN_SET_VNI;
+	local = arg_str(p, "LOCAL");
+	if (local != NULL) {
+		if (inet_pton(AF_INET, local, &vxlan->local) != 1) {
+			errno = EINVAL;
+			return 0;
+		}
+		set_attrs |= GR_VXLAN_SET_LOCAL;
+	}
+	remote = arg_str(p, "REMOTE");
+	if (remote != NULL) {
+		if (inet_pton(AF_INET, remote, &vxlan->remote) != 1) {
+			errno = EINVAL;
+			return 0;
+		}
+		set_attrs |= GR_VXLAN_SET_REMOTE;
+	}
+	if (local != NULL && remote != NULL && vxlan->local == vxlan->remote) {
+		errno = EADDRINUSE;
+		return 0;
+	}
+	// A random address is generated on creation if none is specified.
+	if (arg_eth_addr(p, "MAC", &vxlan->mac) == 0 || !update)
+		set_attrs |= GR_VXLAN_SET_MAC;
+
+	if (set_attrs == 0)
+		errno = EINVAL;
+	return set_attrs;
+}
+
+static cmd_status_t vxlan_add(const struct gr_api_client *c, const struct ec_pnode *p) {
+	const struct gr_infra_iface_add_resp *resp;
+	struct gr_infra_iface_add_req req = {
+		.iface = {.type = GR_IFACE_TYPE_VXLAN, .flags = GR_IFACE_F_UP}
+	};
+	void *resp_ptr = NULL;
+
+	if (parse_vxlan_args(c, p, &req.iface, false) == 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_IFACE_ADD, sizeof(req), &req, &resp_ptr) < 0)
+		return CMD_ERROR;
+
+	resp = resp_ptr;
+	printf("Created interface %u\n", resp->iface_id);
+	free(resp_ptr);
+	return CMD_SUCCESS;
+}
+
+static cmd_status_t vxlan_set(const struct gr_api_client *c, const struct ec_pnode *p) {
+	struct gr_infra_iface_set_req req = {0};
+
+	if ((req.set_attrs = parse_vxlan_args(c, p, &req.iface, true)) == 0)
+		return CMD_ERROR;
+
+	if (gr_api_client_send_recv(c, GR_INFRA_IFACE_SET, sizeof(req), &req, NULL) < 0)
+		return CMD_ERROR;
+
+	return CMD_SUCCESS;
+}
+
+#define VXLAN_ATTRS_CMD IFACE_ATTRS_CMD ",(mac MAC)"
+
+#define VXLAN_ATTRS_ARGS                                                                           \
+	IFACE_ATTRS_ARGS,                                                                          \
+		with_help(                                                                         \
+			"VXLAN network identifier.",                                               \
+			ec_node_uint("VNI", 0, GR_VXLAN_VNI_MAX, 10)                               \
+		),                                                                                 \
+		with_help("Local tunnel endpoint address.", ec_node_re("LOCAL", IPV4_RE)),         \
+		with_help("Remote tunnel endpoint address.", ec_node_re("REMOTE", IPV4_RE)),       \
+		with_help("Set the ethernet address.", ec_node_re("MAC", ETH_ADDR_RE))
+
+static int ctx_init(struct ec_node *root) {
+	int ret;
+
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_ADD, CTX_ARG("interface", "Create interfaces.")),
+		"vxlan NAME vni VNI local LOCAL remote REMOTE [" VXLAN_ATTRS_CMD "]",
+		vxlan_add,
+		"Create a new VXLAN tunnel interface.",
+		with_help("Interface name.", ec_node("any", "NAME")),
+		VXLAN_ATTRS_ARGS
+	);
+	if (ret < 0)
+		return ret;
+	ret = CLI_COMMAND(
+		CLI_CONTEXT(root, CTX_SET, CTX_ARG("interface", "Modify interfaces.")),
+		"vxlan NAME (name NEW_NAME),(vni VNI),(local LOCAL),(remote REMOTE),"
+		VXLAN_ATTRS_CMD,
+		vxlan_set,
+		"Modify VXLAN parameters.",
+		with_help(
+			"Interface name.",
+			ec_node_dyn("NAME", complete_iface_names, INT2PTR(GR_IFACE_TYPE_VXLAN))
+		),
+		with_help("New interface name.", ec_node("any", "NEW_NAME")),
+		VXLAN_ATTRS_ARGS
+	);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+static struct gr_cli_context ctx = {
+	.name = "vxlan",
+	.init = ctx_init,
+};
+
+static void __attribute__((constructor, used)) init(void) {
+	register_context(&ctx);
+	register_iface_type(&vxlan_type);
+}
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_vxlan.h"
+#include "vxlan_priv.h"
+
+#include <gr_control.h>
+#include <gr_iface.h>
+#include <gr_infra.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+
+#include <event2/event.h>
+#include <rte_ether.h>
+#include <rte_hash.h>
+#include <rte_ip.h>
+
+#include <netinet/in.h>
+#include <string.h>
+
+static struct rte_hash *vxlan_hash;
+
+void vxlan_get_iface_bulk(const struct vxlan_key **keys, unsigned n, struct iface **ifaces) {
+	ip4_tunnel_get_iface_bulk(vxlan_hash, (const void **)keys, n, ifaces);
+}
+
+static void vxlan_template_init(struct iface_info_vxlan *vxlan) {
+	struct vxlan_encap *t = &vxlan->template;
+	struct ip_local_mbuf_data tunnel = {
+		.src = vxlan->local,
+		.dst = vxlan->remote,
+		.len = 0,
+		.proto = IPPROTO_UDP,
+	};
+
+	memset(t, 0, sizeof(*t));
+	ip_set_fields(&t->ip, &tunnel);
+	t->ip.total_length = 0;
+	t->ip.hdr_checksum = 0;
+	vxlan->template_sum = __rte_raw_cksum(&t->ip, sizeof(t->ip), 0);
+
+	// The UDP checksum is left to zero (RFC 7348).
+	t->udp.dst_port = RTE_BE16(GR_VXLAN_PORT);
+	t->vxlan.vx_flags = RTE_BE32(0x08000000); // VNI is valid
+	t->vxlan.vx_vni = rte_cpu_to_be_32(vxlan->vni << 8);
+}
+
+// Only remove keys which point to this interface. New interfaces have a zero key which may be
+// used by another one.
+static void vxlan_hash_del(const struct vxlan_key *key, const struct iface *iface) {
+	void *data;
+
+	if (rte_hash_lookup_data(vxlan_hash, key, &data) >= 0 && data == iface)
+		rte_hash_del_key(vxlan_hash, key);
+}
+
+static int iface_vxlan_reconfig(
+	struct iface *iface,
+	uint64_t set_attrs,
+	uint16_t flags,
+	uint16_t mtu,
+	uint16_t vrf_id,
+	const void *api_info
+) {
+	struct iface_info_vxlan *cur = (struct iface_info_vxlan *)iface->info;
+	const struct gr_iface_info_vxlan *next = api_info;
+	struct vxlan_key cur_key = {cur->vni, iface->vrf_id};
+	struct vxlan_key next_key;
+	ip4_addr_t local, remote;
+	int ret;
+
+	// Only the fields of the set attributes are initialized.
+	if (!(set_attrs & GR_IFACE_SET_VRF))
+		vrf_id = iface->vrf_id;
+	next_key.vni = set_attrs & GR_VXLAN_SET_VNI ? next->vni : cur->vni;
+	next_key.vrf_id = vrf_id;
+
+	if (set_attrs & (GR_IFACE_SET_VRF | GR_VXLAN_SET_LOCAL | GR_VXLAN_SET_REMOTE)) {
+		if (vrf_id >= IP4_MAX_VRFS)
+			return errno_set(EOVERFLOW);
+
+		local = set_attrs & GR_VXLAN_SET_LOCAL ? next->local : cur->local;
+		remote = set_attrs & GR_VXLAN_SET_REMOTE ? next->remote : cur->remote;
+		if (ip4_route_lookup(vrf_id, local) == NULL)
+			return -errno;
+		if (ip4_route_lookup(vrf_id, remote) == NULL)
+			return -errno;
+
+		cur->local = local;
+		cur->remote = remote;
+	}
+
+	if (set_attrs & (GR_IFACE_SET_VRF | GR_VXLAN_SET_VNI)) {
+		if (next_key.vni > GR_VXLAN_VNI_MAX)
+			return errno_set(ERANGE);
+
+		if (memcmp(&cur_key, &next_key, sizeof(cur_key)) != 0) {
+			if (rte_hash_lookup(vxlan_hash, &next_key) >= 0)
+				return errno_set(EADDRINUSE);
+			vxlan_hash_del(&cur_key, iface);
+		}
+		if ((ret = rte_hash_add_key_data(vxlan_hash, &next_key, iface)) < 0)
+			return errno_log(-ret, "rte_hash_add_key_data");
+
+		cur->vni = next_key.vni;
+		iface->vrf_id = vrf_id;
+	}
+
+	if (set_attrs & (GR_IFACE_SET_VRF | GR_VXLAN_SET_VNI | GR_VXLAN_SET_LOCAL
+			 | GR_VXLAN_SET_REMOTE)) {
+		vxlan_template_init(cur);
+		// Workers cache the next hop towards the remote endpoint.
+		ip4_flow_cache_invalidate();
+	}
+
+	if (set_attrs & GR_VXLAN_SET_MAC) {
+		if (rte_is_zero_ether_addr(&next->mac))
+			rte_eth_random_addr(cur->mac.addr_bytes);
+		else if (rte_is_unicast_ether_addr(&next->mac))
+			rte_ether_addr_copy(&next->mac, &cur->mac);
+		else
+			return errno_set(EINVAL);
+	}
+
+	if (set_attrs & GR_IFACE_SET_FLAGS)
+		iface->flags = flags;
+	if (set_attrs & GR_IFACE_SET_MTU)
+		iface->mtu = mtu;
+
+	return 0;
+}
+
+static int iface_vxlan_fini(struct iface *iface) {
+	struct iface_info_vxlan *vxlan = (struct iface_info_vxlan *)iface->info;
+	struct vxlan_key key = {vxlan->vni, iface->vrf_id};
+
+	vxlan_hash_del(&key, iface);
+
+	return 0;
+}
+
+static int iface_vxlan_init(struct iface *iface, const void *api_info) {
+	int ret;
+
+	ret = iface_vxlan_reconfig(
+		iface, IFACE_SET_ALL, iface->flags, iface->mtu, iface->vrf_id, api_info
+	);
+	if (ret < 0) {
+		iface_vxlan_fini(iface);
+		errno = -ret;
+	}
+
+	return ret;
+}
+
+static int iface_vxlan_get_eth_addr(const struct iface *iface, struct rte_ether_addr *mac) {
+	const struct iface_info_vxlan *vxlan = (const struct iface_info_vxlan *)iface->info;
+	rte_ether_addr_copy(&vxlan->mac, mac);
+	return 0;
+}
+
+static void vxlan_to_api(void *info, const struct iface *iface) {
+	const struct iface_info_vxlan *vxlan = (const struct iface_info_vxlan *)iface->info;
+	struct gr_iface_info_vxlan *api = info;
+
+	api->local = vxlan->local;
+	api->remote = vxlan->remote;
+	api->vni = vxlan->vni;
+	rte_ether_addr_copy(&vxlan->mac, &api->mac);
+}
+
+static struct iface_type iface_type_vxlan = {
+	.id = GR_IFACE_TYPE_VXLAN,
+	.name = "vxlan",
+	.info_size = sizeof(struct iface_info_vxlan),
+	.init = iface_vxlan_init,
+	.reconfig = iface_vxlan_reconfig,
+	.fini = iface_vxlan_fini,
+	.get_eth_addr = iface_vxlan_get_eth_addr,
+	.to_api = vxlan_to_api,
+};
+
+static void vxlan_init(struct event_base *) {
+	struct rte_hash_parameters params = {
+		.name = "vxlan",
+		.entries = MAX_IFACES,
+		.key_len = sizeof(struct vxlan_key),
+		.socket_id = SOCKET_ID_ANY,
+		.extra_flag = RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF
+			| RTE_HASH_EXTRA_FLAGS_TRANS_MEM_SUPPORT,
+	};
+	vxlan_hash = rte_hash_create(&params);
+	if (vxlan_hash == NULL)
+		ABORT("rte_hash_create(vxlan)");
+}
+
+static void vxlan_fini(struct event_base *) {
+	rte_hash_free(vxlan_hash);
+	vxlan_hash = NULL;
+}
+
+static struct gr_module vxlan_module = {
+	.name = "vxlan",
+	.init = vxlan_init,
+	.fini = vxlan_fini,
+	.fini_prio = 1000,
+};
+
+RTE_INIT(vxlan_constructor) {
+	gr_register_module(&vxlan_module);
+	iface_type_register(&iface_type_vxlan);
+}
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_vxlan.h"
+#include "vxlan_priv.h"
+
+#include <gr_datapath.h>
+#include <gr_eth_input.h>
+#include <gr_graph.h>
+#include <gr_ip4_datapath.h>
+#include <gr_log.h>
+#include <gr_mbuf.h>
+
+#include <rte_byteorder.h>
+#include <rte_common.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+#include <rte_hash.h>
+#include <rte_mbuf.h>
+#include <rte_vxlan.h>
+
+enum {
+	ETH_INPUT = 0,
+	NO_TUNNEL,
+	BAD_HEADER,
+	EDGE_COUNT,
+};
+
+// Never configured, VNIs are 24 bits long.
+#define INVALID_VNI UINT32_MAX
+// VXLAN header followed by the inner ethernet header.
+#define VXLAN_MIN_LEN (sizeof(struct rte_vxlan_hdr) + sizeof(struct rte_ether_hdr))
+
+static uint16_t
+vxlan_input_process(struct rte_graph *graph, struct rte_node *node, void **objs, uint16_t nb_objs) {
+	const struct vxlan_key *key_ptrs[RTE_HASH_LOOKUP_BULK_MAX];
+	struct vxlan_key keys[RTE_HASH_LOOKUP_BULK_MAX];
+	struct iface *ifaces[RTE_HASH_LOOKUP_BULK_MAX];
+	const struct ip_local_mbuf_data *ip_data;
+	const struct rte_vxlan_hdr *vxlan;
+	struct rte_mbuf *mbuf;
+	rte_edge_t next;
+	unsigned n;
+
+	for (uint16_t i = 0; i < nb_objs; i += n) {
+		n = RTE_MIN(nb_objs - i, RTE_HASH_LOOKUP_BULK_MAX);
+
+		// Resolve the tunnels of the whole batch with a single hash lookup.
+		for (unsigned j = 0; j < n; j++) {
+			mbuf = objs[i + j];
+			ip_data = ip_local_mbuf_data(mbuf);
+			vxlan = rte_pktmbuf_mtod(mbuf, const struct rte_vxlan_hdr *);
+			keys[j].vni = INVALID_VNI;
+			keys[j].vrf_id = ip_data->vrf_id;
+			key_ptrs[j] = &keys[j];
+			if (ip_data->len < VXLAN_MIN_LEN
+			    || rte_pktmbuf_data_len(mbuf) < VXLAN_MIN_LEN
+			    || !(vxlan->vx_flags & RTE_BE32(0x08000000)))
+				continue;
+			keys[j].vni = rte_be_to_cpu_32(vxlan->vx_vni) >> 8;
+		}
+		vxlan_get_iface_bulk(key_ptrs, n, ifaces);
+
+		for (unsigned j = 0; j < n; j++) {
+			mbuf = objs[i + j];
+			if (keys[j].vni == INVALID_VNI) {
+				next = BAD_HEADER;
+				goto next;
+			}
+			if (ifaces[j] == NULL) {
+				next = NO_TUNNEL;
+				goto next;
+			}
+			rte_pktmbuf_adj(mbuf, sizeof(*vxlan));
+			// The rx offload flags only apply to the outer headers. Let eth_input parse
+			// the inner VLAN tag and ip_input check the inner IP checksum.
+			mbuf->ol_flags &= ~(RTE_MBUF_F_RX_VLAN | RTE_MBUF_F_RX_VLAN_STRIPPED);
+			mbuf->ol_flags |= RTE_MBUF_F_RX_IP_CKSUM_NONE;
+			eth_input_mbuf_data(mbuf)->iface = ifaces[j];
+			next = ETH_INPUT;
+next:
+			rte_node_enqueue_x1(graph, node, next, mbuf);
+		}
+	}
+
+	return nb_objs;
+}
+
+static void vxlan_input_register(void) {
+	udp_input_add_tunnel(RTE_BE16(GR_VXLAN_PORT), "vxlan_input");
+}
+
+static struct rte_node_register vxlan_input_node = {
+	.name = "vxlan_input",
+
+	.process = vxlan_input_process,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[ETH_INPUT] = "eth_input",
+		[NO_TUNNEL] = "vxlan_input_no_tunnel",
+		[BAD_HEADER] = "vxlan_input_bad_header",
+	},
+};
+
+static struct gr_node_info vxlan_input_info = {
+	.node = &vxlan_input_node,
+	.register_callback = vxlan_input_register,
+};
+
+GR_NODE_REGISTER(vxlan_input_info);
+
+GR_DROP_REGISTER(vxlan_input_no_tunnel);
+GR_DROP_REGISTER(vxlan_input_bad_header);
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#include "gr_vxlan.h"
+#include "vxlan_priv.h"
+
+#include <gr_datapath.h>
+#include <gr_eth_output.h>
+#include <gr_graph.h>
+#include <gr_ip4_control.h>
+#include <gr_ip4_datapath.h>
+#include <gr_mbuf.h>
+
+#include <rte_byteorder.h>
+#include <rte_ether.h>
+#include <rte_graph_worker.h>
+#include <rte_ip.h>
+#include <rte_jhash.h>
+#include <rte_mbuf.h>
+
+#include <netinet/in.h>
+
+enum {
+	IP_OUTPUT = 0,
+	NO_HEADROOM,
+	EDGE_COUNT,
+};
+
+// Outer UDP source ports are taken from the dynamic range (RFC 7348 section 5).
+#define SRC_PORT_MIN 49152
+#define SRC_PORT_MASK 0x3fff
+
+// Hash of the inner flow. Packets of a flow use the same outer source port so that they are
+// not reordered, different flows are spread over the receiver RSS queues and ECMP paths.
+static inline uint32_t inner_hash(const struct rte_mbuf *mbuf, rte_be16_t ether_type) {
+	const rte_be16_t frag_mask = RTE_BE16(RTE_IPV4_HDR_MF_FLAG | RTE_IPV4_HDR_OFFSET_MASK);
+	const struct rte_ipv4_hdr *ip;
+	uint32_t ports = 0;
+
+	// Forwarded packets keep the hash computed by the input port.
+	if (mbuf->ol_flags & RTE_MBUF_F_RX_RSS_HASH)
+		return mbuf->hash.rss;
+	if (ether_type != RTE_BE16(RTE_ETHER_TYPE_IPV4))
+		return 0;
+
+	ip = rte_pktmbuf_mtod(mbuf, const struct rte_ipv4_hdr *);
+	switch (ip->next_proto_id) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		if (!(ip->fragment_offset & frag_mask)) {
+			const uint8_t *l4 = (const uint8_t *)ip + rte_ipv4_hdr_len(ip);
+			ports = *(const unaligned_uint32_t *)l4;
+		}
+		break;
+	}
+
+	return rte_jhash_3words(ip->src_addr, ip->dst_addr, ports, ip->next_proto_id);
+}
+
+static uint16_t vxlan_output_process(
+	struct rte_graph *graph,
+	struct rte_node *node,
+	void **objs,
+	uint16_t nb_objs
+) {
+	const struct eth_output_mbuf_data *eth_data;
+	const struct iface_info_vxlan *vxlan;
+	struct ip_output_mbuf_data *ip_data;
+	struct vxlan_encap *outer;
+	const struct iface *iface;
+	struct rte_ether_hdr *eth;
+	struct rte_mbuf *mbuf;
+	uint32_t gen, hash;
+	rte_be16_t len;
+	rte_edge_t next;
+
+	// Route changes bump the generation, see ip4_encap_nh_get().
+	gen = ip4_flow_cache_generation();
+
+	for (uint16_t i = 0; i < nb_objs; i++) {
+		mbuf = objs[i];
+		eth_data = eth_output_mbuf_data(mbuf);
+		iface = eth_data->iface;
+		vxlan = (const struct iface_info_vxlan *)iface->info;
+		hash = inner_hash(mbuf, eth_data->ether_type);
+
+		eth = (struct rte_ether_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*eth));
+		if (unlikely(eth == NULL)) {
+			next = NO_HEADROOM;
+			goto next;
+		}
+		rte_ether_addr_copy(&eth_data->dst, &eth->dst_addr);
+		rte_ether_addr_copy(&vxlan->mac, &eth->src_addr);
+		eth->ether_type = eth_data->ether_type;
+
+		// Encapsulate with a copy of the precomputed outer headers.
+		len = rte_cpu_to_be_16(rte_pktmbuf_pkt_len(mbuf) + sizeof(*outer));
+		outer = (struct vxlan_encap *)rte_pktmbuf_prepend(mbuf, sizeof(*outer));
+		if (unlikely(outer == NULL)) {
+			next = NO_HEADROOM;
+			goto next;
+		}
+		*outer = vxlan->template;
+		outer->ip.total_length = len;
+		outer->ip.hdr_checksum = ~__rte_raw_cksum_reduce(vxlan->template_sum + len);
+		outer->udp.src_port = rte_cpu_to_be_16(
+			SRC_PORT_MIN + ((hash ^ (hash >> 16)) & SRC_PORT_MASK)
+		);
+		outer->udp.dgram_len = rte_cpu_to_be_16(
+			rte_pktmbuf_pkt_len(mbuf) - sizeof(outer->ip)
+		);
+
+		// Resolve nexthop for the encapsulated packet. This overwrites eth_data.
+		ip_data = ip_output_mbuf_data(mbuf);
+		ip_data->nh = ip4_encap_nh_get(node, iface, vxlan->remote, gen);
+		ip_data->flow = NULL;
+		next = IP_OUTPUT;
+next:
+		rte_node_enqueue_x1(graph, node, next, mbuf);
+	}
+
+	return nb_objs;
+}
+
+static void vxlan_output_register(void) {
+	eth_output_add_tunnel(GR_IFACE_TYPE_VXLAN, "vxlan_output");
+}
+
+static struct rte_node_register vxlan_output_node = {
+	.name = "vxlan_output",
+
+	.process = vxlan_output_process,
+	.init = ip4_encap_nh_init,
+	.fini = ip4_encap_nh_fini,
+
+	.nb_edges = EDGE_COUNT,
+	.next_nodes = {
+		[IP_OUTPUT] = "ip_output",
+		[NO_HEADROOM] = "error_no_headroom",
+	},
+};
+
+static struct gr_node_info vxlan_output_info = {
+	.node = &vxlan_output_node,
+	.register_callback = vxlan_output_register,
+};
+
+GR_NODE_REGISTER(vxlan_output_info);
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _GR_API_VXLAN
+#define _GR_API_VXLAN
+
+#include <gr_api.h>
+#include <gr_bitops.h>
+#include <gr_infra.h>
+#include <gr_macro.h>
+#include <gr_net_types.h>
+
+#define GR_IFACE_TYPE_VXLAN 0x0004
+
+// IANA assigned UDP destination port (RFC 7348).
+#define GR_VXLAN_PORT 4789
+#define GR_VXLAN_VNI_MAX ((1 << 24) - 1)
+
+// VXLAN reconfig attributes
+#define GR_VXLAN_SET_LOCAL GR_BIT64(32)
+#define GR_VXLAN_SET_REMOTE GR_BIT64(33)
+#define GR_VXLAN_SET_VNI GR_BIT64(34)
+#define GR_VXLAN_SET_MAC GR_BIT64(35)
+
+// Info for GR_IFACE_TYPE_VXLAN interfaces
+struct gr_iface_info_vxlan {
+	ip4_addr_t local;
+	ip4_addr_t remote;
+	uint32_t vni;
+	struct rte_ether_addr mac; // Random if zero on creation.
+};
+
+static_assert(sizeof(struct gr_iface_info_vxlan) <= MEMBER_SIZE(struct gr_iface, info));
+
+#endif
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright (c) 2024 Robin Jarry
+
+#ifndef _VXLAN_PRIV_H
+#define _VXLAN_PRIV_H
+
+#include <gr_iface.h>
+#include <gr_net_types.h>
+
+#include <rte_common.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_udp.h>
+#include <rte_vxlan.h>
+
+#include <stdint.h>
+
+// Headers prepended to the inner ethernet frame.
+struct __rte_packed vxlan_encap {
+	struct rte_ipv4_hdr ip;
+	struct rte_udp_hdr udp;
+	struct rte_vxlan_hdr vxlan;
+};
+
+struct __rte_aligned(alignof(void *)) iface_info_vxlan {
+	ip4_addr_t local;
+	ip4_addr_t remote;
+	uint32_t vni;
+	struct rte_ether_addr mac;
+	// Outer headers of encapsulated packets without lengths, checksum and source port.
+	struct vxlan_encap template;
+	// One's complement sum of the template IP header, see vxlan_output_process().
+	uint32_t template_sum;
+};
+
+struct vxlan_key {
+	uint32_t vni;
+	// uint32_t to avoid padding bytes in hash keys, see struct ipip_key.
+	uint32_t vrf_id;
+};
+
+// See ip4_tunnel_get_iface_bulk().
+void vxlan_get_iface_bulk(const struct vxlan_key **keys, unsigned n, struct iface **ifaces);
+
+#endif
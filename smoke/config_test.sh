@@ -12,6 +12,28 @@ grcli add ip route 0.0.0.0/0 via 10.0.0.2
 grcli show interface all
 grcli show ip route
 grcli show ip nexthop
+grcli set ip nexthop hold max 64 time 5
+grcli show ip nexthop hold | grep -qx 'max_pkts: 64'
+grcli set ip nexthop solicit rate 500 iface_rate 50
+grcli show ip nexthop solicit | grep -qx 'iface_rate: 50'
+grcli set ip icmp error rate 100 src_prefixlen 32
+grcli show ip icmp error | grep -qx 'src_prefixlen: 32'
+grcli set ip copp arp rate 500 src_rate 50
+grcli show ip copp | grep -q '^arp  *500 '
+grcli set ip urpf iface p0 strict
+grcli show ip urpf | grep -q '^p0  *strict'
+grcli set ip urpf iface p0 off
+grcli set ip flow cache on
+grcli show ip flow cache | grep -qx 'enabled: on'
+grcli set conntrack timeout udp 60 icmp 10
+grcli show conntrack timeout | grep -qx 'udp: 60'
+grcli set port qos p0 rate 100 pipes 4
+grcli set port qos p0 dscp 46 tc 0
+grcli show port qos p0 | grep -qx 'rate: 100 Mbit/s'
+grcli set port qos p0 rate 0
+grcli set policer iface p0 cir 100000 cbs 10000 pir 200000 ebs 20000 red 10
+grcli show policer all | grep -q trtcm
+grcli del policer iface p0
 grcli show graph dot
 grcli show stats software
 grcli show stats hardware
@@ -0,0 +1,40 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+# Copyright (c) 2024 Robin Jarry
+
+. $(dirname $0)/_init.sh
+
+p0=${run_id}0
+p1=${run_id}1
+
+grcli add interface port $p0 devargs net_tap0,iface=$p0 mac f0:0d:ac:dc:00:00 rxqs 2 ctrlq on
+grcli add interface port $p1 devargs net_tap1,iface=$p1 mac f0:0d:ac:dc:00:01 ctrlq on
+grcli add ip address 172.16.0.1/24 iface $p0
+grcli add ip address 172.16.1.1/24 iface $p1
+grcli show interface name $p0 | grep -F 'ctrlq: on (active)'
+grcli show port qmap
+
+for n in 0 1; do
+	p=$run_id$n
+	ip netns add $p
+	echo ip netns del $p >> $tmp/cleanup
+	ip link set $p netns $p
+	ip -n $p link set $p address ba:d0:ca:ca:00:0$n
+	ip -n $p link set $p up
+	ip -n $p addr add 172.16.$n.2/24 dev $p
+	ip -n $p route add default via 172.16.$n.1
+	ip -n $p addr show
+done
+
+# the first ping resolves 172.16.0.1 with ARP, which is steered to the control queue (rxq 2)
+grcli clear stats
+ip netns exec $p0 ping -i0.01 -c3 172.16.0.1
+ctrlq_pkts=$(grcli show stats hardware pattern "$p0.rx_q2_packets" | awk '{print $2}')
+if [ "${ctrlq_pkts:-0}" -eq 0 ]; then exit 1; fi
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+ip netns exec $p1 ping -i0.01 -c3 172.16.0.2
+
+# the control queue can be disabled at runtime
+grcli set interface port $p0 ctrlq off
+grcli show interface name $p0 | grep -F 'ctrlq: off'
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
@@ -0,0 +1,57 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+# Copyright (c) 2024 Robin Jarry
+
+. $(dirname $0)/_init.sh
+
+p0=${run_id}0
+p1=${run_id}1
+
+drops() {
+	n=$(grcli show stats software brief | awk -v name=$1 '$1 == name {print $2}')
+	echo ${n:-0}
+}
+
+# send 200 packets as fast as possible and print the number of ICMP errors received
+flood() {
+	out=$(ip netns exec $p0 ping -i0.001 -c200 -W1 "$@" 2>&1 || true)
+	n=$(echo "$out" | sed -En 's/.*\+([0-9]+) errors.*/\1/p')
+	echo ${n:-0}
+}
+
+grcli add interface port $p0 devargs net_tap0,iface=$p0 mac f0:0d:ac:dc:00:00
+grcli add interface port $p1 devargs net_tap1,iface=$p1 mac f0:0d:ac:dc:00:01
+grcli add ip address 172.16.0.1/24 iface $p0
+grcli add ip address 172.16.1.1/24 iface $p1
+
+for n in 0 1; do
+	p=$run_id$n
+	ip netns add $p
+	echo ip netns del $p >> $tmp/cleanup
+	ip link set $p netns $p
+	ip -n $p link set $p address ba:d0:ca:ca:00:0$n
+	ip -n $p link set $p up
+	ip -n $p addr add 172.16.$n.2/24 dev $p
+	ip -n $p route add default via 172.16.$n.1
+	ip -n $p addr show
+done
+
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+
+# no route, limited by the per source bucket (10 errors/s, burst 10)
+grcli set ip icmp error rate 100000 burst 100000 src_rate 10 src_burst 10
+grcli show ip icmp error
+limited=$(drops icmp_error_src_rate_limited)
+errors=$(flood 198.51.100.1)
+test $errors -ge 1
+test $errors -le 20
+test $(drops icmp_error_src_rate_limited) -ge $((limited + 150))
+
+# ttl exceeded, limited by the global bucket (10 errors/s, burst 10)
+grcli set ip icmp error rate 10 burst 10 src_rate 100000 src_burst 100000
+grcli show ip icmp error
+limited=$(drops icmp_error_rate_limited)
+errors=$(flood -t1 172.16.1.2)
+test $errors -ge 1
+test $errors -le 20
+test $(drops icmp_error_rate_limited) -ge $((limited + 150))
@@ -26,3 +26,19 @@ done
 
 ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
 ip netns exec $p1 ping -i0.01 -c3 172.16.0.2
+
+# same flows, bypassing route and neighbor lookups
+grcli set ip flow cache on
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+ip netns exec $p1 ping -i0.01 -c3 172.16.0.2
+grcli set ip flow cache off
+
+# commands read from stdin are sent in bulk
+for i in $(seq 0 9999); do
+	echo "add ip route 10.$((i / 256)).$((i % 256)).0/24 via 172.16.1.2"
+done | grcli -e
+test $(grcli show ip route | grep -c '^10\.') -eq 10000
+for i in $(seq 0 9999); do
+	echo "del ip route 10.$((i / 256)).$((i % 256)).0/24"
+done | grcli -e
+test $(grcli show ip route | grep -c '^10\.') -eq 0
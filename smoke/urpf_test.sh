@@ -0,0 +1,61 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+# Copyright (c) 2024 Robin Jarry
+
+. $(dirname $0)/_init.sh
+
+p0=${run_id}0
+p1=${run_id}1
+
+rpf_failed() {
+	n=$(grcli show stats software brief | awk '$1 == "ip_input_rpf_failed" {print $2}')
+	echo ${n:-0}
+}
+
+rx_packets() {
+	ip netns exec $1 cat /sys/class/net/$1/statistics/rx_packets
+}
+
+grcli add interface port $p0 devargs net_tap0,iface=$p0 mac f0:0d:ac:dc:00:00
+grcli add interface port $p1 devargs net_tap1,iface=$p1 mac f0:0d:ac:dc:00:01
+grcli add ip address 172.16.0.1/24 iface $p0
+grcli add ip address 172.16.1.1/24 iface $p1
+
+for n in 0 1; do
+	p=$run_id$n
+	ip netns add $p
+	echo ip netns del $p >> $tmp/cleanup
+	ip link set $p netns $p
+	ip -n $p link set $p address ba:d0:ca:ca:00:0$n
+	ip -n $p link set $p up
+	ip -n $p addr add 172.16.$n.2/24 dev $p
+	ip -n $p route add default via 172.16.$n.1
+	ip -n $p addr show
+done
+# spoofed source, the route to 172.16.1.99 goes through $p1
+ip -n $p0 addr add 172.16.1.99/32 dev $p0
+
+grcli set ip urpf iface $p0 strict
+grcli show ip urpf | grep -E "^$p0 +strict"
+
+# legitimate sources are accepted
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+
+# spoofed sources are dropped
+failed=$(rpf_failed)
+rx=$(rx_packets $p1)
+ip netns exec $p0 ping -i0.01 -c3 -W1 -I 172.16.1.99 172.16.1.2 || true
+test $(rpf_failed) -ge $((failed + 3))
+test $(rx_packets $p1) -eq $rx
+
+# loose mode only requires a route to the source
+grcli set ip urpf iface $p0 loose
+grcli show ip urpf | grep -E "^$p0 +loose"
+failed=$(rpf_failed)
+rx=$(rx_packets $p1)
+ip netns exec $p0 ping -i0.01 -c3 -W1 -I 172.16.1.99 172.16.1.2 || true
+test $(rpf_failed) -eq $failed
+test $(rx_packets $p1) -ge $((rx + 3))
+
+grcli set ip urpf iface $p0 off
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
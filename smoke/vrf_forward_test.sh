@@ -9,6 +9,7 @@ p1=${run_id}1
 p2=${run_id}2
 p3=${run_id}3
 
+grcli add vrf 2 fib trie
 grcli add interface port $p0 devargs net_tap0,iface=$p0 vrf 1 mac f0:0d:ac:dc:01:00
 grcli add interface port $p1 devargs net_tap1,iface=$p1 vrf 1 mac f0:0d:ac:dc:01:01
 grcli add interface port $p2 devargs net_tap2,iface=$p2 vrf 2 mac f0:0d:ac:dc:02:00
@@ -30,6 +31,19 @@ for n in 0 1; do
 	ip -n $p addr show
 done
 ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+# rebuild the fib with a different configuration, routes must be preserved
+# 2 bytes next hop indexes cannot address the default 65536 next hops
+! grcli set vrf 1 nh_size 2
+grcli set vrf 1 nh_size 8 tbl8 256
+grcli show ip vrf
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+# move the routes back to the shared compact fib
+grcli set vrf 1 fib compact
+grcli show ip vrf | grep -qE '^1 +compact'
+ip netns exec $p0 ping -i0.01 -c3 172.16.1.2
+# changing one attribute must preserve the others
+grcli set vrf 2 nh_size 8
+grcli show ip vrf | grep -qE '^2 +trie +8 '
 
 for n in 2 3; do
 	p=$run_id$n